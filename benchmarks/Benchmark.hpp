@@ -0,0 +1,104 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Kuma3D {
+
+/**
+ * The result of a single benchmark run.
+ */
+struct BenchmarkResult
+{
+  std::string mName;
+
+  // The size of the data set the benchmark ran against (e.g. the number
+  // of Entities in the Scene).
+  std::size_t mSize { 0 };
+
+  // The number of operations that were timed.
+  std::size_t mOperations { 0 };
+
+  // The total time spent performing the timed operations.
+  double mTotalNanoseconds { 0 };
+};
+
+/**
+ * A simple stopwatch built on the steady clock.
+ */
+class BenchmarkTimer
+{
+  public:
+    BenchmarkTimer()
+      : mStart(std::chrono::steady_clock::now()) {}
+
+    /**
+     * Restarts the timer.
+     */
+    void Reset()
+    {
+      mStart = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Returns the time elapsed since the timer was created or last reset.
+     *
+     * @return The elapsed time in nanoseconds.
+     */
+    double GetElapsedNanoseconds() const
+    {
+      auto elapsed = std::chrono::steady_clock::now() - mStart;
+      return std::chrono::duration<double, std::nano>(elapsed).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point mStart;
+};
+
+/**
+ * Prevents the compiler from optimizing away a computed value.
+ *
+ * @param aValue The value to keep.
+ */
+template<typename T>
+inline void DoNotOptimize(const T& aValue)
+{
+  asm volatile("" : : "r,m"(aValue) : "memory");
+}
+
+/**
+ * Writes a list of benchmark results as JSON, so that results from
+ * different builds can be compared by a script.
+ *
+ * @param aStream The stream to write to.
+ * @param aSuite The name of the benchmark suite.
+ * @param aResults The results to write.
+ */
+inline void WriteBenchmarkResults(std::ostream& aStream,
+                                  const std::string& aSuite,
+                                  const std::vector<BenchmarkResult>& aResults)
+{
+  aStream << "{\n  \"suite\": \"" << aSuite << "\",\n  \"results\": [";
+
+  for(std::size_t i = 0; i < aResults.size(); ++i)
+  {
+    const auto& result = aResults[i];
+    auto perOperation = result.mOperations > 0 ? result.mTotalNanoseconds / result.mOperations : 0.0;
+
+    aStream << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << result.mName << "\", "
+            << "\"size\": " << result.mSize << ", "
+            << "\"operations\": " << result.mOperations << ", "
+            << "\"total_ns\": " << static_cast<unsigned long long>(result.mTotalNanoseconds) << ", "
+            << "\"ns_per_op\": " << perOperation << "}";
+  }
+
+  aStream << "\n  ]\n}\n";
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef ECSBENCHMARKS_HPP
+#define ECSBENCHMARKS_HPP
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <Scene.hpp>
+#include <System.hpp>
+
+#include "Benchmark.hpp"
+
+namespace Kuma3D {
+
+struct BenchComponentA
+{
+  int mValue { 1 };
+};
+
+struct BenchComponentB
+{
+  float mValues[4] { 0.0, 0.0, 0.0, 0.0 };
+};
+
+/**
+ * A System that reads the BenchComponentA of each eligible Entity.
+ */
+class BenchSystem : public System
+{
+  public:
+    void Initialize(Scene& aScene) override
+    {
+      auto signature = aScene.CreateSignature();
+      signature[aScene.GetComponentIndex<BenchComponentA>()] = true;
+      SetSignature(signature);
+    }
+
+    void Operate(Scene& aScene, double aTime) override
+    {
+      for(const auto& entity : GetEntities())
+      {
+        mSum += aScene.GetComponentForEntity<BenchComponentA>(entity).mValue;
+      }
+      DoNotOptimize(mSum);
+    }
+
+  private:
+    long long mSum { 0 };
+};
+
+/**
+ * Creates a Scene with both benchmark components registered, optionally
+ * adds a BenchSystem, and creates the given number of Entities with a
+ * BenchComponentA each.
+ *
+ * @param aSize The number of Entities to create.
+ * @param aAddSystem Whether to add a BenchSystem to the Scene.
+ * @param aEntities Filled with the created Entities.
+ * @return The new Scene.
+ */
+inline std::unique_ptr<Scene> CreateBenchScene(std::size_t aSize,
+                                               bool aAddSystem,
+                                               std::vector<Entity>& aEntities)
+{
+  auto scene = std::make_unique<Scene>();
+  scene->RegisterComponentType<BenchComponentA>(aSize);
+  scene->RegisterComponentType<BenchComponentB>(aSize);
+
+  if(aAddSystem)
+  {
+    scene->AddSystem(std::make_unique<BenchSystem>());
+  }
+
+  aEntities.clear();
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    auto entity = scene->CreateEntity();
+    scene->AddComponentToEntity<BenchComponentA>(entity);
+    aEntities.emplace_back(entity);
+  }
+  scene->OperateSystems(0);
+
+  return scene;
+}
+
+/**
+ * Returns an evenly spaced sample of the given Entities.
+ *
+ * @param aEntities The Entities to sample.
+ * @param aCount The maximum number of Entities in the sample.
+ * @return The sampled Entities.
+ */
+inline std::vector<Entity> SampleEntities(const std::vector<Entity>& aEntities,
+                                          std::size_t aCount)
+{
+  std::vector<Entity> sample;
+
+  auto count = std::min(aCount, aEntities.size());
+  for(std::size_t i = 0; i < count; ++i)
+  {
+    sample.emplace_back(aEntities[(i * aEntities.size()) / count]);
+  }
+
+  return sample;
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkCreateEntities(std::size_t aSize)
+{
+  Scene scene;
+  scene.RegisterComponentType<BenchComponentA>(aSize);
+
+  // Entities aren't fully created until the Scene is updated, so include
+  // the update in the measurement.
+  BenchmarkTimer timer;
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    scene.CreateEntity();
+  }
+  scene.OperateSystems(0);
+
+  return { "CreateEntity", aSize, aSize, timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkDestroyEntities(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, false, entities);
+  auto sample = SampleEntities(entities, 1000);
+
+  BenchmarkTimer timer;
+  for(const auto& entity : sample)
+  {
+    scene->RemoveEntity(entity);
+  }
+  scene->OperateSystems(0);
+
+  return { "DestroyEntity", aSize, sample.size(), timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkAddComponent(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, false, entities);
+
+  BenchmarkTimer timer;
+  for(const auto& entity : entities)
+  {
+    scene->AddComponentToEntity<BenchComponentB>(entity);
+  }
+  scene->OperateSystems(0);
+
+  return { "AddComponent", aSize, aSize, timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkRemoveComponent(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, false, entities);
+  auto sample = SampleEntities(entities, 100);
+
+  BenchmarkTimer timer;
+  for(const auto& entity : sample)
+  {
+    scene->RemoveComponentFromEntity<BenchComponentA>(entity);
+  }
+  scene->OperateSystems(0);
+
+  return { "RemoveComponent", aSize, sample.size(), timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkGetComponent(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, false, entities);
+
+  // Access the components in a scrambled (but deterministic) order to
+  // avoid measuring only the best case.
+  std::vector<Entity> order(entities);
+  unsigned int state = 12345;
+  for(std::size_t i = order.size(); i > 1; --i)
+  {
+    state = state * 1664525 + 1013904223;
+    std::swap(order[i - 1], order[state % i]);
+  }
+
+  long long sum = 0;
+  BenchmarkTimer timer;
+  for(const auto& entity : order)
+  {
+    sum += scene->GetComponentForEntity<BenchComponentA>(entity).mValue;
+  }
+  auto elapsed = timer.GetElapsedNanoseconds();
+  DoNotOptimize(sum);
+
+  return { "GetComponent", aSize, aSize, elapsed };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkSignatureChangeDispatch(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, true, entities);
+  auto sample = SampleEntities(entities, 1000);
+
+  // Adding a component changes each Signature, which notifies every System
+  // when the Scene is updated.
+  for(const auto& entity : sample)
+  {
+    scene->AddComponentToEntity<BenchComponentB>(entity);
+  }
+
+  BenchmarkTimer timer;
+  scene->OperateSystems(0);
+
+  return { "SignatureChangeDispatch", aSize, sample.size(), timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkSystemIteration(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, true, entities);
+
+  const std::size_t repetitions = 10;
+  BenchmarkTimer timer;
+  for(std::size_t i = 0; i < repetitions; ++i)
+  {
+    scene->OperateSystems(0);
+  }
+
+  return { "SystemIteration", aSize, aSize * repetitions, timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkGetEntitiesWithSignature(std::size_t aSize)
+{
+  std::vector<Entity> entities;
+  auto scene = CreateBenchScene(aSize, false, entities);
+
+  // Give half of the Entities a second component to query for.
+  for(std::size_t i = 0; i < entities.size(); i += 2)
+  {
+    scene->AddComponentToEntity<BenchComponentB>(entities[i]);
+  }
+  scene->OperateSystems(0);
+
+  auto signature = scene->CreateSignature();
+  signature[scene->GetComponentIndex<BenchComponentA>()] = true;
+  signature[scene->GetComponentIndex<BenchComponentB>()] = true;
+
+  const std::size_t repetitions = 10;
+  std::size_t found = 0;
+  BenchmarkTimer timer;
+  for(std::size_t i = 0; i < repetitions; ++i)
+  {
+    found += scene->GetEntitiesWithSignature(signature).size();
+  }
+  auto elapsed = timer.GetElapsedNanoseconds();
+  DoNotOptimize(found);
+
+  return { "GetEntitiesWithSignature", aSize, repetitions, elapsed };
+}
+
+} // namespace Kuma3D
+
+#endif
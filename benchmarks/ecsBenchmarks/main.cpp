@@ -0,0 +1,68 @@
+#include "EcsBenchmarks.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+/**
+ * Usage: ecsBenchmark [output file] [maximum Entity count]
+ *
+ * Results are written as JSON to the output file, or to stdout if no
+ * file is given. Progress is reported on stderr.
+ */
+int main(int argc, char* argv[])
+{
+  std::size_t maxSize = 1000000;
+  if(argc >= 3)
+  {
+    maxSize = std::strtoul(argv[2], nullptr, 10);
+  }
+
+  // Populating a System currently costs O(n^2) (each newly eligible Entity
+  // is searched for in the System's list), so benchmarks that require a
+  // System are capped to keep the suite's run time reasonable.
+  const std::size_t maxSystemSize = 100000;
+
+  using Benchmark = std::function<Kuma3D::BenchmarkResult(std::size_t)>;
+  std::vector<std::pair<Benchmark, bool>> benchmarks =
+  {
+    { Kuma3D::BenchmarkCreateEntities, false },
+    { Kuma3D::BenchmarkDestroyEntities, false },
+    { Kuma3D::BenchmarkAddComponent, false },
+    { Kuma3D::BenchmarkRemoveComponent, false },
+    { Kuma3D::BenchmarkGetComponent, false },
+    { Kuma3D::BenchmarkSignatureChangeDispatch, true },
+    { Kuma3D::BenchmarkSystemIteration, true },
+    { Kuma3D::BenchmarkGetEntitiesWithSignature, false }
+  };
+
+  std::vector<Kuma3D::BenchmarkResult> results;
+  for(std::size_t size = 1000; size <= maxSize; size *= 10)
+  {
+    for(const auto& benchmark : benchmarks)
+    {
+      if(benchmark.second && size > maxSystemSize)
+      {
+        continue;
+      }
+
+      results.emplace_back(benchmark.first(size));
+      std::cerr << results.back().mName << " (" << size << "): "
+                << results.back().mTotalNanoseconds / results.back().mOperations
+                << " ns/op" << std::endl;
+    }
+  }
+
+  if(argc >= 2)
+  {
+    std::ofstream output(argv[1]);
+    Kuma3D::WriteBenchmarkResults(output, "ecs", results);
+  }
+  else
+  {
+    Kuma3D::WriteBenchmarkResults(std::cout, "ecs", results);
+  }
+
+  return 0;
+}
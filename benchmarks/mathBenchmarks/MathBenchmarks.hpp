@@ -0,0 +1,410 @@
+#ifndef MATHBENCHMARKS_HPP
+#define MATHBENCHMARKS_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Camera.hpp>
+
+#include <Mat4.hpp>
+#include <MathUtil.hpp>
+#include <Quat.hpp>
+#include <Simd.hpp>
+#include <TransformStreams.hpp>
+#include <Vec3.hpp>
+#include <Vec4.hpp>
+
+#include "Benchmark.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Returns the name of the instruction set the math routines were compiled
+ * for. Configure with FORCE_SCALAR_MATH to benchmark the scalar routines.
+ *
+ * @return The name of the math backend.
+ */
+inline std::string GetMathBackendName()
+{
+#if defined(KUMA3D_SIMD_SSE)
+  return "sse2";
+#elif defined(KUMA3D_SIMD_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
+
+/**
+ * A small random number generator, so that every build benchmarks the same
+ * inputs.
+ */
+class BenchmarkRandom
+{
+  public:
+
+    /**
+     * Returns a random number in the given range.
+     *
+     * @param aMin The smallest number to return.
+     * @param aMax The largest number to return.
+     * @return A random number.
+     */
+    float Next(float aMin, float aMax)
+    {
+      mState = mState * 1664525 + 1013904223;
+      return aMin + (aMax - aMin) * ((mState >> 8) / 16777216.0f);
+    }
+
+    Vec3 NextVec3()
+    {
+      auto x = Next(-10.0, 10.0);
+      auto y = Next(-10.0, 10.0);
+      auto z = Next(-10.0, 10.0);
+      return Vec3(x, y, z);
+    }
+
+    Quat NextQuat()
+    {
+      auto x = Next(-1.0, 1.0);
+      auto y = Next(-1.0, 1.0);
+      auto z = Next(-1.0, 1.0);
+      auto w = Next(-1.0, 1.0);
+      return Normalize(Quat(x, y, z, w));
+    }
+
+    Mat4 NextMat4()
+    {
+      auto position = NextVec3();
+      auto rotation = NextQuat();
+      auto scale = Vec3(Next(0.5, 2.0), Next(0.5, 2.0), Next(0.5, 2.0));
+      return ComposeMatrix(position, rotation, scale);
+    }
+
+  private:
+    unsigned int mState { 12345 };
+};
+
+/**
+ * Runs an operation over a data set enough times to get a stable
+ * measurement; small data sets are repeated more often.
+ *
+ * @param aName The name of the benchmark.
+ * @param aSize The number of operations performed by each call.
+ * @param aFunction Performs the operations once.
+ * @return The result of the benchmark.
+ */
+template<typename T>
+inline BenchmarkResult RunMathBenchmark(const std::string& aName,
+                                        std::size_t aSize,
+                                        T aFunction)
+{
+  auto repetitions = std::max<std::size_t>(1, 10000000 / aSize);
+
+  // Run once beforehand, so that the data is in the cache for small sizes.
+  aFunction();
+
+  BenchmarkTimer timer;
+  for(std::size_t i = 0; i < repetitions; ++i)
+  {
+    aFunction();
+  }
+
+  return { aName, aSize, aSize * repetitions, timer.GetElapsedNanoseconds() };
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkMat4Multiply(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Mat4> lhs, rhs, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    lhs.emplace_back(random.NextMat4());
+    rhs.emplace_back(random.NextMat4());
+  }
+
+  return RunMathBenchmark("Mat4Multiply", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = lhs[i] * rhs[i];
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkMat4TransformVec3(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Mat4> matrices;
+  std::vector<Vec3> vectors, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    matrices.emplace_back(random.NextMat4());
+    vectors.emplace_back(random.NextVec3());
+  }
+
+  return RunMathBenchmark("Mat4TransformVec3", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = matrices[i] * vectors[i];
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkMat4TransformVec4(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Mat4> matrices;
+  std::vector<Vec4> vectors, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    matrices.emplace_back(random.NextMat4());
+    vectors.emplace_back(random.NextVec3(), 1.0);
+  }
+
+  return RunMathBenchmark("Mat4TransformVec4", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = matrices[i] * vectors[i];
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkMat4Inverse(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Mat4> matrices, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    matrices.emplace_back(random.NextMat4());
+  }
+
+  return RunMathBenchmark("Mat4Inverse", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Inverse(matrices[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkNormalize(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Vec3> vectors, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    vectors.emplace_back(random.NextVec3());
+  }
+
+  return RunMathBenchmark("Normalize", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Normalize(vectors[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkCross(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Vec3> lhs, rhs, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    lhs.emplace_back(random.NextVec3());
+    rhs.emplace_back(random.NextVec3());
+  }
+
+  return RunMathBenchmark("Cross", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Cross(lhs[i], rhs[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkRotate(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Vec3> axes;
+  std::vector<float> angles;
+  std::vector<Mat4> results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    axes.emplace_back(Normalize(random.NextVec3()));
+    angles.emplace_back(random.Next(-180.0, 180.0));
+  }
+
+  return RunMathBenchmark("Rotate", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Rotate(axes[i], angles[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkPerspective(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Camera> cameras(aSize);
+  std::vector<Mat4> results(aSize);
+  for(auto& camera : cameras)
+  {
+    camera.mFOV = random.Next(30.0, 90.0);
+    camera.mNearPlane = random.Next(0.01, 1.0);
+    camera.mFarPlane = random.Next(100.0, 1000.0);
+  }
+
+  return RunMathBenchmark("Perspective", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Perspective(cameras[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkQuatMultiply(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Quat> lhs, rhs, results(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    lhs.emplace_back(random.NextQuat());
+    rhs.emplace_back(random.NextQuat());
+  }
+
+  return RunMathBenchmark("QuatMultiply", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = lhs[i] * rhs[i];
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkSlerp(std::size_t aSize)
+{
+  BenchmarkRandom random;
+  std::vector<Quat> starts, targets, results(aSize);
+  std::vector<float> percents;
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    starts.emplace_back(random.NextQuat());
+    targets.emplace_back(random.NextQuat());
+    percents.emplace_back(random.Next(0.0, 1.0));
+  }
+
+  return RunMathBenchmark("Slerp", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      results[i] = Slerp(starts[i], targets[i], percents[i]);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/**
+ * Fills a set of streams with random transformations.
+ *
+ * @param aSize The number of transformations.
+ * @param aStreams The streams to fill.
+ */
+inline void CreateBenchStreams(std::size_t aSize, TransformStreams& aStreams)
+{
+  BenchmarkRandom random;
+  aStreams.Resize(aSize);
+  for(std::size_t i = 0; i < aSize; ++i)
+  {
+    auto position = random.NextVec3();
+    auto rotation = random.NextQuat();
+    auto scale = Vec3(random.Next(0.5, 2.0), random.Next(0.5, 2.0), random.Next(0.5, 2.0));
+    aStreams.Set(i, position, rotation, scale);
+  }
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkTranslateRotateScale(std::size_t aSize)
+{
+  TransformStreams streams;
+  CreateBenchStreams(aSize, streams);
+  std::vector<Mat4> results(aSize);
+
+  // Build each matrix by multiplying its parts together, for comparison
+  // with ComposeMatrix().
+  return RunMathBenchmark("TranslateRotateScale", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      Vec3 position(streams.mPositionX[i], streams.mPositionY[i], streams.mPositionZ[i]);
+      Quat rotation(streams.mRotationX[i], streams.mRotationY[i], streams.mRotationZ[i], streams.mRotationW[i]);
+      Vec3 scale(streams.mScaleX[i], streams.mScaleY[i], streams.mScaleZ[i]);
+      results[i] = Translate(position) * ToMatrix(rotation) * Scale(scale);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkComposeMatrix(std::size_t aSize)
+{
+  TransformStreams streams;
+  CreateBenchStreams(aSize, streams);
+  std::vector<Mat4> results(aSize);
+
+  return RunMathBenchmark("ComposeMatrix", aSize, [&]()
+  {
+    for(std::size_t i = 0; i < aSize; ++i)
+    {
+      Vec3 position(streams.mPositionX[i], streams.mPositionY[i], streams.mPositionZ[i]);
+      Quat rotation(streams.mRotationX[i], streams.mRotationY[i], streams.mRotationZ[i], streams.mRotationW[i]);
+      Vec3 scale(streams.mScaleX[i], streams.mScaleY[i], streams.mScaleZ[i]);
+      results[i] = ComposeMatrix(position, rotation, scale);
+    }
+    DoNotOptimize(results.back());
+  });
+}
+
+/******************************************************************************/
+inline BenchmarkResult BenchmarkComposeMatrices(std::size_t aSize)
+{
+  TransformStreams streams;
+  CreateBenchStreams(aSize, streams);
+  std::vector<Mat4> results(aSize);
+
+  return RunMathBenchmark("ComposeMatrices", aSize, [&]()
+  {
+    ComposeMatrices(streams, results.data());
+    DoNotOptimize(results.back());
+  });
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,68 @@
+#include "MathBenchmarks.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+/**
+ * Usage: mathBenchmark [output file] [maximum data set size]
+ *
+ * Results are written as JSON to the output file, or to stdout if no
+ * file is given. Progress is reported on stderr. The suite is named after
+ * the math backend (e.g. "math-sse2"); build with FORCE_SCALAR_MATH to
+ * produce results for the scalar routines.
+ */
+int main(int argc, char* argv[])
+{
+  std::size_t maxSize = 100000;
+  if(argc >= 3)
+  {
+    maxSize = std::strtoul(argv[2], nullptr, 10);
+  }
+
+  using Benchmark = std::function<Kuma3D::BenchmarkResult(std::size_t)>;
+  std::vector<Benchmark> benchmarks =
+  {
+    Kuma3D::BenchmarkMat4Multiply,
+    Kuma3D::BenchmarkMat4TransformVec3,
+    Kuma3D::BenchmarkMat4TransformVec4,
+    Kuma3D::BenchmarkMat4Inverse,
+    Kuma3D::BenchmarkNormalize,
+    Kuma3D::BenchmarkCross,
+    Kuma3D::BenchmarkRotate,
+    Kuma3D::BenchmarkPerspective,
+    Kuma3D::BenchmarkQuatMultiply,
+    Kuma3D::BenchmarkSlerp,
+    Kuma3D::BenchmarkTranslateRotateScale,
+    Kuma3D::BenchmarkComposeMatrix,
+    Kuma3D::BenchmarkComposeMatrices
+  };
+
+  // The smaller data sets fit in the cache; the larger ones show the cost
+  // of streaming through memory.
+  std::vector<Kuma3D::BenchmarkResult> results;
+  for(std::size_t size = 1000; size <= maxSize; size *= 100)
+  {
+    for(const auto& benchmark : benchmarks)
+    {
+      results.emplace_back(benchmark(size));
+      std::cerr << results.back().mName << " (" << size << "): "
+                << results.back().mTotalNanoseconds / results.back().mOperations
+                << " ns/op" << std::endl;
+    }
+  }
+
+  auto suite = "math-" + Kuma3D::GetMathBackendName();
+  if(argc >= 2)
+  {
+    std::ofstream output(argv[1]);
+    Kuma3D::WriteBenchmarkResults(output, suite, results);
+  }
+  else
+  {
+    Kuma3D::WriteBenchmarkResults(std::cout, suite, results);
+  }
+
+  return 0;
+}
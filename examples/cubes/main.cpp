@@ -5,18 +5,18 @@
 #include <Game.hpp>
 #include <Scene.hpp>
 
+#include <PhysicsSystem.hpp>
 #include <RenderSystem.hpp>
 
+#include <MeshLoader.hpp>
 #include <ShaderLoader.hpp>
 #include <TextureLoader.hpp>
 
 #include <Camera.hpp>
 #include <Mesh.hpp>
+#include <RigidBody.hpp>
 #include <Transform.hpp>
 
-#include "Physics.hpp"
-#include "PhysicsSystem.hpp"
-
 /******************************************************************************/
 Kuma3D::Mesh CreateCubeMesh()
 {
@@ -173,22 +173,25 @@ Kuma3D::Mesh CreateCubeMesh()
   mesh.mIndices.emplace_back(22);
   mesh.mIndices.emplace_back(23);
 
-  mesh.mDirty = true;
+  // Store the geometry in the MeshLoader so that each cube can share it.
+  mesh.mGeometry = Kuma3D::MeshLoader::LoadMesh(std::move(mesh.mVertices),
+                                                std::move(mesh.mIndices));
+  mesh.mVertices.clear();
+  mesh.mIndices.clear();
 
   return mesh;
 }
 
 /******************************************************************************/
-Kuma3D::Transform CreateRandomTransform(std::random_device& aDevice)
+Kuma3D::Transform CreateRandomTransform(std::mt19937& aGenerator)
 {
   Kuma3D::Transform transform;
 
-  std::mt19937 generator(aDevice());
   std::uniform_real_distribution<> dist(-50, 50);
 
-  transform.mPosition.x = dist(generator);
-  transform.mPosition.y = dist(generator);
-  transform.mPosition.z = dist(generator) - 70;
+  transform.mPosition.x = dist(aGenerator);
+  transform.mPosition.y = dist(aGenerator);
+  transform.mPosition.z = dist(aGenerator) - 70;
 
   return transform;
 }
@@ -210,7 +213,9 @@ int main(int argc, char* argv[])
   // Create a scene, a camera, and a bunch of cubes.
   auto scene = std::make_unique<Kuma3D::Scene>();
 
-  int numCubes = 5000;
+  // The number of cubes can be given as the first argument; by default,
+  // there are enough to show the PhysicsSystem and instancing at scale.
+  int numCubes = 100000;
   if(argc >= 2)
   {
     numCubes = std::atoi(argv[1]);
@@ -218,32 +223,35 @@ int main(int argc, char* argv[])
   scene->RegisterComponentType<Kuma3D::Camera>(1);
   scene->RegisterComponentType<Kuma3D::Transform>(numCubes + 1);
   scene->RegisterComponentType<Kuma3D::Mesh>(numCubes);
-  scene->RegisterComponentType<Cubes::Physics>(numCubes);
+  scene->RegisterComponentType<Kuma3D::RigidBody>(numCubes);
 
   auto camera = scene->CreateEntity();
   scene->AddComponentToEntity<Kuma3D::Camera>(camera);
   scene->AddComponentToEntity<Kuma3D::Transform>(camera);
 
+  auto cubeMesh = CreateCubeMesh();
+  cubeMesh.mShaders.emplace_back(shaderID);
+  cubeMesh.mTextures.emplace_back(textureID);
+
   std::random_device rd;
+  std::mt19937 generator(rd());
   for(int i = 0; i < numCubes; ++i)
   {
     auto cube = scene->CreateEntity();
 
-    auto transform = CreateRandomTransform(rd);
+    auto transform = CreateRandomTransform(generator);
     scene->AddComponentToEntity<Kuma3D::Transform>(cube, transform);
 
-    auto mesh = CreateCubeMesh();
-    mesh.mShaders.emplace_back(shaderID);
-    mesh.mTextures.emplace_back(textureID);
+    auto mesh = cubeMesh;
     scene->AddComponentToEntity<Kuma3D::Mesh>(cube, mesh);
 
-    Cubes::Physics physics;
-    physics.mAcceleration.y = -9.81;
-    scene->AddComponentToEntity<Cubes::Physics>(cube, physics);
+    Kuma3D::RigidBody body;
+    body.mAcceleration.y = -9.81;
+    scene->AddComponentToEntity<Kuma3D::RigidBody>(cube, body);
   }
 
   // Add a PhysicsSystem to move the cubes, and a RenderSystem to draw them.
-  scene->AddSystem(std::make_unique<Cubes::PhysicsSystem>());
+  scene->AddSystem(std::make_unique<Kuma3D::PhysicsSystem>());
   scene->AddSystem(std::make_unique<Kuma3D::RenderSystem>());
 
   // Set the scene and run the game.
@@ -253,6 +261,7 @@ int main(int argc, char* argv[])
   // Unload all resources.
   Kuma3D::ShaderLoader::UnloadShaders();
   Kuma3D::TextureLoader::UnloadTextures();
+  Kuma3D::MeshLoader::UnloadMeshes();
   Kuma3D::Game::Uninitialize();
 
   return 0;
@@ -2,16 +2,19 @@
 
 layout (location = 0) in vec3 aPosition;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 instanceMatrix;
 
 out vec2 texCoords;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+layout (std140) uniform CameraBlock
+{
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+};
 
 void main()
 {
   texCoords = aTexCoords;
 
-  gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPosition, 1.0);
+  gl_Position = projectionMatrix * viewMatrix * instanceMatrix * vec4(aPosition, 1.0);
 }
@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <sstream>
 
+#include "Profiler.hpp"
+
 namespace Kuma3D {
 
 /******************************************************************************/
@@ -18,6 +20,8 @@ bool AudioLoader::mInitialized = false;
 /******************************************************************************/
 ID AudioLoader::LoadAudioFromFile(const std::string& aFilePath)
 {
+  KUMA3D_PROFILE_SCOPE("AudioLoader::LoadAudioFromFile");
+
   ID audioID = 0;
 
   // Initialize the Miniaudio library if it isn't already.
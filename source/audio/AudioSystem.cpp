@@ -2,6 +2,7 @@
 
 #include <miniaudio/miniaudio.h>
 
+#include "Metrics.hpp"
 #include "Scene.hpp"
 
 #include "Audio.hpp"
@@ -27,6 +28,9 @@ void AudioSystem::Initialize(Scene& aScene)
 /******************************************************************************/
 void AudioSystem::Operate(Scene& aScene, double aTime)
 {
+  static auto& soundsPlaying = Metrics::GetGauge("Audio.SoundsPlaying");
+  std::size_t playing = 0;
+
   for(const auto& entity : GetEntities())
   {
     auto& audio = aScene.GetComponentForEntity<Audio>(entity);
@@ -41,6 +45,11 @@ void AudioSystem::Operate(Scene& aScene, double aTime)
       ma_sound_start(&sound);
     }
 
+    if(ma_sound_is_playing(&sound))
+    {
+      ++playing;
+    }
+
     // If the sound is at the end, and it isn't set to loop, remove it
     // from this Entity.
     if(ma_sound_at_end(&sound) && !audio.mLooping)
@@ -49,6 +58,8 @@ void AudioSystem::Operate(Scene& aScene, double aTime)
       AudioLoader::RemoveSound(audio.mSoundID);
     }
   }
+
+  soundsPlaying.Set(playing);
 }
 
 } // namespace Kuma3D
@@ -0,0 +1,21 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include "Geometry.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The space an Entity occupies, for spatial queries (see SpatialSystem).
+ *
+ * The box is in the Entity's local space; it's moved, rotated and scaled
+ * along with the Entity's Transform.
+ */
+struct Bounds
+{
+  AABB mBox;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -12,6 +12,9 @@ struct Camera
   float mFOV { 45.0 };
   float mNearPlane { 0.1 };
   float mFarPlane { 1000.0 };
+
+  // Whether Meshes hidden behind occluders are culled (see Mesh).
+  bool mUseOcclusionCulling { false };
 };
 
 } // namespace Kuma3D
@@ -0,0 +1,43 @@
+#ifndef COLLIDER_HPP
+#define COLLIDER_HPP
+
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The shapes a Collider can take.
+ */
+enum class ColliderType
+{
+  // A sphere, scaled by the largest of the Transform's scales.
+  eSPHERE,
+
+  // A box that stays lined up with the world's axes, growing to fit its
+  // rotated corners when the Transform rotates.
+  eBOX,
+
+  // A box that rotates along with the Transform.
+  eORIENTED_BOX
+};
+
+/**
+ * The shape an Entity occupies for collision detection (see
+ * CollisionSystem).
+ *
+ * The shape is in the Entity's local space; it's moved, rotated and scaled
+ * along with the Entity's Transform. Spheres use mCenter and mRadius, and
+ * boxes use mCenter and mHalfExtents.
+ */
+struct Collider
+{
+  ColliderType mType { ColliderType::eBOX };
+
+  Vec3 mCenter;
+  Vec3 mHalfExtents { 0.5, 0.5, 0.5 };
+  float mRadius { 0.5 };
+};
+
+} // namespace Kuma3D
+
+#endif
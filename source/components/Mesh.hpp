@@ -5,6 +5,7 @@
 
 #include "Vec3.hpp"
 #include "IDGenerator.hpp"
+#include "MeshHandle.hpp"
 
 namespace Kuma3D {
 
@@ -33,6 +34,20 @@ enum class CoordinateSystem
   eSCREEN_SPACE
 };
 
+/**
+ * An enumeration for how often a Mesh's geometry is expected to change.
+ *
+ * Static geometry is stored in OpenGL buffers until it changes; changes
+ * that don't increase its size are written in place. Dynamic geometry is
+ * streamed to OpenGL every frame it's drawn, which suits geometry that
+ * changes often (such as animated sprites and text).
+ */
+enum class MeshUsage
+{
+  eSTATIC,
+  eDYNAMIC
+};
+
 /**
  * A struct that contains all data needed to render a vertex.
  *
@@ -51,11 +66,26 @@ struct MeshVertex
 
 /**
  * The actual Mesh component data.
+ *
+ * The geometry can either be stored on the Mesh itself (in mVertices and
+ * mIndices), or shared with other Meshes through a handle from the
+ * MeshLoader. If mGeometry is set, mVertices and mIndices are ignored.
+ *
+ * After editing mVertices or mIndices, set mDirty. The RenderSystem clears
+ * it once it has picked up the change, and increments mRevision, so that
+ * other Systems can tell when the geometry has changed.
+ *
+ * Triangle Meshes marked as occluders hide the Meshes behind them from
+ * Cameras that use occlusion culling. Large, simple, solid Meshes (such as
+ * walls and floors) make the best occluders.
  */
 struct Mesh
 {
   RenderMode mRenderMode   { RenderMode::eTRIANGLES };
   CoordinateSystem mSystem { CoordinateSystem::eWORLD_SPACE };
+  MeshUsage mUsage         { MeshUsage::eSTATIC };
+
+  MeshHandle mGeometry;
 
   std::vector<MeshVertex> mVertices;
   std::vector<unsigned int> mIndices;
@@ -65,7 +95,9 @@ struct Mesh
   bool mUseDepthTesting { true };
 
   bool mHasTransparency { false };
+  bool mOccluder { false };
   bool mDirty { false };
+  unsigned int mRevision { 0 };
 };
 
 } // namespace Kuma3D
@@ -0,0 +1,67 @@
+#ifndef MESHHANDLE_HPP
+#define MESHHANDLE_HPP
+
+#include "IDGenerator.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A reference-counted reference to geometry owned by the MeshLoader.
+ * Copying a handle adds a reference, and destroying one removes it; once
+ * the last handle to some geometry is destroyed, the MeshLoader frees the
+ * geometry along with its OpenGL buffers.
+ *
+ * The member functions are implemented in MeshLoader.cpp.
+ */
+class MeshHandle
+{
+  public:
+    MeshHandle() = default;
+    ~MeshHandle();
+
+    MeshHandle(const MeshHandle& aOther);
+    MeshHandle(MeshHandle&& aOther) noexcept;
+
+    MeshHandle& operator=(const MeshHandle& aOther);
+    MeshHandle& operator=(MeshHandle&& aOther) noexcept;
+
+    /**
+     * Releases this handle's reference, leaving it empty.
+     */
+    void Reset();
+
+    /**
+     * Returns whether this handle refers to any geometry.
+     *
+     * @return True if the handle refers to geometry, false otherwise.
+     */
+    bool IsValid() const { return mID != 0; }
+
+    /**
+     * Returns the ID of the geometry this handle refers to, or 0 if the
+     * handle is empty.
+     *
+     * @return The ID of the geometry.
+     */
+    ID GetID() const { return mID; }
+
+    bool operator==(const MeshHandle& aOther) const { return mID == aOther.mID; }
+    bool operator!=(const MeshHandle& aOther) const { return mID != aOther.mID; }
+
+  private:
+    friend class MeshLoader;
+
+    /**
+     * Constructor used by the MeshLoader; adds a reference to the
+     * geometry with the given ID.
+     *
+     * @param aID The ID of the geometry to refer to.
+     */
+    explicit MeshHandle(ID aID);
+
+    ID mID { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
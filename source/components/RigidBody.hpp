@@ -0,0 +1,36 @@
+#ifndef RIGIDBODY_HPP
+#define RIGIDBODY_HPP
+
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A body that moves under its own velocity and acceleration (see
+ * PhysicsSystem).
+ *
+ * The PhysicsSystem keeps its own copy of each body's state, and writes the
+ * body's velocity (and its Transform's position) back to the component
+ * after each frame. Changes made to an awake body's component (or its
+ * Transform) afterwards take effect on the next frame; changes made to a
+ * sleeping body only take effect once PhysicsSystem::WakeBody() is called
+ * for the Entity.
+ */
+struct RigidBody
+{
+  Vec3 mVelocity;
+  Vec3 mAcceleration;
+
+  // The fraction of the body's velocity lost each second, roughly; 0 for
+  // no damping.
+  float mLinearDamping { 0.0 };
+
+  // Whether the body falls asleep once it has moved slowly for a while
+  // without accelerating. Sleeping bodies aren't moved until they're woken.
+  bool mCanSleep { true };
+  bool mSleeping { false };
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -3,15 +3,23 @@
 
 #include "Entity.hpp"
 
-#include "Mat4.hpp"
+#include "Quat.hpp"
 #include "Vec3.hpp"
 
 namespace Kuma3D {
 
+/**
+ * The position, rotation and scale of an Entity.
+ *
+ * The rotation is stored as a Quat rather than a matrix. Multiplying it
+ * with a Vec3 rotates the vector, as multiplying a rotation matrix did;
+ * code that needs a matrix can use ToMatrix(mRotation), and code that
+ * builds a rotation matrix can store it with ToQuat() (see MathUtil.hpp).
+ */
 struct Transform
 {
   Vec3 mPosition;
-  Mat4 mRotation;
+  Quat mRotation;
   Vec3 mScalar { 1.0, 1.0, 1.0 };
 
   Entity mParent;
@@ -0,0 +1,203 @@
+#include "AllocationTracker.hpp"
+
+#include <atomic>
+
+#ifdef KUMA3D_TRACK_ALLOCATIONS
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace Kuma3D {
+
+// These are constant-initialized, so they're safe to use from allocations
+// made before any other static initialization has occurred.
+std::atomic<std::uint64_t> AllocationCount { 0 };
+std::atomic<std::uint64_t> AllocatedBytes { 0 };
+
+/******************************************************************************/
+bool AllocationTracker::IsEnabled()
+{
+#ifdef KUMA3D_TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/******************************************************************************/
+std::uint64_t AllocationTracker::GetAllocationCount()
+{
+  return AllocationCount.load(std::memory_order_relaxed);
+}
+
+/******************************************************************************/
+std::uint64_t AllocationTracker::GetAllocatedBytes()
+{
+  return AllocatedBytes.load(std::memory_order_relaxed);
+}
+
+} // namespace Kuma3D
+
+#ifdef KUMA3D_TRACK_ALLOCATIONS
+
+/******************************************************************************/
+void* TrackedAllocate(std::size_t aSize)
+{
+  Kuma3D::AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  Kuma3D::AllocatedBytes.fetch_add(aSize, std::memory_order_relaxed);
+
+  // malloc(0) may return nullptr, but operator new must not.
+  return std::malloc(aSize == 0 ? 1 : aSize);
+}
+
+/******************************************************************************/
+void* TrackedAllocate(std::size_t aSize, std::align_val_t aAlignment)
+{
+  Kuma3D::AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  Kuma3D::AllocatedBytes.fetch_add(aSize, std::memory_order_relaxed);
+
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  auto alignment = static_cast<std::size_t>(aAlignment);
+  auto size = std::max<std::size_t>(aSize, 1);
+  size = (size + alignment - 1) / alignment * alignment;
+  return std::aligned_alloc(alignment, size);
+}
+
+/******************************************************************************/
+void* operator new(std::size_t aSize)
+{
+  auto memory = TrackedAllocate(aSize);
+  if(memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+/******************************************************************************/
+void* operator new[](std::size_t aSize)
+{
+  return operator new(aSize);
+}
+
+/******************************************************************************/
+void* operator new(std::size_t aSize, const std::nothrow_t&) noexcept
+{
+  return TrackedAllocate(aSize);
+}
+
+/******************************************************************************/
+void* operator new[](std::size_t aSize, const std::nothrow_t&) noexcept
+{
+  return TrackedAllocate(aSize);
+}
+
+/******************************************************************************/
+void* operator new(std::size_t aSize, std::align_val_t aAlignment)
+{
+  auto memory = TrackedAllocate(aSize, aAlignment);
+  if(memory == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  return memory;
+}
+
+/******************************************************************************/
+void* operator new[](std::size_t aSize, std::align_val_t aAlignment)
+{
+  return operator new(aSize, aAlignment);
+}
+
+/******************************************************************************/
+void* operator new(std::size_t aSize,
+                   std::align_val_t aAlignment,
+                   const std::nothrow_t&) noexcept
+{
+  return TrackedAllocate(aSize, aAlignment);
+}
+
+/******************************************************************************/
+void* operator new[](std::size_t aSize,
+                     std::align_val_t aAlignment,
+                     const std::nothrow_t&) noexcept
+{
+  return TrackedAllocate(aSize, aAlignment);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory, std::size_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory, std::size_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory, const std::nothrow_t&) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory, const std::nothrow_t&) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory, std::align_val_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory, std::align_val_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory, std::size_t, std::align_val_t) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete(void* aMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  std::free(aMemory);
+}
+
+/******************************************************************************/
+void operator delete[](void* aMemory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  std::free(aMemory);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef ALLOCATIONTRACKER_HPP
+#define ALLOCATIONTRACKER_HPP
+
+#include <cstdint>
+
+namespace Kuma3D {
+
+/**
+ * A static class that reports how many heap allocations have been made by
+ * the process. Allocations are only counted when the engine is built with
+ * the TRACK_ALLOCATIONS CMake option, which replaces the global operator
+ * new and operator delete (including their aligned forms); otherwise each
+ * count is always zero.
+ */
+class AllocationTracker
+{
+  public:
+
+    /**
+     * Returns whether allocation tracking was compiled into the engine.
+     *
+     * @return True if allocations are being counted, false otherwise.
+     */
+    static bool IsEnabled();
+
+    /**
+     * Returns the total number of allocations made since the program started.
+     *
+     * @return The number of allocations.
+     */
+    static std::uint64_t GetAllocationCount();
+
+    /**
+     * Returns the total number of bytes allocated since the program started.
+     *
+     * @return The number of bytes allocated.
+     */
+    static std::uint64_t GetAllocatedBytes();
+};
+
+} // namespace Kuma3D
+
+#endif
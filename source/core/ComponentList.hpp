@@ -30,6 +30,13 @@ class ComponentList
      * @param aEntity The Entity to remove a component from.
      */
     virtual void RemoveComponentFromEntity(Entity aEntity) = 0;
+
+    /**
+     * Returns the number of components currently in the list.
+     *
+     * @return The number of components.
+     */
+    virtual std::size_t GetNumComponents() const = 0;
 };
 
 /**
@@ -89,6 +96,10 @@ class ComponentListT : public ComponentList
       auto lastValidIndex = mNumValidComponents - 1;
       mComponents[removedIndex] = std::move(mComponents[lastValidIndex]);
 
+      // Reset the now unused slot, so that it doesn't hold on to any
+      // resources (such as shared geometry) until it's reused.
+      mComponents[lastValidIndex] = T();
+
       // Find the Entity that corresponds to the last valid component
       // and update its index.
       for(auto& entityIndexPair : mEntityToIndexMap)
@@ -105,6 +116,16 @@ class ComponentListT : public ComponentList
       mEntityToIndexMap.erase(aEntity);
     }
 
+    /**
+     * Returns the number of components currently in the list.
+     *
+     * @return The number of components.
+     */
+    std::size_t GetNumComponents() const override
+    {
+      return mNumValidComponents;
+    }
+
     /**
      * Returns a component of type T associated with the given Entity.
      *
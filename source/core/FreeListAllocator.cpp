@@ -0,0 +1,196 @@
+#include "FreeListAllocator.hpp"
+
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace Kuma3D {
+
+/******************************************************************************/
+FreeListAllocator::FreeListAllocator(std::size_t aCapacity)
+{
+  Grow(aCapacity);
+}
+
+/******************************************************************************/
+bool FreeListAllocator::Allocate(ID aID, std::size_t aSize)
+{
+  if(IsAllocated(aID))
+  {
+    std::stringstream error;
+    error << "ID " << aID << " already has an allocation!";
+    throw(std::invalid_argument(error.str()));
+  }
+
+  if(aSize == 0)
+  {
+    throw(std::invalid_argument("Can't allocate an empty range!"));
+  }
+
+  for(auto freeBlock = mFreeBlocks.begin(); freeBlock != mFreeBlocks.end(); ++freeBlock)
+  {
+    if(freeBlock->second >= aSize)
+    {
+      Block block { freeBlock->first, aSize };
+      TakeFreeBlock(freeBlock, aSize);
+
+      mAllocations[aID] = block;
+      mAllocationOffsets[block.mOffset] = aID;
+      mUsedSize += aSize;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/******************************************************************************/
+void FreeListAllocator::Free(ID aID)
+{
+  auto foundAllocation = mAllocations.find(aID);
+  if(foundAllocation == mAllocations.end())
+  {
+    return;
+  }
+
+  auto block = foundAllocation->second;
+  mAllocations.erase(foundAllocation);
+  mAllocationOffsets.erase(block.mOffset);
+  mUsedSize -= block.mSize;
+
+  AddFreeBlock(block.mOffset, block.mSize);
+}
+
+/******************************************************************************/
+void FreeListAllocator::Grow(std::size_t aCapacity)
+{
+  if(aCapacity < mCapacity)
+  {
+    throw(std::invalid_argument("An allocator can't be shrunk!"));
+  }
+
+  auto oldCapacity = mCapacity;
+  mCapacity = aCapacity;
+  AddFreeBlock(oldCapacity, aCapacity - oldCapacity);
+}
+
+/******************************************************************************/
+bool FreeListAllocator::Compact(Move& aMove)
+{
+  if(mAllocationOffsets.empty() || mFreeBlocks.empty())
+  {
+    return false;
+  }
+
+  // Find the allocation with the highest offset, and the first free range
+  // before it that's large enough to hold it. Since the free range comes
+  // before the allocation, the two never overlap.
+  auto lastAllocation = std::prev(mAllocationOffsets.end());
+  auto& block = mAllocations[lastAllocation->second];
+  for(auto freeBlock = mFreeBlocks.begin(); freeBlock != mFreeBlocks.end(); ++freeBlock)
+  {
+    if(freeBlock->first > block.mOffset)
+    {
+      break;
+    }
+
+    if(freeBlock->second >= block.mSize)
+    {
+      aMove.mID = lastAllocation->second;
+      aMove.mOldOffset = block.mOffset;
+      aMove.mNewOffset = freeBlock->first;
+      aMove.mSize = block.mSize;
+
+      TakeFreeBlock(freeBlock, block.mSize);
+      mAllocationOffsets.erase(lastAllocation);
+      mAllocationOffsets[aMove.mNewOffset] = aMove.mID;
+      block.mOffset = aMove.mNewOffset;
+
+      AddFreeBlock(aMove.mOldOffset, aMove.mSize);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/******************************************************************************/
+void FreeListAllocator::Clear()
+{
+  mAllocations.clear();
+  mAllocationOffsets.clear();
+  mFreeBlocks.clear();
+  mUsedSize = 0;
+
+  AddFreeBlock(0, mCapacity);
+}
+
+/******************************************************************************/
+bool FreeListAllocator::IsAllocated(ID aID) const
+{
+  return mAllocations.find(aID) != mAllocations.end();
+}
+
+/******************************************************************************/
+const FreeListAllocator::Block& FreeListAllocator::GetBlock(ID aID) const
+{
+  auto foundAllocation = mAllocations.find(aID);
+  if(foundAllocation == mAllocations.end())
+  {
+    std::stringstream error;
+    error << "ID " << aID << " has no allocation!";
+    throw(std::invalid_argument(error.str()));
+  }
+
+  return foundAllocation->second;
+}
+
+/******************************************************************************/
+void FreeListAllocator::AddFreeBlock(std::size_t aOffset, std::size_t aSize)
+{
+  if(aSize == 0)
+  {
+    return;
+  }
+
+  auto offset = aOffset;
+  auto size = aSize;
+
+  // Merge with the free range that ends where this one starts.
+  auto next = mFreeBlocks.lower_bound(offset);
+  if(next != mFreeBlocks.begin())
+  {
+    auto previous = std::prev(next);
+    if(previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      size += previous->second;
+      mFreeBlocks.erase(previous);
+    }
+  }
+
+  // Merge with the free range that starts where this one ends.
+  if(next != mFreeBlocks.end() && next->first == aOffset + aSize)
+  {
+    size += next->second;
+    mFreeBlocks.erase(next);
+  }
+
+  mFreeBlocks[offset] = size;
+}
+
+/******************************************************************************/
+void FreeListAllocator::TakeFreeBlock(std::map<std::size_t, std::size_t>::iterator aFreeBlock,
+                                      std::size_t aSize)
+{
+  auto offset = aFreeBlock->first + aSize;
+  auto remainingSize = aFreeBlock->second - aSize;
+  mFreeBlocks.erase(aFreeBlock);
+
+  if(remainingSize > 0)
+  {
+    mFreeBlocks[offset] = remainingSize;
+  }
+}
+
+} // namespace Kuma3D
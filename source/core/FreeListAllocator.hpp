@@ -0,0 +1,167 @@
+#ifndef FREELISTALLOCATOR_HPP
+#define FREELISTALLOCATOR_HPP
+
+#include <cstddef>
+#include <map>
+
+#include "IDGenerator.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Keeps track of which ranges of a fixed-size region (such as an OpenGL
+ * buffer) are in use. Each range is allocated on behalf of an owner ID,
+ * which is used to look up, free and move the range later.
+ *
+ * The allocator doesn't own any memory itself; offsets and sizes are in
+ * whatever unit the caller chooses.
+ */
+class FreeListAllocator
+{
+  public:
+
+    /**
+     * A contiguous range of the region.
+     */
+    struct Block
+    {
+      std::size_t mOffset { 0 };
+      std::size_t mSize { 0 };
+    };
+
+    /**
+     * Describes an allocation that was moved to compact the region. The
+     * caller is responsible for copying the data from the old offset to
+     * the new one.
+     */
+    struct Move
+    {
+      ID mID { 0 };
+      std::size_t mOldOffset { 0 };
+      std::size_t mNewOffset { 0 };
+      std::size_t mSize { 0 };
+    };
+
+    /**
+     * Creates an allocator for a region of the given size.
+     *
+     * @param aCapacity The size of the region.
+     */
+    explicit FreeListAllocator(std::size_t aCapacity = 0);
+
+    /**
+     * Allocates a range of the given size for the given ID, using the
+     * free range with the lowest offset that fits. Throws an exception if
+     * the ID already has a range.
+     *
+     * @param aID The ID to allocate a range for.
+     * @param aSize The size of the range.
+     * @return True if a range was allocated, false if no free range fits.
+     */
+    bool Allocate(ID aID, std::size_t aSize);
+
+    /**
+     * Frees the range allocated for the given ID, merging it with any
+     * neighboring free ranges. Does nothing if the ID has no range.
+     *
+     * @param aID The ID to free the range for.
+     */
+    void Free(ID aID);
+
+    /**
+     * Increases the size of the region. The new space is added to the end
+     * of the region.
+     *
+     * @param aCapacity The new size of the region. Must not be less than
+     *                  the current size.
+     */
+    void Grow(std::size_t aCapacity);
+
+    /**
+     * Moves the allocation with the highest offset into the free range with
+     * the lowest offset before it that fits, if there is one. Calling this
+     * repeatedly gradually moves the allocations toward the start of the
+     * region.
+     *
+     * @param aMove Filled with the details of the move, if one was made.
+     * @return True if an allocation was moved, false otherwise.
+     */
+    bool Compact(Move& aMove);
+
+    /**
+     * Frees every range.
+     */
+    void Clear();
+
+    /**
+     * Returns whether the given ID has a range allocated.
+     *
+     * @param aID The ID to check.
+     * @return True if the ID has a range, false otherwise.
+     */
+    bool IsAllocated(ID aID) const;
+
+    /**
+     * Returns the range allocated for the given ID. Throws an exception
+     * if the ID has no range.
+     *
+     * @param aID The ID to retrieve the range for.
+     * @return The range allocated for the ID.
+     */
+    const Block& GetBlock(ID aID) const;
+
+    /**
+     * Returns the size of the region.
+     *
+     * @return The size of the region.
+     */
+    std::size_t GetCapacity() const { return mCapacity; }
+
+    /**
+     * Returns the combined size of every allocated range.
+     *
+     * @return The amount of the region in use.
+     */
+    std::size_t GetUsedSize() const { return mUsedSize; }
+
+    /**
+     * Returns the number of free ranges. A fully compacted region has
+     * at most one.
+     *
+     * @return The number of free ranges.
+     */
+    std::size_t GetNumFreeBlocks() const { return mFreeBlocks.size(); }
+
+  private:
+
+    /**
+     * Adds a range to the free list, merging it with its neighbors.
+     *
+     * @param aOffset The offset of the range.
+     * @param aSize The size of the range.
+     */
+    void AddFreeBlock(std::size_t aOffset, std::size_t aSize);
+
+    /**
+     * Removes part (or all) of a free range from the free list.
+     *
+     * @param aFreeBlock The free range to take from.
+     * @param aSize The amount to take from the start of the range.
+     */
+    void TakeFreeBlock(std::map<std::size_t, std::size_t>::iterator aFreeBlock,
+                       std::size_t aSize);
+
+    // Maps the offset of each free range to its size.
+    std::map<std::size_t, std::size_t> mFreeBlocks;
+
+    // Maps each ID to its range, and each range's offset back to its ID.
+    std::map<ID, Block> mAllocations;
+    std::map<std::size_t, ID> mAllocationOffsets;
+
+    std::size_t mCapacity { 0 };
+    std::size_t mUsedSize { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
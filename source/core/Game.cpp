@@ -1,18 +1,27 @@
 #include "Game.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include <stdexcept>
 
 #include "GameSignals.hpp"
+#include "HitchDetector.hpp"
+#include "Metrics.hpp"
 #include "InputSignals.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
 
 namespace Kuma3D {
 
 bool Game::mInitialized = false;
 GLFWwindow* Game::mWindow = nullptr;
 
+bool Game::mHeadless = false;
+HeadlessOptions Game::mHeadlessOptions;
+double Game::mHeadlessTime = 0.0;
+
 std::map<int, std::vector<GamepadButton>> Game::mGamepadButtonMap;
 
 std::unique_ptr<Scene> Game::mScene = nullptr;
@@ -115,6 +124,7 @@ void Game::Initialize(const WindowOptions& aOptions)
   glfwSetErrorCallback(GLFWErrorCallback);
 
   // Initialize GLFW.
+  mHeadless = false;
   mInitialized = glfwInit();
   if(mInitialized)
   {
@@ -147,22 +157,49 @@ void Game::Initialize(const WindowOptions& aOptions)
       mInitialized = false;
     }
   }
+
+  JobSystem::Initialize();
+}
+
+/******************************************************************************/
+void Game::InitializeHeadless(const HeadlessOptions& aOptions)
+{
+  // No third-party graphics libraries are needed in headless mode, so
+  // just store the options and reset the simulated clock.
+  mHeadlessOptions = aOptions;
+  mHeadlessTime = 0.0;
+
+  mHeadless = true;
+  mInitialized = true;
+
+  JobSystem::Initialize();
 }
 
 /******************************************************************************/
 void Game::Uninitialize()
 {
-  // Clean up GLFW.
-  glfwDestroyWindow(mWindow);
-  glfwTerminate();
+  // Clean up GLFW (only if it was initialized).
+  if(!mHeadless)
+  {
+    glfwDestroyWindow(mWindow);
+    glfwTerminate();
+  }
+
+  JobSystem::Uninitialize();
 
   mInitialized = false;
+  mHeadless = false;
   mWindow = nullptr;
 }
 
 /******************************************************************************/
 void Game::ApplyOptionsToWindow(const WindowOptions& aOptions)
 {
+  if(mWindow == nullptr)
+  {
+    return;
+  }
+
   switch(aOptions.mWindowMode)
   {
     case WindowMode::eWINDOWED:
@@ -221,31 +258,16 @@ void Game::Run()
     throw std::logic_error("The Game must have a Scene before calling Run()!");
   }
 
-  // Run until the window is closed or until Exit() is called.
-  while(!glfwWindowShouldClose(mWindow) &&
-        !mExiting)
+  if(mHeadless)
   {
-    if(mNewScene != nullptr)
-    {
-      mScene.reset(nullptr);
-      mScene = std::move(mNewScene);
-      mNewScene.reset(nullptr);
-    }
-
-    // Process the GLFW event queue.
-    glfwPollEvents();
-
-    // GLFW doesn't use events for gamepad/gamepad input, so do that here.
-    PollGamepadButtons();
-
-    // Update the current Scene.
-    mScene->OperateSystems(glfwGetTime());
-
-    // Swap the front/back buffers.
-    glfwSwapBuffers(mWindow);
+    RunHeadless();
+  }
+  else
+  {
+    RunWindowed();
   }
 
-  GamePendingExit.Notify(glfwGetTime());
+  GamePendingExit.Notify(GetTime());
   mScene.reset(nullptr);
   mExiting = false;
 }
@@ -275,7 +297,7 @@ float Game::GetGamepadAxisValue(int aID, const GamepadAxis& aAxis)
   float value = 0;
 
   GLFWgamepadstate state;
-  if(glfwGetGamepadState(aID, &state))
+  if(!mHeadless && glfwGetGamepadState(aID, &state))
   {
     value = state.axes[static_cast<int>(aAxis)];
   }
@@ -283,6 +305,96 @@ float Game::GetGamepadAxisValue(int aID, const GamepadAxis& aAxis)
   return value;
 }
 
+/******************************************************************************/
+double Game::GetTime()
+{
+  return mHeadless ? mHeadlessTime : glfwGetTime();
+}
+
+/******************************************************************************/
+void Game::RunWindowed()
+{
+  // Run until the window is closed or until Exit() is called.
+  while(!glfwWindowShouldClose(mWindow) &&
+        !mExiting)
+  {
+    auto frameStart = std::chrono::steady_clock::now();
+
+    {
+      KUMA3D_PROFILE_SCOPE("Game::Frame");
+
+      // Process the GLFW event queue.
+      {
+        KUMA3D_PROFILE_SCOPE("Game::PollEvents");
+        glfwPollEvents();
+
+        // GLFW doesn't use events for gamepad/gamepad input, so do that here.
+        PollGamepadButtons();
+      }
+
+      // Update the current Scene.
+      UpdateScene(glfwGetTime());
+
+      // Swap the front/back buffers.
+      KUMA3D_PROFILE_SCOPE("Game::SwapBuffers");
+      glfwSwapBuffers(mWindow);
+    }
+
+    EndFrame(frameStart);
+  }
+}
+
+/******************************************************************************/
+void Game::RunHeadless()
+{
+  // Run until Exit() is called or until the maximum number of ticks
+  // has been reached (if there is a maximum).
+  unsigned long ticks = 0;
+  while(!mExiting &&
+        (mHeadlessOptions.mMaxTicks == 0 || ticks < mHeadlessOptions.mMaxTicks))
+  {
+    auto frameStart = std::chrono::steady_clock::now();
+
+    {
+      KUMA3D_PROFILE_SCOPE("Game::Frame");
+      UpdateScene(mHeadlessTime);
+    }
+
+    EndFrame(frameStart);
+
+    mHeadlessTime += mHeadlessOptions.mTimeStep;
+    ++ticks;
+  }
+}
+
+/******************************************************************************/
+void Game::UpdateScene(double aTime)
+{
+  if(mNewScene != nullptr)
+  {
+    KUMA3D_PROFILE_SCOPE("Game::SwapScene");
+    HitchDetector::AddFrameEvent("Scene swap");
+    mScene.reset(nullptr);
+    mScene = std::move(mNewScene);
+    mNewScene.reset(nullptr);
+  }
+
+  mScene->OperateSystems(aTime);
+}
+
+/******************************************************************************/
+void Game::EndFrame(std::chrono::steady_clock::time_point aFrameStart)
+{
+  // Hitches are measured in real time, even in headless mode.
+  auto frameEnd = std::chrono::steady_clock::now();
+  auto frameTime = std::chrono::duration<double>(frameEnd - aFrameStart).count();
+  HitchDetector::RecordFrame(frameTime, mScene->GetSystemTimings());
+
+  static auto& frameTimes = Metrics::GetHistogram("Game.FrameTime");
+  frameTimes.Record(frameTime * 1000.0);
+  Metrics::EndFrame();
+}
+
 /******************************************************************************/
 void Game::CreateWindow(const WindowOptions& aOptions)
 {
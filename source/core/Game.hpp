@@ -1,6 +1,7 @@
 #ifndef GAME_HPP
 #define GAME_HPP
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <vector>
@@ -8,6 +9,7 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "HeadlessOptions.hpp"
 #include "Scene.hpp"
 #include "WindowOptions.hpp"
 
@@ -22,6 +24,11 @@ namespace Kuma3D {
  * 2) Creating a window and an OpenGL context
  * 3) Connecting several callbacks to GLFW events (for input, resizing, etc).
  * 4) Updating a Scene
+ *
+ * Alternatively, the Game can be initialized in headless mode, in which case
+ * steps 1 through 3 are skipped entirely and the Scene is updated in a tight
+ * loop using a simulated clock. This is useful for running simulations on
+ * machines without a GPU, or for benchmarking.
  */
 class Game
 {
@@ -35,6 +42,15 @@ class Game
      */
     static void Initialize(const WindowOptions& aOptions);
 
+    /**
+     * Initializes the Game in headless mode. No window or OpenGL context
+     * is created, and Systems that require one (such as the RenderSystem)
+     * will skip their logic.
+     *
+     * @param aOptions The options to use while running headless.
+     */
+    static void InitializeHeadless(const HeadlessOptions& aOptions);
+
     /**
      * Uninitializes the third-party graphics libraries and destroys
      * the current window.
@@ -50,7 +66,8 @@ class Game
 
     /**
      * Begins the game loop. This loop will run until Exit() is called
-     * or until the window is closed.
+     * or until the window is closed. In headless mode, the loop will also
+     * stop once the maximum number of ticks has been reached.
      */
     static void Run();
 
@@ -75,8 +92,48 @@ class Game
      */
     static float GetGamepadAxisValue(int aID, const GamepadAxis& aAxis);
 
+    /**
+     * Returns whether the Game was initialized in headless mode.
+     *
+     * @return True if running headless, false otherwise.
+     */
+    static bool IsHeadless() { return mHeadless; }
+
+    /**
+     * Returns the current time in seconds. In headless mode, this is the
+     * simulated time rather than the time since GLFW was initialized.
+     *
+     * @return The current time in seconds.
+     */
+    static double GetTime();
+
   private:
 
+    /**
+     * Runs the game loop using a window and the GLFW clock.
+     */
+    static void RunWindowed();
+
+    /**
+     * Runs the game loop without a window, using a simulated clock.
+     */
+    static void RunHeadless();
+
+    /**
+     * Swaps in the new Scene (if there is one) and updates the current Scene.
+     *
+     * @param aTime The time at the start of the current frame.
+     */
+    static void UpdateScene(double aTime);
+
+    /**
+     * Records the time taken by the frame that just finished with the
+     * HitchDetector and the Metrics, and ends the frame for the Metrics.
+     *
+     * @param aFrameStart The time at which the frame started.
+     */
+    static void EndFrame(std::chrono::steady_clock::time_point aFrameStart);
+
     /**
      * Creates a window using the given options.
      */
@@ -99,6 +156,10 @@ class Game
     static bool mInitialized;
     static GLFWwindow* mWindow;
 
+    static bool mHeadless;
+    static HeadlessOptions mHeadlessOptions;
+    static double mHeadlessTime;
+
     static std::map<int, std::vector<GamepadButton>> mGamepadButtonMap;
 
     static std::unique_ptr<Scene> mScene;
@@ -0,0 +1,23 @@
+#ifndef HEADLESSOPTIONS_HPP
+#define HEADLESSOPTIONS_HPP
+
+namespace Kuma3D {
+
+/**
+ * Contains several options used when running the Game without a window.
+ * In headless mode, time is simulated rather than read from a clock; each
+ * tick advances the time by a fixed step.
+ */
+struct HeadlessOptions
+{
+  // The amount of simulated time (in seconds) that passes each tick.
+  double mTimeStep { 1.0 / 60.0 };
+
+  // The maximum number of ticks to run before exiting. A value of 0
+  // means the game loop runs until Exit() is called.
+  unsigned long mMaxTicks { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,246 @@
+#include "HitchDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "AllocationTracker.hpp"
+#include "StringUtil.hpp"
+
+namespace Kuma3D {
+
+double HitchDetector::mFrameBudget = 1.0 / 30.0;
+std::string HitchDetector::mCaptureDirectory;
+
+std::vector<double> HitchDetector::mHistory(600, 0.0);
+std::vector<HitchDetector::FrameRecord> HitchDetector::mCapture(60);
+std::vector<std::string> HitchDetector::mPendingEvents;
+
+std::uint64_t HitchDetector::mFrameCount = 0;
+std::uint64_t HitchDetector::mLastCaptureFrame = 0;
+std::size_t HitchDetector::mHitchCount = 0;
+
+std::uint64_t HitchDetector::mLastAllocationCount = 0;
+std::uint64_t HitchDetector::mLastAllocatedBytes = 0;
+
+/******************************************************************************/
+void HitchDetector::RecordFrame(double aFrameTime,
+                                const std::vector<SystemTiming>& aSystemTimings)
+{
+  ++mFrameCount;
+  mHistory[mFrameCount % mHistory.size()] = aFrameTime;
+
+  // Record the frame in detail. The records are reused once the capture
+  // wraps around, so this doesn't allocate in the steady state.
+  auto& record = mCapture[mFrameCount % mCapture.size()];
+  record.mFrame = mFrameCount;
+  record.mFrameTime = aFrameTime;
+  record.mSystemTimings.assign(aSystemTimings.begin(), aSystemTimings.end());
+  record.mEvents.swap(mPendingEvents);
+  mPendingEvents.clear();
+
+  auto allocations = AllocationTracker::GetAllocationCount();
+  auto allocatedBytes = AllocationTracker::GetAllocatedBytes();
+  record.mAllocations = allocations - mLastAllocationCount;
+  record.mAllocatedBytes = allocatedBytes - mLastAllocatedBytes;
+  mLastAllocationCount = allocations;
+  mLastAllocatedBytes = allocatedBytes;
+
+  if(aFrameTime > mFrameBudget)
+  {
+    ++mHitchCount;
+
+    // Only write a capture if none of its frames were already written
+    // out, so that a run of slow frames doesn't produce a file per frame.
+    if(!mCaptureDirectory.empty() &&
+       (mLastCaptureFrame == 0 || mFrameCount - mLastCaptureFrame >= mCapture.size()))
+    {
+      WriteCaptureFile();
+      mLastCaptureFrame = mFrameCount;
+    }
+  }
+}
+
+/******************************************************************************/
+void HitchDetector::AddFrameEvent(const std::string& aDescription)
+{
+  mPendingEvents.emplace_back(aDescription);
+}
+
+/******************************************************************************/
+FrameTimeStats HitchDetector::GetFrameTimeStats()
+{
+  FrameTimeStats stats;
+
+  auto count = std::min<std::uint64_t>(mFrameCount, mHistory.size());
+  if(count == 0)
+  {
+    return stats;
+  }
+
+  // Until the history fills up, the recorded frames are at indices
+  // 1 through count (see RecordFrame()).
+  std::vector<double> sorted;
+  if(count == mHistory.size())
+  {
+    sorted = mHistory;
+  }
+  else
+  {
+    sorted.assign(mHistory.begin() + 1, mHistory.begin() + 1 + count);
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  // Use the nearest-rank method.
+  auto percentile = [&sorted](double aPercentile)
+  {
+    auto rank = static_cast<std::size_t>(std::ceil(aPercentile * sorted.size()));
+    return sorted[std::max<std::size_t>(rank, 1) - 1];
+  };
+
+  stats.mP50 = percentile(0.50);
+  stats.mP95 = percentile(0.95);
+  stats.mP99 = percentile(0.99);
+  stats.mMax = sorted.back();
+
+  return stats;
+}
+
+/******************************************************************************/
+void HitchDetector::SetFrameBudget(double aSeconds)
+{
+  if(aSeconds <= 0.0)
+  {
+    throw std::invalid_argument("The frame budget must be positive!");
+  }
+
+  mFrameBudget = aSeconds;
+}
+
+/******************************************************************************/
+void HitchDetector::SetHistorySize(std::size_t aFrames)
+{
+  if(aFrames == 0)
+  {
+    throw std::invalid_argument("The frame history must contain at least one frame!");
+  }
+
+  mHistory.assign(aFrames, 0.0);
+  Reset();
+}
+
+/******************************************************************************/
+void HitchDetector::SetCaptureSize(std::size_t aFrames)
+{
+  if(aFrames == 0)
+  {
+    throw std::invalid_argument("The capture must contain at least one frame!");
+  }
+
+  mCapture.assign(aFrames, FrameRecord());
+  Reset();
+}
+
+/******************************************************************************/
+void HitchDetector::SetCaptureDirectory(const std::string& aDirectory)
+{
+  mCaptureDirectory = aDirectory;
+}
+
+/******************************************************************************/
+void HitchDetector::WriteCapture(std::ostream& aStream)
+{
+  auto flags = aStream.flags();
+  auto precision = aStream.precision();
+  aStream << std::fixed << std::setprecision(3);
+
+  auto stats = GetFrameTimeStats();
+  aStream << "{\n"
+          << "  \"budget_ms\": " << mFrameBudget * 1000.0 << ",\n"
+          << "  \"p50_ms\": " << stats.mP50 * 1000.0 << ",\n"
+          << "  \"p95_ms\": " << stats.mP95 * 1000.0 << ",\n"
+          << "  \"p99_ms\": " << stats.mP99 * 1000.0 << ",\n"
+          << "  \"max_ms\": " << stats.mMax * 1000.0 << ",\n"
+          << "  \"allocations_tracked\": " << (AllocationTracker::IsEnabled() ? "true" : "false") << ",\n"
+          << "  \"frames\": [";
+
+  // Write the frames oldest first, skipping any that haven't been recorded.
+  bool first = true;
+  for(std::size_t i = 1; i <= mCapture.size(); ++i)
+  {
+    const auto& record = mCapture[(mFrameCount + i) % mCapture.size()];
+    if(record.mFrame == 0)
+    {
+      continue;
+    }
+
+    aStream << (first ? "\n" : ",\n")
+            << "    {\"frame\": " << record.mFrame << ", "
+            << "\"frame_ms\": " << record.mFrameTime * 1000.0 << ", "
+            << "\"hitch\": " << (record.mFrameTime > mFrameBudget ? "true" : "false") << ", "
+            << "\"allocations\": " << record.mAllocations << ", "
+            << "\"allocated_bytes\": " << record.mAllocatedBytes << ",\n"
+            << "     \"systems\": [";
+    first = false;
+
+    for(std::size_t j = 0; j < record.mSystemTimings.size(); ++j)
+    {
+      const auto& timing = record.mSystemTimings[j];
+      aStream << (j == 0 ? "" : ", ")
+              << "{\"name\": \"" << EscapeJSON(DemangleTypeName(timing.mName)) << "\", "
+              << "\"ms\": " << timing.mSeconds * 1000.0 << "}";
+    }
+
+    aStream << "],\n     \"events\": [";
+    for(std::size_t j = 0; j < record.mEvents.size(); ++j)
+    {
+      aStream << (j == 0 ? "" : ", ") << "\"" << EscapeJSON(record.mEvents[j]) << "\"";
+    }
+    aStream << "]}";
+  }
+
+  aStream << "\n  ]\n}\n";
+
+  aStream.flags(flags);
+  aStream.precision(precision);
+}
+
+/******************************************************************************/
+void HitchDetector::Reset()
+{
+  for(auto& record : mCapture)
+  {
+    record.mFrame = 0;
+    record.mSystemTimings.clear();
+    record.mEvents.clear();
+  }
+  std::fill(mHistory.begin(), mHistory.end(), 0.0);
+  mPendingEvents.clear();
+
+  mFrameCount = 0;
+  mLastCaptureFrame = 0;
+  mHitchCount = 0;
+
+  mLastAllocationCount = AllocationTracker::GetAllocationCount();
+  mLastAllocatedBytes = AllocationTracker::GetAllocatedBytes();
+}
+
+/******************************************************************************/
+void HitchDetector::WriteCaptureFile()
+{
+  auto filePath = mCaptureDirectory + "/hitch_" + std::to_string(mFrameCount) + ".json";
+
+  std::ofstream output(filePath);
+  if(!output.is_open())
+  {
+    std::cout << "Error writing hitch capture " << filePath << "!" << std::endl;
+    return;
+  }
+
+  WriteCapture(output);
+}
+
+} // namespace Kuma3D
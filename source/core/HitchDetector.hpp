@@ -0,0 +1,162 @@
+#ifndef HITCHDETECTOR_HPP
+#define HITCHDETECTOR_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Scene.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Frame time percentiles over the HitchDetector's history, in seconds.
+ */
+struct FrameTimeStats
+{
+  double mP50 { 0.0 };
+  double mP95 { 0.0 };
+  double mP99 { 0.0 };
+  double mMax { 0.0 };
+};
+
+/**
+ * A static class that keeps a rolling history of frame times and watches
+ * for hitches (frames that take longer than a given budget).
+ *
+ * Along with the frame time, the last few frames are recorded in more
+ * detail: how long each System took, how many allocations were made (see
+ * AllocationTracker), and any notable events that occurred (a Scene swap,
+ * a shader compile, a texture load, etc). If a capture directory is set,
+ * these frames are written to a JSON file whenever a hitch occurs, so that
+ * the cause of a hitch can be found after the fact.
+ *
+ * The Game records each frame automatically; this class only needs to be
+ * configured.
+ */
+class HitchDetector
+{
+  public:
+
+    /**
+     * Records a completed frame and checks whether it was a hitch.
+     *
+     * @param aFrameTime The time the frame took, in seconds.
+     * @param aSystemTimings The time each System took during the frame.
+     */
+    static void RecordFrame(double aFrameTime,
+                            const std::vector<SystemTiming>& aSystemTimings);
+
+    /**
+     * Adds a description of a notable event to the current frame.
+     *
+     * @param aDescription A description of the event.
+     */
+    static void AddFrameEvent(const std::string& aDescription);
+
+    /**
+     * Returns the frame time percentiles over the recorded history.
+     *
+     * @return The frame time statistics.
+     */
+    static FrameTimeStats GetFrameTimeStats();
+
+    /**
+     * Sets the frame budget; any frame that takes longer is a hitch.
+     * The default budget is 1/30th of a second.
+     *
+     * @param aSeconds The frame budget, in seconds.
+     */
+    static void SetFrameBudget(double aSeconds);
+
+    /**
+     * Returns the frame budget.
+     *
+     * @return The frame budget, in seconds.
+     */
+    static double GetFrameBudget() { return mFrameBudget; }
+
+    /**
+     * Sets the number of frame times used to calculate percentiles.
+     * This also clears the history. The default is 600 frames.
+     *
+     * @param aFrames The number of frames to keep.
+     */
+    static void SetHistorySize(std::size_t aFrames);
+
+    /**
+     * Sets the number of frames to record in detail and write out when a
+     * hitch occurs. This also clears the history. The default is 60 frames.
+     *
+     * @param aFrames The number of frames to capture.
+     */
+    static void SetCaptureSize(std::size_t aFrames);
+
+    /**
+     * Sets the directory that captures are written to when a hitch occurs.
+     * Each capture is named hitch_<frame number>.json. If the directory is
+     * empty (the default), hitches are counted but not written out.
+     *
+     * @param aDirectory The directory to write captures to.
+     */
+    static void SetCaptureDirectory(const std::string& aDirectory);
+
+    /**
+     * Returns the number of hitches that have occurred.
+     *
+     * @return The number of hitches.
+     */
+    static std::size_t GetHitchCount() { return mHitchCount; }
+
+    /**
+     * Writes the captured frames to the given stream as JSON, oldest first.
+     *
+     * @param aStream The stream to write to.
+     */
+    static void WriteCapture(std::ostream& aStream);
+
+    /**
+     * Clears the frame history, the captured frames, and the hitch count.
+     * The current settings are kept.
+     */
+    static void Reset();
+
+  private:
+
+    /**
+     * The detailed record of a single frame.
+     */
+    struct FrameRecord
+    {
+      std::uint64_t mFrame { 0 };
+      double mFrameTime { 0.0 };
+      std::uint64_t mAllocations { 0 };
+      std::uint64_t mAllocatedBytes { 0 };
+      std::vector<SystemTiming> mSystemTimings;
+      std::vector<std::string> mEvents;
+    };
+
+    /**
+     * Writes the captured frames to a new file in the capture directory.
+     */
+    static void WriteCaptureFile();
+
+    static double mFrameBudget;
+    static std::string mCaptureDirectory;
+
+    static std::vector<double> mHistory;
+    static std::vector<FrameRecord> mCapture;
+    static std::vector<std::string> mPendingEvents;
+
+    static std::uint64_t mFrameCount;
+    static std::uint64_t mLastCaptureFrame;
+    static std::size_t mHitchCount;
+
+    static std::uint64_t mLastAllocationCount;
+    static std::uint64_t mLastAllocatedBytes;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,143 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace Kuma3D {
+
+std::vector<std::thread> JobSystem::mThreads;
+std::deque<std::function<void()>> JobSystem::mJobs;
+
+std::mutex JobSystem::mMutex;
+std::condition_variable JobSystem::mJobAvailable;
+bool JobSystem::mStopping = false;
+
+/******************************************************************************/
+void JobSystem::Initialize(unsigned int aNumThreads)
+{
+  Uninitialize();
+
+  if(aNumThreads == 0)
+  {
+    auto hardwareThreads = std::thread::hardware_concurrency();
+    aNumThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  for(unsigned int i = 0; i < aNumThreads; ++i)
+  {
+    mThreads.emplace_back(WorkerLoop);
+  }
+}
+
+/******************************************************************************/
+void JobSystem::Uninitialize()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mJobAvailable.notify_all();
+
+  for(auto& thread : mThreads)
+  {
+    thread.join();
+  }
+
+  mThreads.clear();
+  mStopping = false;
+}
+
+/******************************************************************************/
+void JobSystem::ParallelFor(std::size_t aCount,
+                            std::size_t aBatchSize,
+                            const std::function<void(std::size_t, std::size_t)>& aFunction)
+{
+  aBatchSize = std::max<std::size_t>(aBatchSize, 1);
+  auto numBatches = (aCount + aBatchSize - 1) / aBatchSize;
+  if(numBatches == 0)
+  {
+    return;
+  }
+
+  // If there's nothing to share, skip the overhead of waking the workers.
+  auto numHelpers = std::min<std::size_t>(mThreads.size(), numBatches - 1);
+  if(numHelpers == 0)
+  {
+    aFunction(0, aCount);
+    return;
+  }
+
+  // Each thread (including this one) claims batches until none are left.
+  // The state is shared with the workers, since a worker may only pick up
+  // its job after every batch has already been finished.
+  struct LoopState
+  {
+    std::atomic<std::size_t> mNextBatch { 0 };
+    std::atomic<std::size_t> mFinishedBatches { 0 };
+    std::mutex mMutex;
+    std::condition_variable mFinished;
+  };
+  auto state = std::make_shared<LoopState>();
+
+  auto runBatches = [state, numBatches, aCount, aBatchSize, &aFunction]()
+  {
+    std::size_t batch;
+    while((batch = state->mNextBatch.fetch_add(1)) < numBatches)
+    {
+      auto start = batch * aBatchSize;
+      aFunction(start, std::min(start + aBatchSize, aCount));
+
+      if(state->mFinishedBatches.fetch_add(1) + 1 == numBatches)
+      {
+        std::lock_guard<std::mutex> lock(state->mMutex);
+        state->mFinished.notify_all();
+      }
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(std::size_t i = 0; i < numHelpers; ++i)
+    {
+      mJobs.emplace_back(runBatches);
+    }
+  }
+  mJobAvailable.notify_all();
+
+  runBatches();
+
+  std::unique_lock<std::mutex> lock(state->mMutex);
+  state->mFinished.wait(lock, [&state, numBatches]()
+  {
+    return state->mFinishedBatches.load() == numBatches;
+  });
+}
+
+/******************************************************************************/
+void JobSystem::WorkerLoop()
+{
+  while(true)
+  {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mJobAvailable.wait(lock, []()
+      {
+        return mStopping || !mJobs.empty();
+      });
+
+      if(mJobs.empty())
+      {
+        return;
+      }
+
+      job = std::move(mJobs.front());
+      mJobs.pop_front();
+    }
+
+    job();
+  }
+}
+
+} // namespace Kuma3D
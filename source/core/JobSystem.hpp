@@ -0,0 +1,81 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Kuma3D {
+
+/**
+ * A static class that owns a pool of worker threads for splitting large
+ * loops across cores.
+ *
+ * The Game starts the workers when it's initialized and stops them when
+ * it's uninitialized. Without any workers, ParallelFor() simply runs the
+ * whole loop on the calling thread.
+ */
+class JobSystem
+{
+  public:
+
+    /**
+     * Starts the worker threads, stopping any that are already running.
+     *
+     * @param aNumThreads The number of worker threads to start. If 0, one
+     *                    fewer than the number of hardware threads is used,
+     *                    since the calling thread helps with each loop.
+     */
+    static void Initialize(unsigned int aNumThreads = 0);
+
+    /**
+     * Finishes any queued work, then stops the worker threads.
+     */
+    static void Uninitialize();
+
+    /**
+     * Returns the number of running worker threads.
+     *
+     * @return The number of worker threads.
+     */
+    static unsigned int GetNumThreads() { return mThreads.size(); }
+
+    /**
+     * Splits the range [0, aCount) into batches and calls the given
+     * function once for each batch, spread across the worker threads and
+     * the calling thread. Returns once every batch is done.
+     *
+     * The function must be safe to call from several threads at once for
+     * different batches.
+     *
+     * @param aCount The number of items to loop over.
+     * @param aBatchSize The most items to give the function at once.
+     * @param aFunction The function to call with the start (inclusive) and
+     *                  end (exclusive) of each batch.
+     */
+    static void ParallelFor(std::size_t aCount,
+                            std::size_t aBatchSize,
+                            const std::function<void(std::size_t, std::size_t)>& aFunction);
+
+  private:
+
+    /**
+     * Runs queued jobs until the workers are told to stop.
+     */
+    static void WorkerLoop();
+
+    static std::vector<std::thread> mThreads;
+    static std::deque<std::function<void()>> mJobs;
+
+    static std::mutex mMutex;
+    static std::condition_variable mJobAvailable;
+    static bool mStopping;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,294 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+#include "StringUtil.hpp"
+
+namespace Kuma3D {
+
+std::map<std::string, std::unique_ptr<Counter>> Metrics::mCounters;
+std::map<std::string, std::unique_ptr<Gauge>> Metrics::mGauges;
+std::map<std::string, std::unique_ptr<Histogram>> Metrics::mHistograms;
+std::mutex Metrics::mMutex;
+
+std::uint64_t Metrics::mFrameCount = 0;
+
+std::ofstream Metrics::mDumpFile;
+MetricsFormat Metrics::mDumpFormat = MetricsFormat::eCSV;
+unsigned int Metrics::mDumpInterval = 60;
+
+/******************************************************************************/
+void Gauge::Add(double aAmount)
+{
+  // std::atomic<double> has no fetch_add before C++20.
+  auto value = mValue.load(std::memory_order_relaxed);
+  while(!mValue.compare_exchange_weak(value,
+                                      value + aAmount,
+                                      std::memory_order_relaxed))
+  {
+  }
+}
+
+/******************************************************************************/
+Histogram::Histogram(const std::vector<double>& aBucketBounds)
+  : mBucketBounds(aBucketBounds)
+  , mBucketCounts(aBucketBounds.size() + 1, 0)
+{
+  if(!std::is_sorted(mBucketBounds.begin(), mBucketBounds.end()))
+  {
+    throw std::invalid_argument("Histogram bucket bounds must be in ascending order!");
+  }
+}
+
+/******************************************************************************/
+void Histogram::Record(double aValue)
+{
+  // Find the first bucket whose upper bound contains the value; if there
+  // isn't one, this is the overflow bucket.
+  auto bound = std::lower_bound(mBucketBounds.begin(), mBucketBounds.end(), aValue);
+  ++mBucketCounts[bound - mBucketBounds.begin()];
+
+  mMin = (mCount == 0) ? aValue : std::min(mMin, aValue);
+  mMax = (mCount == 0) ? aValue : std::max(mMax, aValue);
+  mSum += aValue;
+  ++mCount;
+}
+
+/******************************************************************************/
+double Histogram::GetPercentile(double aPercentile) const
+{
+  if(mCount == 0)
+  {
+    return 0.0;
+  }
+
+  auto rank = static_cast<std::uint64_t>(std::ceil(aPercentile * mCount));
+  rank = std::max<std::uint64_t>(rank, 1);
+
+  std::uint64_t total = 0;
+  for(std::size_t i = 0; i < mBucketBounds.size(); ++i)
+  {
+    total += mBucketCounts[i];
+    if(total >= rank)
+    {
+      // The bucket bound may be looser than the largest value recorded.
+      return std::min(mBucketBounds[i], mMax);
+    }
+  }
+
+  return mMax;
+}
+
+/******************************************************************************/
+void Histogram::Reset()
+{
+  std::fill(mBucketCounts.begin(), mBucketCounts.end(), 0);
+  mCount = 0;
+  mSum = 0.0;
+  mMin = 0.0;
+  mMax = 0.0;
+}
+
+/******************************************************************************/
+Counter& Metrics::GetCounter(const std::string& aName)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto& counter = mCounters[aName];
+  if(counter == nullptr)
+  {
+    counter = std::make_unique<Counter>();
+  }
+
+  return *counter;
+}
+
+/******************************************************************************/
+Gauge& Metrics::GetGauge(const std::string& aName)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto& gauge = mGauges[aName];
+  if(gauge == nullptr)
+  {
+    gauge = std::make_unique<Gauge>();
+  }
+
+  return *gauge;
+}
+
+/******************************************************************************/
+void Metrics::RemoveGauge(const std::string& aName)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mGauges.erase(aName);
+}
+
+/******************************************************************************/
+Histogram& Metrics::GetHistogram(const std::string& aName,
+                                 const std::vector<double>& aBucketBounds)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto& histogram = mHistograms[aName];
+  if(histogram == nullptr)
+  {
+    if(aBucketBounds.empty())
+    {
+      std::vector<double> bounds;
+      for(double decade = 0.1; decade < 10000.0; decade *= 10.0)
+      {
+        bounds.emplace_back(decade);
+        bounds.emplace_back(decade * 2.0);
+        bounds.emplace_back(decade * 5.0);
+      }
+      bounds.emplace_back(10000.0);
+      histogram = std::make_unique<Histogram>(bounds);
+    }
+    else
+    {
+      histogram = std::make_unique<Histogram>(aBucketBounds);
+    }
+  }
+
+  return *histogram;
+}
+
+/******************************************************************************/
+void Metrics::EndFrame()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(auto& counterPair : mCounters)
+    {
+      auto& counter = *counterPair.second;
+      auto value = counter.GetValue();
+      counter.mFrameValue = value - counter.mFrameStartValue;
+      counter.mFrameStartValue = value;
+    }
+  }
+
+  ++mFrameCount;
+
+  if(mDumpFile.is_open() && mFrameCount % mDumpInterval == 0)
+  {
+    switch(mDumpFormat)
+    {
+      case MetricsFormat::eCSV: { WriteCSV(mDumpFile); break; }
+      case MetricsFormat::eJSON: { WriteJSON(mDumpFile); break; }
+    }
+    mDumpFile.flush();
+  }
+}
+
+/******************************************************************************/
+void Metrics::WriteJSON(std::ostream& aStream)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  aStream << "{\"frame\":" << mFrameCount << ",\"counters\":{";
+
+  bool first = true;
+  for(const auto& counterPair : mCounters)
+  {
+    aStream << (first ? "" : ",")
+            << "\"" << EscapeJSON(counterPair.first) << "\":{"
+            << "\"total\":" << counterPair.second->GetValue() << ","
+            << "\"frame\":" << counterPair.second->GetFrameValue() << "}";
+    first = false;
+  }
+
+  aStream << "},\"gauges\":{";
+  first = true;
+  for(const auto& gaugePair : mGauges)
+  {
+    aStream << (first ? "" : ",")
+            << "\"" << EscapeJSON(gaugePair.first) << "\":"
+            << gaugePair.second->GetValue();
+    first = false;
+  }
+
+  aStream << "},\"histograms\":{";
+  first = true;
+  for(const auto& histogramPair : mHistograms)
+  {
+    const auto& histogram = *histogramPair.second;
+    aStream << (first ? "" : ",")
+            << "\"" << EscapeJSON(histogramPair.first) << "\":{"
+            << "\"count\":" << histogram.GetCount() << ","
+            << "\"mean\":" << histogram.GetMean() << ","
+            << "\"min\":" << histogram.GetMin() << ","
+            << "\"max\":" << histogram.GetMax() << ","
+            << "\"p50\":" << histogram.GetPercentile(0.50) << ","
+            << "\"p95\":" << histogram.GetPercentile(0.95) << ","
+            << "\"p99\":" << histogram.GetPercentile(0.99) << "}";
+    first = false;
+  }
+
+  aStream << "}}\n";
+}
+
+/******************************************************************************/
+void Metrics::WriteCSV(std::ostream& aStream)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for(const auto& counterPair : mCounters)
+  {
+    aStream << mFrameCount << "," << counterPair.first << ","
+            << counterPair.second->GetValue() << "\n"
+            << mFrameCount << "," << counterPair.first << ".frame,"
+            << counterPair.second->GetFrameValue() << "\n";
+  }
+
+  for(const auto& gaugePair : mGauges)
+  {
+    aStream << mFrameCount << "," << gaugePair.first << ","
+            << gaugePair.second->GetValue() << "\n";
+  }
+
+  for(const auto& histogramPair : mHistograms)
+  {
+    const auto& name = histogramPair.first;
+    const auto& histogram = *histogramPair.second;
+    aStream << mFrameCount << "," << name << ".count," << histogram.GetCount() << "\n"
+            << mFrameCount << "," << name << ".mean," << histogram.GetMean() << "\n"
+            << mFrameCount << "," << name << ".p50," << histogram.GetPercentile(0.50) << "\n"
+            << mFrameCount << "," << name << ".p95," << histogram.GetPercentile(0.95) << "\n"
+            << mFrameCount << "," << name << ".p99," << histogram.GetPercentile(0.99) << "\n"
+            << mFrameCount << "," << name << ".max," << histogram.GetMax() << "\n";
+  }
+}
+
+/******************************************************************************/
+void Metrics::SetDumpFile(const std::string& aFilePath,
+                          MetricsFormat aFormat,
+                          unsigned int aInterval)
+{
+  if(aInterval == 0)
+  {
+    throw std::invalid_argument("The metrics dump interval must be at least one frame!");
+  }
+
+  mDumpFile.close();
+  mDumpFormat = aFormat;
+  mDumpInterval = aInterval;
+
+  if(!aFilePath.empty())
+  {
+    mDumpFile.open(aFilePath);
+    if(!mDumpFile.is_open())
+    {
+      std::cout << "Error opening metrics file " << aFilePath << "!" << std::endl;
+    }
+    else if(aFormat == MetricsFormat::eCSV)
+    {
+      mDumpFile << "frame,metric,value\n";
+    }
+  }
+}
+
+} // namespace Kuma3D
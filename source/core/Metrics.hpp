@@ -0,0 +1,278 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Kuma3D {
+
+/**
+ * A metric that counts how many times something has happened. Counters
+ * can be incremented from any thread.
+ */
+class Counter
+{
+  public:
+
+    /**
+     * Increments the counter.
+     *
+     * @param aAmount The amount to increment by.
+     */
+    void Increment(std::uint64_t aAmount = 1)
+    {
+      mValue.fetch_add(aAmount, std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the total count since the program started.
+     *
+     * @return The total count.
+     */
+    std::uint64_t GetValue() const { return mValue.load(std::memory_order_relaxed); }
+
+    /**
+     * Returns how much the counter was incremented during the most recently
+     * completed frame (see Metrics::EndFrame()).
+     *
+     * @return The count for the last frame.
+     */
+    std::uint64_t GetFrameValue() const { return mFrameValue; }
+
+  private:
+    friend class Metrics;
+
+    std::atomic<std::uint64_t> mValue { 0 };
+    std::uint64_t mFrameStartValue { 0 };
+    std::uint64_t mFrameValue { 0 };
+};
+
+/**
+ * A metric that holds a single value that can go up or down, such as the
+ * number of Entities in a Scene. Gauges can be modified from any thread.
+ */
+class Gauge
+{
+  public:
+
+    /**
+     * Sets the value of the gauge.
+     *
+     * @param aValue The new value.
+     */
+    void Set(double aValue) { mValue.store(aValue, std::memory_order_relaxed); }
+
+    /**
+     * Adds to (or subtracts from) the value of the gauge.
+     *
+     * @param aAmount The amount to add.
+     */
+    void Add(double aAmount);
+
+    /**
+     * Returns the current value of the gauge.
+     *
+     * @return The current value.
+     */
+    double GetValue() const { return mValue.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<double> mValue { 0.0 };
+};
+
+/**
+ * A metric that tracks the distribution of a value, such as a frame time,
+ * by counting how many recorded values fall into each of a set of buckets.
+ * Unlike counters and gauges, histograms must only be used from one thread.
+ */
+class Histogram
+{
+  public:
+
+    /**
+     * Constructor.
+     *
+     * @param aBucketBounds The upper bound of each bucket, in ascending
+     *                      order. Values above the last bound are counted
+     *                      in an extra overflow bucket.
+     */
+    explicit Histogram(const std::vector<double>& aBucketBounds);
+
+    /**
+     * Records a value.
+     *
+     * @param aValue The value to record.
+     */
+    void Record(double aValue);
+
+    /**
+     * Returns an estimate of the given percentile: the upper bound of the
+     * bucket it falls into, or the maximum value for the overflow bucket.
+     *
+     * @param aPercentile The percentile to estimate, between 0 and 1.
+     * @return The estimated value at the percentile.
+     */
+    double GetPercentile(double aPercentile) const;
+
+    /**
+     * Discards all recorded values.
+     */
+    void Reset();
+
+    std::uint64_t GetCount() const { return mCount; }
+    double GetSum() const { return mSum; }
+    double GetMin() const { return mMin; }
+    double GetMax() const { return mMax; }
+    double GetMean() const { return mCount > 0 ? mSum / mCount : 0.0; }
+
+    const std::vector<double>& GetBucketBounds() const { return mBucketBounds; }
+    const std::vector<std::uint64_t>& GetBucketCounts() const { return mBucketCounts; }
+
+  private:
+    std::vector<double> mBucketBounds;
+    std::vector<std::uint64_t> mBucketCounts;
+
+    std::uint64_t mCount { 0 };
+    double mSum { 0.0 };
+    double mMin { 0.0 };
+    double mMax { 0.0 };
+};
+
+/**
+ * Represents each file format the Metrics can be dumped in.
+ */
+enum class MetricsFormat
+{
+  eCSV,
+  eJSON
+};
+
+/**
+ * A static registry of named metrics that engine subsystems (and games)
+ * publish to. Metrics are created the first time they're requested and
+ * live until the program exits (or, for gauges, until RemoveGauge() is
+ * called), so references to them can be cached.
+ *
+ * The engine publishes the following metrics:
+ *
+ * Scene.EntitiesAlive            (gauge, summed over every live Scene)
+ * Scene.Components.<type>        (gauge, one per component type, summed over
+ *                                every live Scene)
+ * Renderer.DrawCalls             (counter)
+ * Renderer.BufferUploads         (counter)
+ * Renderer.TextureBytes          (gauge)
+ * Renderer.Camera<id>.*Meshes    (gauge, one set per Camera Entity, removed
+ *                                when the Camera is)
+ * Audio.SoundsPlaying            (gauge)
+ * Signals.Notifications          (counter)
+ * Game.FrameTime                 (histogram, in milliseconds)
+ *
+ * Every metric can be read at any time (the pull API), or the registry can
+ * be dumped to a file every few frames (see SetDumpFile()).
+ */
+class Metrics
+{
+  public:
+
+    /**
+     * Returns the counter with the given name, creating it if necessary.
+     *
+     * @param aName The name of the counter.
+     * @return The counter.
+     */
+    static Counter& GetCounter(const std::string& aName);
+
+    /**
+     * Returns the gauge with the given name, creating it if necessary.
+     *
+     * @param aName The name of the gauge.
+     * @return The gauge.
+     */
+    static Gauge& GetGauge(const std::string& aName);
+
+    /**
+     * Removes the gauge with the given name, if it exists. Any reference to
+     * the gauge must not be used afterward.
+     *
+     * @param aName The name of the gauge.
+     */
+    static void RemoveGauge(const std::string& aName);
+
+    /**
+     * Returns the histogram with the given name, creating it if necessary.
+     *
+     * @param aName The name of the histogram.
+     * @param aBucketBounds The bucket bounds to use if the histogram is
+     *                      created. If empty, buckets from 0.1 to 10000 in
+     *                      1-2-5 steps are used.
+     * @return The histogram.
+     */
+    static Histogram& GetHistogram(const std::string& aName,
+                                   const std::vector<double>& aBucketBounds = {});
+
+    /**
+     * Marks the end of a frame: updates the per-frame value of each counter
+     * and writes to the dump file, if one is set and it's time to. The Game
+     * calls this automatically at the end of each frame.
+     */
+    static void EndFrame();
+
+    /**
+     * Returns the number of frames that have been completed.
+     *
+     * @return The number of frames.
+     */
+    static std::uint64_t GetFrameCount() { return mFrameCount; }
+
+    /**
+     * Writes every metric to the given stream as a single JSON object.
+     *
+     * @param aStream The stream to write to.
+     */
+    static void WriteJSON(std::ostream& aStream);
+
+    /**
+     * Writes every metric to the given stream as CSV rows of the form
+     * "frame,metric,value"; counters are written as both a total and a
+     * per-frame value, and histograms as a count, mean, and percentiles.
+     *
+     * @param aStream The stream to write to.
+     */
+    static void WriteCSV(std::ostream& aStream);
+
+    /**
+     * Sets a file to dump the metrics to periodically. Each dump is appended
+     * to the file: for JSON, each dump is one line (JSON Lines); for CSV,
+     * each dump is a set of rows. Passing an empty path stops dumping.
+     *
+     * @param aFilePath The path of the file to write.
+     * @param aFormat The format to write the metrics in.
+     * @param aInterval The number of frames between each dump.
+     */
+    static void SetDumpFile(const std::string& aFilePath,
+                            MetricsFormat aFormat = MetricsFormat::eCSV,
+                            unsigned int aInterval = 60);
+
+  private:
+    static std::map<std::string, std::unique_ptr<Counter>> mCounters;
+    static std::map<std::string, std::unique_ptr<Gauge>> mGauges;
+    static std::map<std::string, std::unique_ptr<Histogram>> mHistograms;
+    static std::mutex mMutex;
+
+    static std::uint64_t mFrameCount;
+
+    static std::ofstream mDumpFile;
+    static MetricsFormat mDumpFormat;
+    static unsigned int mDumpInterval;
+};
+
+} // namespace Kuma3D
+
+#endif
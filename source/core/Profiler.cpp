@@ -0,0 +1,237 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#include "StringUtil.hpp"
+
+namespace Kuma3D {
+
+std::vector<std::unique_ptr<ProfileBuffer>> Profiler::mBuffers;
+std::mutex Profiler::mBufferMutex;
+
+std::atomic<bool> Profiler::mEnabled { true };
+
+/******************************************************************************/
+ProfileBuffer::ProfileBuffer(unsigned int aThreadID)
+  : mSlots(CAPACITY)
+  , mThreadID(aThreadID)
+{
+}
+
+/******************************************************************************/
+void ProfileBuffer::Write(const ProfileEvent& aEvent)
+{
+  // Only the owning thread writes, so a relaxed load of the head is enough.
+  // Mark the slot as being written (an odd sequence number) before changing
+  // it, and publish both the event and the new head with release stores.
+  auto head = mHead.load(std::memory_order_relaxed);
+  auto& slot = mSlots[head % CAPACITY];
+  slot.mSequence.store(2 * head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.mName.store(aEvent.mName, std::memory_order_relaxed);
+  slot.mStart.store(aEvent.mStart, std::memory_order_relaxed);
+  slot.mEnd.store(aEvent.mEnd, std::memory_order_relaxed);
+  slot.mType.store(aEvent.mType, std::memory_order_relaxed);
+
+  slot.mSequence.store(2 * head + 2, std::memory_order_release);
+  mHead.store(head + 1, std::memory_order_release);
+}
+
+/******************************************************************************/
+void ProfileBuffer::Read(std::vector<ProfileEvent>& aEvents) const
+{
+  auto head = mHead.load(std::memory_order_acquire);
+  auto tail = mTail.load(std::memory_order_acquire);
+
+  // If the buffer has wrapped around, the oldest events are gone.
+  if(head > CAPACITY)
+  {
+    tail = std::max(tail, head - CAPACITY);
+  }
+
+  for(auto i = tail; i < head; ++i)
+  {
+    // Skip the event if the owning thread has already started overwriting
+    // it, or overwrote it while it was being copied.
+    const auto& slot = mSlots[i % CAPACITY];
+    auto sequence = slot.mSequence.load(std::memory_order_acquire);
+    if(sequence != 2 * i + 2)
+    {
+      continue;
+    }
+
+    ProfileEvent event;
+    event.mName = slot.mName.load(std::memory_order_relaxed);
+    event.mStart = slot.mStart.load(std::memory_order_relaxed);
+    event.mEnd = slot.mEnd.load(std::memory_order_relaxed);
+    event.mType = slot.mType.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot.mSequence.load(std::memory_order_relaxed) != sequence)
+    {
+      continue;
+    }
+
+    aEvents.emplace_back(event);
+  }
+}
+
+/******************************************************************************/
+void ProfileBuffer::Clear()
+{
+  // Rather than resetting the head (which only the owning thread may write),
+  // move the tail up to it; everything before the tail is ignored.
+  mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+/******************************************************************************/
+void Profiler::RecordZone(const char* aName,
+                          std::uint64_t aStart,
+                          std::uint64_t aEnd)
+{
+  if(mEnabled.load(std::memory_order_relaxed))
+  {
+    ProfileEvent event;
+    event.mName = aName;
+    event.mStart = aStart;
+    event.mEnd = aEnd;
+    event.mType = ProfileEventType::eZONE;
+    GetThreadBuffer().Write(event);
+  }
+}
+
+/******************************************************************************/
+void Profiler::RecordMarker(const char* aName)
+{
+  if(mEnabled.load(std::memory_order_relaxed))
+  {
+    ProfileEvent event;
+    event.mName = aName;
+    event.mStart = GetTimestamp();
+    event.mEnd = event.mStart;
+    event.mType = ProfileEventType::eMARKER;
+    GetThreadBuffer().Write(event);
+  }
+}
+
+/******************************************************************************/
+std::uint64_t Profiler::GetTimestamp()
+{
+  static const auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+/******************************************************************************/
+void Profiler::SetEnabled(bool aEnabled)
+{
+  mEnabled.store(aEnabled);
+}
+
+/******************************************************************************/
+bool Profiler::IsEnabled()
+{
+  return mEnabled.load();
+}
+
+/******************************************************************************/
+void Profiler::Clear()
+{
+  std::lock_guard<std::mutex> lock(mBufferMutex);
+  for(auto& buffer : mBuffers)
+  {
+    buffer->Clear();
+  }
+}
+
+/******************************************************************************/
+void Profiler::WriteChromeTrace(std::ostream& aStream)
+{
+  std::lock_guard<std::mutex> lock(mBufferMutex);
+
+  // Timestamps are written in microseconds with nanosecond precision;
+  // restore the stream's formatting afterwards.
+  auto flags = aStream.flags();
+  auto precision = aStream.precision();
+  aStream << std::fixed << std::setprecision(3);
+
+  aStream << "{\"traceEvents\":[";
+
+  bool first = true;
+  std::vector<ProfileEvent> events;
+  for(const auto& buffer : mBuffers)
+  {
+    events.clear();
+    buffer->Read(events);
+
+    for(const auto& event : events)
+    {
+      if(!first)
+      {
+        aStream << ",";
+      }
+      first = false;
+
+      aStream << "\n{\"name\":\"" << EscapeJSON(DemangleTypeName(event.mName)) << "\","
+              << "\"cat\":\"Kuma3D\","
+              << "\"pid\":1,"
+              << "\"tid\":" << buffer->GetThreadID() << ","
+              << "\"ts\":" << (event.mStart / 1000.0) << ",";
+
+      switch(event.mType)
+      {
+        case ProfileEventType::eZONE:
+        {
+          aStream << "\"ph\":\"X\",\"dur\":" << ((event.mEnd - event.mStart) / 1000.0) << "}";
+          break;
+        }
+        case ProfileEventType::eMARKER:
+        {
+          aStream << "\"ph\":\"i\",\"s\":\"t\"}";
+          break;
+        }
+      }
+    }
+  }
+
+  aStream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  aStream.flags(flags);
+  aStream.precision(precision);
+}
+
+/******************************************************************************/
+bool Profiler::WriteChromeTrace(const std::string& aFilePath)
+{
+  std::ofstream output(aFilePath);
+  if(!output.is_open())
+  {
+    return false;
+  }
+
+  WriteChromeTrace(output);
+  return output.good();
+}
+
+/******************************************************************************/
+ProfileBuffer& Profiler::GetThreadBuffer()
+{
+  thread_local ProfileBuffer* threadBuffer = nullptr;
+
+  if(threadBuffer == nullptr)
+  {
+    // Buffers are kept alive even after their thread exits, so that
+    // their events can still be exported.
+    std::lock_guard<std::mutex> lock(mBufferMutex);
+    mBuffers.emplace_back(std::make_unique<ProfileBuffer>(mBuffers.size()));
+    threadBuffer = mBuffers.back().get();
+  }
+
+  return *threadBuffer;
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,241 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Profiling macros. These are compiled into the engine only when
+ * KUMA3D_ENABLE_PROFILER is defined (see the ENABLE_PROFILER CMake option);
+ * otherwise they expand to nothing, so they can be left in release builds.
+ *
+ * Names passed to these macros must outlive the profiler (string literals
+ * or typeid names are fine), since only the pointer is recorded.
+ */
+#ifdef KUMA3D_ENABLE_PROFILER
+  #define KUMA3D_PROFILE_CONCAT_INNER(a, b) a##b
+  #define KUMA3D_PROFILE_CONCAT(a, b) KUMA3D_PROFILE_CONCAT_INNER(a, b)
+  #define KUMA3D_PROFILE_SCOPE(aName) \
+    Kuma3D::ProfileZone KUMA3D_PROFILE_CONCAT(profileZone, __LINE__)(aName)
+  #define KUMA3D_PROFILE_MARKER(aName) Kuma3D::Profiler::RecordMarker(aName)
+#else
+  #define KUMA3D_PROFILE_SCOPE(aName)
+  #define KUMA3D_PROFILE_MARKER(aName)
+#endif
+
+namespace Kuma3D {
+
+/**
+ * An enumeration for each type of event the Profiler can record.
+ */
+enum class ProfileEventType
+{
+  eZONE,
+  eMARKER
+};
+
+/**
+ * A single event recorded by the Profiler. Timestamps are in nanoseconds,
+ * relative to the first time the Profiler was used.
+ */
+struct ProfileEvent
+{
+  const char* mName { nullptr };
+  std::uint64_t mStart { 0 };
+  std::uint64_t mEnd { 0 };
+  ProfileEventType mType { ProfileEventType::eZONE };
+};
+
+/**
+ * A fixed-size ring buffer of events recorded by a single thread. Only the
+ * owning thread ever writes to the buffer, so no locking is necessary; the
+ * head index is published atomically so that other threads can read it.
+ * Once the buffer is full, the oldest events are overwritten.
+ *
+ * Each slot carries a sequence number, which is odd while the owning thread
+ * is writing to it. A reader skips any slot that was being written to, or
+ * that was overwritten while it was being read.
+ */
+class ProfileBuffer
+{
+  public:
+
+    /**
+     * Constructor.
+     *
+     * @param aThreadID The index of the thread that owns this buffer.
+     */
+    explicit ProfileBuffer(unsigned int aThreadID);
+
+    /**
+     * Writes an event into the buffer. This must only be called by the
+     * owning thread.
+     *
+     * @param aEvent The event to write.
+     */
+    void Write(const ProfileEvent& aEvent);
+
+    /**
+     * Copies the events currently in the buffer, oldest first.
+     *
+     * @param aEvents The list to append the events to.
+     */
+    void Read(std::vector<ProfileEvent>& aEvents) const;
+
+    /**
+     * Discards all events in the buffer.
+     */
+    void Clear();
+
+    /**
+     * Returns the index of the thread that owns this buffer.
+     *
+     * @return The thread index.
+     */
+    unsigned int GetThreadID() const { return mThreadID; }
+
+    static const std::size_t CAPACITY = 1 << 16;
+
+  private:
+
+    /**
+     * A single event in the buffer. Each field is atomic so that a reader
+     * can copy it while the owning thread overwrites it; the sequence number
+     * tells the reader whether the copy can be trusted.
+     */
+    struct Slot
+    {
+      std::atomic<std::uint64_t> mSequence { 0 };
+      std::atomic<const char*> mName { nullptr };
+      std::atomic<std::uint64_t> mStart { 0 };
+      std::atomic<std::uint64_t> mEnd { 0 };
+      std::atomic<ProfileEventType> mType { ProfileEventType::eZONE };
+    };
+
+    std::vector<Slot> mSlots;
+    std::atomic<std::uint64_t> mHead { 0 };
+    std::atomic<std::uint64_t> mTail { 0 };
+
+    unsigned int mThreadID;
+};
+
+/**
+ * A static class that collects timing information into per-thread ring
+ * buffers and exports it in the Chrome trace event format, which can be
+ * viewed in chrome://tracing or Perfetto.
+ *
+ * Usually the Profiler isn't used directly; instead, use the
+ * KUMA3D_PROFILE_SCOPE and KUMA3D_PROFILE_MARKER macros.
+ */
+class Profiler
+{
+  public:
+
+    /**
+     * Records a zone (a named span of time) for the calling thread.
+     *
+     * @param aName The name of the zone.
+     * @param aStart The start time of the zone, from GetTimestamp().
+     * @param aEnd The end time of the zone, from GetTimestamp().
+     */
+    static void RecordZone(const char* aName,
+                           std::uint64_t aStart,
+                           std::uint64_t aEnd);
+
+    /**
+     * Records an instantaneous marker for the calling thread.
+     *
+     * @param aName The name of the marker.
+     */
+    static void RecordMarker(const char* aName);
+
+    /**
+     * Returns the current time in nanoseconds, relative to the first time
+     * this function was called.
+     *
+     * @return The current time in nanoseconds.
+     */
+    static std::uint64_t GetTimestamp();
+
+    /**
+     * Enables or disables recording at runtime. Recording is enabled
+     * by default.
+     *
+     * @param aEnabled Whether events should be recorded.
+     */
+    static void SetEnabled(bool aEnabled);
+
+    /**
+     * Returns whether recording is enabled.
+     *
+     * @return True if events are being recorded, false otherwise.
+     */
+    static bool IsEnabled();
+
+    /**
+     * Discards all recorded events on every thread.
+     */
+    static void Clear();
+
+    /**
+     * Writes each recorded event to the given stream as Chrome trace JSON.
+     *
+     * @param aStream The stream to write to.
+     */
+    static void WriteChromeTrace(std::ostream& aStream);
+
+    /**
+     * Writes each recorded event to the given file as Chrome trace JSON.
+     *
+     * @param aFilePath The path of the file to write.
+     * @return True if the file was written, false otherwise.
+     */
+    static bool WriteChromeTrace(const std::string& aFilePath);
+
+  private:
+
+    /**
+     * Returns the buffer owned by the calling thread, creating it if
+     * necessary.
+     *
+     * @return The calling thread's buffer.
+     */
+    static ProfileBuffer& GetThreadBuffer();
+
+    static std::vector<std::unique_ptr<ProfileBuffer>> mBuffers;
+    static std::mutex mBufferMutex;
+
+    static std::atomic<bool> mEnabled;
+};
+
+/**
+ * Records a zone spanning the lifetime of this object.
+ */
+class ProfileZone
+{
+  public:
+    explicit ProfileZone(const char* aName)
+      : mName(aName)
+      , mStart(Profiler::GetTimestamp()) {}
+
+    ~ProfileZone()
+    {
+      Profiler::RecordZone(mName, mStart, Profiler::GetTimestamp());
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+  private:
+    const char* mName;
+    std::uint64_t mStart;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef RADIXSORT_HPP
+#define RADIXSORT_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Kuma3D {
+
+/**
+ * Sorts a list of items in ascending order of a 64-bit key, using a
+ * least-significant-digit radix sort with 8-bit digits. The sort is
+ * stable, and skips any digit that's the same for every item.
+ *
+ * @param aItems The items to sort.
+ * @param aScratch A list to use as temporary storage; its contents are
+ *                 overwritten. Reusing the same list avoids reallocating
+ *                 it for each sort.
+ * @param aKey A function that returns the key for an item.
+ */
+template<typename T, typename KeyFunction>
+void RadixSort(std::vector<T>& aItems,
+               std::vector<T>& aScratch,
+               KeyFunction aKey)
+{
+  if(aItems.size() < 2)
+  {
+    return;
+  }
+
+  aScratch.resize(aItems.size());
+
+  // Count how often each value of each digit appears, all in one pass.
+  std::array<std::array<std::size_t, 256>, 8> counts {};
+  for(const auto& item : aItems)
+  {
+    std::uint64_t key = aKey(item);
+    for(std::size_t digit = 0; digit < 8; ++digit)
+    {
+      ++counts[digit][(key >> (digit * 8)) & 0xff];
+    }
+  }
+
+  auto* source = &aItems;
+  auto* destination = &aScratch;
+  for(std::size_t digit = 0; digit < 8; ++digit)
+  {
+    auto& digitCounts = counts[digit];
+
+    // If every item has the same value for this digit, this pass
+    // wouldn't change the order.
+    auto shift = digit * 8;
+    if(digitCounts[(aKey((*source)[0]) >> shift) & 0xff] == aItems.size())
+    {
+      continue;
+    }
+
+    // Convert the counts into the starting position of each value.
+    std::size_t offset = 0;
+    for(auto& count : digitCounts)
+    {
+      auto valueCount = count;
+      count = offset;
+      offset += valueCount;
+    }
+
+    for(const auto& item : *source)
+    {
+      auto value = (aKey(item) >> shift) & 0xff;
+      (*destination)[digitCounts[value]++] = item;
+    }
+
+    std::swap(source, destination);
+  }
+
+  if(source != &aItems)
+  {
+    aItems.swap(aScratch);
+  }
+}
+
+} // namespace Kuma3D
+
+#endif
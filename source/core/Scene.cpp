@@ -1,18 +1,47 @@
 #include "Scene.hpp"
 
+#include <chrono>
+#include <typeinfo>
+
 #include "EntitySignals.hpp"
+#include "Profiler.hpp"
+
+#include "SpatialSystem.hpp"
 
 namespace Kuma3D {
 
+/******************************************************************************/
+Scene::~Scene()
+{
+  mEntitiesAliveGauge.Add(-static_cast<double>(mPublishedEntityCount));
+  for(std::size_t i = 0; i < mComponentGauges.size(); ++i)
+  {
+    mComponentGauges[i]->Add(-static_cast<double>(mPublishedComponentCounts[i]));
+  }
+}
+
 /******************************************************************************/
 void Scene::OperateSystems(double aTime)
 {
-  // Perform logic for each System.
-  for(auto& system : mSystems)
+  KUMA3D_PROFILE_SCOPE("Scene::OperateSystems");
+
+  // Perform logic for each System, recording how long each one takes.
+  mSystemTimings.resize(mSystems.size());
+  for(std::size_t i = 0; i < mSystems.size(); ++i)
   {
-    system->Operate(*this, aTime);
+    auto& system = *mSystems[i];
+    KUMA3D_PROFILE_SCOPE(typeid(system).name());
+
+    auto start = std::chrono::steady_clock::now();
+    system.Operate(*this, aTime);
+    auto end = std::chrono::steady_clock::now();
+
+    mSystemTimings[i].mName = typeid(system).name();
+    mSystemTimings[i].mSeconds = std::chrono::duration<double>(end - start).count();
   }
 
+  KUMA3D_PROFILE_SCOPE("Scene::UpdateEntities");
+
   // Remove all components that have been scheduled for removal.
   for(const auto& entityComponentPair : mComponentsToRemove)
   {
@@ -45,6 +74,18 @@ void Scene::OperateSystems(double aTime)
     EntitySignatureChanged.Notify(entity, mEntityToSignatureMap[entity]);
   }
   mBufferEntityToSignatureMap.clear();
+
+  // Publish the number of Entities and components. Other Scenes may be
+  // adding to the same metrics, so only add the change since last time.
+  auto numEntities = mEntityToSignatureMap.size();
+  mEntitiesAliveGauge.Add(static_cast<double>(numEntities) - static_cast<double>(mPublishedEntityCount));
+  mPublishedEntityCount = numEntities;
+  for(std::size_t i = 0; i < mComponentLists.size(); ++i)
+  {
+    auto numComponents = mComponentLists[i]->GetNumComponents();
+    mComponentGauges[i]->Add(static_cast<double>(numComponents) - static_cast<double>(mPublishedComponentCounts[i]));
+    mPublishedComponentCounts[i] = numComponents;
+  }
 }
 
 /******************************************************************************/
@@ -54,6 +95,32 @@ void Scene::AddSystem(std::unique_ptr<System> aSystem)
   mSystems.back()->Initialize(*this);
 }
 
+/******************************************************************************/
+bool Scene::Raycast(const Ray& aRay, RaycastHit& aHit, float aMaxDistance)
+{
+  auto spatialSystem = GetSystem<SpatialSystem>();
+  if(spatialSystem == nullptr)
+  {
+    throw std::runtime_error("Error raycasting: Scene has no SpatialSystem!");
+  }
+
+  return spatialSystem->Raycast(*this, aRay, aHit, aMaxDistance);
+}
+
+/******************************************************************************/
+void Scene::Raycast(const std::vector<Ray>& aRays,
+                    std::vector<RaycastHit>& aHits,
+                    float aMaxDistance)
+{
+  auto spatialSystem = GetSystem<SpatialSystem>();
+  if(spatialSystem == nullptr)
+  {
+    throw std::runtime_error("Error raycasting: Scene has no SpatialSystem!");
+  }
+
+  spatialSystem->Raycast(*this, aRays, aHits, aMaxDistance);
+}
+
 /******************************************************************************/
 Entity Scene::CreateEntity()
 {
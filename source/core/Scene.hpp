@@ -2,6 +2,7 @@
 #define SCENE_HPP
 
 #include <algorithm>
+#include <limits>
 #include <memory>
 #include <typeinfo>
 #include <unordered_map>
@@ -12,6 +13,8 @@
 
 #include "ComponentList.hpp"
 #include "IDGenerator.hpp"
+#include "Metrics.hpp"
+#include "StringUtil.hpp"
 #include "System.hpp"
 
 #include "Entity.hpp"
@@ -19,6 +22,22 @@
 
 namespace Kuma3D {
 
+struct Ray;
+struct RaycastHit;
+
+/**
+ * The time a single System spent performing its logic during the most
+ * recent call to Scene::OperateSystems().
+ */
+struct SystemTiming
+{
+  // The name of the System's type, as returned by typeid.
+  const char* mName { nullptr };
+
+  // The time spent in the System's Operate() function, in seconds.
+  double mSeconds { 0.0 };
+};
+
 /**
  * A Scene contains all the information necessary for a single level,
  * area, screen, etc. in a game. An example of this could be the
@@ -28,6 +47,12 @@ class Scene
 {
   public:
 
+    /**
+     * Destructor. Removes this Scene's Entities and components from the
+     * Scene metrics.
+     */
+    ~Scene();
+
     /**
      * Asks each system to perform its logic. Note that systems will
      * perform logic in the order in which they were added.
@@ -36,6 +61,15 @@ class Scene
      */
     void OperateSystems(double aTime);
 
+    /**
+     * Returns how long each System took to perform its logic during the
+     * most recent call to OperateSystems(), in the order the Systems
+     * were added.
+     *
+     * @return The timing for each System.
+     */
+    const std::vector<SystemTiming>& GetSystemTimings() const { return mSystemTimings; }
+
     /**
      * Creates and returns a unique Entity ID.
      *
@@ -85,6 +119,56 @@ class Scene
      */
     void AddSystem(std::unique_ptr<System> aSystem);
 
+    /**
+     * Returns the first System of a given type that was added to this
+     * Scene.
+     *
+     * @return The System, or nullptr if no System of the type was added.
+     */
+    template<typename T>
+    T* GetSystem() const
+    {
+      for(const auto& system : mSystems)
+      {
+        auto castSystem = dynamic_cast<T*>(system.get());
+        if(castSystem != nullptr)
+        {
+          return castSystem;
+        }
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * Finds the nearest Entity hit by a ray, using this Scene's
+     * SpatialSystem. Entities are hit by their Bounds, or by their Mesh's
+     * triangles if they have a triangle Mesh.
+     *
+     * To pick the Entity under the mouse, create the ray with
+     * ScreenPointToRay().
+     *
+     * @param aRay The world-space ray.
+     * @param aHit Filled with the nearest hit, if any.
+     * @param aMaxDistance The farthest distance along the ray to look.
+     * @return True if the ray hit an Entity, false otherwise.
+     */
+    bool Raycast(const Ray& aRay,
+                 RaycastHit& aHit,
+                 float aMaxDistance = std::numeric_limits<float>::max());
+
+    /**
+     * Finds the nearest Entity hit by each of a list of rays, using this
+     * Scene's SpatialSystem. The rays are traced in packets of four.
+     *
+     * @param aRays The world-space rays.
+     * @param aHits Filled with the nearest hit of each ray.
+     * @param aMaxDistance The farthest distance along each ray to look.
+     */
+    void Raycast(const std::vector<Ray>& aRays,
+                 std::vector<RaycastHit>& aHits,
+                 float aMaxDistance = std::numeric_limits<float>::max());
+
     /**
      * Creates and returns an empty Signature for use with a System.
      *
@@ -120,6 +204,10 @@ class Scene
       std::string name(typeid(T).name());
       mComponentToIndexMap.emplace(name, mComponentLists.size() - 1);
 
+      // Publish the number of components of this type.
+      mComponentGauges.emplace_back(&Metrics::GetGauge("Scene.Components." + DemangleTypeName(name.c_str())));
+      mPublishedComponentCounts.emplace_back(0);
+
       // Update the EntityToSignature maps.
       UpdateSignatures();
     }
@@ -227,6 +315,20 @@ class Scene
       return const_cast<T&>(constScene->GetComponentForEntity<T>(aEntity));
     }
 
+    /**
+     * Returns the list containing every component of type T. Systems that
+     * look up components for many Entities at once can find the list once,
+     * rather than once per Entity as GetComponentForEntity() does.
+     *
+     * @return The list of components of type T.
+     */
+    template<typename T>
+    ComponentListT<T>& GetComponentList()
+    {
+      auto componentIndex = GetComponentIndex<T>();
+      return dynamic_cast<ComponentListT<T>&>(*mComponentLists.at(componentIndex));
+    }
+
   private:
 
     /**
@@ -237,9 +339,20 @@ class Scene
     // Contains each System currently in the Scene.
     std::vector<std::unique_ptr<System>> mSystems;
 
+    // Contains the time each System took during the last update.
+    std::vector<SystemTiming> mSystemTimings;
+
     // Contains a list for each component type in the Scene.
     std::vector<std::unique_ptr<ComponentList>> mComponentLists;
 
+    // Contains the metric for each ComponentList's size. The Scene metrics
+    // are totals across every Scene, so each Scene remembers what it last
+    // added to them.
+    std::vector<Gauge*> mComponentGauges;
+    std::vector<std::size_t> mPublishedComponentCounts;
+    Gauge& mEntitiesAliveGauge { Metrics::GetGauge("Scene.EntitiesAlive") };
+    std::size_t mPublishedEntityCount { 0 };
+
     // Maps component type names to the index of their corresponding ComponentList.
     std::unordered_map<std::string, unsigned int> mComponentToIndexMap;
 
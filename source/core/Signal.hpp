@@ -5,6 +5,7 @@
 #include <map>
 #include <vector>
 
+#include "Metrics.hpp"
 #include "Observer.hpp"
 
 namespace Kuma3D {
@@ -48,6 +49,9 @@ class SignalT : public Signal
      */
     void Notify(Args... args)
     {
+      static auto& notifications = Metrics::GetCounter("Signals.Notifications");
+      notifications.Increment();
+
       // Copy the function map and iterate over that instead of
       // the member variable; this way, functions that are connected
       // as a result are not called until the signal is notified again.
@@ -0,0 +1,78 @@
+#ifndef STRINGUTIL_HPP
+#define STRINGUTIL_HPP
+
+#include <cctype>
+#include <string>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+namespace Kuma3D {
+
+/**
+ * Returns a readable version of a type name returned by typeid. Type names
+ * are mangled by GCC and Clang; on other compilers, or if the name doesn't
+ * look like a mangled type name, it is returned unchanged.
+ *
+ * @param aName The name to demangle.
+ * @return The demangled name.
+ */
+inline std::string DemangleTypeName(const char* aName)
+{
+  std::string name(aName);
+  if(name.empty())
+  {
+    return name;
+  }
+
+#ifdef __GNUG__
+  // Only touch names that look like mangled type names, so that a
+  // name such as "i" doesn't become "int".
+  bool mangled = std::isdigit(name.front()) ||
+                 (name.front() == 'N' && name.back() == 'E');
+  if(mangled)
+  {
+    int status = 0;
+    auto demangled = abi::__cxa_demangle(aName, nullptr, nullptr, &status);
+    if(status == 0 && demangled != nullptr)
+    {
+      name = demangled;
+    }
+    std::free(demangled);
+  }
+#endif
+
+  return name;
+}
+
+/**
+ * Escapes the characters in a string that can't appear unescaped inside
+ * a JSON string literal.
+ *
+ * @param aText The text to escape.
+ * @return The escaped text.
+ */
+inline std::string EscapeJSON(const std::string& aText)
+{
+  std::string escaped;
+
+  for(const auto& character : aText)
+  {
+    switch(character)
+    {
+      case '"': { escaped += "\\\""; break; }
+      case '\\': { escaped += "\\\\"; break; }
+      case '\n': { escaped += "\\n"; break; }
+      case '\t': { escaped += "\\t"; break; }
+      default: { escaped += character; break; }
+    }
+  }
+
+  return escaped;
+}
+
+} // namespace Kuma3D
+
+#endif
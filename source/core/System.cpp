@@ -1,6 +1,5 @@
 #include "System.hpp"
 
-#include <algorithm>
 #include <functional>
 
 #include "EntitySignals.hpp"
@@ -28,6 +27,7 @@ void System::SetSignature(const Signature& aSignature)
 {
   mSignature = aSignature;
   mEntities.clear();
+  mEntityToIndexMap.clear();
 }
 
 /******************************************************************************/
@@ -35,21 +35,21 @@ void System::HandleEntitySignatureChanged(Entity aEntity,
                                           const Signature& aSignature)
 {
   auto relevant = IsSignatureRelevant(aSignature, mSignature);
-  auto foundEntity = std::find(mEntities.begin(), mEntities.end(), aEntity);
-  if(foundEntity != mEntities.end())
+  if(mEntityToIndexMap.count(aEntity))
   {
     // This Entity is already being kept track of, so check if the Signature
     // is still relevant for this system. If it isn't, remove the Entity.
     if(!relevant)
     {
-      HandleEntityBecameIneligible(*foundEntity);
-      mEntities.erase(foundEntity);
+      HandleEntityBecameIneligible(aEntity);
+      RemoveEntity(aEntity);
     }
   }
   else if(relevant)
   {
     // Start keeping track of this Entity.
     HandleEntityBecameEligible(aEntity);
+    mEntityToIndexMap.emplace(aEntity, mEntities.size());
     mEntities.emplace_back(aEntity);
   }
 }
@@ -58,12 +58,25 @@ void System::HandleEntitySignatureChanged(Entity aEntity,
 void System::HandleEntityPendingDeletion(Entity aEntity,
                                          const Scene& aScene)
 {
-  auto foundEntity = std::find(mEntities.begin(), mEntities.end(), aEntity);
-  if(foundEntity != mEntities.end())
+  if(mEntityToIndexMap.count(aEntity))
   {
     HandleEntityBecameIneligible(aEntity);
-    mEntities.erase(foundEntity);
+    RemoveEntity(aEntity);
   }
 }
 
+/******************************************************************************/
+void System::RemoveEntity(Entity aEntity)
+{
+  // Move the last Entity into the removed Entity's place, so that removal
+  // doesn't need to search or shift the rest of the list.
+  auto removedIndex = mEntityToIndexMap.at(aEntity);
+  auto lastEntity = mEntities.back();
+  mEntities[removedIndex] = lastEntity;
+  mEntityToIndexMap[lastEntity] = removedIndex;
+
+  mEntities.pop_back();
+  mEntityToIndexMap.erase(aEntity);
+}
+
 } // namespace Kuma3D
@@ -1,6 +1,8 @@
 #ifndef SYSTEM_HPP
 #define SYSTEM_HPP
 
+#include <cstddef>
+#include <unordered_map>
 #include <vector>
 
 #include "Observer.hpp"
@@ -97,7 +99,16 @@ class System
     void HandleEntityPendingDeletion(Entity aEntity,
                                      const Scene& aScene);
 
+    /**
+     * Stops keeping track of an eligible Entity. The last Entity in
+     * mEntities is moved into its place.
+     *
+     * @param aEntity The Entity to remove.
+     */
+    void RemoveEntity(Entity aEntity);
+
     std::vector<Entity> mEntities;
+    std::unordered_map<Entity, std::size_t> mEntityToIndexMap;
     Signature mSignature;
 
     Observer mObserver;
@@ -0,0 +1,279 @@
+#ifndef BOUNDSSTREAMS_HPP
+#define BOUNDSSTREAMS_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "Simd.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A list of boxes, stored as a separate stream of floats for each
+ * component of their centers and extents so that four boxes can be tested
+ * at once. The streams are padded to a multiple of four boxes.
+ */
+struct BoxStreams
+{
+  /**
+   * Removes every box, keeping the memory allocated for them.
+   */
+  void Clear()
+  {
+    mCenterX.clear();
+    mCenterY.clear();
+    mCenterZ.clear();
+    mExtentX.clear();
+    mExtentY.clear();
+    mExtentZ.clear();
+    mSize = 0;
+  }
+
+  /**
+   * Adds a box to the end of the streams.
+   *
+   * @param aBox The box to add.
+   * @return The index of the box.
+   */
+  std::size_t Add(const AABB& aBox)
+  {
+    // Grow the streams four boxes at a time, so that the last group of four
+    // can always be loaded at once.
+    if(mSize % 4 == 0)
+    {
+      for(auto* values : { &mCenterX, &mCenterY, &mCenterZ, &mExtentX, &mExtentY, &mExtentZ })
+      {
+        values->resize(mSize + 4, 0.0f);
+      }
+    }
+
+    auto center = GetCenter(aBox);
+    auto extents = GetExtents(aBox);
+    mCenterX[mSize] = center.x;
+    mCenterY[mSize] = center.y;
+    mCenterZ[mSize] = center.z;
+    mExtentX[mSize] = extents.x;
+    mExtentY[mSize] = extents.y;
+    mExtentZ[mSize] = extents.z;
+
+    return mSize++;
+  }
+
+  /**
+   * Returns the number of boxes in the streams, not counting padding.
+   *
+   * @return The number of boxes.
+   */
+  std::size_t Size() const { return mSize; }
+
+  std::vector<float> mCenterX;
+  std::vector<float> mCenterY;
+  std::vector<float> mCenterZ;
+  std::vector<float> mExtentX;
+  std::vector<float> mExtentY;
+  std::vector<float> mExtentZ;
+
+  std::size_t mSize { 0 };
+};
+
+/**
+ * A list of spheres, stored as a separate stream of floats for each
+ * component so that four spheres can be tested at once. The streams are
+ * padded to a multiple of four spheres.
+ */
+struct SphereStreams
+{
+  /**
+   * Removes every sphere, keeping the memory allocated for them.
+   */
+  void Clear()
+  {
+    mCenterX.clear();
+    mCenterY.clear();
+    mCenterZ.clear();
+    mRadius.clear();
+    mSize = 0;
+  }
+
+  /**
+   * Adds a sphere to the end of the streams.
+   *
+   * @param aSphere The sphere to add.
+   * @return The index of the sphere.
+   */
+  std::size_t Add(const Sphere& aSphere)
+  {
+    if(mSize % 4 == 0)
+    {
+      for(auto* values : { &mCenterX, &mCenterY, &mCenterZ, &mRadius })
+      {
+        values->resize(mSize + 4, 0.0f);
+      }
+    }
+
+    mCenterX[mSize] = aSphere.mCenter.x;
+    mCenterY[mSize] = aSphere.mCenter.y;
+    mCenterZ[mSize] = aSphere.mCenter.z;
+    mRadius[mSize] = aSphere.mRadius;
+
+    return mSize++;
+  }
+
+  /**
+   * Returns the number of spheres in the streams, not counting padding.
+   *
+   * @return The number of spheres.
+   */
+  std::size_t Size() const { return mSize; }
+
+  std::vector<float> mCenterX;
+  std::vector<float> mCenterY;
+  std::vector<float> mCenterZ;
+  std::vector<float> mRadius;
+
+  std::size_t mSize { 0 };
+};
+
+/**
+ * The planes of a frustum, each component loaded into every lane.
+ */
+struct FrustumPlanes
+{
+  Float4 mNormalX[6];
+  Float4 mNormalY[6];
+  Float4 mNormalZ[6];
+  Float4 mDistance[6];
+
+  // The absolute value of each normal, for projecting box extents.
+  Float4 mAbsNormalX[6];
+  Float4 mAbsNormalY[6];
+  Float4 mAbsNormalZ[6];
+};
+
+/**
+ * Loads the planes of a frustum for testing four objects at a time.
+ *
+ * @param aFrustum The frustum.
+ * @return The planes of the frustum.
+ */
+inline FrustumPlanes LoadFrustumPlanes(const Frustum& aFrustum)
+{
+  FrustumPlanes planes;
+  for(int i = 0; i < 6; ++i)
+  {
+    const auto& plane = aFrustum.mPlanes[i];
+    planes.mNormalX[i] = SplatFloat4(plane.mNormal.x);
+    planes.mNormalY[i] = SplatFloat4(plane.mNormal.y);
+    planes.mNormalZ[i] = SplatFloat4(plane.mNormal.z);
+    planes.mDistance[i] = SplatFloat4(plane.mDistance);
+    planes.mAbsNormalX[i] = SplatFloat4(std::abs(plane.mNormal.x));
+    planes.mAbsNormalY[i] = SplatFloat4(std::abs(plane.mNormal.y));
+    planes.mAbsNormalZ[i] = SplatFloat4(std::abs(plane.mNormal.z));
+  }
+
+  return planes;
+}
+
+/**
+ * Tests a range of boxes against a frustum, four at a time, giving the
+ * same results as Intersects() does for each box.
+ *
+ * @param aFrustum The frustum.
+ * @param aBoxes The boxes.
+ * @param aStart The first box to test; must be a multiple of 4.
+ * @param aEnd One past the last box to test. The rest of the last group of
+ *             four is tested as well.
+ * @param aResults Set to 1 for each box that might be inside the frustum,
+ *                 and 0 for each box that's outside it.
+ */
+inline void Intersects(const Frustum& aFrustum,
+                       const BoxStreams& aBoxes,
+                       std::size_t aStart,
+                       std::size_t aEnd,
+                       unsigned char* aResults)
+{
+  auto planes = LoadFrustumPlanes(aFrustum);
+
+  auto zero = SplatFloat4(0.0f);
+  for(auto i = aStart; i < aEnd; i += 4)
+  {
+    auto centerX = LoadFloat4(&aBoxes.mCenterX[i]);
+    auto centerY = LoadFloat4(&aBoxes.mCenterY[i]);
+    auto centerZ = LoadFloat4(&aBoxes.mCenterZ[i]);
+    auto extentX = LoadFloat4(&aBoxes.mExtentX[i]);
+    auto extentY = LoadFloat4(&aBoxes.mExtentY[i]);
+    auto extentZ = LoadFloat4(&aBoxes.mExtentZ[i]);
+
+    // A box is outside the frustum if it's entirely behind any plane.
+    auto outside = SplatFloat4(0.0f);
+    for(int p = 0; p < 6; ++p)
+    {
+      auto centerDistance = planes.mNormalX[p] * centerX +
+                            planes.mNormalY[p] * centerY +
+                            planes.mNormalZ[p] * centerZ +
+                            planes.mDistance[p];
+      auto radius = planes.mAbsNormalX[p] * extentX +
+                    planes.mAbsNormalY[p] * extentY +
+                    planes.mAbsNormalZ[p] * extentZ;
+      outside = outside | Less(centerDistance + radius, zero);
+    }
+
+    auto outsideMask = MoveMask(outside);
+    for(int lane = 0; lane < 4; ++lane)
+    {
+      aResults[i + lane] = ((outsideMask >> lane) & 1) ? 0 : 1;
+    }
+  }
+}
+
+/**
+ * Tests a range of spheres against a frustum, four at a time, giving the
+ * same results as Intersects() does for each sphere.
+ *
+ * @param aFrustum The frustum.
+ * @param aSpheres The spheres.
+ * @param aStart The first sphere to test; must be a multiple of 4.
+ * @param aEnd One past the last sphere to test. The rest of the last group
+ *             of four is tested as well.
+ * @param aResults Set to 1 for each sphere that might be inside the
+ *                 frustum, and 0 for each sphere that's outside it.
+ */
+inline void Intersects(const Frustum& aFrustum,
+                       const SphereStreams& aSpheres,
+                       std::size_t aStart,
+                       std::size_t aEnd,
+                       unsigned char* aResults)
+{
+  auto planes = LoadFrustumPlanes(aFrustum);
+
+  auto zero = SplatFloat4(0.0f);
+  for(auto i = aStart; i < aEnd; i += 4)
+  {
+    auto centerX = LoadFloat4(&aSpheres.mCenterX[i]);
+    auto centerY = LoadFloat4(&aSpheres.mCenterY[i]);
+    auto centerZ = LoadFloat4(&aSpheres.mCenterZ[i]);
+    auto radius = LoadFloat4(&aSpheres.mRadius[i]);
+
+    auto outside = SplatFloat4(0.0f);
+    for(int p = 0; p < 6; ++p)
+    {
+      auto centerDistance = planes.mNormalX[p] * centerX +
+                            planes.mNormalY[p] * centerY +
+                            planes.mNormalZ[p] * centerZ +
+                            planes.mDistance[p];
+      outside = outside | Less(centerDistance + radius, zero);
+    }
+
+    auto outsideMask = MoveMask(outside);
+    for(int lane = 0; lane < 4; ++lane)
+    {
+      aResults[i + lane] = ((outsideMask >> lane) & 1) ? 0 : 1;
+    }
+  }
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,888 @@
+#ifndef GEOMETRY_HPP
+#define GEOMETRY_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Mat4.hpp"
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * An axis-aligned bounding box. A default-constructed box is empty (its
+ * minimum is greater than its maximum), and grows to fit each point added
+ * to it with Expand().
+ */
+struct AABB
+{
+  Vec3 mMin { std::numeric_limits<float>::max(),
+              std::numeric_limits<float>::max(),
+              std::numeric_limits<float>::max() };
+  Vec3 mMax { std::numeric_limits<float>::lowest(),
+              std::numeric_limits<float>::lowest(),
+              std::numeric_limits<float>::lowest() };
+};
+
+/**
+ * A sphere.
+ */
+struct Sphere
+{
+  Vec3 mCenter;
+  float mRadius { 0.0 };
+};
+
+/**
+ * An oriented bounding box: a box that has been rotated so its edges line
+ * up with three perpendicular, normalized axes rather than with the x, y
+ * and z axes.
+ */
+struct OBB
+{
+  Vec3 mCenter;
+  Vec3 mAxes[3] { Vec3(1.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), Vec3(0.0, 0.0, 1.0) };
+
+  // Half the box's size along each of its axes.
+  Vec3 mHalfExtents;
+};
+
+/**
+ * A ray, made up of every point mOrigin + t * mDirection where t >= 0.
+ * The direction doesn't need to be normalized; distances along the ray
+ * are measured in multiples of its length.
+ */
+struct Ray
+{
+  Vec3 mOrigin;
+  Vec3 mDirection { 0.0, 0.0, -1.0 };
+};
+
+/**
+ * A plane, made up of every point p where Dot(mNormal, p) + mDistance = 0.
+ * Points on the side the normal faces are in front of the plane.
+ */
+struct Plane
+{
+  Vec3 mNormal;
+  float mDistance { 0.0 };
+};
+
+/**
+ * The six planes bounding a camera's view (left, right, bottom, top, near
+ * and far), each facing inward.
+ */
+struct Frustum
+{
+  Plane mPlanes[6];
+};
+
+/**
+ * Returns whether a box contains no points at all.
+ *
+ * @param aBox The box to check.
+ * @return True if the box is empty, false otherwise.
+ */
+inline bool IsEmpty(const AABB& aBox)
+{
+  return aBox.mMin.x > aBox.mMax.x ||
+         aBox.mMin.y > aBox.mMax.y ||
+         aBox.mMin.z > aBox.mMax.z;
+}
+
+/**
+ * Grows a box to fit the given point.
+ *
+ * @param aBox The box to grow.
+ * @param aPoint The point to fit.
+ */
+inline void Expand(AABB& aBox, const Vec3& aPoint)
+{
+  aBox.mMin = Vec3(std::min(aBox.mMin.x, aPoint.x),
+                   std::min(aBox.mMin.y, aPoint.y),
+                   std::min(aBox.mMin.z, aPoint.z));
+  aBox.mMax = Vec3(std::max(aBox.mMax.x, aPoint.x),
+                   std::max(aBox.mMax.y, aPoint.y),
+                   std::max(aBox.mMax.z, aPoint.z));
+}
+
+/**
+ * Returns the smallest box containing both of the given boxes.
+ *
+ * @param aBoxA The first box.
+ * @param aBoxB The second box.
+ * @return A box containing both boxes.
+ */
+inline AABB Merge(const AABB& aBoxA, const AABB& aBoxB)
+{
+  AABB result;
+  result.mMin = Vec3(std::min(aBoxA.mMin.x, aBoxB.mMin.x),
+                     std::min(aBoxA.mMin.y, aBoxB.mMin.y),
+                     std::min(aBoxA.mMin.z, aBoxB.mMin.z));
+  result.mMax = Vec3(std::max(aBoxA.mMax.x, aBoxB.mMax.x),
+                     std::max(aBoxA.mMax.y, aBoxB.mMax.y),
+                     std::max(aBoxA.mMax.z, aBoxB.mMax.z));
+  return result;
+}
+
+/**
+ * Returns whether one box entirely contains another.
+ *
+ * @param aOuter The containing box.
+ * @param aInner The contained box.
+ * @return True if every point of aInner is inside aOuter, false otherwise.
+ */
+inline bool Contains(const AABB& aOuter, const AABB& aInner)
+{
+  return aOuter.mMin.x <= aInner.mMin.x && aInner.mMax.x <= aOuter.mMax.x &&
+         aOuter.mMin.y <= aInner.mMin.y && aInner.mMax.y <= aOuter.mMax.y &&
+         aOuter.mMin.z <= aInner.mMin.z && aInner.mMax.z <= aOuter.mMax.z;
+}
+
+/**
+ * Returns whether a box contains a point. Points on the box's surface are
+ * contained.
+ *
+ * @param aBox The box.
+ * @param aPoint The point.
+ * @return True if the point is inside the box, false otherwise.
+ */
+inline bool Contains(const AABB& aBox, const Vec3& aPoint)
+{
+  return aBox.mMin.x <= aPoint.x && aPoint.x <= aBox.mMax.x &&
+         aBox.mMin.y <= aPoint.y && aPoint.y <= aBox.mMax.y &&
+         aBox.mMin.z <= aPoint.z && aPoint.z <= aBox.mMax.z;
+}
+
+/**
+ * Returns the surface area of a box.
+ *
+ * @param aBox The box.
+ * @return The surface area of the box; 0 if the box is empty.
+ */
+inline float GetSurfaceArea(const AABB& aBox)
+{
+  if(IsEmpty(aBox))
+  {
+    return 0.0f;
+  }
+
+  auto x = aBox.mMax.x - aBox.mMin.x;
+  auto y = aBox.mMax.y - aBox.mMin.y;
+  auto z = aBox.mMax.z - aBox.mMin.z;
+  return 2.0f * (x * y + y * z + z * x);
+}
+
+/**
+ * Returns the center of a box.
+ *
+ * @param aBox The box.
+ * @return The center of the box.
+ */
+inline Vec3 GetCenter(const AABB& aBox)
+{
+  return Vec3((aBox.mMin.x + aBox.mMax.x) * 0.5f,
+              (aBox.mMin.y + aBox.mMax.y) * 0.5f,
+              (aBox.mMin.z + aBox.mMax.z) * 0.5f);
+}
+
+/**
+ * Returns the half-size of a box along each axis.
+ *
+ * @param aBox The box.
+ * @return The extents of the box.
+ */
+inline Vec3 GetExtents(const AABB& aBox)
+{
+  return Vec3((aBox.mMax.x - aBox.mMin.x) * 0.5f,
+              (aBox.mMax.y - aBox.mMin.y) * 0.5f,
+              (aBox.mMax.z - aBox.mMin.z) * 0.5f);
+}
+
+/**
+ * Transforms a box by a matrix, returning the smallest axis-aligned box
+ * that contains the result.
+ *
+ * @param aMatrix The transformation matrix.
+ * @param aBox The box to transform.
+ * @return The transformed box.
+ */
+inline AABB TransformBounds(const Mat4& aMatrix, const AABB& aBox)
+{
+  if(IsEmpty(aBox))
+  {
+    return aBox;
+  }
+
+  // Transform the center, then find how far the rotated and scaled
+  // extents reach along each axis.
+  auto center = aMatrix * GetCenter(aBox);
+  auto extents = GetExtents(aBox);
+
+  Vec3 reach;
+  reach.x = std::abs(aMatrix(0, 0)) * extents.x + std::abs(aMatrix(1, 0)) * extents.y + std::abs(aMatrix(2, 0)) * extents.z;
+  reach.y = std::abs(aMatrix(0, 1)) * extents.x + std::abs(aMatrix(1, 1)) * extents.y + std::abs(aMatrix(2, 1)) * extents.z;
+  reach.z = std::abs(aMatrix(0, 2)) * extents.x + std::abs(aMatrix(1, 2)) * extents.y + std::abs(aMatrix(2, 2)) * extents.z;
+
+  AABB result;
+  result.mMin = Vec3(center.x - reach.x, center.y - reach.y, center.z - reach.z);
+  result.mMax = Vec3(center.x + reach.x, center.y + reach.y, center.z + reach.z);
+  return result;
+}
+
+/**
+ * Returns the smallest sphere containing a box.
+ *
+ * @param aBox The box.
+ * @return A sphere containing the box; a sphere with no radius if the box
+ *         is empty.
+ */
+inline Sphere GetBoundingSphere(const AABB& aBox)
+{
+  Sphere result;
+  if(!IsEmpty(aBox))
+  {
+    auto extents = GetExtents(aBox);
+    result.mCenter = GetCenter(aBox);
+    result.mRadius = std::sqrt(extents.x * extents.x +
+                               extents.y * extents.y +
+                               extents.z * extents.z);
+  }
+
+  return result;
+}
+
+/**
+ * Returns the smallest sphere containing both of the given spheres.
+ *
+ * @param aSphereA The first sphere.
+ * @param aSphereB The second sphere.
+ * @return A sphere containing both spheres.
+ */
+inline Sphere Merge(const Sphere& aSphereA, const Sphere& aSphereB)
+{
+  Vec3 offset(aSphereB.mCenter.x - aSphereA.mCenter.x,
+              aSphereB.mCenter.y - aSphereA.mCenter.y,
+              aSphereB.mCenter.z - aSphereA.mCenter.z);
+  auto distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+
+  // If one sphere is inside the other, the larger one is the result.
+  if(distance + aSphereB.mRadius <= aSphereA.mRadius)
+  {
+    return aSphereA;
+  }
+  if(distance + aSphereA.mRadius <= aSphereB.mRadius)
+  {
+    return aSphereB;
+  }
+
+  // Otherwise, the result spans from the far side of one sphere to the far
+  // side of the other.
+  Sphere result;
+  result.mRadius = (distance + aSphereA.mRadius + aSphereB.mRadius) * 0.5f;
+  auto along = (result.mRadius - aSphereA.mRadius) / distance;
+  result.mCenter = Vec3(aSphereA.mCenter.x + offset.x * along,
+                        aSphereA.mCenter.y + offset.y * along,
+                        aSphereA.mCenter.z + offset.z * along);
+  return result;
+}
+
+/**
+ * Transforms a sphere by a matrix, returning the smallest sphere that
+ * contains the result. Non-uniform scales stretch the sphere into an
+ * ellipsoid, so the radius is scaled by the largest of them.
+ *
+ * @param aMatrix The transformation matrix.
+ * @param aSphere The sphere to transform.
+ * @return The transformed sphere.
+ */
+inline Sphere TransformBounds(const Mat4& aMatrix, const Sphere& aSphere)
+{
+  auto scale = 0.0f;
+  for(unsigned int c = 0; c < 3; ++c)
+  {
+    scale = std::max(scale, aMatrix(c, 0) * aMatrix(c, 0) +
+                            aMatrix(c, 1) * aMatrix(c, 1) +
+                            aMatrix(c, 2) * aMatrix(c, 2));
+  }
+
+  Sphere result;
+  result.mCenter = aMatrix * aSphere.mCenter;
+  result.mRadius = aSphere.mRadius * std::sqrt(scale);
+  return result;
+}
+
+/**
+ * Returns an oriented box covering the same space as an axis-aligned box.
+ *
+ * @param aBox The axis-aligned box, which must not be empty.
+ * @return The oriented box.
+ */
+inline OBB ToOBB(const AABB& aBox)
+{
+  OBB result;
+  result.mCenter = GetCenter(aBox);
+  result.mHalfExtents = GetExtents(aBox);
+  return result;
+}
+
+/**
+ * Transforms an oriented box by a matrix. Each of the box's axes must stay
+ * perpendicular to the others, which is the case for any matrix built from
+ * a translation, rotation and scale when the box is in the space being
+ * scaled.
+ *
+ * @param aMatrix The transformation matrix.
+ * @param aBox The box to transform.
+ * @return The transformed box.
+ */
+inline OBB TransformBounds(const Mat4& aMatrix, const OBB& aBox)
+{
+  OBB result;
+  result.mCenter = aMatrix * aBox.mCenter;
+
+  // Each axis is rotated and scaled without being translated; the scaling
+  // moves into the extents so the axes stay normalized.
+  float halfExtents[3] = { aBox.mHalfExtents.x, aBox.mHalfExtents.y, aBox.mHalfExtents.z };
+  float scaledExtents[3];
+  for(int i = 0; i < 3; ++i)
+  {
+    const auto& axis = aBox.mAxes[i];
+    Vec3 transformed(aMatrix(0, 0) * axis.x + aMatrix(1, 0) * axis.y + aMatrix(2, 0) * axis.z,
+                     aMatrix(0, 1) * axis.x + aMatrix(1, 1) * axis.y + aMatrix(2, 1) * axis.z,
+                     aMatrix(0, 2) * axis.x + aMatrix(1, 2) * axis.y + aMatrix(2, 2) * axis.z);
+    auto length = std::sqrt(transformed.x * transformed.x +
+                            transformed.y * transformed.y +
+                            transformed.z * transformed.z);
+
+    result.mAxes[i] = length > 0.0f ? transformed / length : axis;
+    scaledExtents[i] = halfExtents[i] * length;
+  }
+
+  result.mHalfExtents = Vec3(scaledExtents[0], scaledExtents[1], scaledExtents[2]);
+  return result;
+}
+
+/**
+ * Returns the smallest axis-aligned box containing an oriented box.
+ *
+ * @param aBox The oriented box.
+ * @return The axis-aligned box.
+ */
+inline AABB GetBounds(const OBB& aBox)
+{
+  const auto& axes = aBox.mAxes;
+  const auto& extents = aBox.mHalfExtents;
+
+  Vec3 reach;
+  reach.x = std::abs(axes[0].x) * extents.x + std::abs(axes[1].x) * extents.y + std::abs(axes[2].x) * extents.z;
+  reach.y = std::abs(axes[0].y) * extents.x + std::abs(axes[1].y) * extents.y + std::abs(axes[2].y) * extents.z;
+  reach.z = std::abs(axes[0].z) * extents.x + std::abs(axes[1].z) * extents.y + std::abs(axes[2].z) * extents.z;
+
+  AABB result;
+  result.mMin = aBox.mCenter - reach;
+  result.mMax = aBox.mCenter + reach;
+  return result;
+}
+
+/**
+ * Returns the smallest axis-aligned box containing a sphere.
+ *
+ * @param aSphere The sphere.
+ * @return The axis-aligned box.
+ */
+inline AABB GetBounds(const Sphere& aSphere)
+{
+  Vec3 reach(aSphere.mRadius, aSphere.mRadius, aSphere.mRadius);
+
+  AABB result;
+  result.mMin = aSphere.mCenter - reach;
+  result.mMax = aSphere.mCenter + reach;
+  return result;
+}
+
+/**
+ * Returns the point inside an oriented box that's closest to another point.
+ *
+ * @param aBox The box.
+ * @param aPoint The point.
+ * @return The closest point in the box; the point itself if it's inside.
+ */
+inline Vec3 GetClosestPoint(const OBB& aBox, const Vec3& aPoint)
+{
+  // Clamp the point's offset along each of the box's axes.
+  auto offset = aPoint - aBox.mCenter;
+  float halfExtents[3] = { aBox.mHalfExtents.x, aBox.mHalfExtents.y, aBox.mHalfExtents.z };
+
+  auto result = aBox.mCenter;
+  for(int i = 0; i < 3; ++i)
+  {
+    const auto& axis = aBox.mAxes[i];
+    auto distance = offset.x * axis.x + offset.y * axis.y + offset.z * axis.z;
+    result += axis * std::clamp(distance, -halfExtents[i], halfExtents[i]);
+  }
+
+  return result;
+}
+
+/**
+ * Creates a plane that passes through a point.
+ *
+ * @param aNormal The normalized direction the plane faces.
+ * @param aPoint A point on the plane.
+ * @return The plane.
+ */
+inline Plane CreatePlane(const Vec3& aNormal, const Vec3& aPoint)
+{
+  Plane result;
+  result.mNormal = aNormal;
+  result.mDistance = -(aNormal.x * aPoint.x + aNormal.y * aPoint.y + aNormal.z * aPoint.z);
+  return result;
+}
+
+/**
+ * Returns how far a point is in front of a plane.
+ *
+ * @param aPlane The plane, with a normalized normal.
+ * @param aPoint The point.
+ * @return The distance from the plane to the point; negative if the point
+ *         is behind the plane.
+ */
+inline float GetDistance(const Plane& aPlane, const Vec3& aPoint)
+{
+  return aPlane.mNormal.x * aPoint.x +
+         aPlane.mNormal.y * aPoint.y +
+         aPlane.mNormal.z * aPoint.z +
+         aPlane.mDistance;
+}
+
+/**
+ * Extracts the frustum planes from a combined projection and view matrix.
+ * Points are inside the frustum exactly when OpenGL wouldn't clip them.
+ *
+ * @param aMatrix The projection matrix multiplied by the view matrix.
+ * @return The frustum, with normalized planes.
+ */
+inline Frustum CalculateFrustum(const Mat4& aMatrix)
+{
+  // Each plane is the last row of the matrix plus or minus another row.
+  Frustum frustum;
+  for(int i = 0; i < 6; ++i)
+  {
+    auto row = i / 2;
+    auto sign = (i % 2 == 0) ? 1.0f : -1.0f;
+
+    auto& plane = frustum.mPlanes[i];
+    plane.mNormal = Vec3(aMatrix(0, 3) + sign * aMatrix(0, row),
+                         aMatrix(1, 3) + sign * aMatrix(1, row),
+                         aMatrix(2, 3) + sign * aMatrix(2, row));
+    plane.mDistance = aMatrix(3, 3) + sign * aMatrix(3, row);
+
+    auto length = std::sqrt(plane.mNormal.x * plane.mNormal.x +
+                            plane.mNormal.y * plane.mNormal.y +
+                            plane.mNormal.z * plane.mNormal.z);
+    if(length > 0)
+    {
+      plane.mNormal /= length;
+      plane.mDistance /= length;
+    }
+  }
+
+  return frustum;
+}
+
+/**
+ * Returns whether any part of a box might be inside a frustum. Boxes near
+ * the frustum's corners may be reported as inside when they aren't.
+ *
+ * @param aFrustum The frustum.
+ * @param aBox The box.
+ * @return False if the box is entirely outside the frustum, true otherwise.
+ */
+inline bool Intersects(const Frustum& aFrustum, const AABB& aBox)
+{
+  auto center = GetCenter(aBox);
+  auto extents = GetExtents(aBox);
+
+  for(const auto& plane : aFrustum.mPlanes)
+  {
+    auto distance = plane.mNormal.x * center.x +
+                    plane.mNormal.y * center.y +
+                    plane.mNormal.z * center.z +
+                    plane.mDistance;
+    auto radius = std::abs(plane.mNormal.x) * extents.x +
+                  std::abs(plane.mNormal.y) * extents.y +
+                  std::abs(plane.mNormal.z) * extents.z;
+    if(distance + radius < 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Returns whether any part of a sphere might be inside a frustum. Spheres
+ * near the frustum's corners may be reported as inside when they aren't.
+ *
+ * @param aFrustum The frustum.
+ * @param aSphere The sphere.
+ * @return False if the sphere is entirely outside the frustum, true
+ *         otherwise.
+ */
+inline bool Intersects(const Frustum& aFrustum, const Sphere& aSphere)
+{
+  for(const auto& plane : aFrustum.mPlanes)
+  {
+    if(GetDistance(plane, aSphere.mCenter) + aSphere.mRadius < 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Returns whether two boxes overlap. Boxes that only touch overlap.
+ *
+ * @param aBoxA The first box.
+ * @param aBoxB The second box.
+ * @return True if the boxes overlap, false otherwise.
+ */
+inline bool Intersects(const AABB& aBoxA, const AABB& aBoxB)
+{
+  return aBoxA.mMin.x <= aBoxB.mMax.x && aBoxB.mMin.x <= aBoxA.mMax.x &&
+         aBoxA.mMin.y <= aBoxB.mMax.y && aBoxB.mMin.y <= aBoxA.mMax.y &&
+         aBoxA.mMin.z <= aBoxB.mMax.z && aBoxB.mMin.z <= aBoxA.mMax.z;
+}
+
+/**
+ * Returns whether a sphere overlaps a box.
+ *
+ * @param aSphere The sphere.
+ * @param aBox The box.
+ * @return True if the sphere and box overlap, false otherwise.
+ */
+inline bool Intersects(const Sphere& aSphere, const AABB& aBox)
+{
+  if(IsEmpty(aBox))
+  {
+    return false;
+  }
+
+  // Measure the distance from the center to the closest point in the box.
+  auto dx = aSphere.mCenter.x - std::clamp(aSphere.mCenter.x, aBox.mMin.x, aBox.mMax.x);
+  auto dy = aSphere.mCenter.y - std::clamp(aSphere.mCenter.y, aBox.mMin.y, aBox.mMax.y);
+  auto dz = aSphere.mCenter.z - std::clamp(aSphere.mCenter.z, aBox.mMin.z, aBox.mMax.z);
+  return dx * dx + dy * dy + dz * dz <= aSphere.mRadius * aSphere.mRadius;
+}
+
+/**
+ * Returns whether two spheres overlap. Spheres that only touch overlap.
+ *
+ * @param aSphereA The first sphere.
+ * @param aSphereB The second sphere.
+ * @return True if the spheres overlap, false otherwise.
+ */
+inline bool Intersects(const Sphere& aSphereA, const Sphere& aSphereB)
+{
+  auto dx = aSphereA.mCenter.x - aSphereB.mCenter.x;
+  auto dy = aSphereA.mCenter.y - aSphereB.mCenter.y;
+  auto dz = aSphereA.mCenter.z - aSphereB.mCenter.z;
+  auto radius = aSphereA.mRadius + aSphereB.mRadius;
+  return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+/**
+ * Returns whether a sphere overlaps an oriented box.
+ *
+ * @param aSphere The sphere.
+ * @param aBox The box.
+ * @return True if the sphere and box overlap, false otherwise.
+ */
+inline bool Intersects(const Sphere& aSphere, const OBB& aBox)
+{
+  auto offset = aSphere.mCenter - GetClosestPoint(aBox, aSphere.mCenter);
+  return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z <= aSphere.mRadius * aSphere.mRadius;
+}
+
+/**
+ * Returns whether two oriented boxes overlap, by looking for an axis that
+ * separates them. Only fifteen axes need to be checked: the three axes of
+ * each box, and the cross product of each pair of axes from different
+ * boxes.
+ *
+ * @param aBoxA The first box.
+ * @param aBoxB The second box.
+ * @return True if the boxes overlap, false otherwise.
+ */
+inline bool Intersects(const OBB& aBoxA, const OBB& aBoxB)
+{
+  auto dot = [](const Vec3& aLhs, const Vec3& aRhs)
+  {
+    return aLhs.x * aRhs.x + aLhs.y * aRhs.y + aLhs.z * aRhs.z;
+  };
+
+  float a[3] = { aBoxA.mHalfExtents.x, aBoxA.mHalfExtents.y, aBoxA.mHalfExtents.z };
+  float b[3] = { aBoxB.mHalfExtents.x, aBoxB.mHalfExtents.y, aBoxB.mHalfExtents.z };
+
+  // Express B's axes and center in A's frame. A small amount is added to
+  // the absolute values so that nearly parallel edges, whose cross product
+  // is close to zero, don't report a separation that isn't there.
+  float r[3][3];
+  float absR[3][3];
+  for(int i = 0; i < 3; ++i)
+  {
+    for(int j = 0; j < 3; ++j)
+    {
+      r[i][j] = dot(aBoxA.mAxes[i], aBoxB.mAxes[j]);
+      absR[i][j] = std::abs(r[i][j]) + 1e-6f;
+    }
+  }
+
+  auto offset = aBoxB.mCenter - aBoxA.mCenter;
+  float t[3] = { dot(offset, aBoxA.mAxes[0]), dot(offset, aBoxA.mAxes[1]), dot(offset, aBoxA.mAxes[2]) };
+
+  // A's axes.
+  for(int i = 0; i < 3; ++i)
+  {
+    auto rb = b[0] * absR[i][0] + b[1] * absR[i][1] + b[2] * absR[i][2];
+    if(std::abs(t[i]) > a[i] + rb)
+    {
+      return false;
+    }
+  }
+
+  // B's axes.
+  for(int j = 0; j < 3; ++j)
+  {
+    auto ra = a[0] * absR[0][j] + a[1] * absR[1][j] + a[2] * absR[2][j];
+    auto distance = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+    if(std::abs(distance) > ra + b[j])
+    {
+      return false;
+    }
+  }
+
+  // The cross product of A's axis i with B's axis j.
+  for(int i = 0; i < 3; ++i)
+  {
+    auto i1 = (i + 1) % 3;
+    auto i2 = (i + 2) % 3;
+    for(int j = 0; j < 3; ++j)
+    {
+      auto j1 = (j + 1) % 3;
+      auto j2 = (j + 2) % 3;
+      auto ra = a[i1] * absR[i2][j] + a[i2] * absR[i1][j];
+      auto rb = b[j1] * absR[i][j2] + b[j2] * absR[i][j1];
+      auto distance = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+      if(std::abs(distance) > ra + rb)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Finds where a ray enters a box.
+ *
+ * @param aRay The ray.
+ * @param aBox The box.
+ * @param aMaxDistance The farthest distance along the ray to look.
+ * @param aDistance Set to the distance along the ray where it enters the
+ *                  box, or 0 if it starts inside the box.
+ * @return True if the ray hits the box within the maximum distance, false
+ *         otherwise.
+ */
+inline bool Intersects(const Ray& aRay,
+                       const AABB& aBox,
+                       float aMaxDistance,
+                       float& aDistance)
+{
+  // Clip the ray against each pair of planes (or slab) bounding the box.
+  const float origin[3] = { aRay.mOrigin.x, aRay.mOrigin.y, aRay.mOrigin.z };
+  const float direction[3] = { aRay.mDirection.x, aRay.mDirection.y, aRay.mDirection.z };
+  const float boxMin[3] = { aBox.mMin.x, aBox.mMin.y, aBox.mMin.z };
+  const float boxMax[3] = { aBox.mMax.x, aBox.mMax.y, aBox.mMax.z };
+
+  auto near = 0.0f;
+  auto far = aMaxDistance;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    if(direction[axis] == 0.0f)
+    {
+      // Rays parallel to the slab either always or never overlap it.
+      if(origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+      {
+        return false;
+      }
+      continue;
+    }
+
+    auto inverse = 1.0f / direction[axis];
+    auto enter = (boxMin[axis] - origin[axis]) * inverse;
+    auto exit = (boxMax[axis] - origin[axis]) * inverse;
+    near = std::max(near, std::min(enter, exit));
+    far = std::min(far, std::max(enter, exit));
+    if(near > far)
+    {
+      return false;
+    }
+  }
+
+  aDistance = near;
+  return true;
+}
+
+/**
+ * Finds where a ray enters a sphere.
+ *
+ * @param aRay The ray.
+ * @param aSphere The sphere.
+ * @param aMaxDistance The farthest distance along the ray to look.
+ * @param aDistance Set to the distance along the ray where it enters the
+ *                  sphere, or 0 if it starts inside the sphere.
+ * @return True if the ray hits the sphere within the maximum distance,
+ *         false otherwise.
+ */
+inline bool Intersects(const Ray& aRay,
+                       const Sphere& aSphere,
+                       float aMaxDistance,
+                       float& aDistance)
+{
+  // Solve |origin + t * direction - center|^2 = radius^2 for t.
+  const auto& d = aRay.mDirection;
+  Vec3 offset(aRay.mOrigin.x - aSphere.mCenter.x,
+              aRay.mOrigin.y - aSphere.mCenter.y,
+              aRay.mOrigin.z - aSphere.mCenter.z);
+  auto a = d.x * d.x + d.y * d.y + d.z * d.z;
+  auto b = offset.x * d.x + offset.y * d.y + offset.z * d.z;
+  auto c = offset.x * offset.x + offset.y * offset.y + offset.z * offset.z -
+           aSphere.mRadius * aSphere.mRadius;
+
+  if(c <= 0.0f)
+  {
+    aDistance = 0.0f;
+    return true;
+  }
+
+  auto discriminant = b * b - a * c;
+  if(a == 0.0f || b > 0.0f || discriminant < 0.0f)
+  {
+    return false;
+  }
+
+  auto distance = (-b - std::sqrt(discriminant)) / a;
+  if(distance > aMaxDistance)
+  {
+    return false;
+  }
+
+  aDistance = distance;
+  return true;
+}
+
+/**
+ * Finds where a ray crosses a plane, from either side.
+ *
+ * @param aRay The ray.
+ * @param aPlane The plane.
+ * @param aMaxDistance The farthest distance along the ray to look.
+ * @param aDistance Set to the distance along the ray where it crosses the
+ *                  plane.
+ * @return True if the ray crosses the plane within the maximum distance,
+ *         false otherwise.
+ */
+inline bool Intersects(const Ray& aRay,
+                       const Plane& aPlane,
+                       float aMaxDistance,
+                       float& aDistance)
+{
+  const auto& n = aPlane.mNormal;
+  auto speed = n.x * aRay.mDirection.x + n.y * aRay.mDirection.y + n.z * aRay.mDirection.z;
+  if(speed == 0.0f)
+  {
+    return false;
+  }
+
+  auto distance = -GetDistance(aPlane, aRay.mOrigin) / speed;
+  if(distance < 0.0f || distance > aMaxDistance)
+  {
+    return false;
+  }
+
+  aDistance = distance;
+  return true;
+}
+
+/**
+ * Finds where a ray hits a triangle, from either side.
+ *
+ * @param aRay The ray.
+ * @param aA The first vertex of the triangle.
+ * @param aB The second vertex of the triangle.
+ * @param aC The third vertex of the triangle.
+ * @param aMaxDistance The farthest distance along the ray to look.
+ * @param aDistance Set to the distance along the ray where it hits the
+ *                  triangle.
+ * @return True if the ray hits the triangle within the maximum distance,
+ *         false otherwise.
+ */
+inline bool Intersects(const Ray& aRay,
+                       const Vec3& aA,
+                       const Vec3& aB,
+                       const Vec3& aC,
+                       float aMaxDistance,
+                       float& aDistance)
+{
+  // Solve for the distance and the barycentric coordinates of the hit
+  // (the Moller-Trumbore algorithm).
+  Vec3 edgeAB(aB.x - aA.x, aB.y - aA.y, aB.z - aA.z);
+  Vec3 edgeAC(aC.x - aA.x, aC.y - aA.y, aC.z - aA.z);
+  const auto& d = aRay.mDirection;
+
+  Vec3 p(d.y * edgeAC.z - d.z * edgeAC.y,
+         d.z * edgeAC.x - d.x * edgeAC.z,
+         d.x * edgeAC.y - d.y * edgeAC.x);
+  auto determinant = edgeAB.x * p.x + edgeAB.y * p.y + edgeAB.z * p.z;
+  if(std::abs(determinant) < 1e-12f)
+  {
+    return false;
+  }
+  auto inverse = 1.0f / determinant;
+
+  Vec3 t(aRay.mOrigin.x - aA.x, aRay.mOrigin.y - aA.y, aRay.mOrigin.z - aA.z);
+  auto u = (t.x * p.x + t.y * p.y + t.z * p.z) * inverse;
+  if(u < 0.0f || u > 1.0f)
+  {
+    return false;
+  }
+
+  Vec3 q(t.y * edgeAB.z - t.z * edgeAB.y,
+         t.z * edgeAB.x - t.x * edgeAB.z,
+         t.x * edgeAB.y - t.y * edgeAB.x);
+  auto v = (d.x * q.x + d.y * q.y + d.z * q.z) * inverse;
+  if(v < 0.0f || u + v > 1.0f)
+  {
+    return false;
+  }
+
+  auto distance = (edgeAC.x * q.x + edgeAC.y * q.y + edgeAC.z * q.z) * inverse;
+  if(distance < 0.0f || distance > aMaxDistance)
+  {
+    return false;
+  }
+
+  aDistance = distance;
+  return true;
+}
+
+} // namespace Kuma3D
+
+#endif
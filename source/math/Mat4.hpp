@@ -3,15 +3,18 @@
 
 #include <ostream>
 
+#include "Simd.hpp"
 #include "Vec3.hpp"
+#include "Vec4.hpp"
 
 namespace Kuma3D {
 
 /**
  * A 4x4 matrix used for vector transformation purposes. The values of the
- * matrix are stored in column-major order.
+ * matrix are stored in column-major order, and each column is aligned so
+ * that it can be loaded with a single SIMD instruction.
  */
-class Mat4
+class alignas(16) Mat4
 {
   public:
 
@@ -77,31 +80,51 @@ inline std::ostream& operator<<(std::ostream& os, const Mat4& rhs)
 /******************************************************************************/
 inline Mat4 operator*(const Mat4& lhs, const Mat4& rhs)
 {
-  return Mat4(lhs(0, 0) * rhs(0, 0) + lhs(1, 0) * rhs(0, 1) + lhs(2, 0) * rhs(0, 2) + lhs(3, 0) * rhs(0, 3),
-              lhs(0, 0) * rhs(1, 0) + lhs(1, 0) * rhs(1, 1) + lhs(2, 0) * rhs(1, 2) + lhs(3, 0) * rhs(1, 3),
-              lhs(0, 0) * rhs(2, 0) + lhs(1, 0) * rhs(2, 1) + lhs(2, 0) * rhs(2, 2) + lhs(3, 0) * rhs(2, 3),
-              lhs(0, 0) * rhs(3, 0) + lhs(1, 0) * rhs(3, 1) + lhs(2, 0) * rhs(3, 2) + lhs(3, 0) * rhs(3, 3),
-              lhs(0, 1) * rhs(0, 0) + lhs(1, 1) * rhs(0, 1) + lhs(2, 1) * rhs(0, 2) + lhs(3, 1) * rhs(0, 3),
-              lhs(0, 1) * rhs(1, 0) + lhs(1, 1) * rhs(1, 1) + lhs(2, 1) * rhs(1, 2) + lhs(3, 1) * rhs(1, 3),
-              lhs(0, 1) * rhs(2, 0) + lhs(1, 1) * rhs(2, 1) + lhs(2, 1) * rhs(2, 2) + lhs(3, 1) * rhs(2, 3),
-              lhs(0, 1) * rhs(3, 0) + lhs(1, 1) * rhs(3, 1) + lhs(2, 1) * rhs(3, 2) + lhs(3, 1) * rhs(3, 3),
-              lhs(0, 2) * rhs(0, 0) + lhs(1, 2) * rhs(0, 1) + lhs(2, 2) * rhs(0, 2) + lhs(3, 2) * rhs(0, 3),
-              lhs(0, 2) * rhs(1, 0) + lhs(1, 2) * rhs(1, 1) + lhs(2, 2) * rhs(1, 2) + lhs(3, 2) * rhs(1, 3),
-              lhs(0, 2) * rhs(2, 0) + lhs(1, 2) * rhs(2, 1) + lhs(2, 2) * rhs(2, 2) + lhs(3, 2) * rhs(2, 3),
-              lhs(0, 2) * rhs(3, 0) + lhs(1, 2) * rhs(3, 1) + lhs(2, 2) * rhs(3, 2) + lhs(3, 2) * rhs(3, 3),
-              lhs(0, 3) * rhs(0, 0) + lhs(1, 3) * rhs(0, 1) + lhs(2, 3) * rhs(0, 2) + lhs(3, 3) * rhs(0, 3),
-              lhs(0, 3) * rhs(1, 0) + lhs(1, 3) * rhs(1, 1) + lhs(2, 3) * rhs(1, 2) + lhs(3, 3) * rhs(1, 3),
-              lhs(0, 3) * rhs(2, 0) + lhs(1, 3) * rhs(2, 1) + lhs(2, 3) * rhs(2, 2) + lhs(3, 3) * rhs(2, 3),
-              lhs(0, 3) * rhs(3, 0) + lhs(1, 3) * rhs(3, 1) + lhs(2, 3) * rhs(3, 2) + lhs(3, 3) * rhs(3, 3));
+  // Each column of the result is a combination of the columns of lhs,
+  // weighted by the matching column of rhs.
+  auto lhs0 = LoadFloat4(lhs.data[0]);
+  auto lhs1 = LoadFloat4(lhs.data[1]);
+  auto lhs2 = LoadFloat4(lhs.data[2]);
+  auto lhs3 = LoadFloat4(lhs.data[3]);
+
+  Mat4 result;
+  for(int c = 0; c < 4; ++c)
+  {
+    auto column = lhs0 * SplatFloat4(rhs(c, 0)) +
+                  lhs1 * SplatFloat4(rhs(c, 1)) +
+                  lhs2 * SplatFloat4(rhs(c, 2)) +
+                  lhs3 * SplatFloat4(rhs(c, 3));
+    StoreFloat4(result.data[c], column);
+  }
+
+  return result;
+};
+
+/******************************************************************************/
+inline Vec4 operator*(const Mat4& lhs, const Vec4& rhs)
+{
+  auto column = LoadFloat4(lhs.data[0]) * SplatFloat4(rhs.x) +
+                LoadFloat4(lhs.data[1]) * SplatFloat4(rhs.y) +
+                LoadFloat4(lhs.data[2]) * SplatFloat4(rhs.z) +
+                LoadFloat4(lhs.data[3]) * SplatFloat4(rhs.w);
+
+  Vec4 result;
+  StoreFloat4(&result.x, column);
+  return result;
 };
 
 /******************************************************************************/
 inline Vec3 operator*(const Mat4& lhs, const Vec3& rhs)
 {
   // This operation assumes a w-coordinate of 1.0.
-  return Vec3(lhs(0, 0) * rhs.x + lhs(1, 0) * rhs.y + lhs(2, 0) * rhs.z + lhs(3, 0) * 1.0,
-              lhs(0, 1) * rhs.x + lhs(1, 1) * rhs.y + lhs(2, 1) * rhs.z + lhs(3, 1) * 1.0,
-              lhs(0, 2) * rhs.x + lhs(1, 2) * rhs.y + lhs(2, 2) * rhs.z + lhs(3, 2) * 1.0);
+  auto column = LoadFloat4(lhs.data[0]) * SplatFloat4(rhs.x) +
+                LoadFloat4(lhs.data[1]) * SplatFloat4(rhs.y) +
+                LoadFloat4(lhs.data[2]) * SplatFloat4(rhs.z) +
+                LoadFloat4(lhs.data[3]);
+
+  float values[4];
+  StoreFloat4(values, column);
+  return Vec3(values[0], values[1], values[2]);
 };
 
 } // namespace Kuma3D
@@ -4,9 +4,15 @@
 #include <math.h>
 
 #include "Camera.hpp"
+#include "Transform.hpp"
+
+#include "Geometry.hpp"
 
 #include "Mat4.hpp"
+#include "Quat.hpp"
+#include "Simd.hpp"
 #include "Vec3.hpp"
+#include "Vec4.hpp"
 
 namespace Kuma3D {
 
@@ -18,9 +24,11 @@ namespace Kuma3D {
  */
 inline Vec3 Normalize(const Vec3& aVector)
 {
-  auto magnitude = std::sqrt(std::pow(aVector.x, 2) +
-                             std::pow(aVector.y, 2) +
-                             std::pow(aVector.z, 2));
+  // Squaring in double precision gives the same (exact) result as
+  // std::pow(), without the cost of calling it.
+  auto magnitude = std::sqrt(static_cast<double>(aVector.x) * aVector.x +
+                             static_cast<double>(aVector.y) * aVector.y +
+                             static_cast<double>(aVector.z) * aVector.z);
 
   Vec3 result(0, 0, 0);
   if(magnitude > 0)
@@ -68,6 +76,21 @@ inline float Dot(const Vec3& aVectorA, const Vec3& aVectorB)
   return (xx + yy + zz);
 }
 
+/**
+ * Calculates the dot product of two 4-dimensional vectors and returns it.
+ *
+ * @param aVectorA The first vector in the equation.
+ * @param aVectorB The second vector in the equation.
+ * @return The dot product of the two vectors.
+ */
+inline float Dot(const Vec4& aVectorA, const Vec4& aVectorB)
+{
+  float products[4];
+  StoreFloat4(products, LoadFloat4(&aVectorA.x) * LoadFloat4(&aVectorB.x));
+
+  return (products[0] + products[1] + products[2] + products[3]);
+}
+
 /**
  * Calculates the distance between two vectors and returns it.
  *
@@ -81,7 +104,9 @@ inline float Distance(const Vec3& aVectorA, const Vec3& aVectorB)
   auto yVal = aVectorB.y - aVectorA.y;
   auto zVal = aVectorB.z - aVectorA.z;
 
-  return std::sqrt(std::pow(xVal, 2) + std::pow(yVal, 2) + std::pow(zVal, 2));
+  return std::sqrt(static_cast<double>(xVal) * xVal +
+                   static_cast<double>(yVal) * yVal +
+                   static_cast<double>(zVal) * zVal);
 }
 
 /**
@@ -134,9 +159,9 @@ inline Mat4 Rotate(const Vec3& aVector,
   float vy = aVector.y;
   float vz = aVector.z;
 
-  float vx2 = std::pow(vx, 2) * d;
-  float vy2 = std::pow(vy, 2) * d;
-  float vz2 = std::pow(vz, 2) * d;
+  float vx2 = static_cast<double>(vx) * vx * d;
+  float vy2 = static_cast<double>(vy) * vy * d;
+  float vz2 = static_cast<double>(vz) * vz * d;
 
   float vxvy = (vx * vy) * d;
   float vxvz = (vx * vz) * d;
@@ -148,6 +173,153 @@ inline Mat4 Rotate(const Vec3& aVector,
               0.0, 0.0, 0.0, 1.0);
 }
 
+/**
+ * Creates and returns a rotation of a given number of degrees around a
+ * given axis. This is the same rotation as Rotate() creates. Note that the
+ * given axis must be normalized before calling this function!
+ *
+ * @param aVector The normalized axis of rotation.
+ * @param aDegrees The amount of degrees to rotate.
+ * @return A rotation.
+ */
+inline Quat AxisAngle(const Vec3& aVector,
+                      float aDegrees)
+{
+  double halfAngle = aDegrees * (M_PI / 360.0);
+  float s = std::sin(halfAngle);
+
+  return Quat(aVector.x * s, aVector.y * s, aVector.z * s, std::cos(halfAngle));
+}
+
+/**
+ * Calculates the dot product of two quaternions and returns it.
+ *
+ * @param aQuatA The first quaternion in the equation.
+ * @param aQuatB The second quaternion in the equation.
+ * @return The dot product of the two quaternions.
+ */
+inline float Dot(const Quat& aQuatA, const Quat& aQuatB)
+{
+  return (aQuatA.x * aQuatB.x) + (aQuatA.y * aQuatB.y) +
+         (aQuatA.z * aQuatB.z) + (aQuatA.w * aQuatB.w);
+}
+
+/**
+ * Creates and returns the normalized version of a given quaternion.
+ *
+ * @param aQuat The quaternion to normalize.
+ * @return The normalized version of the given quaternion, or the identity
+ *         rotation if it has no length.
+ */
+inline Quat Normalize(const Quat& aQuat)
+{
+  auto magnitude = std::sqrt(static_cast<double>(aQuat.x) * aQuat.x +
+                             static_cast<double>(aQuat.y) * aQuat.y +
+                             static_cast<double>(aQuat.z) * aQuat.z +
+                             static_cast<double>(aQuat.w) * aQuat.w);
+
+  Quat result;
+  if(magnitude > 0)
+  {
+    result.x = aQuat.x / magnitude;
+    result.y = aQuat.y / magnitude;
+    result.z = aQuat.z / magnitude;
+    result.w = aQuat.w / magnitude;
+  }
+
+  return result;
+}
+
+/**
+ * Creates and returns the inverse of a given rotation. Note that the given
+ * quaternion must be normalized before calling this function!
+ *
+ * @param aQuat The rotation to invert.
+ * @return A rotation that undoes the given rotation.
+ */
+inline Quat Inverse(const Quat& aQuat)
+{
+  return Quat(-aQuat.x, -aQuat.y, -aQuat.z, aQuat.w);
+}
+
+/**
+ * Creates and returns a rotation matrix that performs the same rotation as
+ * a given quaternion. Note that the given quaternion must be normalized
+ * before calling this function!
+ *
+ * @param aQuat The rotation.
+ * @return A rotation transformation matrix.
+ */
+inline Mat4 ToMatrix(const Quat& aQuat)
+{
+  auto xx = aQuat.x * aQuat.x;
+  auto yy = aQuat.y * aQuat.y;
+  auto zz = aQuat.z * aQuat.z;
+  auto xy = aQuat.x * aQuat.y;
+  auto xz = aQuat.x * aQuat.z;
+  auto yz = aQuat.y * aQuat.z;
+  auto wx = aQuat.w * aQuat.x;
+  auto wy = aQuat.w * aQuat.y;
+  auto wz = aQuat.w * aQuat.z;
+
+  return Mat4(1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy), 0.0,
+              2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx), 0.0,
+              2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy), 0.0,
+              0.0, 0.0, 0.0, 1.0);
+}
+
+/**
+ * Creates and returns a quaternion that performs the same rotation as a
+ * given rotation matrix. Only the upper 3x3 part of the matrix is used, and
+ * it must not contain any scaling.
+ *
+ * @param aMatrix The rotation transformation matrix.
+ * @return A normalized rotation.
+ */
+inline Quat ToQuat(const Mat4& aMatrix)
+{
+  // Divide by the largest of the four components, to avoid dividing by a
+  // number close to zero.
+  const auto& m = aMatrix;
+  auto trace = m(0, 0) + m(1, 1) + m(2, 2);
+
+  Quat result;
+  if(trace > 0.0f)
+  {
+    auto s = std::sqrt(trace + 1.0f) * 2.0f;
+    result = Quat((m(1, 2) - m(2, 1)) / s,
+                  (m(2, 0) - m(0, 2)) / s,
+                  (m(0, 1) - m(1, 0)) / s,
+                  0.25f * s);
+  }
+  else if(m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+  {
+    auto s = std::sqrt(1.0f + m(0, 0) - m(1, 1) - m(2, 2)) * 2.0f;
+    result = Quat(0.25f * s,
+                  (m(1, 0) + m(0, 1)) / s,
+                  (m(2, 0) + m(0, 2)) / s,
+                  (m(1, 2) - m(2, 1)) / s);
+  }
+  else if(m(1, 1) > m(2, 2))
+  {
+    auto s = std::sqrt(1.0f + m(1, 1) - m(0, 0) - m(2, 2)) * 2.0f;
+    result = Quat((m(1, 0) + m(0, 1)) / s,
+                  0.25f * s,
+                  (m(2, 1) + m(1, 2)) / s,
+                  (m(2, 0) - m(0, 2)) / s);
+  }
+  else
+  {
+    auto s = std::sqrt(1.0f + m(2, 2) - m(0, 0) - m(1, 1)) * 2.0f;
+    result = Quat((m(2, 0) + m(0, 2)) / s,
+                  (m(2, 1) + m(1, 2)) / s,
+                  0.25f * s,
+                  (m(0, 1) - m(1, 0)) / s);
+  }
+
+  return Normalize(result);
+}
+
 /**
  * Creates and returns a view matrix for a given direction vector,
  * right vector, and camera position.
@@ -212,6 +384,154 @@ inline Mat4 Orthographic(const Camera& aCamera)
               0.0, 0.0, 0.0, 1.0);
 }
 
+/**
+ * Calculates and returns the inverse of a matrix.
+ *
+ * @param aMatrix The matrix to invert.
+ * @return The inverse of the matrix, or the identity matrix if the matrix
+ *         can't be inverted.
+ */
+inline Mat4 Inverse(const Mat4& aMatrix)
+{
+  // Split the matrix into the 3D vectors a, b, c and d (the top three rows
+  // of each column) and the scalars x, y, z and w (the bottom row), then
+  // build the inverse from their cross products (see Lengyel, "Foundations
+  // of Game Engine Development", Volume 1, section 1.7.5). Only the first
+  // three lanes of each vector are meaningful.
+  auto a = LoadFloat4(aMatrix.data[0]);
+  auto b = LoadFloat4(aMatrix.data[1]);
+  auto c = LoadFloat4(aMatrix.data[2]);
+  auto d = LoadFloat4(aMatrix.data[3]);
+  auto x = SplatLane<3>(a);
+  auto y = SplatLane<3>(b);
+  auto z = SplatLane<3>(c);
+  auto w = SplatLane<3>(d);
+
+  auto cross = [](const Float4& aLeft, const Float4& aRight)
+  {
+    return Shuffle<1, 2, 0, 3>(aLeft) * Shuffle<2, 0, 1, 3>(aRight) -
+           Shuffle<2, 0, 1, 3>(aLeft) * Shuffle<1, 2, 0, 3>(aRight);
+  };
+  auto dot = [](const Float4& aLeft, const Float4& aRight)
+  {
+    float products[4];
+    StoreFloat4(products, aLeft * aRight);
+    return products[0] + products[1] + products[2];
+  };
+
+  auto s = cross(a, b);
+  auto t = cross(c, d);
+  auto u = a * y - b * x;
+  auto v = c * w - d * z;
+
+  auto determinant = dot(s, v) + dot(t, u);
+  if(determinant == 0.0f)
+  {
+    return Mat4();
+  }
+
+  auto inverseDeterminant = SplatFloat4(1.0f / determinant);
+  s = s * inverseDeterminant;
+  t = t * inverseDeterminant;
+  u = u * inverseDeterminant;
+  v = v * inverseDeterminant;
+
+  // Calculate each row of the inverse, then transpose them into columns.
+  float rows[4][4];
+  StoreFloat4(rows[0], cross(b, v) + t * y);
+  StoreFloat4(rows[1], cross(v, a) - t * x);
+  StoreFloat4(rows[2], cross(d, u) + s * w);
+  StoreFloat4(rows[3], cross(u, c) - s * z);
+  rows[0][3] = -dot(b, t);
+  rows[1][3] = dot(a, t);
+  rows[2][3] = -dot(d, s);
+  rows[3][3] = dot(c, s);
+
+  auto column0 = LoadFloat4(rows[0]);
+  auto column1 = LoadFloat4(rows[1]);
+  auto column2 = LoadFloat4(rows[2]);
+  auto column3 = LoadFloat4(rows[3]);
+  Transpose(column0, column1, column2, column3);
+
+  Mat4 result;
+  StoreFloat4(result.data[0], column0);
+  StoreFloat4(result.data[1], column1);
+  StoreFloat4(result.data[2], column2);
+  StoreFloat4(result.data[3], column3);
+  return result;
+}
+
+/**
+ * Calculates and returns the transpose of a matrix.
+ *
+ * @param aMatrix The matrix to transpose.
+ * @return The transpose of the matrix.
+ */
+inline Mat4 Transpose(const Mat4& aMatrix)
+{
+  auto column0 = LoadFloat4(aMatrix.data[0]);
+  auto column1 = LoadFloat4(aMatrix.data[1]);
+  auto column2 = LoadFloat4(aMatrix.data[2]);
+  auto column3 = LoadFloat4(aMatrix.data[3]);
+  Transpose(column0, column1, column2, column3);
+
+  Mat4 result;
+  StoreFloat4(result.data[0], column0);
+  StoreFloat4(result.data[1], column1);
+  StoreFloat4(result.data[2], column2);
+  StoreFloat4(result.data[3], column3);
+  return result;
+}
+
+/**
+ * Calculates the ray passing through a point on the screen, from a Camera
+ * using a perspective projection. This is useful for picking the Entity
+ * under the mouse cursor.
+ *
+ * @param aCamera The Camera.
+ * @param aTransform The Camera's Transform.
+ * @param aX The horizontal position of the point, in pixels from the left
+ *           of the viewport.
+ * @param aY The vertical position of the point, in pixels from the top of
+ *           the viewport.
+ * @param aWidth The width of the viewport, in pixels.
+ * @param aHeight The height of the viewport, in pixels.
+ * @return A ray starting on the near plane, with a normalized direction.
+ */
+inline Ray ScreenPointToRay(const Camera& aCamera,
+                            const Transform& aTransform,
+                            float aX,
+                            float aY,
+                            float aWidth,
+                            float aHeight)
+{
+  // Build the view matrix the same way the RenderSystem does.
+  auto directionVector = aTransform.mRotation * Vec3(0.0, 0.0, 1.0);
+  auto rightVector = Cross(Vec3(0.0, 1.0, 0.0), directionVector);
+  auto inverse = Inverse(Perspective(aCamera) * View(directionVector, rightVector, aTransform.mPosition));
+
+  // Move the point on the near and far planes back into world space.
+  auto ndcX = 2.0f * aX / aWidth - 1.0f;
+  auto ndcY = 1.0f - 2.0f * aY / aHeight;
+  auto unproject = [&inverse, ndcX, ndcY](float aNDCZ)
+  {
+    float result[4];
+    for(int r = 0; r < 4; ++r)
+    {
+      result[r] = inverse(0, r) * ndcX + inverse(1, r) * ndcY + inverse(2, r) * aNDCZ + inverse(3, r);
+    }
+    return Vec3(result[0] / result[3], result[1] / result[3], result[2] / result[3]);
+  };
+
+  auto nearPoint = unproject(-1.0f);
+  auto farPoint = unproject(1.0f);
+
+  Ray ray;
+  ray.mOrigin = nearPoint;
+  ray.mDirection = Normalize(farPoint - nearPoint);
+  return ray;
+}
+
 /**
  * Calculates and returns the linear interpolation between two values
  * and a third percentage value.
@@ -241,6 +561,66 @@ inline Vec3 Lerp(const Vec3& aStart, const Vec3& aTarget, float aPercent)
               Lerp(aStart.z, aTarget.z, aPercent));
 }
 
+/**
+ * Interpolates between two rotations by normalizing the linear
+ * interpolation of their components. This is cheaper than Slerp(), but
+ * doesn't rotate at a constant speed; it's close enough when the rotations
+ * are similar.
+ *
+ * @param aStart The starting rotation.
+ * @param aTarget The target rotation.
+ * @param aPercent The percentage to interpolate by, between 0.0 and 1.0.
+ * @return The rotation that is aPercent of the way towards aTarget from aStart.
+ */
+inline Quat Nlerp(const Quat& aStart, const Quat& aTarget, float aPercent)
+{
+  // A quaternion and its negation are the same rotation; pick whichever
+  // takes the shorter path.
+  auto sign = Dot(aStart, aTarget) < 0.0f ? -1.0f : 1.0f;
+
+  return Normalize(Quat(Lerp(aStart.x, sign * aTarget.x, aPercent),
+                        Lerp(aStart.y, sign * aTarget.y, aPercent),
+                        Lerp(aStart.z, sign * aTarget.z, aPercent),
+                        Lerp(aStart.w, sign * aTarget.w, aPercent)));
+}
+
+/**
+ * Interpolates between two rotations along the shortest path, at a constant
+ * speed. Note that the given quaternions must be normalized before calling
+ * this function!
+ *
+ * @param aStart The starting rotation.
+ * @param aTarget The target rotation.
+ * @param aPercent The percentage to interpolate by, between 0.0 and 1.0.
+ * @return The rotation that is aPercent of the way towards aTarget from aStart.
+ */
+inline Quat Slerp(const Quat& aStart, const Quat& aTarget, float aPercent)
+{
+  auto cosAngle = Dot(aStart, aTarget);
+  auto sign = 1.0f;
+  if(cosAngle < 0.0f)
+  {
+    cosAngle = -cosAngle;
+    sign = -1.0f;
+  }
+
+  // Very close rotations would divide by a sine close to zero.
+  if(cosAngle > 0.9995f)
+  {
+    return Nlerp(aStart, aTarget, aPercent);
+  }
+
+  auto angle = std::acos(cosAngle);
+  auto sinAngle = std::sin(angle);
+  auto startWeight = std::sin((1.0f - aPercent) * angle) / sinAngle;
+  auto targetWeight = sign * std::sin(aPercent * angle) / sinAngle;
+
+  return Quat(aStart.x * startWeight + aTarget.x * targetWeight,
+              aStart.y * startWeight + aTarget.y * targetWeight,
+              aStart.z * startWeight + aTarget.z * targetWeight,
+              aStart.w * startWeight + aTarget.w * targetWeight);
+}
+
 } // namespace Kuma3D
 
 #endif
@@ -0,0 +1,94 @@
+#ifndef QUAT_HPP
+#define QUAT_HPP
+
+#include <ostream>
+
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A quaternion representing a rotation. Use AxisAngle() to create one, and
+ * ToMatrix() to convert one into a rotation matrix (see MathUtil.hpp).
+ *
+ * Multiplying two rotations combines them, applying the right-hand rotation
+ * first, the same way multiplying rotation matrices does. Rounding errors
+ * build up when rotations are combined many times over; Normalize() the
+ * result now and then to keep it a pure rotation.
+ */
+class Quat
+{
+  public:
+
+    /**
+     * Default constructor. This initializes the quaternion to be the
+     * identity rotation.
+     */
+    Quat()
+      : x(0.0)
+      , y(0.0)
+      , z(0.0)
+      , w(1.0) {}
+
+    /**
+     * Value constructor. This allows the initialization of each value
+     * in the quaternion.
+     *
+     * @param a The x-coordinate of the vector part.
+     * @param b The y-coordinate of the vector part.
+     * @param c The z-coordinate of the vector part.
+     * @param d The scalar part.
+     */
+    Quat(float a, float b, float c, float d)
+      : x(a)
+      , y(b)
+      , z(c)
+      , w(d) {};
+
+    Quat& operator*=(const Quat& rhs)
+    {
+      auto newX = w * rhs.x + x * rhs.w + y * rhs.z - z * rhs.y;
+      auto newY = w * rhs.y - x * rhs.z + y * rhs.w + z * rhs.x;
+      auto newZ = w * rhs.z + x * rhs.y - y * rhs.x + z * rhs.w;
+      auto newW = w * rhs.w - x * rhs.x - y * rhs.y - z * rhs.z;
+      x = newX;
+      y = newY;
+      z = newZ;
+      w = newW;
+      return (*this);
+    }
+
+    float x, y, z, w;
+};
+
+/******************************************************************************/
+inline std::ostream& operator<<(std::ostream& os, const Quat& rhs)
+{
+  os << rhs.x << " " << rhs.y << " " << rhs.z << " " << rhs.w;
+  return os;
+}
+
+/******************************************************************************/
+inline Quat operator*(const Quat& lhs, const Quat& rhs)
+{
+  Quat result = lhs;
+  result *= rhs;
+  return result;
+}
+
+/******************************************************************************/
+inline Vec3 operator*(const Quat& lhs, const Vec3& rhs)
+{
+  // v' = v + 2w(u x v) + 2u x (u x v), where u is the vector part.
+  Vec3 t(2.0f * (lhs.y * rhs.z - lhs.z * rhs.y),
+         2.0f * (lhs.z * rhs.x - lhs.x * rhs.z),
+         2.0f * (lhs.x * rhs.y - lhs.y * rhs.x));
+
+  return Vec3(rhs.x + lhs.w * t.x + (lhs.y * t.z - lhs.z * t.y),
+              rhs.y + lhs.w * t.y + (lhs.z * t.x - lhs.x * t.z),
+              rhs.z + lhs.w * t.z + (lhs.x * t.y - lhs.y * t.x));
+}
+
+} // namespace Kuma3D
+
+#endif
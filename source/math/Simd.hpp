@@ -0,0 +1,398 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// The instruction set is chosen at compile time. Defining
+// KUMA3D_FORCE_SCALAR (see the FORCE_SCALAR_MATH CMake option) uses plain
+// loops instead, which give the same results.
+#if defined(KUMA3D_FORCE_SCALAR)
+  // Use the scalar fallbacks.
+#elif defined(__SSE2__) || defined(_M_X64)
+  #define KUMA3D_SIMD_SSE
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #define KUMA3D_SIMD_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace Kuma3D {
+
+/**
+ * Four floats operated on at once, using SSE or NEON when available and
+ * plain loops otherwise.
+ *
+ * Comparisons return a mask with every bit set in each lane where the
+ * comparison is true; use MoveMask() to turn it into one bit per lane.
+ */
+struct Float4
+{
+#if defined(KUMA3D_SIMD_SSE)
+  __m128 mValue;
+#elif defined(KUMA3D_SIMD_NEON)
+  float32x4_t mValue;
+#else
+  float mValue[4];
+#endif
+};
+
+/******************************************************************************/
+inline Float4 LoadFloat4(const float* aValues)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_loadu_ps(aValues);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vld1q_f32(aValues);
+#else
+  std::memcpy(result.mValue, aValues, sizeof(result.mValue));
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 SplatFloat4(float aValue)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_set1_ps(aValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vdupq_n_f32(aValue);
+#else
+  for(auto& value : result.mValue)
+  {
+    value = aValue;
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline void StoreFloat4(float* aDestination, const Float4& aValue)
+{
+#if defined(KUMA3D_SIMD_SSE)
+  _mm_storeu_ps(aDestination, aValue.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  vst1q_f32(aDestination, aValue.mValue);
+#else
+  std::memcpy(aDestination, aValue.mValue, sizeof(aValue.mValue));
+#endif
+}
+
+/******************************************************************************/
+inline Float4 operator+(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_add_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vaddq_f32(lhs.mValue, rhs.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    result.mValue[i] = lhs.mValue[i] + rhs.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 operator-(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_sub_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vsubq_f32(lhs.mValue, rhs.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    result.mValue[i] = lhs.mValue[i] - rhs.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 operator*(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_mul_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vmulq_f32(lhs.mValue, rhs.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    result.mValue[i] = lhs.mValue[i] * rhs.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 operator/(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_div_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON) && defined(__aarch64__)
+  result.mValue = vdivq_f32(lhs.mValue, rhs.mValue);
+#else
+  float left[4], right[4], values[4];
+  StoreFloat4(left, lhs);
+  StoreFloat4(right, rhs);
+  for(int i = 0; i < 4; ++i)
+  {
+    values[i] = left[i] / right[i];
+  }
+  result = LoadFloat4(values);
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 Less(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_cmplt_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vreinterpretq_f32_u32(vcltq_f32(lhs.mValue, rhs.mValue));
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    std::uint32_t mask = lhs.mValue[i] < rhs.mValue[i] ? 0xffffffff : 0;
+    std::memcpy(&result.mValue[i], &mask, sizeof(mask));
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 operator&(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_and_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(lhs.mValue),
+                                                  vreinterpretq_u32_f32(rhs.mValue)));
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    std::uint32_t a, b;
+    std::memcpy(&a, &lhs.mValue[i], sizeof(a));
+    std::memcpy(&b, &rhs.mValue[i], sizeof(b));
+    a &= b;
+    std::memcpy(&result.mValue[i], &a, sizeof(a));
+  }
+#endif
+  return result;
+}
+
+/******************************************************************************/
+inline Float4 operator|(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_or_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(lhs.mValue),
+                                                  vreinterpretq_u32_f32(rhs.mValue)));
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    std::uint32_t a, b;
+    std::memcpy(&a, &lhs.mValue[i], sizeof(a));
+    std::memcpy(&b, &rhs.mValue[i], sizeof(b));
+    a |= b;
+    std::memcpy(&result.mValue[i], &a, sizeof(a));
+  }
+#endif
+  return result;
+}
+
+/**
+ * Returns the smaller value in each lane. Like _mm_min_ps, this is
+ * lhs < rhs ? lhs : rhs, so rhs is returned wherever either value is NaN.
+ *
+ * @param lhs The first values.
+ * @param rhs The second values.
+ * @return The smaller of each pair of values.
+ */
+inline Float4 Min(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_min_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vbslq_f32(vcltq_f32(lhs.mValue, rhs.mValue), lhs.mValue, rhs.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    result.mValue[i] = lhs.mValue[i] < rhs.mValue[i] ? lhs.mValue[i] : rhs.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/**
+ * Returns the larger value in each lane. Like _mm_max_ps, this is
+ * lhs > rhs ? lhs : rhs, so rhs is returned wherever either value is NaN.
+ *
+ * @param lhs The first values.
+ * @param rhs The second values.
+ * @return The larger of each pair of values.
+ */
+inline Float4 Max(const Float4& lhs, const Float4& rhs)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_max_ps(lhs.mValue, rhs.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vbslq_f32(vcgtq_f32(lhs.mValue, rhs.mValue), lhs.mValue, rhs.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    result.mValue[i] = lhs.mValue[i] > rhs.mValue[i] ? lhs.mValue[i] : rhs.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/**
+ * Chooses between two values for each lane, according to a mask returned
+ * by a comparison.
+ *
+ * @param aMask The mask choosing each lane.
+ * @param aIfSet The value of each lane where the mask is set.
+ * @param aIfClear The value of each lane where the mask is clear.
+ * @return The chosen values.
+ */
+inline Float4 Select(const Float4& aMask, const Float4& aIfSet, const Float4& aIfClear)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_or_ps(_mm_and_ps(aMask.mValue, aIfSet.mValue),
+                            _mm_andnot_ps(aMask.mValue, aIfClear.mValue));
+#elif defined(KUMA3D_SIMD_NEON)
+  result.mValue = vbslq_f32(vreinterpretq_u32_f32(aMask.mValue), aIfSet.mValue, aIfClear.mValue);
+#else
+  for(int i = 0; i < 4; ++i)
+  {
+    std::uint32_t mask;
+    std::memcpy(&mask, &aMask.mValue[i], sizeof(mask));
+    result.mValue[i] = mask ? aIfSet.mValue[i] : aIfClear.mValue[i];
+  }
+#endif
+  return result;
+}
+
+/**
+ * Rearranges the lanes of a value.
+ *
+ * @tparam aX The lane to place in lane 0.
+ * @tparam aY The lane to place in lane 1.
+ * @tparam aZ The lane to place in lane 2.
+ * @tparam aW The lane to place in lane 3.
+ * @param aValue The value to rearrange.
+ * @return The rearranged value.
+ */
+template<int aX, int aY, int aZ, int aW>
+inline Float4 Shuffle(const Float4& aValue)
+{
+  Float4 result;
+#if defined(KUMA3D_SIMD_SSE)
+  result.mValue = _mm_shuffle_ps(aValue.mValue, aValue.mValue, _MM_SHUFFLE(aW, aZ, aY, aX));
+#else
+  float values[4];
+  StoreFloat4(values, aValue);
+  float shuffled[4] { values[aX], values[aY], values[aZ], values[aW] };
+  result = LoadFloat4(shuffled);
+#endif
+  return result;
+}
+
+/**
+ * Copies one lane of a value into every lane.
+ *
+ * @tparam aLane The lane to copy.
+ * @param aValue The value to copy a lane of.
+ * @return The copied lane, in every lane.
+ */
+template<int aLane>
+inline Float4 SplatLane(const Float4& aValue)
+{
+#if defined(KUMA3D_SIMD_NEON) && defined(__aarch64__)
+  Float4 result;
+  result.mValue = vdupq_laneq_f32(aValue.mValue, aLane);
+  return result;
+#else
+  return Shuffle<aLane, aLane, aLane, aLane>(aValue);
+#endif
+}
+
+/**
+ * Transposes the 4x4 matrix whose rows (or columns) are the given values.
+ *
+ * @param aRow0 The first row, replaced with the first column.
+ * @param aRow1 The second row, replaced with the second column.
+ * @param aRow2 The third row, replaced with the third column.
+ * @param aRow3 The fourth row, replaced with the fourth column.
+ */
+inline void Transpose(Float4& aRow0, Float4& aRow1, Float4& aRow2, Float4& aRow3)
+{
+#if defined(KUMA3D_SIMD_SSE)
+  _MM_TRANSPOSE4_PS(aRow0.mValue, aRow1.mValue, aRow2.mValue, aRow3.mValue);
+#elif defined(KUMA3D_SIMD_NEON)
+  auto rows01 = vtrnq_f32(aRow0.mValue, aRow1.mValue);
+  auto rows23 = vtrnq_f32(aRow2.mValue, aRow3.mValue);
+  aRow0.mValue = vcombine_f32(vget_low_f32(rows01.val[0]), vget_low_f32(rows23.val[0]));
+  aRow1.mValue = vcombine_f32(vget_low_f32(rows01.val[1]), vget_low_f32(rows23.val[1]));
+  aRow2.mValue = vcombine_f32(vget_high_f32(rows01.val[0]), vget_high_f32(rows23.val[0]));
+  aRow3.mValue = vcombine_f32(vget_high_f32(rows01.val[1]), vget_high_f32(rows23.val[1]));
+#else
+  Float4* rows[4] { &aRow0, &aRow1, &aRow2, &aRow3 };
+  for(int r = 0; r < 4; ++r)
+  {
+    for(int c = r + 1; c < 4; ++c)
+    {
+      auto value = rows[r]->mValue[c];
+      rows[r]->mValue[c] = rows[c]->mValue[r];
+      rows[c]->mValue[r] = value;
+    }
+  }
+#endif
+}
+
+/**
+ * Collects the sign bit of each lane into the lowest four bits of an
+ * integer (lane 0 in bit 0).
+ *
+ * @param aValue The value to collect the sign bits of.
+ * @return The sign bits.
+ */
+inline int MoveMask(const Float4& aValue)
+{
+#if defined(KUMA3D_SIMD_SSE)
+  return _mm_movemask_ps(aValue.mValue);
+#else
+  float values[4];
+  StoreFloat4(values, aValue);
+
+  int result = 0;
+  for(int i = 0; i < 4; ++i)
+  {
+    std::uint32_t bits;
+    std::memcpy(&bits, &values[i], sizeof(bits));
+    result |= static_cast<int>(bits >> 31) << i;
+  }
+  return result;
+#endif
+}
+
+} // namespace Kuma3D
+
+#endif
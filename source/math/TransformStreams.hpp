@@ -0,0 +1,290 @@
+#ifndef TRANSFORMSTREAMS_HPP
+#define TRANSFORMSTREAMS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Transform.hpp"
+
+#include "Mat4.hpp"
+#include "Quat.hpp"
+#include "Simd.hpp"
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The positions, rotations and scales of a number of objects, stored as a
+ * separate stream of floats for each component so that ComposeMatrices()
+ * can work on four objects at a time.
+ */
+struct TransformStreams
+{
+  /**
+   * Sets the number of objects in the streams. Shrinking the streams keeps
+   * the memory allocated for them.
+   *
+   * @param aSize The number of objects.
+   */
+  void Resize(std::size_t aSize)
+  {
+    mPositionX.resize(aSize);
+    mPositionY.resize(aSize);
+    mPositionZ.resize(aSize);
+    mRotationX.resize(aSize);
+    mRotationY.resize(aSize);
+    mRotationZ.resize(aSize);
+    mRotationW.resize(aSize);
+    mScaleX.resize(aSize);
+    mScaleY.resize(aSize);
+    mScaleZ.resize(aSize);
+  }
+
+  /**
+   * Sets the position, rotation and scale of an object.
+   *
+   * @param aIndex The index of the object.
+   * @param aPosition The position of the object.
+   * @param aRotation The rotation of the object, which must be normalized.
+   * @param aScale The scale of the object.
+   */
+  void Set(std::size_t aIndex,
+           const Vec3& aPosition,
+           const Quat& aRotation,
+           const Vec3& aScale)
+  {
+    mPositionX[aIndex] = aPosition.x;
+    mPositionY[aIndex] = aPosition.y;
+    mPositionZ[aIndex] = aPosition.z;
+    mRotationX[aIndex] = aRotation.x;
+    mRotationY[aIndex] = aRotation.y;
+    mRotationZ[aIndex] = aRotation.z;
+    mRotationW[aIndex] = aRotation.w;
+    mScaleX[aIndex] = aScale.x;
+    mScaleY[aIndex] = aScale.y;
+    mScaleZ[aIndex] = aScale.z;
+  }
+
+  /**
+   * Returns the number of objects in the streams.
+   *
+   * @return The number of objects.
+   */
+  std::size_t Size() const { return mPositionX.size(); }
+
+  std::vector<float> mPositionX;
+  std::vector<float> mPositionY;
+  std::vector<float> mPositionZ;
+
+  std::vector<float> mRotationX;
+  std::vector<float> mRotationY;
+  std::vector<float> mRotationZ;
+  std::vector<float> mRotationW;
+
+  std::vector<float> mScaleX;
+  std::vector<float> mScaleY;
+  std::vector<float> mScaleZ;
+};
+
+/**
+ * Builds a matrix that scales, then rotates, then translates. This gives
+ * the same result as Translate(aPosition) * ToMatrix(aRotation) *
+ * Scale(aScale), without building or multiplying any other matrices.
+ *
+ * @param aPosition The translation.
+ * @param aRotation The rotation, which must be normalized.
+ * @param aScale The scale.
+ * @return The combined matrix.
+ */
+inline Mat4 ComposeMatrix(const Vec3& aPosition,
+                          const Quat& aRotation,
+                          const Vec3& aScale)
+{
+  auto xx = aRotation.x * aRotation.x;
+  auto yy = aRotation.y * aRotation.y;
+  auto zz = aRotation.z * aRotation.z;
+  auto xy = aRotation.x * aRotation.y;
+  auto xz = aRotation.x * aRotation.z;
+  auto yz = aRotation.y * aRotation.z;
+  auto wx = aRotation.w * aRotation.x;
+  auto wy = aRotation.w * aRotation.y;
+  auto wz = aRotation.w * aRotation.z;
+
+  // Each of the first three columns is a column of the rotation matrix
+  // multiplied by the scale along that axis.
+  Mat4 result;
+  result(0, 0) = (1.0f - 2.0f * (yy + zz)) * aScale.x;
+  result(0, 1) = (2.0f * (xy + wz)) * aScale.x;
+  result(0, 2) = (2.0f * (xz - wy)) * aScale.x;
+  result(1, 0) = (2.0f * (xy - wz)) * aScale.y;
+  result(1, 1) = (1.0f - 2.0f * (xx + zz)) * aScale.y;
+  result(1, 2) = (2.0f * (yz + wx)) * aScale.y;
+  result(2, 0) = (2.0f * (xz + wy)) * aScale.z;
+  result(2, 1) = (2.0f * (yz - wx)) * aScale.z;
+  result(2, 2) = (1.0f - 2.0f * (xx + yy)) * aScale.z;
+
+  result(3, 0) = aPosition.x;
+  result(3, 1) = aPosition.y;
+  result(3, 2) = aPosition.z;
+
+  return result;
+}
+
+/**
+ * Builds the matrix of a Transform, not including its parent's.
+ *
+ * @param aTransform The Transform.
+ * @return The Transform's matrix.
+ */
+inline Mat4 ComposeMatrix(const Transform& aTransform)
+{
+  return ComposeMatrix(aTransform.mPosition, aTransform.mRotation, aTransform.mScalar);
+}
+
+/**
+ * Builds the world matrix of a Transform from its own matrix, including its
+ * parent's transformation (if it has one).
+ *
+ * @param aTransform The Transform.
+ * @param aModelMatrix The Transform's own matrix, from ComposeMatrix().
+ * @param aGetTransform A function that returns the Transform of an Entity,
+ *                      which is called for the parent.
+ * @return The world matrix.
+ */
+template<typename GetTransformFunction>
+inline Mat4 ComposeWorldMatrix(const Transform& aTransform,
+                               const Mat4& aModelMatrix,
+                               const GetTransformFunction& aGetTransform)
+{
+  if(!aTransform.mUseParent)
+  {
+    return aModelMatrix;
+  }
+
+  return ComposeMatrix(aGetTransform(aTransform.mParent)) * aModelMatrix;
+}
+
+/**
+ * Builds the world matrix of a Transform, including its parent's
+ * transformation (if it has one).
+ *
+ * @param aTransform The Transform.
+ * @param aGetTransform A function that returns the Transform of an Entity,
+ *                      which is called for the parent.
+ * @return The world matrix.
+ */
+template<typename GetTransformFunction>
+inline Mat4 ComposeWorldMatrix(const Transform& aTransform,
+                               const GetTransformFunction& aGetTransform)
+{
+  return ComposeWorldMatrix(aTransform, ComposeMatrix(aTransform), aGetTransform);
+}
+
+/**
+ * Builds the matrix of each object in a set of streams, as ComposeMatrix()
+ * does. Four objects are built at once, one in each SIMD lane, when SIMD
+ * instructions are available.
+ *
+ * @param aStreams The positions, rotations and scales of the objects.
+ * @param aMatrices The matrices to write to, one for each object.
+ */
+inline void ComposeMatrices(const TransformStreams& aStreams, Mat4* aMatrices)
+{
+  auto count = aStreams.Size();
+
+  // SIMD stores may alias anything, so read the streams' pointers once
+  // rather than after every store.
+  const auto* positionX = aStreams.mPositionX.data();
+  const auto* positionY = aStreams.mPositionY.data();
+  const auto* positionZ = aStreams.mPositionZ.data();
+  const auto* rotationX = aStreams.mRotationX.data();
+  const auto* rotationY = aStreams.mRotationY.data();
+  const auto* rotationZ = aStreams.mRotationZ.data();
+  const auto* rotationW = aStreams.mRotationW.data();
+  const auto* scaleX = aStreams.mScaleX.data();
+  const auto* scaleY = aStreams.mScaleY.data();
+  const auto* scaleZ = aStreams.mScaleZ.data();
+
+  // Without SIMD instructions, emulating four lanes is slower than
+  // building each object one at a time.
+  std::size_t i = 0;
+#if defined(KUMA3D_SIMD_SSE) || defined(KUMA3D_SIMD_NEON)
+  auto zero = SplatFloat4(0.0f);
+  auto one = SplatFloat4(1.0f);
+  auto two = SplatFloat4(2.0f);
+  for(; i + 4 <= count; i += 4)
+  {
+    auto x = LoadFloat4(rotationX + i);
+    auto y = LoadFloat4(rotationY + i);
+    auto z = LoadFloat4(rotationZ + i);
+    auto w = LoadFloat4(rotationW + i);
+    auto xx = x * x;
+    auto yy = y * y;
+    auto zz = z * z;
+    auto xy = x * y;
+    auto xz = x * z;
+    auto yz = y * z;
+    auto wx = w * x;
+    auto wy = w * y;
+    auto wz = w * z;
+
+    // Each lane holds one object; transposing turns the lanes into a
+    // column of each object's matrix.
+    auto* matrices = aMatrices + i;
+    auto sx = LoadFloat4(scaleX + i);
+    auto r0 = (one - two * (yy + zz)) * sx;
+    auto r1 = (two * (xy + wz)) * sx;
+    auto r2 = (two * (xz - wy)) * sx;
+    auto r3 = zero;
+    Transpose(r0, r1, r2, r3);
+    StoreFloat4(matrices[0].data[0], r0);
+    StoreFloat4(matrices[1].data[0], r1);
+    StoreFloat4(matrices[2].data[0], r2);
+    StoreFloat4(matrices[3].data[0], r3);
+
+    auto sy = LoadFloat4(scaleY + i);
+    r0 = (two * (xy - wz)) * sy;
+    r1 = (one - two * (xx + zz)) * sy;
+    r2 = (two * (yz + wx)) * sy;
+    r3 = zero;
+    Transpose(r0, r1, r2, r3);
+    StoreFloat4(matrices[0].data[1], r0);
+    StoreFloat4(matrices[1].data[1], r1);
+    StoreFloat4(matrices[2].data[1], r2);
+    StoreFloat4(matrices[3].data[1], r3);
+
+    auto sz = LoadFloat4(scaleZ + i);
+    r0 = (two * (xz + wy)) * sz;
+    r1 = (two * (yz - wx)) * sz;
+    r2 = (one - two * (xx + yy)) * sz;
+    r3 = zero;
+    Transpose(r0, r1, r2, r3);
+    StoreFloat4(matrices[0].data[2], r0);
+    StoreFloat4(matrices[1].data[2], r1);
+    StoreFloat4(matrices[2].data[2], r2);
+    StoreFloat4(matrices[3].data[2], r3);
+
+    r0 = LoadFloat4(positionX + i);
+    r1 = LoadFloat4(positionY + i);
+    r2 = LoadFloat4(positionZ + i);
+    r3 = one;
+    Transpose(r0, r1, r2, r3);
+    StoreFloat4(matrices[0].data[3], r0);
+    StoreFloat4(matrices[1].data[3], r1);
+    StoreFloat4(matrices[2].data[3], r2);
+    StoreFloat4(matrices[3].data[3], r3);
+  }
+#endif
+
+  // Build any remaining objects one at a time.
+  for(; i < count; ++i)
+  {
+    aMatrices[i] = ComposeMatrix(Vec3(positionX[i], positionY[i], positionZ[i]),
+                                 Quat(rotationX[i], rotationY[i], rotationZ[i], rotationW[i]),
+                                 Vec3(scaleX[i], scaleY[i], scaleZ[i]));
+  }
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef VEC4_HPP
+#define VEC4_HPP
+
+#include <ostream>
+
+#include "Simd.hpp"
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A simple 4-dimensional vector class. Unlike Vec3, a Vec4 is aligned so
+ * that it can be operated on with a single SIMD instruction.
+ */
+class alignas(16) Vec4
+{
+  public:
+    Vec4()
+      : x(0.0),
+        y(0.0),
+        z(0.0),
+        w(0.0) {}
+
+    /**
+     * Value constructor. This allows the initialization of each value
+     * in the vector.
+     *
+     * @param a The x-coordinate of the vector.
+     * @param b The y-coordinate of the vector.
+     * @param c The z-coordinate of the vector.
+     * @param d The w-coordinate of the vector.
+     */
+    Vec4(float a, float b, float c, float d)
+      : x(a)
+      , y(b)
+      , z(c)
+      , w(d) {};
+
+    /**
+     * Extends a 3-dimensional vector.
+     *
+     * @param aVector The x, y and z-coordinates of the vector.
+     * @param d The w-coordinate of the vector.
+     */
+    Vec4(const Vec3& aVector, float d)
+      : x(aVector.x)
+      , y(aVector.y)
+      , z(aVector.z)
+      , w(d) {};
+
+    Vec4& operator+=(const Vec4& rhs)
+    {
+      StoreFloat4(&x, LoadFloat4(&x) + LoadFloat4(&rhs.x));
+      return (*this);
+    }
+
+    Vec4& operator-=(const Vec4& rhs)
+    {
+      StoreFloat4(&x, LoadFloat4(&x) - LoadFloat4(&rhs.x));
+      return (*this);
+    }
+
+    Vec4& operator*=(float rhs)
+    {
+      StoreFloat4(&x, LoadFloat4(&x) * SplatFloat4(rhs));
+      return (*this);
+    }
+
+    Vec4& operator/=(float rhs)
+    {
+      StoreFloat4(&x, LoadFloat4(&x) / SplatFloat4(rhs));
+      return (*this);
+    }
+
+    float x, y, z, w;
+};
+
+/******************************************************************************/
+inline std::ostream& operator<<(std::ostream& os, const Vec4& rhs)
+{
+  os << rhs.x << " " << rhs.y << " " << rhs.z << " " << rhs.w;
+  return os;
+}
+
+/******************************************************************************/
+inline Vec4 operator+(const Vec4& lhs, const Vec4& rhs)
+{
+  Vec4 result(lhs);
+  result += rhs;
+  return result;
+}
+
+/******************************************************************************/
+inline Vec4 operator-(const Vec4& lhs, const Vec4& rhs)
+{
+  Vec4 result(lhs);
+  result -= rhs;
+  return result;
+}
+
+/******************************************************************************/
+inline Vec4 operator*(const Vec4& lhs, float rhs)
+{
+  Vec4 result(lhs);
+  result *= rhs;
+  return result;
+}
+
+/******************************************************************************/
+inline Vec4 operator/(const Vec4& lhs, float rhs)
+{
+  Vec4 result(lhs);
+  result /= rhs;
+  return result;
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,7 @@
+#include "CollisionSignals.hpp"
+
+namespace Kuma3D {
+
+SignalT<const std::vector<CollisionEvent>&, Scene&> CollisionsDetected;
+
+} // namespace Kuma3D
@@ -0,0 +1,44 @@
+#ifndef COLLISIONSIGNALS_HPP
+#define COLLISIONSIGNALS_HPP
+
+#include <vector>
+
+#include "Signal.hpp"
+
+#include "Entity.hpp"
+#include "Scene.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The ways a collision between two Entities can change from one frame to
+ * the next.
+ */
+enum class CollisionState
+{
+  eBEGIN,
+  eSTAY,
+  eEND
+};
+
+/**
+ * A collision between two Entities' Colliders. The first Entity is always
+ * the smaller of the two.
+ */
+struct CollisionEvent
+{
+  Entity mFirst { 0 };
+  Entity mSecond { 0 };
+  CollisionState mState { CollisionState::eBEGIN };
+};
+
+/**
+ * Notified once per frame by the CollisionSystem with every collision that
+ * began, continued or ended that frame, sorted by Entity. It isn't notified
+ * on frames with no collisions at all.
+ */
+extern SignalT<const std::vector<CollisionEvent>&, Scene&> CollisionsDetected;
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,266 @@
+#include "CollisionSystem.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "JobSystem.hpp"
+#include "RadixSort.hpp"
+#include "Scene.hpp"
+
+#include "TransformStreams.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void CollisionSystem::Initialize(Scene& aScene)
+{
+  // Register the Collider and Transform components.
+  if(!aScene.IsComponentTypeRegistered<Collider>())
+  {
+    aScene.RegisterComponentType<Collider>();
+  }
+
+  if(!aScene.IsComponentTypeRegistered<Transform>())
+  {
+    aScene.RegisterComponentType<Transform>();
+  }
+
+  // Set the signature to care about entities with Colliders and
+  // Transforms.
+  auto signature = aScene.CreateSignature();
+  signature[aScene.GetComponentIndex<Collider>()] = true;
+  signature[aScene.GetComponentIndex<Transform>()] = true;
+  SetSignature(signature);
+}
+
+/******************************************************************************/
+void CollisionSystem::Operate(Scene& aScene, double aTime)
+{
+  const auto& entities = GetEntities();
+
+  // Move each Collider into world space.
+  const auto& colliders = aScene.GetComponentList<Collider>();
+  const auto& transforms = aScene.GetComponentList<Transform>();
+  mWorldColliders.resize(entities.size());
+  auto getTransform = [&transforms](Entity aEntity) -> const Transform&
+  {
+    return transforms.GetComponentForEntity(aEntity);
+  };
+  JobSystem::ParallelFor(entities.size(), BATCH_SIZE, [this, &entities, &colliders, &transforms, &getTransform](std::size_t aStart, std::size_t aEnd)
+  {
+    for(auto i = aStart; i < aEnd; ++i)
+    {
+      auto worldMatrix = ComposeWorldMatrix(transforms.GetComponentForEntity(entities[i]),
+                                            getTransform);
+      mWorldColliders[i] = CalculateWorldCollider(colliders.GetComponentForEntity(entities[i]),
+                                                  worldMatrix);
+    }
+  });
+
+  // Find the pairs whose bounding boxes overlap, then test their shapes.
+  mBroadphase.Clear();
+  for(const auto& worldCollider : mWorldColliders)
+  {
+    mBroadphase.Add(worldCollider.mBox);
+  }
+  mBroadphase.FindPairs(mCandidatePairs);
+
+  mCandidateResults.resize(mCandidatePairs.size());
+  JobSystem::ParallelFor(mCandidatePairs.size(), BATCH_SIZE, [this](std::size_t aStart, std::size_t aEnd)
+  {
+    for(auto i = aStart; i < aEnd; ++i)
+    {
+      const auto& pair = mCandidatePairs[i];
+      mCandidateResults[i] = Collide(mWorldColliders[pair.first], mWorldColliders[pair.second]) ? 1 : 0;
+    }
+  });
+
+  mNewContacts.clear();
+  for(std::size_t i = 0; i < mCandidatePairs.size(); ++i)
+  {
+    if(mCandidateResults[i])
+    {
+      const auto& pair = mCandidatePairs[i];
+      mNewContacts.emplace_back(GetContactKey(entities[pair.first], entities[pair.second]));
+    }
+  }
+  RadixSort(mNewContacts, mScratchContacts, [](std::uint64_t aKey) { return aKey; });
+
+  // Compare this frame's contacts with the last frame's. Since both lists
+  // are sorted, one pass through each finds every change.
+  mEvents.clear();
+  auto addEvent = [this](std::uint64_t aKey, CollisionState aState)
+  {
+    CollisionEvent event;
+    event.mFirst = static_cast<Entity>(aKey >> 32);
+    event.mSecond = static_cast<Entity>(aKey & 0xffffffff);
+    event.mState = aState;
+    mEvents.emplace_back(event);
+  };
+
+  for(const auto& key : mEndedContacts)
+  {
+    addEvent(key, CollisionState::eEND);
+  }
+
+  std::size_t oldIndex = 0;
+  std::size_t newIndex = 0;
+  while(oldIndex < mContacts.size() || newIndex < mNewContacts.size())
+  {
+    if(newIndex == mNewContacts.size() ||
+       (oldIndex < mContacts.size() && mContacts[oldIndex] < mNewContacts[newIndex]))
+    {
+      addEvent(mContacts[oldIndex++], CollisionState::eEND);
+    }
+    else if(oldIndex == mContacts.size() || mNewContacts[newIndex] < mContacts[oldIndex])
+    {
+      addEvent(mNewContacts[newIndex++], CollisionState::eBEGIN);
+    }
+    else
+    {
+      addEvent(mNewContacts[newIndex++], CollisionState::eSTAY);
+      ++oldIndex;
+    }
+  }
+  std::swap(mContacts, mNewContacts);
+
+  // Put the ended contacts in order among the others. If a new Entity with
+  // the same ID touches the same thing, its collision begins after the old
+  // one ends.
+  if(!mEndedContacts.empty())
+  {
+    std::stable_sort(mEvents.begin(), mEvents.end(), [](const CollisionEvent& aFirst, const CollisionEvent& aSecond)
+    {
+      return GetContactKey(aFirst.mFirst, aFirst.mSecond) < GetContactKey(aSecond.mFirst, aSecond.mSecond);
+    });
+    mEndedContacts.clear();
+  }
+
+  mNumCandidatePairs.Set(mCandidatePairs.size());
+  mNumContacts.Set(mContacts.size());
+
+  if(!mEvents.empty())
+  {
+    CollisionsDetected.Notify(mEvents, aScene);
+  }
+}
+
+/******************************************************************************/
+bool CollisionSystem::AreColliding(Entity aFirst, Entity aSecond) const
+{
+  return std::binary_search(mContacts.begin(),
+                            mContacts.end(),
+                            GetContactKey(aFirst, aSecond));
+}
+
+/******************************************************************************/
+void CollisionSystem::HandleEntityBecameIneligible(Entity aEntity)
+{
+  // Contacts are keyed by Entity ID, so forget this Entity's contacts now
+  // rather than let an Entity that reuses its ID continue them.
+  auto involvesEntity = [aEntity](std::uint64_t aKey)
+  {
+    return static_cast<Entity>(aKey >> 32) == aEntity ||
+           static_cast<Entity>(aKey & 0xffffffff) == aEntity;
+  };
+
+  std::copy_if(mContacts.begin(),
+               mContacts.end(),
+               std::back_inserter(mEndedContacts),
+               involvesEntity);
+  mContacts.erase(std::remove_if(mContacts.begin(), mContacts.end(), involvesEntity),
+                  mContacts.end());
+  mNumContacts.Set(mContacts.size());
+}
+
+/******************************************************************************/
+CollisionSystem::WorldCollider CollisionSystem::CalculateWorldCollider(const Collider& aCollider,
+                                                                       const Mat4& aWorldMatrix)
+{
+  WorldCollider result;
+  result.mType = aCollider.mType;
+
+  AABB localBox;
+  localBox.mMin = aCollider.mCenter - aCollider.mHalfExtents;
+  localBox.mMax = aCollider.mCenter + aCollider.mHalfExtents;
+
+  switch(aCollider.mType)
+  {
+    case ColliderType::eSPHERE:
+    {
+      result.mSphere = TransformBounds(aWorldMatrix, Sphere { aCollider.mCenter, aCollider.mRadius });
+      result.mBox = GetBounds(result.mSphere);
+      break;
+    }
+    case ColliderType::eBOX:
+    {
+      result.mBox = TransformBounds(aWorldMatrix, localBox);
+      break;
+    }
+    case ColliderType::eORIENTED_BOX:
+    {
+      result.mOrientedBox = TransformBounds(aWorldMatrix, ToOBB(localBox));
+      result.mBox = GetBounds(result.mOrientedBox);
+      break;
+    }
+  }
+
+  return result;
+}
+
+/******************************************************************************/
+bool CollisionSystem::Collide(const WorldCollider& aFirst,
+                              const WorldCollider& aSecond)
+{
+  // Order the Colliders by type, so that each combination only needs to be
+  // handled once.
+  if(aSecond.mType < aFirst.mType)
+  {
+    return Collide(aSecond, aFirst);
+  }
+
+  switch(aFirst.mType)
+  {
+    case ColliderType::eSPHERE:
+    {
+      switch(aSecond.mType)
+      {
+        case ColliderType::eSPHERE:
+          return Intersects(aFirst.mSphere, aSecond.mSphere);
+        case ColliderType::eBOX:
+          return Intersects(aFirst.mSphere, aSecond.mBox);
+        case ColliderType::eORIENTED_BOX:
+          return Intersects(aFirst.mSphere, aSecond.mOrientedBox);
+      }
+      break;
+    }
+    case ColliderType::eBOX:
+    {
+      switch(aSecond.mType)
+      {
+        case ColliderType::eBOX:
+          return Intersects(aFirst.mBox, aSecond.mBox);
+        case ColliderType::eORIENTED_BOX:
+          return Intersects(ToOBB(aFirst.mBox), aSecond.mOrientedBox);
+        default:
+          break;
+      }
+      break;
+    }
+    case ColliderType::eORIENTED_BOX:
+    {
+      return Intersects(aFirst.mOrientedBox, aSecond.mOrientedBox);
+    }
+  }
+
+  return false;
+}
+
+/******************************************************************************/
+std::uint64_t CollisionSystem::GetContactKey(Entity aFirst, Entity aSecond)
+{
+  return (static_cast<std::uint64_t>(std::min(aFirst, aSecond)) << 32) |
+         static_cast<std::uint64_t>(std::max(aFirst, aSecond));
+}
+
+} // namespace Kuma3D
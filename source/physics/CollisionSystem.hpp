@@ -0,0 +1,168 @@
+#ifndef COLLISIONSYSTEM_HPP
+#define COLLISIONSYSTEM_HPP
+
+#include "System.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ComponentList.hpp"
+
+#include "Collider.hpp"
+#include "Transform.hpp"
+
+#include "Geometry.hpp"
+#include "Mat4.hpp"
+
+#include "CollisionSignals.hpp"
+#include "SweepAndPrune.hpp"
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The CollisionSystem finds which Entities with a Collider and a Transform
+ * are touching each other.
+ *
+ * Each frame, every Collider is moved into world space, and a SweepAndPrune
+ * finds the pairs whose bounding boxes overlap. Each of those pairs is then
+ * tested against the Colliders' actual shapes, split across the JobSystem's
+ * workers.
+ *
+ * The collisions that began, continued or ended are gathered into a single
+ * list, which is available from GetCollisionEvents() and sent out through
+ * the CollisionsDetected signal once per frame. A collision with an Entity
+ * that has been removed ends on the frame after it's removed, even if a new
+ * Entity with the same ID has taken its place by then.
+ *
+ * Add this System after the PhysicsSystem, so that collisions are found
+ * where bodies are after they've moved.
+ */
+class CollisionSystem : public System
+{
+  public:
+
+    /**
+     * Initializes the System by registering the Collider and Transform
+     * component types, if they aren't registered already. This function
+     * also sets the Signature of the System to keep track of Entities with
+     * Collider and Transform components.
+     *
+     * @param aScene The Scene this System was added to.
+     */
+    void Initialize(Scene& aScene) override;
+
+    /**
+     * Finds every pair of touching Colliders, and notifies the
+     * CollisionsDetected signal of any collisions that began, continued or
+     * ended since the last frame.
+     *
+     * @param aScene The Scene containing the Entities' component data.
+     * @param aTime The start time of the current frame.
+     */
+    void Operate(Scene& aScene, double aTime) override;
+
+    /**
+     * Returns whether two Entities were touching as of the most recent call
+     * to Operate().
+     *
+     * @param aFirst The first Entity.
+     * @param aSecond The second Entity.
+     * @return True if the Entities are touching, false otherwise.
+     */
+    bool AreColliding(Entity aFirst, Entity aSecond) const;
+
+    /**
+     * Returns the collisions that began, continued or ended during the most
+     * recent call to Operate(), sorted by Entity.
+     *
+     * @return The collision events.
+     */
+    const std::vector<CollisionEvent>& GetCollisionEvents() const { return mEvents; }
+
+  protected:
+
+    /**
+     * A handler function that gets called whenever an Entity becomes
+     * ineligible for this System. Ends every collision the Entity was in.
+     *
+     * @param aEntity The Entity that became ineligible.
+     */
+    void HandleEntityBecameIneligible(Entity aEntity) override;
+
+  private:
+
+    /**
+     * A Collider moved into world space, along with the axis-aligned box
+     * that bounds it.
+     */
+    struct WorldCollider
+    {
+      ColliderType mType { ColliderType::eBOX };
+      AABB mBox;
+      Sphere mSphere;
+      OBB mOrientedBox;
+    };
+
+    /**
+     * Moves a Collider into world space.
+     *
+     * @param aCollider The Collider, in its Entity's local space.
+     * @param aWorldMatrix The world matrix of the Entity.
+     * @return The Collider in world space.
+     */
+    static WorldCollider CalculateWorldCollider(const Collider& aCollider,
+                                                const Mat4& aWorldMatrix);
+
+    /**
+     * Returns whether two world-space Colliders are touching.
+     *
+     * @param aFirst The first Collider.
+     * @param aSecond The second Collider.
+     * @return True if the Colliders are touching, false otherwise.
+     */
+    static bool Collide(const WorldCollider& aFirst,
+                        const WorldCollider& aSecond);
+
+    /**
+     * Returns a key identifying a pair of Entities, which is the same
+     * whichever order they're given in.
+     *
+     * @param aFirst The first Entity.
+     * @param aSecond The second Entity.
+     * @return The key for the pair.
+     */
+    static std::uint64_t GetContactKey(Entity aFirst, Entity aSecond);
+
+    // Each Entity's Collider in world space, in the same order as the
+    // Entities.
+    std::vector<WorldCollider> mWorldColliders;
+
+    SweepAndPrune mBroadphase;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> mCandidatePairs;
+    std::vector<unsigned char> mCandidateResults;
+
+    // The key of each pair of touching Entities, sorted, as of this frame
+    // and the last.
+    std::vector<std::uint64_t> mContacts;
+    std::vector<std::uint64_t> mNewContacts;
+    std::vector<std::uint64_t> mScratchContacts;
+
+    // The contacts of Entities that left the System since the last frame,
+    // which end next frame whether or not their IDs are reused.
+    std::vector<std::uint64_t> mEndedContacts;
+
+    std::vector<CollisionEvent> mEvents;
+
+    Gauge& mNumCandidatePairs { Metrics::GetGauge("Collision.CandidatePairs") };
+    Gauge& mNumContacts { Metrics::GetGauge("Collision.Contacts") };
+
+    // The number of Colliders or pairs each thread works on at once.
+    static const std::size_t BATCH_SIZE = 1024;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,267 @@
+#include "PhysicsSystem.hpp"
+
+#include <algorithm>
+
+#include "JobSystem.hpp"
+#include "Scene.hpp"
+
+#include "RigidBody.hpp"
+#include "Transform.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void PhysicsSystem::Initialize(Scene& aScene)
+{
+  // Register the RigidBody and Transform components.
+  if(!aScene.IsComponentTypeRegistered<RigidBody>())
+  {
+    aScene.RegisterComponentType<RigidBody>();
+  }
+
+  if(!aScene.IsComponentTypeRegistered<Transform>())
+  {
+    aScene.RegisterComponentType<Transform>();
+  }
+
+  // Set the signature to care about entities with RigidBodies and
+  // Transforms.
+  auto signature = aScene.CreateSignature();
+  signature[aScene.GetComponentIndex<RigidBody>()] = true;
+  signature[aScene.GetComponentIndex<Transform>()] = true;
+  SetSignature(signature);
+}
+
+/******************************************************************************/
+void PhysicsSystem::Operate(Scene& aScene, double aTime)
+{
+  AddNewBodies(aScene);
+  SyncChangedBodies(aScene);
+
+  // Work out how many steps fit in the time since the last frame. The first
+  // frame has nothing to catch up on.
+  if(mLastTime >= 0.0)
+  {
+    mAccumulatedTime += aTime - mLastTime;
+  }
+  mLastTime = aTime;
+
+  int numSteps = 0;
+  while(mAccumulatedTime >= mTimeStep && numSteps < MAX_STEPS_PER_FRAME)
+  {
+    mAccumulatedTime -= mTimeStep;
+    ++numSteps;
+  }
+  mAccumulatedTime = std::min(mAccumulatedTime, mTimeStep);
+
+  if(numSteps > 0)
+  {
+    // Bodies don't affect each other, so each batch can be taken through
+    // every step while it's in the cache.
+    auto timeStep = static_cast<float>(mTimeStep);
+    JobSystem::ParallelFor(mNumAwake, BATCH_SIZE, [this, numSteps, timeStep](std::size_t aStart, std::size_t aEnd)
+    {
+      for(int step = 0; step < numSteps; ++step)
+      {
+        IntegrateBodies(mBodies, aStart, aEnd, timeStep);
+      }
+    });
+    mSteps.Increment(numSteps);
+
+    SleepRestingBodies(aScene);
+
+    // Write the new state of each awake body back to its components.
+    auto& transforms = aScene.GetComponentList<Transform>();
+    auto& bodies = aScene.GetComponentList<RigidBody>();
+    JobSystem::ParallelFor(mNumAwake, BATCH_SIZE, [this, &transforms, &bodies](std::size_t aStart, std::size_t aEnd)
+    {
+      for(auto i = aStart; i < aEnd; ++i)
+      {
+        auto entity = mBodyEntities[i];
+        auto& transform = transforms.GetComponentForEntity(entity);
+        transform.mPosition = Vec3(mBodies.mPositionX[i],
+                                   mBodies.mPositionY[i],
+                                   mBodies.mPositionZ[i]);
+
+        auto& body = bodies.GetComponentForEntity(entity);
+        body.mVelocity = Vec3(mBodies.mVelocityX[i],
+                              mBodies.mVelocityY[i],
+                              mBodies.mVelocityZ[i]);
+      }
+    });
+  }
+
+  mAwakeBodies.Set(mNumAwake);
+  mSleepingBodies.Set(mBodies.Size() - mNumAwake);
+}
+
+/******************************************************************************/
+void PhysicsSystem::WakeBody(Scene& aScene, Entity aEntity)
+{
+  // Bodies that haven't been added yet will be loaded from their
+  // components anyway.
+  auto foundIndex = mBodyIndexMap.find(aEntity);
+  if(foundIndex == mBodyIndexMap.end())
+  {
+    return;
+  }
+
+  auto& body = aScene.GetComponentForEntity<RigidBody>(aEntity);
+  const auto& transform = aScene.GetComponentForEntity<Transform>(aEntity);
+  body.mSleeping = false;
+
+  auto index = foundIndex->second;
+  mBodies.Set(index,
+              transform.mPosition,
+              body,
+              body.mCanSleep ? SLEEP_SPEED : -1.0f);
+
+  // Move the body into the awake part of the streams.
+  if(index >= mNumAwake)
+  {
+    SwapBodies(index, mNumAwake);
+    ++mNumAwake;
+  }
+}
+
+/******************************************************************************/
+void PhysicsSystem::HandleEntityBecameEligible(Entity aEntity)
+{
+  // The Entity's components can't be read here, so its body is added at
+  // the start of the next frame.
+  mNewEntities.emplace_back(aEntity);
+}
+
+/******************************************************************************/
+void PhysicsSystem::HandleEntityBecameIneligible(Entity aEntity)
+{
+  mNewEntities.erase(std::remove(mNewEntities.begin(), mNewEntities.end(), aEntity),
+                     mNewEntities.end());
+
+  auto foundIndex = mBodyIndexMap.find(aEntity);
+  if(foundIndex == mBodyIndexMap.end())
+  {
+    return;
+  }
+
+  // Move the body to the end of the awake bodies, then to the end of the
+  // streams, so that it can be removed without disturbing the others.
+  auto index = foundIndex->second;
+  if(index < mNumAwake)
+  {
+    --mNumAwake;
+    SwapBodies(index, mNumAwake);
+    index = mNumAwake;
+  }
+  SwapBodies(index, mBodies.Size() - 1);
+
+  mBodies.PopBack();
+  mBodyEntities.pop_back();
+  mBodyIndexMap.erase(aEntity);
+}
+
+/******************************************************************************/
+void PhysicsSystem::AddNewBodies(Scene& aScene)
+{
+  for(const auto& entity : mNewEntities)
+  {
+    const auto& body = aScene.GetComponentForEntity<RigidBody>(entity);
+    const auto& transform = aScene.GetComponentForEntity<Transform>(entity);
+
+    auto index = mBodies.Add(transform.mPosition,
+                             body,
+                             body.mCanSleep ? SLEEP_SPEED : -1.0f);
+    mBodyEntities.emplace_back(entity);
+    mBodyIndexMap.emplace(entity, index);
+
+    if(!body.mSleeping)
+    {
+      SwapBodies(index, mNumAwake);
+      ++mNumAwake;
+    }
+  }
+
+  mNewEntities.clear();
+}
+
+/******************************************************************************/
+void PhysicsSystem::SyncChangedBodies(Scene& aScene)
+{
+  // The streams still hold exactly what was written back last frame, so
+  // any difference from the components is a change made since then.
+  const auto& transforms = aScene.GetComponentList<Transform>();
+  const auto& bodies = aScene.GetComponentList<RigidBody>();
+  JobSystem::ParallelFor(mNumAwake, BATCH_SIZE, [this, &transforms, &bodies](std::size_t aStart, std::size_t aEnd)
+  {
+    for(auto i = aStart; i < aEnd; ++i)
+    {
+      auto entity = mBodyEntities[i];
+      const auto& position = transforms.GetComponentForEntity(entity).mPosition;
+      const auto& body = bodies.GetComponentForEntity(entity);
+      if(position.x != mBodies.mPositionX[i] ||
+         position.y != mBodies.mPositionY[i] ||
+         position.z != mBodies.mPositionZ[i] ||
+         body.mVelocity.x != mBodies.mVelocityX[i] ||
+         body.mVelocity.y != mBodies.mVelocityY[i] ||
+         body.mVelocity.z != mBodies.mVelocityZ[i] ||
+         body.mAcceleration.x != mBodies.mAccelerationX[i] ||
+         body.mAcceleration.y != mBodies.mAccelerationY[i] ||
+         body.mAcceleration.z != mBodies.mAccelerationZ[i] ||
+         body.mLinearDamping != mBodies.mDamping[i])
+      {
+        mBodies.Set(i, position, body, body.mCanSleep ? SLEEP_SPEED : -1.0f);
+      }
+    }
+  });
+}
+
+/******************************************************************************/
+void PhysicsSystem::SleepRestingBodies(Scene& aScene)
+{
+  for(std::size_t i = 0; i < mNumAwake;)
+  {
+    if(mBodies.mSleepTime[i] < SLEEP_DELAY)
+    {
+      ++i;
+      continue;
+    }
+
+    // Stop the body, and leave its components as it was when it fell
+    // asleep.
+    mBodies.mVelocityX[i] = 0.0f;
+    mBodies.mVelocityY[i] = 0.0f;
+    mBodies.mVelocityZ[i] = 0.0f;
+    mBodies.mSleepTime[i] = 0.0f;
+
+    auto entity = mBodyEntities[i];
+    auto& transform = aScene.GetComponentForEntity<Transform>(entity);
+    transform.mPosition = Vec3(mBodies.mPositionX[i],
+                               mBodies.mPositionY[i],
+                               mBodies.mPositionZ[i]);
+
+    auto& body = aScene.GetComponentForEntity<RigidBody>(entity);
+    body.mVelocity = Vec3();
+    body.mSleeping = true;
+
+    // Move the body into the sleeping part of the streams. The body swapped
+    // into its place hasn't been checked yet.
+    --mNumAwake;
+    SwapBodies(i, mNumAwake);
+  }
+}
+
+/******************************************************************************/
+void PhysicsSystem::SwapBodies(std::size_t aFirst, std::size_t aSecond)
+{
+  if(aFirst == aSecond)
+  {
+    return;
+  }
+
+  mBodies.Swap(aFirst, aSecond);
+  std::swap(mBodyEntities[aFirst], mBodyEntities[aSecond]);
+  mBodyIndexMap[mBodyEntities[aFirst]] = aFirst;
+  mBodyIndexMap[mBodyEntities[aSecond]] = aSecond;
+}
+
+} // namespace Kuma3D
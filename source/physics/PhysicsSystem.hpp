@@ -0,0 +1,178 @@
+#ifndef PHYSICSSYSTEM_HPP
+#define PHYSICSSYSTEM_HPP
+
+#include "System.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+#include "RigidBodyStreams.hpp"
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The PhysicsSystem moves each Entity with a RigidBody and a Transform
+ * according to the body's velocity and acceleration.
+ *
+ * Bodies are advanced in fixed time steps, however long each frame takes,
+ * so that the simulation behaves the same at any frame rate. Each body's
+ * state is kept in RigidBodyStreams rather than in its component, so that
+ * bodies can be moved four at a time and split across the JobSystem's
+ * workers; the Transform's position and the RigidBody's velocity are
+ * written back once per frame. Changes made to an awake body's components
+ * in between are picked up at the start of the next frame.
+ *
+ * Bodies that move slowly for long enough fall asleep, unless they're
+ * accelerating. Sleeping bodies are kept at the end of the streams and
+ * skipped entirely, including when checking for changes and writing back
+ * to components, until they're woken with WakeBody().
+ *
+ * A body's position is its Transform's position, even if the Transform is
+ * relative to a parent.
+ */
+class PhysicsSystem : public System
+{
+  public:
+
+    /**
+     * Initializes the System by registering the RigidBody and Transform
+     * component types, if they aren't registered already. This function
+     * also sets the Signature of the System to keep track of Entities with
+     * RigidBody and Transform components.
+     *
+     * @param aScene The Scene this System was added to.
+     */
+    void Initialize(Scene& aScene) override;
+
+    /**
+     * Advances every awake body by as many time steps as fit in the time
+     * since the last frame, then writes their state back to their
+     * components.
+     *
+     * @param aScene The Scene containing the Entities' component data.
+     * @param aTime The start time of the current frame.
+     */
+    void Operate(Scene& aScene, double aTime) override;
+
+    /**
+     * Reloads an Entity's body from its RigidBody and Transform components,
+     * and wakes it up if it's asleep. Call this after changing either
+     * component of a sleeping body, or the change is ignored.
+     *
+     * @param aScene The Scene containing the Entity.
+     * @param aEntity The Entity to wake.
+     */
+    void WakeBody(Scene& aScene, Entity aEntity);
+
+    /**
+     * Sets the length of each time step. Shorter steps are more accurate,
+     * but take more work each frame.
+     *
+     * @param aTimeStep The length of a time step, in seconds.
+     */
+    void SetTimeStep(double aTimeStep) { mTimeStep = aTimeStep; }
+
+    /**
+     * Returns the length of each time step.
+     *
+     * @return The length of a time step, in seconds.
+     */
+    double GetTimeStep() const { return mTimeStep; }
+
+    /**
+     * Returns the number of bodies that are awake.
+     *
+     * @return The number of awake bodies.
+     */
+    std::size_t GetNumAwakeBodies() const { return mNumAwake; }
+
+  protected:
+
+    /**
+     * A handler function that gets called whenever an Entity becomes
+     * eligible for this System.
+     *
+     * @param eEntity The Entity that became eligible.
+     */
+    void HandleEntityBecameEligible(Entity aEntity) override;
+
+    /**
+     * A handler function that gets called whenever an Entity becomes
+     * ineligible for this System.
+     *
+     * @param eEntity The Entity that became ineligible.
+     */
+    void HandleEntityBecameIneligible(Entity aEntity) override;
+
+  private:
+
+    /**
+     * Adds the bodies of each Entity that became eligible since the last
+     * frame.
+     *
+     * @param aScene The Scene containing the Entities.
+     */
+    void AddNewBodies(Scene& aScene);
+
+    /**
+     * Reloads each awake body whose components have changed since their
+     * state was last written back to them.
+     *
+     * @param aScene The Scene containing the Entities.
+     */
+    void SyncChangedBodies(Scene& aScene);
+
+    /**
+     * Puts each body that has rested for long enough to sleep, writing its
+     * final state back to its components.
+     *
+     * @param aScene The Scene containing the Entities.
+     */
+    void SleepRestingBodies(Scene& aScene);
+
+    /**
+     * Swaps the state of two bodies, along with their Entities.
+     *
+     * @param aFirst The index of the first body.
+     * @param aSecond The index of the second body.
+     */
+    void SwapBodies(std::size_t aFirst, std::size_t aSecond);
+
+    // The state of each body, with the awake bodies first, and the Entity
+    // each body belongs to.
+    RigidBodyStreams mBodies;
+    std::vector<Entity> mBodyEntities;
+    std::size_t mNumAwake { 0 };
+
+    // The index of each Entity's body.
+    std::unordered_map<Entity, std::size_t> mBodyIndexMap;
+
+    // Entities that became eligible since the last frame.
+    std::vector<Entity> mNewEntities;
+
+    double mTimeStep { 1.0 / 60.0 };
+    double mAccumulatedTime { 0.0 };
+    double mLastTime { -1.0 };
+
+    Gauge& mAwakeBodies { Metrics::GetGauge("Physics.AwakeBodies") };
+    Gauge& mSleepingBodies { Metrics::GetGauge("Physics.SleepingBodies") };
+    Counter& mSteps { Metrics::GetCounter("Physics.Steps") };
+
+    // The most steps taken in a single frame. Any time left over is
+    // dropped, so that a long frame doesn't make the next one longer.
+    static const int MAX_STEPS_PER_FRAME = 4;
+
+    // A body that moves slower than this, in units per second, for this
+    // many seconds falls asleep.
+    static constexpr float SLEEP_SPEED = 0.05f;
+    static constexpr float SLEEP_DELAY = 0.5f;
+
+    // The number of bodies each thread moves at once.
+    static const std::size_t BATCH_SIZE = 4096;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef RIGIDBODYSTREAMS_HPP
+#define RIGIDBODYSTREAMS_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "RigidBody.hpp"
+
+#include "Simd.hpp"
+#include "Vec3.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The state of a number of rigid bodies, stored as a separate stream of
+ * floats for each component so that IntegrateBodies() can move four bodies
+ * at a time.
+ */
+struct RigidBodyStreams
+{
+  /**
+   * Adds a body to the end of the streams.
+   *
+   * @param aPosition The position of the body.
+   * @param aBody The body's velocity, acceleration and damping.
+   * @param aSleepSpeed The speed below which the body counts as resting, or
+   *                    a negative number if the body never rests.
+   * @return The index of the body.
+   */
+  std::size_t Add(const Vec3& aPosition,
+                  const RigidBody& aBody,
+                  float aSleepSpeed)
+  {
+    auto index = Size();
+    for(auto* values : { &mPositionX, &mPositionY, &mPositionZ,
+                         &mVelocityX, &mVelocityY, &mVelocityZ,
+                         &mAccelerationX, &mAccelerationY, &mAccelerationZ,
+                         &mDamping, &mSleepThreshold, &mSleepTime })
+    {
+      values->emplace_back(0.0f);
+    }
+
+    Set(index, aPosition, aBody, aSleepSpeed);
+    return index;
+  }
+
+  /**
+   * Sets the state of a body, and resets the time it has been resting.
+   *
+   * @param aIndex The index of the body.
+   * @param aPosition The position of the body.
+   * @param aBody The body's velocity, acceleration and damping.
+   * @param aSleepSpeed The speed below which the body counts as resting, or
+   *                    a negative number if the body never rests. Bodies
+   *                    with any acceleration never rest either.
+   */
+  void Set(std::size_t aIndex,
+           const Vec3& aPosition,
+           const RigidBody& aBody,
+           float aSleepSpeed)
+  {
+    mPositionX[aIndex] = aPosition.x;
+    mPositionY[aIndex] = aPosition.y;
+    mPositionZ[aIndex] = aPosition.z;
+    mVelocityX[aIndex] = aBody.mVelocity.x;
+    mVelocityY[aIndex] = aBody.mVelocity.y;
+    mVelocityZ[aIndex] = aBody.mVelocity.z;
+    mAccelerationX[aIndex] = aBody.mAcceleration.x;
+    mAccelerationY[aIndex] = aBody.mAcceleration.y;
+    mAccelerationZ[aIndex] = aBody.mAcceleration.z;
+    mDamping[aIndex] = aBody.mLinearDamping;
+
+    // The threshold is compared against the squared speed, so a negative
+    // speed becomes a threshold nothing is less than. A body that's
+    // accelerating never rests, however slowly it's moving right now.
+    auto accelerating = aBody.mAcceleration.x != 0.0f ||
+                        aBody.mAcceleration.y != 0.0f ||
+                        aBody.mAcceleration.z != 0.0f;
+    mSleepThreshold[aIndex] = (aSleepSpeed < 0.0f || accelerating) ? -1.0f : aSleepSpeed * aSleepSpeed;
+    mSleepTime[aIndex] = 0.0f;
+  }
+
+  /**
+   * Swaps the state of two bodies.
+   *
+   * @param aFirst The index of the first body.
+   * @param aSecond The index of the second body.
+   */
+  void Swap(std::size_t aFirst, std::size_t aSecond)
+  {
+    for(auto* values : { &mPositionX, &mPositionY, &mPositionZ,
+                         &mVelocityX, &mVelocityY, &mVelocityZ,
+                         &mAccelerationX, &mAccelerationY, &mAccelerationZ,
+                         &mDamping, &mSleepThreshold, &mSleepTime })
+    {
+      std::swap((*values)[aFirst], (*values)[aSecond]);
+    }
+  }
+
+  /**
+   * Removes the last body from the streams.
+   */
+  void PopBack()
+  {
+    for(auto* values : { &mPositionX, &mPositionY, &mPositionZ,
+                         &mVelocityX, &mVelocityY, &mVelocityZ,
+                         &mAccelerationX, &mAccelerationY, &mAccelerationZ,
+                         &mDamping, &mSleepThreshold, &mSleepTime })
+    {
+      values->pop_back();
+    }
+  }
+
+  /**
+   * Returns the number of bodies in the streams.
+   *
+   * @return The number of bodies.
+   */
+  std::size_t Size() const { return mPositionX.size(); }
+
+  std::vector<float> mPositionX;
+  std::vector<float> mPositionY;
+  std::vector<float> mPositionZ;
+
+  std::vector<float> mVelocityX;
+  std::vector<float> mVelocityY;
+  std::vector<float> mVelocityZ;
+
+  std::vector<float> mAccelerationX;
+  std::vector<float> mAccelerationY;
+  std::vector<float> mAccelerationZ;
+
+  // The damping of each body, and the squared speed below which it counts
+  // as resting.
+  std::vector<float> mDamping;
+  std::vector<float> mSleepThreshold;
+
+  // How long each body has been resting, in seconds.
+  std::vector<float> mSleepTime;
+};
+
+/**
+ * Advances a range of bodies by one time step, using semi-implicit Euler
+ * integration: each body's velocity is updated first, then used to move
+ * the body. Four bodies are moved at once, one in each SIMD lane, when SIMD
+ * instructions are available.
+ *
+ * A body's sleep time grows by the time step while its speed is below its
+ * sleep threshold, and is reset to 0 otherwise.
+ *
+ * @param aStreams The bodies.
+ * @param aStart The first body to move.
+ * @param aEnd One past the last body to move.
+ * @param aTimeStep The time step, in seconds.
+ */
+inline void IntegrateBodies(RigidBodyStreams& aStreams,
+                            std::size_t aStart,
+                            std::size_t aEnd,
+                            float aTimeStep)
+{
+  // SIMD stores may alias anything, so read the streams' pointers once
+  // rather than after every store.
+  auto* positionX = aStreams.mPositionX.data();
+  auto* positionY = aStreams.mPositionY.data();
+  auto* positionZ = aStreams.mPositionZ.data();
+  auto* velocityX = aStreams.mVelocityX.data();
+  auto* velocityY = aStreams.mVelocityY.data();
+  auto* velocityZ = aStreams.mVelocityZ.data();
+  const auto* accelerationX = aStreams.mAccelerationX.data();
+  const auto* accelerationY = aStreams.mAccelerationY.data();
+  const auto* accelerationZ = aStreams.mAccelerationZ.data();
+  const auto* damping = aStreams.mDamping.data();
+  const auto* sleepThreshold = aStreams.mSleepThreshold.data();
+  auto* sleepTime = aStreams.mSleepTime.data();
+
+  // Without SIMD instructions, emulating four lanes is slower than moving
+  // each body one at a time.
+  auto i = aStart;
+#if defined(KUMA3D_SIMD_SSE) || defined(KUMA3D_SIMD_NEON)
+  auto step = SplatFloat4(aTimeStep);
+  auto zero = SplatFloat4(0.0f);
+  auto one = SplatFloat4(1.0f);
+  for(; i + 4 <= aEnd; i += 4)
+  {
+    auto drag = one / (one + LoadFloat4(damping + i) * step);
+    auto vx = (LoadFloat4(velocityX + i) + LoadFloat4(accelerationX + i) * step) * drag;
+    auto vy = (LoadFloat4(velocityY + i) + LoadFloat4(accelerationY + i) * step) * drag;
+    auto vz = (LoadFloat4(velocityZ + i) + LoadFloat4(accelerationZ + i) * step) * drag;
+    StoreFloat4(velocityX + i, vx);
+    StoreFloat4(velocityY + i, vy);
+    StoreFloat4(velocityZ + i, vz);
+
+    StoreFloat4(positionX + i, LoadFloat4(positionX + i) + vx * step);
+    StoreFloat4(positionY + i, LoadFloat4(positionY + i) + vy * step);
+    StoreFloat4(positionZ + i, LoadFloat4(positionZ + i) + vz * step);
+
+    auto resting = Less(vx * vx + vy * vy + vz * vz, LoadFloat4(sleepThreshold + i));
+    StoreFloat4(sleepTime + i, Select(resting, LoadFloat4(sleepTime + i) + step, zero));
+  }
+#endif
+
+  for(; i < aEnd; ++i)
+  {
+    auto drag = 1.0f / (1.0f + damping[i] * aTimeStep);
+    auto vx = (velocityX[i] + accelerationX[i] * aTimeStep) * drag;
+    auto vy = (velocityY[i] + accelerationY[i] * aTimeStep) * drag;
+    auto vz = (velocityZ[i] + accelerationZ[i] * aTimeStep) * drag;
+    velocityX[i] = vx;
+    velocityY[i] = vy;
+    velocityZ[i] = vz;
+
+    positionX[i] += vx * aTimeStep;
+    positionY[i] += vy * aTimeStep;
+    positionZ[i] += vz * aTimeStep;
+
+    auto resting = (vx * vx + vy * vy + vz * vz) < sleepThreshold[i];
+    sleepTime[i] = resting ? sleepTime[i] + aTimeStep : 0.0f;
+  }
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,261 @@
+#include "SweepAndPrune.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "JobSystem.hpp"
+#include "RadixSort.hpp"
+#include "Simd.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void SweepAndPrune::Clear()
+{
+  mBoxes.clear();
+}
+
+/******************************************************************************/
+std::size_t SweepAndPrune::Add(const AABB& aBox)
+{
+  mBoxes.emplace_back(aBox);
+  return mBoxes.size() - 1;
+}
+
+/******************************************************************************/
+void SweepAndPrune::FindPairs(std::vector<std::pair<std::uint32_t, std::uint32_t>>& aPairs)
+{
+  aPairs.clear();
+  if(mBoxes.empty())
+  {
+    return;
+  }
+
+  Sort();
+  BuildColumns();
+
+  // Each batch collects its pairs separately, so that the threads don't
+  // need to share a list.
+  auto numColumns = mNumColumnsY * mNumColumnsZ;
+  auto numBatches = (numColumns + BATCH_SIZE - 1) / BATCH_SIZE;
+  mBatchPairs.resize(numBatches);
+  for(auto& batchPairs : mBatchPairs)
+  {
+    batchPairs.clear();
+  }
+
+  JobSystem::ParallelFor(numColumns, BATCH_SIZE, [this](std::size_t aStart, std::size_t aEnd)
+  {
+    Sweep(aStart, aEnd, mBatchPairs[aStart / BATCH_SIZE]);
+  });
+
+  for(const auto& batchPairs : mBatchPairs)
+  {
+    aPairs.insert(aPairs.end(), batchPairs.begin(), batchPairs.end());
+  }
+}
+
+/******************************************************************************/
+void SweepAndPrune::Sort()
+{
+  mOrder.resize(mBoxes.size());
+  for(std::size_t i = 0; i < mOrder.size(); ++i)
+  {
+    mOrder[i] = i;
+  }
+
+  // Flip the bits of each coordinate so that the unsigned integers sort in
+  // the same order as the floats: negative numbers have every bit flipped,
+  // and positive numbers have just their sign bit flipped.
+  RadixSort(mOrder, mScratchOrder, [this](std::uint32_t aIndex)
+  {
+    std::uint32_t bits;
+    std::memcpy(&bits, &mBoxes[aIndex].mMin.x, sizeof(bits));
+    return static_cast<std::uint64_t>((bits & 0x80000000u) ? ~bits : (bits | 0x80000000u));
+  });
+}
+
+/******************************************************************************/
+void SweepAndPrune::BuildColumns()
+{
+  // Size the columns to about twice the average size of a box, so that
+  // most boxes fall into between one and four of them.
+  mGridMinY = std::numeric_limits<float>::max();
+  mGridMinZ = std::numeric_limits<float>::max();
+  auto gridMaxY = std::numeric_limits<float>::lowest();
+  auto gridMaxZ = std::numeric_limits<float>::lowest();
+  double totalSize = 0.0;
+  for(const auto& box : mBoxes)
+  {
+    mGridMinY = std::min(mGridMinY, box.mMin.y);
+    mGridMinZ = std::min(mGridMinZ, box.mMin.z);
+    gridMaxY = std::max(gridMaxY, box.mMax.y);
+    gridMaxZ = std::max(gridMaxZ, box.mMax.z);
+    totalSize += (box.mMax.y - box.mMin.y) + (box.mMax.z - box.mMin.z);
+  }
+
+  // Keep the number of columns reasonable when the boxes are small and far
+  // apart.
+  mColumnSize = std::max({ static_cast<float>(totalSize / mBoxes.size()),
+                           (gridMaxY - mGridMinY) / MAX_COLUMNS_PER_AXIS,
+                           (gridMaxZ - mGridMinZ) / MAX_COLUMNS_PER_AXIS });
+  if(!(mColumnSize > 0.0f))
+  {
+    mColumnSize = 1.0f;
+  }
+
+  std::size_t maxColumns = MAX_COLUMNS_PER_AXIS;
+  mNumColumnsY = std::min(static_cast<std::size_t>((gridMaxY - mGridMinY) / mColumnSize) + 1,
+                          maxColumns);
+  mNumColumnsZ = std::min(static_cast<std::size_t>((gridMaxZ - mGridMinZ) / mColumnSize) + 1,
+                          maxColumns);
+
+  // Count the boxes in each column, then place each box in its columns.
+  // Since the boxes are placed in sorted order, each column stays sorted.
+  auto forEachColumn = [this](const AABB& aBox, auto&& aFunction)
+  {
+    auto first = GetColumn(aBox.mMin.y, aBox.mMin.z);
+    auto last = GetColumn(aBox.mMax.y, aBox.mMax.z);
+    auto firstY = first / mNumColumnsZ;
+    auto firstZ = first % mNumColumnsZ;
+    auto lastY = last / mNumColumnsZ;
+    auto lastZ = last % mNumColumnsZ;
+    for(auto y = firstY; y <= lastY; ++y)
+    {
+      for(auto z = firstZ; z <= lastZ; ++z)
+      {
+        aFunction(y * mNumColumnsZ + z);
+      }
+    }
+  };
+
+  mColumnStarts.assign(mNumColumnsY * mNumColumnsZ + 1, 0);
+  for(const auto& box : mBoxes)
+  {
+    forEachColumn(box, [this](std::size_t aColumn) { ++mColumnStarts[aColumn + 1]; });
+  }
+
+  for(std::size_t i = 1; i < mColumnStarts.size(); ++i)
+  {
+    mColumnStarts[i] += mColumnStarts[i - 1];
+  }
+
+  // Use the scratch list to track the next free entry in each column.
+  mScratchOrder.assign(mColumnStarts.begin(), mColumnStarts.end() - 1);
+  mEntries.resize(mColumnStarts.back());
+  for(auto index : mOrder)
+  {
+    forEachColumn(mBoxes[index], [this, index](std::size_t aColumn)
+    {
+      mEntries[mScratchOrder[aColumn]++] = index;
+    });
+  }
+
+  // Pad the streams with boxes that start after every other box ends, so
+  // they're never counted as overlapping.
+  auto paddedSize = mEntries.size() + 4;
+  for(auto* values : { &mMinX, &mMaxX, &mMinY, &mMaxY, &mMinZ, &mMaxZ })
+  {
+    values->resize(paddedSize);
+  }
+
+  for(std::size_t i = 0; i < mEntries.size(); ++i)
+  {
+    const auto& box = mBoxes[mEntries[i]];
+    mMinX[i] = box.mMin.x;
+    mMaxX[i] = box.mMax.x;
+    mMinY[i] = box.mMin.y;
+    mMaxY[i] = box.mMax.y;
+    mMinZ[i] = box.mMin.z;
+    mMaxZ[i] = box.mMax.z;
+  }
+
+  for(auto i = mEntries.size(); i < paddedSize; ++i)
+  {
+    mMinX[i] = std::numeric_limits<float>::infinity();
+    mMaxX[i] = std::numeric_limits<float>::infinity();
+    mMinY[i] = 0.0f;
+    mMaxY[i] = 0.0f;
+    mMinZ[i] = 0.0f;
+    mMaxZ[i] = 0.0f;
+  }
+}
+
+/******************************************************************************/
+std::size_t SweepAndPrune::GetColumn(float aY, float aZ) const
+{
+  auto y = std::min(static_cast<std::size_t>((aY - mGridMinY) / mColumnSize), mNumColumnsY - 1);
+  auto z = std::min(static_cast<std::size_t>((aZ - mGridMinZ) / mColumnSize), mNumColumnsZ - 1);
+  return y * mNumColumnsZ + z;
+}
+
+/******************************************************************************/
+void SweepAndPrune::Sweep(std::size_t aStart,
+                          std::size_t aEnd,
+                          std::vector<std::pair<std::uint32_t, std::uint32_t>>& aPairs) const
+{
+  const auto* minX = mMinX.data();
+  const auto* minY = mMinY.data();
+  const auto* maxY = mMaxY.data();
+  const auto* minZ = mMinZ.data();
+  const auto* maxZ = mMaxZ.data();
+
+  for(auto column = aStart; column < aEnd; ++column)
+  {
+    std::size_t columnEnd = mColumnStarts[column + 1];
+    for(std::size_t i = mColumnStarts[column]; i < columnEnd; ++i)
+    {
+      auto maxX = mMaxX[i];
+      auto boxMaxX = SplatFloat4(maxX);
+      auto boxMinY = SplatFloat4(minY[i]);
+      auto boxMaxY = SplatFloat4(maxY[i]);
+      auto boxMinZ = SplatFloat4(minZ[i]);
+      auto boxMaxZ = SplatFloat4(maxZ[i]);
+
+      // Every box after this one starts to its right, so they overlap along
+      // x as long as they start before this box ends. Once one starts after
+      // it ends, so does every box after that.
+      for(auto j = i + 1; j < columnEnd && minX[j] <= maxX; j += 4)
+      {
+        auto separated = Less(boxMaxX, LoadFloat4(minX + j)) |
+                         Less(boxMaxY, LoadFloat4(minY + j)) |
+                         Less(LoadFloat4(maxY + j), boxMinY) |
+                         Less(boxMaxZ, LoadFloat4(minZ + j)) |
+                         Less(LoadFloat4(maxZ + j), boxMinZ);
+
+        // Ignore the lanes past the end of the column; most nearby boxes are
+        // separated along y or z.
+        auto numLanes = std::min<std::size_t>(4, columnEnd - j);
+        auto overlapMask = ~MoveMask(separated) & ((1 << numLanes) - 1);
+        if(overlapMask == 0)
+        {
+          continue;
+        }
+
+        for(std::size_t lane = 0; lane < numLanes; ++lane)
+        {
+          if(((overlapMask >> lane) & 1) == 0)
+          {
+            continue;
+          }
+
+          // Boxes that share several columns overlap in each of them; only
+          // report the pair from the column containing the corner where
+          // their overlap begins.
+          auto k = j + lane;
+          if(GetColumn(std::max(minY[i], minY[k]), std::max(minZ[i], minZ[k])) != column)
+          {
+            continue;
+          }
+
+          auto first = mEntries[i];
+          auto second = mEntries[k];
+          aPairs.emplace_back(std::min(first, second), std::max(first, second));
+        }
+      }
+    }
+  }
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,135 @@
+#ifndef SWEEPANDPRUNE_HPP
+#define SWEEPANDPRUNE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Geometry.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Finds every pair of overlapping boxes in a list, without testing every
+ * box against every other box.
+ *
+ * The space the boxes cover is divided into a grid of columns along the y
+ * and z axes, sized to fit a few boxes across, and each box is placed in
+ * every column it overlaps. Within each column, the boxes are sorted by
+ * their minimum x-coordinate, then swept from left to right; each box only
+ * needs to be tested against the boxes that start before it ends. Those
+ * tests are done four boxes at a time with SIMD instructions, and the
+ * columns are split across the JobSystem's workers.
+ *
+ * A pair of boxes sharing several columns is only reported by one of them.
+ * Boxes much larger than the others are placed in many columns, which
+ * makes them slower to add.
+ */
+class SweepAndPrune
+{
+  public:
+
+    /**
+     * Removes every box.
+     */
+    void Clear();
+
+    /**
+     * Adds a box to be tested.
+     *
+     * @param aBox The box to add, which must not be empty.
+     * @return The index of the box, as given to FindPairs().
+     */
+    std::size_t Add(const AABB& aBox);
+
+    /**
+     * Returns the number of boxes added.
+     *
+     * @return The number of boxes.
+     */
+    std::size_t GetSize() const { return mBoxes.size(); }
+
+    /**
+     * Finds each pair of boxes that overlap. Boxes that only touch overlap.
+     *
+     * @param aPairs Filled with the indices of each overlapping pair, the
+     *               smaller index first. The pairs are in no particular
+     *               order.
+     */
+    void FindPairs(std::vector<std::pair<std::uint32_t, std::uint32_t>>& aPairs);
+
+  private:
+
+    /**
+     * Sorts the boxes by their minimum x-coordinate.
+     */
+    void Sort();
+
+    /**
+     * Places each box in the columns it overlaps, in sorted order, and
+     * copies them into the streams.
+     */
+    void BuildColumns();
+
+    /**
+     * Returns the index of the column containing a point.
+     *
+     * @param aY The y-coordinate of the point.
+     * @param aZ The z-coordinate of the point.
+     * @return The index of the column.
+     */
+    std::size_t GetColumn(float aY, float aZ) const;
+
+    /**
+     * Finds the overlapping pairs in a range of columns.
+     *
+     * @param aStart The first column to sweep.
+     * @param aEnd One past the last column to sweep.
+     * @param aPairs The list to add overlapping pairs to.
+     */
+    void Sweep(std::size_t aStart,
+               std::size_t aEnd,
+               std::vector<std::pair<std::uint32_t, std::uint32_t>>& aPairs) const;
+
+    std::vector<AABB> mBoxes;
+
+    // The index of each box, in sorted order.
+    std::vector<std::uint32_t> mOrder;
+    std::vector<std::uint32_t> mScratchOrder;
+
+    // The grid of columns, starting at the smallest y and z of any box.
+    float mGridMinY { 0.0 };
+    float mGridMinZ { 0.0 };
+    float mColumnSize { 1.0 };
+    std::size_t mNumColumnsY { 0 };
+    std::size_t mNumColumnsZ { 0 };
+
+    // The index of each box in each column, sorted within each column, and
+    // where each column's boxes start (with an extra start at the end).
+    std::vector<std::uint32_t> mEntries;
+    std::vector<std::uint32_t> mColumnStarts;
+
+    // The boxes in each column, stored as a separate stream of floats for
+    // each component. The streams are padded at the end, so that four boxes
+    // can be loaded at once from any box.
+    std::vector<float> mMinX;
+    std::vector<float> mMaxX;
+    std::vector<float> mMinY;
+    std::vector<float> mMaxY;
+    std::vector<float> mMinZ;
+    std::vector<float> mMaxZ;
+
+    // The pairs found by each batch of columns.
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> mBatchPairs;
+
+    // The most columns along each axis.
+    static const std::size_t MAX_COLUMNS_PER_AXIS = 1024;
+
+    // The number of columns each thread sweeps at once.
+    static const std::size_t BATCH_SIZE = 64;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,162 @@
+#include "BufferArena.hpp"
+
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+Counter& GetBufferUploadsCounter()
+{
+  // Looked up on first use rather than when an arena is constructed, since
+  // the MeshLoader's arenas are created during static initialization.
+  static Counter& bufferUploads = Metrics::GetCounter("Renderer.BufferUploads");
+  return bufferUploads;
+}
+
+/******************************************************************************/
+BufferArena::BufferArena(std::size_t aElementSize, std::size_t aInitialCapacity)
+  : mElementSize(aElementSize)
+  , mInitialCapacity(std::max<std::size_t>(aInitialCapacity, 1))
+{
+}
+
+/******************************************************************************/
+void BufferArena::Allocate(ID aID, const void* aData, std::size_t aCount)
+{
+  // Empty data still gets a range, so that every ID has an offset.
+  auto size = std::max<std::size_t>(aCount, 1);
+  if(!mAllocator.Allocate(aID, size))
+  {
+    // Make sure the space added to the end of the buffer is enough on its
+    // own, since the existing free space is too fragmented.
+    Grow(mAllocator.GetCapacity() + size);
+    mAllocator.Allocate(aID, size);
+  }
+
+  if(aCount > 0)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    GetOffset(aID) * mElementSize,
+                    aCount * mElementSize,
+                    aData);
+    GetBufferUploadsCounter().Increment();
+  }
+}
+
+/******************************************************************************/
+void BufferArena::Update(ID aID, const void* aData, std::size_t aCount)
+{
+  if(mAllocator.IsAllocated(aID) && aCount <= mAllocator.GetBlock(aID).mSize)
+  {
+    if(aCount > 0)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+      glBufferSubData(GL_COPY_WRITE_BUFFER,
+                      GetOffset(aID) * mElementSize,
+                      aCount * mElementSize,
+                      aData);
+      GetBufferUploadsCounter().Increment();
+    }
+
+    return;
+  }
+
+  Free(aID);
+  Allocate(aID, aData, aCount);
+}
+
+/******************************************************************************/
+void BufferArena::Free(ID aID)
+{
+  mAllocator.Free(aID);
+}
+
+/******************************************************************************/
+std::size_t BufferArena::Defragment(std::size_t aMaxMoves)
+{
+  std::size_t numMoves = 0;
+
+  FreeListAllocator::Move move;
+  while(numMoves < aMaxMoves && mAllocator.Compact(move))
+  {
+    // The old and new ranges never overlap, so the data can be copied
+    // within the same buffer.
+    glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        move.mOldOffset * mElementSize,
+                        move.mNewOffset * mElementSize,
+                        move.mSize * mElementSize);
+    ++numMoves;
+  }
+
+  return numMoves;
+}
+
+/******************************************************************************/
+void BufferArena::Unload()
+{
+  if(mBuffer != 0)
+  {
+    glDeleteBuffers(1, &mBuffer);
+    mBuffer = 0;
+  }
+
+  mAllocator = FreeListAllocator();
+}
+
+/******************************************************************************/
+bool BufferArena::IsAllocated(ID aID) const
+{
+  return mAllocator.IsAllocated(aID);
+}
+
+/******************************************************************************/
+std::size_t BufferArena::GetOffset(ID aID) const
+{
+  return mAllocator.GetBlock(aID).mOffset;
+}
+
+/******************************************************************************/
+void BufferArena::Grow(std::size_t aCapacity)
+{
+  // Double the capacity until it's large enough, to keep the number of
+  // reallocations low.
+  auto oldCapacity = mAllocator.GetCapacity();
+  auto newCapacity = std::max(oldCapacity, mInitialCapacity);
+  while(newCapacity < aCapacity || newCapacity == oldCapacity)
+  {
+    newCapacity *= 2;
+  }
+
+  unsigned int newBuffer = 0;
+  glGenBuffers(1, &newBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               newCapacity * mElementSize,
+               nullptr,
+               GL_STATIC_DRAW);
+
+  // Copy over the existing contents, then replace the old buffer.
+  if(mBuffer != 0)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, mBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER,
+                        GL_COPY_WRITE_BUFFER,
+                        0,
+                        0,
+                        oldCapacity * mElementSize);
+    glDeleteBuffers(1, &mBuffer);
+  }
+
+  mBuffer = newBuffer;
+  mAllocator.Grow(newCapacity);
+}
+
+} // namespace Kuma3D
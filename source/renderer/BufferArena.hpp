@@ -0,0 +1,127 @@
+#ifndef BUFFERARENA_HPP
+#define BUFFERARENA_HPP
+
+#include <cstddef>
+
+#include "FreeListAllocator.hpp"
+#include "IDGenerator.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A single large OpenGL buffer that is divided into ranges of fixed-size
+ * elements (such as vertices or indices), each belonging to an owner ID.
+ * The buffer is created when the first range is allocated, and grows as
+ * needed; growing replaces the buffer, so anything that refers to the
+ * buffer by name (such as a vertex array) must be updated when
+ * GetBuffer() changes.
+ *
+ * All functions that upload or move data require an OpenGL context;
+ * Free() does not.
+ */
+class BufferArena
+{
+  public:
+
+    /**
+     * Creates an empty arena.
+     *
+     * @param aElementSize The size of each element, in bytes.
+     * @param aInitialCapacity The number of elements to make room for when
+     *                         the buffer is first created.
+     */
+    BufferArena(std::size_t aElementSize, std::size_t aInitialCapacity);
+
+    /**
+     * Allocates a range for the given ID and copies the given elements
+     * into it, growing the buffer if there isn't enough room.
+     *
+     * @param aID The ID to allocate a range for.
+     * @param aData The elements to copy into the range.
+     * @param aCount The number of elements.
+     */
+    void Allocate(ID aID, const void* aData, std::size_t aCount);
+
+    /**
+     * Replaces the elements in the range for the given ID. The data is
+     * written in place if it fits in the existing range; otherwise, the
+     * range is reallocated.
+     *
+     * @param aID The ID to update the range for.
+     * @param aData The new elements.
+     * @param aCount The number of elements.
+     */
+    void Update(ID aID, const void* aData, std::size_t aCount);
+
+    /**
+     * Frees the range for the given ID, if it has one.
+     *
+     * @param aID The ID to free the range for.
+     */
+    void Free(ID aID);
+
+    /**
+     * Moves up to the given number of ranges toward the start of the buffer
+     * to reclaim the space left by freed ranges.
+     *
+     * @param aMaxMoves The maximum number of ranges to move.
+     * @return The number of ranges moved.
+     */
+    std::size_t Defragment(std::size_t aMaxMoves);
+
+    /**
+     * Deletes the OpenGL buffer and frees every range.
+     */
+    void Unload();
+
+    /**
+     * Returns whether the given ID has a range in this arena.
+     *
+     * @param aID The ID to check.
+     * @return True if the ID has a range, false otherwise.
+     */
+    bool IsAllocated(ID aID) const;
+
+    /**
+     * Returns the offset (in elements) of the range for the given ID.
+     *
+     * @param aID The ID to retrieve the offset for.
+     * @return The offset of the ID's range.
+     */
+    std::size_t GetOffset(ID aID) const;
+
+    /**
+     * Returns the OpenGL buffer, or 0 if it hasn't been created.
+     *
+     * @return The name of the OpenGL buffer.
+     */
+    unsigned int GetBuffer() const { return mBuffer; }
+
+    /**
+     * Returns the allocator that tracks the buffer's ranges.
+     *
+     * @return The arena's allocator.
+     */
+    const FreeListAllocator& GetAllocator() const { return mAllocator; }
+
+  private:
+
+    /**
+     * Replaces the buffer with one that can hold at least the given
+     * number of elements, copying over the existing contents.
+     *
+     * @param aCapacity The minimum number of elements to hold.
+     */
+    void Grow(std::size_t aCapacity);
+
+    FreeListAllocator mAllocator;
+
+    std::size_t mElementSize { 0 };
+    std::size_t mInitialCapacity { 0 };
+
+    unsigned int mBuffer { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,155 @@
+#include "FencedBufferRing.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <GL/glew.h>
+
+namespace Kuma3D {
+
+/******************************************************************************/
+FencedBufferRing::FencedBufferRing(std::size_t aNumSegments)
+  : mFences(std::max<std::size_t>(aNumSegments, 1), nullptr)
+{
+}
+
+/******************************************************************************/
+void FencedBufferRing::Create(std::size_t aNumBuffers)
+{
+  mUseFences = GLEW_ARB_sync || GLEW_VERSION_3_2;
+
+  mBuffers.resize(aNumBuffers, 0);
+  mSegmentSizes.assign(aNumBuffers, 0);
+  glGenBuffers(static_cast<GLsizei>(aNumBuffers), mBuffers.data());
+  mSegment = 0;
+}
+
+/******************************************************************************/
+void FencedBufferRing::BeginFrame()
+{
+  if(!IsCreated())
+  {
+    return;
+  }
+
+  mSegment = (mSegment + 1) % mFences.size();
+  if(mUseFences)
+  {
+    WaitForSegment(mSegment);
+  }
+  else if(mSegment == 0)
+  {
+    // Without fences, there's no way to know whether the GPU is done with
+    // the ring, so give the driver new storage to write into instead.
+    for(std::size_t i = 0; i < mBuffers.size(); ++i)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffers[i]);
+      glBufferData(GL_COPY_WRITE_BUFFER,
+                   mSegmentSizes[i] * mFences.size(),
+                   nullptr,
+                   GL_STREAM_DRAW);
+    }
+  }
+}
+
+/******************************************************************************/
+void FencedBufferRing::Resize(std::size_t aBuffer, std::size_t aSegmentSize)
+{
+  // The old storage is orphaned, so none of the fences matter anymore.
+  DeleteFences();
+
+  mSegmentSizes[aBuffer] = aSegmentSize;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffers[aBuffer]);
+  glBufferData(GL_COPY_WRITE_BUFFER,
+               aSegmentSize * mFences.size(),
+               nullptr,
+               GL_STREAM_DRAW);
+}
+
+/******************************************************************************/
+void FencedBufferRing::Write(std::size_t aBuffer,
+                             std::size_t aOffset,
+                             std::size_t aSize,
+                             const void* aData)
+{
+  auto offset = (mSegment * mSegmentSizes[aBuffer]) + aOffset;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffers[aBuffer]);
+  mBufferUploads.Increment();
+
+  if(mUseFences)
+  {
+    // The fences already guarantee the GPU isn't reading this range, so
+    // the driver doesn't need to synchronize the write.
+    auto destination = glMapBufferRange(GL_COPY_WRITE_BUFFER,
+                                        offset,
+                                        aSize,
+                                        GL_MAP_WRITE_BIT |
+                                        GL_MAP_INVALIDATE_RANGE_BIT |
+                                        GL_MAP_UNSYNCHRONIZED_BIT);
+    if(destination != nullptr)
+    {
+      std::memcpy(destination, aData, aSize);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      return;
+    }
+  }
+
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, aSize, aData);
+}
+
+/******************************************************************************/
+void FencedBufferRing::EndFrame()
+{
+  if(mUseFences && IsCreated())
+  {
+    WaitForSegment(mSegment);
+    mFences[mSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+/******************************************************************************/
+void FencedBufferRing::Unload()
+{
+  DeleteFences();
+
+  if(IsCreated())
+  {
+    glDeleteBuffers(static_cast<GLsizei>(mBuffers.size()), mBuffers.data());
+    mBuffers.clear();
+    mSegmentSizes.clear();
+  }
+}
+
+/******************************************************************************/
+void FencedBufferRing::WaitForSegment(std::size_t aSegment)
+{
+  auto fence = static_cast<GLsync>(mFences[aSegment]);
+  if(fence == nullptr)
+  {
+    return;
+  }
+
+  GLenum result = GL_TIMEOUT_EXPIRED;
+  while(result == GL_TIMEOUT_EXPIRED)
+  {
+    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+  }
+
+  glDeleteSync(fence);
+  mFences[aSegment] = nullptr;
+}
+
+/******************************************************************************/
+void FencedBufferRing::DeleteFences()
+{
+  for(auto& fence : mFences)
+  {
+    if(fence != nullptr)
+    {
+      glDeleteSync(static_cast<GLsync>(fence));
+      fence = nullptr;
+    }
+  }
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,144 @@
+#ifndef FENCEDBUFFERRING_HPP
+#define FENCEDBUFFERRING_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/**
+ * One or more OpenGL buffers that are rewritten every frame, each split into
+ * one segment per frame in flight. Each frame writes into the next segment
+ * of every buffer, while the GPU may still be reading the segments written
+ * during earlier frames.
+ *
+ * When sync objects are available, a fence guards each segment so that it's
+ * only overwritten once the GPU has finished reading it, and writes skip the
+ * driver's own synchronization. Otherwise, the buffers are orphaned each
+ * time the ring wraps around.
+ *
+ * This class only manages storage and synchronization; the StreamBuffer and
+ * UniformRingBuffer decide what goes into it. All functions require an
+ * OpenGL context.
+ */
+class FencedBufferRing
+{
+  public:
+
+    /**
+     * Creates an empty ring. No OpenGL objects are created until Create()
+     * is called.
+     *
+     * @param aNumSegments The number of frames that can be in flight.
+     */
+    explicit FencedBufferRing(std::size_t aNumSegments = 3);
+
+    /**
+     * Creates the OpenGL buffers, without any storage.
+     *
+     * @param aNumBuffers The number of buffers to create.
+     */
+    void Create(std::size_t aNumBuffers);
+
+    /**
+     * Returns whether the buffers have been created.
+     *
+     * @return True if Create() has been called since the last Unload().
+     */
+    bool IsCreated() const { return !mBuffers.empty(); }
+
+    /**
+     * Returns the name of one of the OpenGL buffers.
+     *
+     * @param aBuffer The index of the buffer.
+     * @return The name of the buffer.
+     */
+    unsigned int GetBuffer(std::size_t aBuffer) const { return mBuffers[aBuffer]; }
+
+    /**
+     * Returns the number of bytes in each segment of a buffer.
+     *
+     * @param aBuffer The index of the buffer.
+     * @return The size of each segment, in bytes.
+     */
+    std::size_t GetSegmentSize(std::size_t aBuffer) const { return mSegmentSizes[aBuffer]; }
+
+    /**
+     * Returns the index of the segment being written this frame.
+     *
+     * @return The current segment.
+     */
+    std::size_t GetSegment() const { return mSegment; }
+
+    /**
+     * Moves to the next segment, waiting for the GPU to finish with it if
+     * necessary. Does nothing if the buffers haven't been created.
+     */
+    void BeginFrame();
+
+    /**
+     * Gives a buffer new storage, which restarts the ring. The driver keeps
+     * the old storage for as long as earlier draw calls need it.
+     *
+     * @param aBuffer The index of the buffer.
+     * @param aSegmentSize The number of bytes in each segment.
+     */
+    void Resize(std::size_t aBuffer, std::size_t aSegmentSize);
+
+    /**
+     * Writes data into the current segment of a buffer without waiting for
+     * the GPU.
+     *
+     * @param aBuffer The index of the buffer.
+     * @param aOffset The offset to write to, in bytes from the start of the
+     *                segment.
+     * @param aSize The number of bytes to write.
+     * @param aData The data to write.
+     */
+    void Write(std::size_t aBuffer,
+               std::size_t aOffset,
+               std::size_t aSize,
+               const void* aData);
+
+    /**
+     * Marks the end of the GPU's use of the current segment. This should be
+     * called once all draw calls that read from it have been made.
+     */
+    void EndFrame();
+
+    /**
+     * Deletes all OpenGL objects.
+     */
+    void Unload();
+
+  private:
+
+    /**
+     * Waits for the GPU to finish with a segment, then deletes its fence.
+     *
+     * @param aSegment The segment to wait for.
+     */
+    void WaitForSegment(std::size_t aSegment);
+
+    /**
+     * Deletes the fence for every segment without waiting for it.
+     */
+    void DeleteFences();
+
+    std::vector<unsigned int> mBuffers;
+    std::vector<std::size_t> mSegmentSizes;
+
+    // One fence per segment, or nullptr if the segment isn't in use.
+    std::vector<void*> mFences;
+    std::size_t mSegment { 0 };
+
+    bool mUseFences { false };
+
+    Counter& mBufferUploads { Metrics::GetCounter("Renderer.BufferUploads") };
+};
+
+} // namespace Kuma3D
+
+#endif
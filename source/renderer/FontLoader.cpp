@@ -8,6 +8,7 @@
 
 #include <GL/glew.h>
 
+#include "Profiler.hpp"
 #include "TextureLoader.hpp"
 
 namespace Kuma3D {
@@ -23,6 +24,8 @@ std::map<FontTextureIdentifier, ID> FontLoader::mFontTextureMap;
 /******************************************************************************/
 void FontLoader::LoadFontFromFile(const std::string& aFilePath)
 {
+  KUMA3D_PROFILE_SCOPE("FontLoader::LoadFontFromFile");
+
   if(!mInitialized)
   {
     auto error = FT_Init_FreeType(&mLibrary);
@@ -56,6 +59,8 @@ void FontLoader::LoadFontFromFile(const std::string& aFilePath)
 /******************************************************************************/
 ID FontLoader::LoadTextureForFont(const FontTextureIdentifier& aFontTextureID)
 {
+  KUMA3D_PROFILE_SCOPE("FontLoader::LoadTextureForFont");
+
   auto foundFace = mFontFaceMap.find(aFontTextureID.mFace);
   if(foundFace == mFontFaceMap.end())
   {
@@ -165,7 +170,7 @@ void FontLoader::UnloadFontsAndTextures()
   // Deallocate all the OpenGL textures.
   for(auto& fontTexturePair : mFontTextureMap)
   {
-    glDeleteTextures(1, &fontTexturePair.second);
+    TextureLoader::UnloadTexture(fontTexturePair.second);
   }
   mFontTextureMap.clear();
 
@@ -295,6 +300,7 @@ void FontLoader::UpdateMeshToDisplayText(Mesh& aMesh,
     aMesh.mTextures.emplace_back(foundTexture->second);
 
     aMesh.mHasTransparency = true;
+    aMesh.mUsage = MeshUsage::eDYNAMIC;
     aMesh.mDirty = true;
   }
 }
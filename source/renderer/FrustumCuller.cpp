@@ -0,0 +1,37 @@
+#include "FrustumCuller.hpp"
+
+#include <algorithm>
+
+#include "JobSystem.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void FrustumCuller::Clear()
+{
+  mBoxes.Clear();
+}
+
+/******************************************************************************/
+std::size_t FrustumCuller::Add(const AABB& aBox)
+{
+  return mBoxes.Add(aBox);
+}
+
+/******************************************************************************/
+std::size_t FrustumCuller::Cull(const Frustum& aFrustum,
+                                std::vector<unsigned char>& aVisible) const
+{
+  // Make room for the padding at the end of the streams.
+  aVisible.resize(mBoxes.mCenterX.size());
+
+  JobSystem::ParallelFor(mBoxes.Size(), BATCH_SIZE, [this, &aFrustum, &aVisible](std::size_t aStart, std::size_t aEnd)
+  {
+    Intersects(aFrustum, mBoxes, aStart, aEnd, aVisible.data());
+  });
+
+  aVisible.resize(mBoxes.Size());
+  return std::count(aVisible.begin(), aVisible.end(), 1);
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,66 @@
+#ifndef FRUSTUMCULLER_HPP
+#define FRUSTUMCULLER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "BoundsStreams.hpp"
+#include "Geometry.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Tests a list of bounding boxes against a view frustum.
+ *
+ * The boxes are stored in BoxStreams, so that four boxes can be tested
+ * against each plane at once with SIMD instructions. Large lists are split
+ * across the JobSystem's workers.
+ */
+class FrustumCuller
+{
+  public:
+
+    /**
+     * Removes every box.
+     */
+    void Clear();
+
+    /**
+     * Adds a box to be tested.
+     *
+     * @param aBox The box to add.
+     * @return The index of the box's result in the list given to Cull().
+     */
+    std::size_t Add(const AABB& aBox);
+
+    /**
+     * Returns the number of boxes added.
+     *
+     * @return The number of boxes.
+     */
+    std::size_t GetSize() const { return mBoxes.Size(); }
+
+    /**
+     * Tests each box against a frustum. A box is visible if it might be
+     * inside the frustum (see Intersects()).
+     *
+     * @param aFrustum The frustum to test against.
+     * @param aVisible Resized to the number of boxes, and filled with 1 for
+     *                 each visible box and 0 for each culled box.
+     * @return The number of visible boxes.
+     */
+    std::size_t Cull(const Frustum& aFrustum,
+                     std::vector<unsigned char>& aVisible) const;
+
+  private:
+
+    // The boxes to test, padded to a multiple of 4.
+    BoxStreams mBoxes;
+
+    // The number of boxes each thread tests at once.
+    static const std::size_t BATCH_SIZE = 1024;
+};
+
+} // namespace Kuma3D
+
+#endif
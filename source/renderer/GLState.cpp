@@ -0,0 +1,164 @@
+#include "GLState.hpp"
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+// The value used for state that isn't known.
+const unsigned int UNKNOWN = ~0u;
+
+unsigned int GLState::mProgram = UNKNOWN;
+unsigned int GLState::mVertexArray = UNKNOWN;
+unsigned int GLState::mActiveTextureUnit = UNKNOWN;
+std::vector<unsigned int> GLState::mTextures;
+std::map<GLenum, bool> GLState::mCapabilities;
+
+int GLState::mViewport[4] = { 0, 0, 0, 0 };
+bool GLState::mViewportKnown = false;
+
+GLenum GLState::mBlendSource = UNKNOWN;
+GLenum GLState::mBlendDestination = UNKNOWN;
+
+/******************************************************************************/
+void GLState::UseProgram(unsigned int aProgram)
+{
+  auto issue = (mProgram != aProgram);
+  if(issue)
+  {
+    glUseProgram(aProgram);
+    mProgram = aProgram;
+  }
+
+  RecordCall(issue);
+}
+
+/******************************************************************************/
+void GLState::BindVertexArray(unsigned int aVertexArray)
+{
+  auto issue = (mVertexArray != aVertexArray);
+  if(issue)
+  {
+    glBindVertexArray(aVertexArray);
+    mVertexArray = aVertexArray;
+  }
+
+  RecordCall(issue);
+}
+
+/******************************************************************************/
+void GLState::BindTexture(unsigned int aUnit, unsigned int aTexture)
+{
+  if(aUnit >= mTextures.size())
+  {
+    mTextures.resize(aUnit + 1, UNKNOWN);
+  }
+
+  if(mTextures[aUnit] == aTexture)
+  {
+    RecordCall(false);
+    return;
+  }
+
+  // Only switch texture units when a texture actually needs binding.
+  auto switchUnit = (mActiveTextureUnit != aUnit);
+  if(switchUnit)
+  {
+    glActiveTexture(GL_TEXTURE0 + aUnit);
+    mActiveTextureUnit = aUnit;
+    RecordCall(true);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, aTexture);
+  mTextures[aUnit] = aTexture;
+  RecordCall(true);
+}
+
+/******************************************************************************/
+void GLState::BindTextureForEdit(unsigned int aTexture)
+{
+  if(mActiveTextureUnit != 0)
+  {
+    glActiveTexture(GL_TEXTURE0);
+    mActiveTextureUnit = 0;
+    RecordCall(true);
+  }
+
+  BindTexture(0, aTexture);
+}
+
+/******************************************************************************/
+void GLState::SetEnabled(GLenum aCapability, bool aEnabled)
+{
+  auto foundCapability = mCapabilities.find(aCapability);
+  auto issue = (foundCapability == mCapabilities.end() ||
+                foundCapability->second != aEnabled);
+  if(issue)
+  {
+    aEnabled ? glEnable(aCapability) : glDisable(aCapability);
+    mCapabilities[aCapability] = aEnabled;
+  }
+
+  RecordCall(issue);
+}
+
+/******************************************************************************/
+void GLState::SetViewport(int aX, int aY, int aWidth, int aHeight)
+{
+  auto issue = (!mViewportKnown ||
+                mViewport[0] != aX ||
+                mViewport[1] != aY ||
+                mViewport[2] != aWidth ||
+                mViewport[3] != aHeight);
+  if(issue)
+  {
+    glViewport(aX, aY, aWidth, aHeight);
+    mViewport[0] = aX;
+    mViewport[1] = aY;
+    mViewport[2] = aWidth;
+    mViewport[3] = aHeight;
+    mViewportKnown = true;
+  }
+
+  RecordCall(issue);
+}
+
+/******************************************************************************/
+void GLState::SetBlendFunction(GLenum aSource, GLenum aDestination)
+{
+  auto issue = (mBlendSource != aSource || mBlendDestination != aDestination);
+  if(issue)
+  {
+    glBlendFunc(aSource, aDestination);
+    mBlendSource = aSource;
+    mBlendDestination = aDestination;
+  }
+
+  RecordCall(issue);
+}
+
+/******************************************************************************/
+void GLState::Invalidate()
+{
+  mProgram = UNKNOWN;
+  mVertexArray = UNKNOWN;
+  mActiveTextureUnit = UNKNOWN;
+  mTextures.clear();
+  mCapabilities.clear();
+  mViewportKnown = false;
+  mBlendSource = UNKNOWN;
+  mBlendDestination = UNKNOWN;
+}
+
+/******************************************************************************/
+void GLState::RecordCall(bool aIssued)
+{
+  // The counters are looked up on first use, since the Metrics registry
+  // may not exist yet during static initialization.
+  static Counter& issuedCalls = Metrics::GetCounter("Renderer.GLCalls.Issued");
+  static Counter& elidedCalls = Metrics::GetCounter("Renderer.GLCalls.Elided");
+
+  aIssued ? issuedCalls.Increment() : elidedCalls.Increment();
+}
+
+} // namespace Kuma3D
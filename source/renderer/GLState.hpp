@@ -0,0 +1,118 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+#include <map>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace Kuma3D {
+
+/**
+ * A static class that remembers the OpenGL state set through it, and skips
+ * any call that wouldn't change that state.
+ *
+ * All renderer code should change the bound program, vertex array and
+ * textures, the enabled capabilities, the viewport and the blend function
+ * through this class; otherwise, call Invalidate() afterwards. Invalidate()
+ * must also be called after deleting programs, vertex arrays or textures,
+ * since OpenGL may reuse their names.
+ *
+ * The number of calls passed on to OpenGL and the number skipped are
+ * recorded in the "Renderer.GLCalls.Issued" and "Renderer.GLCalls.Elided"
+ * counters.
+ */
+class GLState
+{
+  public:
+
+    /**
+     * Binds a shader program.
+     *
+     * @param aProgram The ID of the program to bind.
+     */
+    static void UseProgram(unsigned int aProgram);
+
+    /**
+     * Binds a vertex array.
+     *
+     * @param aVertexArray The ID of the vertex array to bind.
+     */
+    static void BindVertexArray(unsigned int aVertexArray);
+
+    /**
+     * Binds a 2D texture to a texture unit for drawing. The active texture
+     * unit is only changed if the texture needs binding, so use
+     * BindTextureForEdit() before changing a texture.
+     *
+     * @param aUnit The texture unit to bind to, starting from 0.
+     * @param aTexture The ID of the texture to bind.
+     */
+    static void BindTexture(unsigned int aUnit, unsigned int aTexture);
+
+    /**
+     * Binds a 2D texture to texture unit 0 and makes that unit active, so
+     * that calls such as glTexParameteri() and glTexSubImage2D() change
+     * the given texture.
+     *
+     * @param aTexture The ID of the texture to bind.
+     */
+    static void BindTextureForEdit(unsigned int aTexture);
+
+    /**
+     * Enables or disables an OpenGL capability, such as GL_DEPTH_TEST.
+     *
+     * @param aCapability The capability to change.
+     * @param aEnabled Whether to enable the capability.
+     */
+    static void SetEnabled(GLenum aCapability, bool aEnabled);
+
+    /**
+     * Sets the viewport.
+     *
+     * @param aX The left edge of the viewport, in pixels.
+     * @param aY The bottom edge of the viewport, in pixels.
+     * @param aWidth The width of the viewport, in pixels.
+     * @param aHeight The height of the viewport, in pixels.
+     */
+    static void SetViewport(int aX, int aY, int aWidth, int aHeight);
+
+    /**
+     * Sets the blend function.
+     *
+     * @param aSource The factor for the incoming color.
+     * @param aDestination The factor for the color already drawn.
+     */
+    static void SetBlendFunction(GLenum aSource, GLenum aDestination);
+
+    /**
+     * Forgets all remembered state, so the next call to each function
+     * is always passed on to OpenGL.
+     */
+    static void Invalidate();
+
+  private:
+
+    /**
+     * Records whether a call was passed on to OpenGL or skipped.
+     *
+     * @param aIssued Whether the call was passed on to OpenGL.
+     */
+    static void RecordCall(bool aIssued);
+
+    static unsigned int mProgram;
+    static unsigned int mVertexArray;
+    static unsigned int mActiveTextureUnit;
+    static std::vector<unsigned int> mTextures;
+    static std::map<GLenum, bool> mCapabilities;
+
+    static int mViewport[4];
+    static bool mViewportKnown;
+
+    static GLenum mBlendSource;
+    static GLenum mBlendDestination;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,358 @@
+#include "MeshLoader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <GL/glew.h>
+
+#include "GLState.hpp"
+
+namespace Kuma3D {
+
+std::map<ID, MeshLoader::MeshData>& MeshLoader::mMeshMap = *new std::map<ID, MeshLoader::MeshData>();
+ID MeshLoader::mNextID = 1;
+
+BufferArena& MeshLoader::mVertexArena = *new BufferArena(sizeof(MeshVertex), 16384);
+BufferArena& MeshLoader::mIndexArena = *new BufferArena(sizeof(unsigned int), 65536);
+
+unsigned int MeshLoader::mVertexArray = 0;
+unsigned int MeshLoader::mVertexArrayVertexBuffer = 0;
+unsigned int MeshLoader::mVertexArrayElementBuffer = 0;
+
+/******************************************************************************/
+MeshHandle::MeshHandle(ID aID)
+  : mID(aID)
+{
+  MeshLoader::AddReference(mID);
+}
+
+/******************************************************************************/
+MeshHandle::~MeshHandle()
+{
+  Reset();
+}
+
+/******************************************************************************/
+MeshHandle::MeshHandle(const MeshHandle& aOther)
+  : mID(aOther.mID)
+{
+  if(mID != 0)
+  {
+    MeshLoader::AddReference(mID);
+  }
+}
+
+/******************************************************************************/
+MeshHandle::MeshHandle(MeshHandle&& aOther) noexcept
+  : mID(aOther.mID)
+{
+  aOther.mID = 0;
+}
+
+/******************************************************************************/
+MeshHandle& MeshHandle::operator=(const MeshHandle& aOther)
+{
+  // Add the new reference before removing the old one, in case both
+  // handles refer to the same geometry.
+  if(aOther.mID != 0)
+  {
+    MeshLoader::AddReference(aOther.mID);
+  }
+  Reset();
+  mID = aOther.mID;
+
+  return *this;
+}
+
+/******************************************************************************/
+MeshHandle& MeshHandle::operator=(MeshHandle&& aOther) noexcept
+{
+  if(this != &aOther)
+  {
+    Reset();
+    mID = aOther.mID;
+    aOther.mID = 0;
+  }
+
+  return *this;
+}
+
+/******************************************************************************/
+void MeshHandle::Reset()
+{
+  if(mID != 0)
+  {
+    MeshLoader::RemoveReference(mID);
+    mID = 0;
+  }
+}
+
+/******************************************************************************/
+MeshHandle MeshLoader::LoadMesh(std::vector<MeshVertex> aVertices,
+                                std::vector<unsigned int> aIndices)
+{
+  auto id = mNextID;
+  ++mNextID;
+
+  auto& data = mMeshMap[id];
+  data.mVertices = std::move(aVertices);
+  data.mIndices = std::move(aIndices);
+  data.mBounds = CalculateBounds(data.mVertices);
+
+  return MeshHandle(id);
+}
+
+/******************************************************************************/
+void MeshLoader::UpdateMesh(const MeshHandle& aHandle,
+                            std::vector<MeshVertex> aVertices,
+                            std::vector<unsigned int> aIndices)
+{
+  auto& data = GetMeshData(aHandle);
+  data.mVertices = std::move(aVertices);
+  data.mIndices = std::move(aIndices);
+  data.mBounds = CalculateBounds(data.mVertices);
+  ++data.mRevision;
+
+  // If the geometry has already been uploaded, upload it again now.
+  // Otherwise, it will be uploaded the first time it's drawn.
+  if(mVertexArena.IsAllocated(aHandle.GetID()))
+  {
+    mVertexArena.Update(aHandle.GetID(), data.mVertices.data(), data.mVertices.size());
+    mIndexArena.Update(aHandle.GetID(), data.mIndices.data(), data.mIndices.size());
+    UpdateVertexArray();
+  }
+}
+
+/******************************************************************************/
+const std::vector<MeshVertex>& MeshLoader::GetVertices(const MeshHandle& aHandle)
+{
+  return GetMeshData(aHandle).mVertices;
+}
+
+/******************************************************************************/
+const std::vector<unsigned int>& MeshLoader::GetIndices(const MeshHandle& aHandle)
+{
+  return GetMeshData(aHandle).mIndices;
+}
+
+/******************************************************************************/
+const AABB& MeshLoader::GetBounds(const MeshHandle& aHandle)
+{
+  return GetMeshData(aHandle).mBounds;
+}
+
+/******************************************************************************/
+unsigned int MeshLoader::GetRevision(const MeshHandle& aHandle)
+{
+  return GetMeshData(aHandle).mRevision;
+}
+
+/******************************************************************************/
+AABB MeshLoader::CalculateBounds(const std::vector<MeshVertex>& aVertices)
+{
+  AABB bounds;
+  for(const auto& vertex : aVertices)
+  {
+    Expand(bounds, vertex.mPosition);
+  }
+
+  return bounds;
+}
+
+/******************************************************************************/
+std::size_t MeshLoader::HashGeometry(const std::vector<MeshVertex>& aVertices,
+                                     const std::vector<unsigned int>& aIndices)
+{
+  // A 64-bit FNV-1a hash over each vertex attribute and index. The values
+  // are hashed individually (rather than as raw memory) to skip any padding.
+  std::uint64_t hash = 14695981039346656037ULL;
+  auto hashValue = [&hash](std::uint32_t aValue)
+  {
+    for(int i = 0; i < 4; ++i)
+    {
+      hash ^= (aValue >> (i * 8)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  };
+  auto hashFloat = [&hashValue](float aValue)
+  {
+    std::uint32_t bits;
+    std::memcpy(&bits, &aValue, sizeof(bits));
+    hashValue(bits);
+  };
+
+  hashValue(aVertices.size());
+  for(const auto& vertex : aVertices)
+  {
+    hashFloat(vertex.mPosition.x);
+    hashFloat(vertex.mPosition.y);
+    hashFloat(vertex.mPosition.z);
+    hashFloat(vertex.mColor.x);
+    hashFloat(vertex.mColor.y);
+    hashFloat(vertex.mColor.z);
+    hashFloat(vertex.mTexCoords[0]);
+    hashFloat(vertex.mTexCoords[1]);
+  }
+
+  hashValue(aIndices.size());
+  for(const auto& index : aIndices)
+  {
+    hashValue(index);
+  }
+
+  return static_cast<std::size_t>(hash);
+}
+
+/******************************************************************************/
+MeshRange MeshLoader::GetRange(const MeshHandle& aHandle)
+{
+  auto& data = GetMeshData(aHandle);
+
+  auto id = aHandle.GetID();
+  if(!mVertexArena.IsAllocated(id))
+  {
+    mVertexArena.Allocate(id, data.mVertices.data(), data.mVertices.size());
+    mIndexArena.Allocate(id, data.mIndices.data(), data.mIndices.size());
+    UpdateVertexArray();
+  }
+
+  MeshRange range;
+  range.mVertexArray = mVertexArray;
+  range.mBaseVertex = static_cast<int>(mVertexArena.GetOffset(id));
+  range.mFirstIndex = mIndexArena.GetOffset(id);
+  range.mIndexCount = data.mIndices.size();
+  return range;
+}
+
+/******************************************************************************/
+unsigned int MeshLoader::GetVertexArray()
+{
+  UpdateVertexArray();
+  return mVertexArray;
+}
+
+/******************************************************************************/
+unsigned int MeshLoader::GetReferenceCount(const MeshHandle& aHandle)
+{
+  return GetMeshData(aHandle).mReferenceCount;
+}
+
+/******************************************************************************/
+std::size_t MeshLoader::GetMeshCount()
+{
+  return mMeshMap.size();
+}
+
+/******************************************************************************/
+void MeshLoader::Defragment(std::size_t aMaxMoves)
+{
+  mVertexArena.Defragment(aMaxMoves);
+  mIndexArena.Defragment(aMaxMoves);
+}
+
+/******************************************************************************/
+void MeshLoader::UnloadMeshes()
+{
+  if(mVertexArray != 0)
+  {
+    glDeleteVertexArrays(1, &mVertexArray);
+    GLState::Invalidate();
+    mVertexArray = 0;
+    mVertexArrayVertexBuffer = 0;
+    mVertexArrayElementBuffer = 0;
+  }
+
+  mVertexArena.Unload();
+  mIndexArena.Unload();
+}
+
+/******************************************************************************/
+void MeshLoader::UpdateVertexArray()
+{
+  if(mVertexArray == 0)
+  {
+    glGenVertexArrays(1, &mVertexArray);
+  }
+
+  // The arenas replace their buffers whenever they grow.
+  if(mVertexArrayVertexBuffer != mVertexArena.GetBuffer() ||
+     mVertexArrayElementBuffer != mIndexArena.GetBuffer())
+  {
+    mVertexArrayVertexBuffer = mVertexArena.GetBuffer();
+    mVertexArrayElementBuffer = mIndexArena.GetBuffer();
+
+    GLState::BindVertexArray(mVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexArrayVertexBuffer);
+    ConfigureVertexAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mVertexArrayElementBuffer);
+    GLState::BindVertexArray(0);
+  }
+}
+
+/******************************************************************************/
+void MeshLoader::ConfigureVertexAttributes()
+{
+  // Configure the vertex position attributes.
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0,
+                        3,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(MeshVertex),
+                        (void*)(0));
+
+  // Configure the vertex color attributes.
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1,
+                        3,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(MeshVertex),
+                        (void*)(offsetof(MeshVertex, mColor)));
+
+  // Configure the vertex texture coordinates.
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2,
+                        2,
+                        GL_FLOAT,
+                        GL_FALSE,
+                        sizeof(MeshVertex),
+                        (void*)(offsetof(MeshVertex, mTexCoords)));
+}
+
+/******************************************************************************/
+void MeshLoader::AddReference(ID aID)
+{
+  ++mMeshMap.at(aID).mReferenceCount;
+}
+
+/******************************************************************************/
+void MeshLoader::RemoveReference(ID aID)
+{
+  auto foundMesh = mMeshMap.find(aID);
+  if(foundMesh != mMeshMap.end() && --foundMesh->second.mReferenceCount == 0)
+  {
+    mVertexArena.Free(aID);
+    mIndexArena.Free(aID);
+    mMeshMap.erase(foundMesh);
+  }
+}
+
+/******************************************************************************/
+MeshLoader::MeshData& MeshLoader::GetMeshData(const MeshHandle& aHandle)
+{
+  auto foundMesh = mMeshMap.find(aHandle.GetID());
+  if(foundMesh == mMeshMap.end())
+  {
+    std::stringstream error;
+    error << "No mesh with ID " << aHandle.GetID() << " exists!";
+    throw(std::invalid_argument(error.str()));
+  }
+
+  return foundMesh->second;
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,251 @@
+#ifndef MESHLOADER_HPP
+#define MESHLOADER_HPP
+
+#include <map>
+#include <vector>
+
+#include "IDGenerator.hpp"
+
+#include "Geometry.hpp"
+
+#include "BufferArena.hpp"
+#include "Mesh.hpp"
+#include "MeshHandle.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The location of some geometry within a set of OpenGL buffers, as
+ * needed by glDrawElementsBaseVertex().
+ */
+struct MeshRange
+{
+  unsigned int mVertexArray { 0 };
+  int mBaseVertex { 0 };
+  std::size_t mFirstIndex { 0 };
+  std::size_t mIndexCount { 0 };
+};
+
+/**
+ * A static class that owns geometry shared between Meshes. Geometry is
+ * stored once, uploaded to OpenGL the first time it's drawn, and freed
+ * once the last MeshHandle referring to it is destroyed.
+ *
+ * Rather than giving each mesh its own buffers, all geometry is uploaded
+ * into one large vertex buffer and one large index buffer, which are
+ * drawn from through a single vertex array. Freed space is reclaimed
+ * gradually with Defragment().
+ */
+class MeshLoader
+{
+  public:
+
+    /**
+     * Stores the given geometry and returns a handle to it.
+     *
+     * @param aVertices The vertices of the geometry.
+     * @param aIndices The indices of the geometry.
+     * @return A handle to the stored geometry.
+     */
+    static MeshHandle LoadMesh(std::vector<MeshVertex> aVertices,
+                               std::vector<unsigned int> aIndices);
+
+    /**
+     * Replaces the geometry a handle refers to. If the geometry has been
+     * uploaded, the new geometry is written over it in place whenever it
+     * fits.
+     *
+     * @param aHandle The handle to the geometry.
+     * @param aVertices The new vertices.
+     * @param aIndices The new indices.
+     */
+    static void UpdateMesh(const MeshHandle& aHandle,
+                           std::vector<MeshVertex> aVertices,
+                           std::vector<unsigned int> aIndices);
+
+    /**
+     * Returns the vertices of the geometry a handle refers to.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The vertices of the geometry.
+     */
+    static const std::vector<MeshVertex>& GetVertices(const MeshHandle& aHandle);
+
+    /**
+     * Returns the indices of the geometry a handle refers to.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The indices of the geometry.
+     */
+    static const std::vector<unsigned int>& GetIndices(const MeshHandle& aHandle);
+
+    /**
+     * Returns the bounding box of the geometry a handle refers to, which is
+     * recalculated whenever the geometry changes.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The bounding box of the geometry.
+     */
+    static const AABB& GetBounds(const MeshHandle& aHandle);
+
+    /**
+     * Returns the number of times the geometry a handle refers to has been
+     * updated, for caching data derived from it.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The revision of the geometry.
+     */
+    static unsigned int GetRevision(const MeshHandle& aHandle);
+
+    /**
+     * Calculates the smallest box containing each of the given vertices.
+     *
+     * @param aVertices The vertices to fit.
+     * @return The bounding box of the vertices; empty if there are none.
+     */
+    static AABB CalculateBounds(const std::vector<MeshVertex>& aVertices);
+
+    /**
+     * Calculates a hash of the given geometry, for telling whether it has
+     * changed or matches other geometry.
+     *
+     * @param aVertices The vertices of the geometry.
+     * @param aIndices The indices of the geometry.
+     * @return The hash of the geometry.
+     */
+    static std::size_t HashGeometry(const std::vector<MeshVertex>& aVertices,
+                                    const std::vector<unsigned int>& aIndices);
+
+    /**
+     * Returns where the geometry a handle refers to is stored in the
+     * OpenGL buffers, uploading it if this is the first time it has been
+     * requested. This requires an OpenGL context.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The location of the geometry.
+     */
+    static MeshRange GetRange(const MeshHandle& aHandle);
+
+    /**
+     * Returns the OpenGL vertex array that all geometry is drawn with.
+     * This requires an OpenGL context.
+     *
+     * @return The ID of the OpenGL vertex array.
+     */
+    static unsigned int GetVertexArray();
+
+    /**
+     * Returns the number of handles referring to the given geometry.
+     *
+     * @param aHandle A handle to the geometry.
+     * @return The number of references to the geometry.
+     */
+    static unsigned int GetReferenceCount(const MeshHandle& aHandle);
+
+    /**
+     * Returns the amount of geometry currently stored.
+     *
+     * @return The number of meshes stored.
+     */
+    static std::size_t GetMeshCount();
+
+    /**
+     * Configures the vertex attributes of the currently bound vertex array
+     * to read MeshVertex data from the currently bound array buffer.
+     */
+    static void ConfigureVertexAttributes();
+
+    /**
+     * Moves up to the given number of meshes toward the start of each buffer
+     * to reclaim the space left by freed meshes. Calling this once per frame
+     * spreads the cost of defragmentation over many frames.
+     *
+     * @param aMaxMoves The maximum number of meshes to move in each buffer.
+     */
+    static void Defragment(std::size_t aMaxMoves);
+
+    /**
+     * Deletes the OpenGL buffers of all stored geometry. The geometry itself
+     * is kept for as long as handles refer to it. If you load any meshes, be
+     * sure to call this before the program terminates to avoid memory leaks.
+     */
+    static void UnloadMeshes();
+
+    /**
+     * Returns the buffer that vertices are stored in.
+     *
+     * @return The vertex buffer arena.
+     */
+    static const BufferArena& GetVertexArena() { return mVertexArena; }
+
+    /**
+     * Returns the buffer that indices are stored in.
+     *
+     * @return The index buffer arena.
+     */
+    static const BufferArena& GetIndexArena() { return mIndexArena; }
+
+  private:
+    friend class MeshHandle;
+
+    /**
+     * Geometry shared by each Mesh with a handle to it.
+     */
+    struct MeshData
+    {
+      std::vector<MeshVertex> mVertices;
+      std::vector<unsigned int> mIndices;
+      AABB mBounds;
+      unsigned int mRevision { 0 };
+
+      unsigned int mReferenceCount { 0 };
+    };
+
+    /**
+     * Adds a reference to the geometry with the given ID.
+     *
+     * @param aID The ID of the geometry.
+     */
+    static void AddReference(ID aID);
+
+    /**
+     * Removes a reference to the geometry with the given ID, freeing it if
+     * this was the last reference.
+     *
+     * @param aID The ID of the geometry.
+     */
+    static void RemoveReference(ID aID);
+
+    /**
+     * Returns the geometry for a handle, throwing an exception if the
+     * handle is empty.
+     *
+     * @param aHandle The handle to the geometry.
+     * @return The geometry.
+     */
+    static MeshData& GetMeshData(const MeshHandle& aHandle);
+
+    /**
+     * Creates the vertex array if it doesn't exist, and points it at the
+     * current vertex and index buffers if either has been replaced.
+     */
+    static void UpdateVertexArray();
+
+    // The geometry map and buffers are never destroyed, since handles may be
+    // destroyed during static destruction (for example, those held by the
+    // ModelLoader).
+    static std::map<ID, MeshData>& mMeshMap;
+    static ID mNextID;
+
+    static BufferArena& mVertexArena;
+    static BufferArena& mIndexArena;
+
+    // The vertex array, along with the buffers it currently points to.
+    static unsigned int mVertexArray;
+    static unsigned int mVertexArrayVertexBuffer;
+    static unsigned int mVertexArrayElementBuffer;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -6,9 +6,12 @@
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
+#include "MeshLoader.hpp"
 #include "Model.hpp"
 #include "Transform.hpp"
 
+#include "Profiler.hpp"
+
 namespace Kuma3D {
 
 /******************************************************************************/
@@ -28,6 +31,8 @@ ID ModelLoader::LoadModel(const std::string& aFilePath,
                           TextureWrapOption aWrapOption,
                           TextureFilterOption aFilterOption)
 {
+  KUMA3D_PROFILE_SCOPE("ModelLoader::LoadModel");
+
   ID modelID = 0;
 
   // Set the working directory.
@@ -62,6 +67,8 @@ ID ModelLoader::LoadModel(const std::string& aFilePath,
 /******************************************************************************/
 Entity ModelLoader::CreateModel(ID aID, Scene& aScene)
 {
+  KUMA3D_PROFILE_SCOPE("ModelLoader::CreateModel");
+
   auto foundModel = mModelMap.find(aID);
   if(foundModel == mModelMap.end())
   {
@@ -95,6 +102,7 @@ Entity ModelLoader::CreateModel(ID aID, Scene& aScene)
   {
     auto meshEntity = aScene.CreateEntity();
 
+    // The copy shares the mesh's geometry rather than duplicating it.
     auto meshCopy = mesh;
     aScene.AddComponentToEntity<Mesh>(meshEntity, meshCopy);
 
@@ -134,6 +142,8 @@ void ModelLoader::ProcessNode(const ID& aID, aiNode& aNode, const aiScene& aScen
 void ModelLoader::ProcessMesh(const ID& aID, aiMesh& aMesh, const aiScene& aScene)
 {
   Mesh mesh;
+  std::vector<MeshVertex> vertices;
+  std::vector<unsigned int> indices;
 
   // Retrieve the vertex data.
   for(int i = 0; i < aMesh.mNumVertices; ++i)
@@ -159,80 +169,80 @@ void ModelLoader::ProcessMesh(const ID& aID, aiMesh& aMesh, const aiScene& aScen
       vertex.mTexCoords[1] = texCoords[i].y;
     }
 
-    // Load the textures themselves, if there are any.
-    if(aMesh.mMaterialIndex >= 0)
+    vertices.emplace_back(vertex);
+  }
+
+  // Load the textures themselves, if there are any.
+  if(aMesh.mMaterialIndex >= 0)
+  {
+    auto material = aScene.mMaterials[aMesh.mMaterialIndex];
+
+    // Load each texture of each type for the material.
+    auto textureIDs = GetTexturesForMaterial(*material, aiTextureType_NONE);
+    for(const auto& id : textureIDs)
     {
-      auto material = aScene.mMaterials[aMesh.mMaterialIndex];
-
-      // Load each texture of each type for the material.
-      auto textureIDs = GetTexturesForMaterial(*material, aiTextureType_NONE);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_DIFFUSE);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_SPECULAR);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_AMBIENT);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_EMISSIVE);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_HEIGHT);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_NORMALS);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_SHININESS);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_OPACITY);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_DISPLACEMENT);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_LIGHTMAP);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_REFLECTION);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
-      textureIDs = GetTexturesForMaterial(*material, aiTextureType_UNKNOWN);
-      for(const auto& id : textureIDs)
-      {
-        mesh.mTextures.emplace_back(id);
-      }
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_DIFFUSE);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_SPECULAR);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_AMBIENT);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_EMISSIVE);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_HEIGHT);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_NORMALS);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_SHININESS);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_OPACITY);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_DISPLACEMENT);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_LIGHTMAP);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_REFLECTION);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
+    }
+    textureIDs = GetTexturesForMaterial(*material, aiTextureType_UNKNOWN);
+    for(const auto& id : textureIDs)
+    {
+      mesh.mTextures.emplace_back(id);
     }
-
-    mesh.mVertices.emplace_back(vertex);
   }
 
   // Retrieve the index data.
@@ -241,11 +251,12 @@ void ModelLoader::ProcessMesh(const ID& aID, aiMesh& aMesh, const aiScene& aScen
     auto face = aMesh.mFaces[i];
     for(int j = 0; j < face.mNumIndices; ++j)
     {
-      mesh.mIndices.emplace_back(face.mIndices[j]);
+      indices.emplace_back(face.mIndices[j]);
     }
   }
 
-  mesh.mDirty = true;
+  // Store the geometry once; each instance of the model shares it.
+  mesh.mGeometry = MeshLoader::LoadMesh(std::move(vertices), std::move(indices));
 
   mModelMap[aID].emplace_back(mesh);
 }
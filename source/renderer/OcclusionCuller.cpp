@@ -0,0 +1,360 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "JobSystem.hpp"
+#include "Simd.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+OcclusionCuller::OcclusionCuller(int aWidth, int aHeight)
+{
+  Resize(aWidth, aHeight);
+}
+
+/******************************************************************************/
+void OcclusionCuller::Resize(int aWidth, int aHeight)
+{
+  mTilesX = std::max(1, (aWidth + TILE_SIZE - 1) / TILE_SIZE);
+  mTilesY = std::max(1, (aHeight + TILE_SIZE - 1) / TILE_SIZE);
+  mWidth = mTilesX * TILE_SIZE;
+  mHeight = mTilesY * TILE_SIZE;
+
+  // Each level of the hierarchy is half the size of the last, down to a
+  // single texel.
+  mLevels.clear();
+  auto width = mWidth;
+  auto height = mHeight;
+  while(true)
+  {
+    DepthLevel level;
+    level.mWidth = width;
+    level.mHeight = height;
+    level.mDepths.resize(width * height, 1.0f);
+    mLevels.emplace_back(std::move(level));
+
+    if(width == 1 && height == 1)
+    {
+      break;
+    }
+
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+  }
+
+  mTileTriangles.clear();
+  mTileTriangles.resize(mTilesX * mTilesY);
+  mTriangles.clear();
+}
+
+/******************************************************************************/
+void OcclusionCuller::Begin(const Mat4& aViewProjection)
+{
+  mViewProjection = aViewProjection;
+  mTriangles.clear();
+  for(auto& tile : mTileTriangles)
+  {
+    tile.clear();
+  }
+
+  std::fill(mLevels[0].mDepths.begin(), mLevels[0].mDepths.end(), 1.0f);
+}
+
+/******************************************************************************/
+void OcclusionCuller::AddOccluder(const std::vector<MeshVertex>& aVertices,
+                                  const std::vector<unsigned int>& aIndices,
+                                  const Mat4& aModelMatrix)
+{
+  auto matrix = mViewProjection * aModelMatrix;
+
+  float triangle[3][4];
+  for(std::size_t i = 0; i + 2 < aIndices.size(); i += 3)
+  {
+    for(int v = 0; v < 3; ++v)
+    {
+      const auto& position = aVertices[aIndices[i + v]].mPosition;
+      for(int row = 0; row < 4; ++row)
+      {
+        triangle[v][row] = matrix(0, row) * position.x +
+                           matrix(1, row) * position.y +
+                           matrix(2, row) * position.z +
+                           matrix(3, row);
+      }
+    }
+
+    AddTriangle(triangle);
+  }
+}
+
+/******************************************************************************/
+void OcclusionCuller::AddTriangle(const float aVertices[3][4])
+{
+  // Rather than clipping triangles against the near plane, skip them;
+  // leaving out part of an occluder can only make more boxes visible.
+  float x[3], y[3], z[3];
+  for(int v = 0; v < 3; ++v)
+  {
+    auto w = aVertices[v][3];
+    if(w <= 0.0f || aVertices[v][2] < -w)
+    {
+      return;
+    }
+
+    x[v] = (aVertices[v][0] / w * 0.5f + 0.5f) * mWidth;
+    y[v] = (aVertices[v][1] / w * 0.5f + 0.5f) * mHeight;
+    z[v] = aVertices[v][2] / w;
+  }
+
+  // Both sides of each triangle occlude, so wind them all the same way.
+  auto area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+  if(area < 0.0f)
+  {
+    std::swap(x[1], x[2]);
+    std::swap(y[1], y[2]);
+    std::swap(z[1], z[2]);
+    area = -area;
+  }
+
+  if(area < 1e-6f)
+  {
+    return;
+  }
+
+  // Skip triangles that are entirely off screen, then clamp the rest to the
+  // screen while the coordinates are still floats, since vertices close to
+  // the camera plane can land far outside the range of an int.
+  auto minX = std::min({ x[0], x[1], x[2] });
+  auto minY = std::min({ y[0], y[1], y[2] });
+  auto maxX = std::max({ x[0], x[1], x[2] });
+  auto maxY = std::max({ y[0], y[1], y[2] });
+  if(!(maxX >= 0.0f && maxY >= 0.0f && minX < mWidth && minY < mHeight))
+  {
+    return;
+  }
+
+  auto clampX = [this](float aX)
+  {
+    return static_cast<int>(std::floor(std::clamp(aX, 0.0f, static_cast<float>(mWidth - 1))));
+  };
+  auto clampY = [this](float aY)
+  {
+    return static_cast<int>(std::floor(std::clamp(aY, 0.0f, static_cast<float>(mHeight - 1))));
+  };
+
+  Triangle triangle;
+  triangle.mMinX = clampX(minX);
+  triangle.mMinY = clampY(minY);
+  triangle.mMaxX = clampX(maxX);
+  triangle.mMaxY = clampY(maxY);
+
+  // The edge opposite each vertex is zero along the edge and equal to the
+  // triangle's area at the vertex, so dividing by the area gives the
+  // vertex's barycentric weight.
+  for(int e = 0; e < 3; ++e)
+  {
+    auto start = (e + 1) % 3;
+    auto end = (e + 2) % 3;
+    triangle.mEdgeA[e] = y[start] - y[end];
+    triangle.mEdgeB[e] = x[end] - x[start];
+    triangle.mEdgeC[e] = x[start] * y[end] - y[start] * x[end];
+
+    triangle.mDepthA += triangle.mEdgeA[e] * z[e] / area;
+    triangle.mDepthB += triangle.mEdgeB[e] * z[e] / area;
+    triangle.mDepthC += triangle.mEdgeC[e] * z[e] / area;
+  }
+
+  auto index = mTriangles.size();
+  mTriangles.emplace_back(triangle);
+
+  for(auto tileY = triangle.mMinY / TILE_SIZE; tileY <= triangle.mMaxY / TILE_SIZE; ++tileY)
+  {
+    for(auto tileX = triangle.mMinX / TILE_SIZE; tileX <= triangle.mMaxX / TILE_SIZE; ++tileX)
+    {
+      mTileTriangles[tileY * mTilesX + tileX].emplace_back(index);
+    }
+  }
+}
+
+/******************************************************************************/
+void OcclusionCuller::Rasterize()
+{
+  // Tiles don't share any pixels, so each can be drawn independently.
+  JobSystem::ParallelFor(mTileTriangles.size(), 1, [this](std::size_t aStart, std::size_t aEnd)
+  {
+    for(auto tile = aStart; tile < aEnd; ++tile)
+    {
+      this->RasterizeTile(tile);
+    }
+  });
+
+  BuildHierarchy();
+}
+
+/******************************************************************************/
+void OcclusionCuller::RasterizeTile(std::size_t aTile)
+{
+  auto tileMinX = static_cast<int>(aTile % mTilesX) * TILE_SIZE;
+  auto tileMinY = static_cast<int>(aTile / mTilesX) * TILE_SIZE;
+  auto tileMaxX = tileMinX + TILE_SIZE - 1;
+  auto tileMaxY = tileMinY + TILE_SIZE - 1;
+
+  const float offsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+  auto pixelOffsets = LoadFloat4(offsets);
+  auto zero = SplatFloat4(0.0f);
+
+  auto& depths = mLevels[0].mDepths;
+  for(const auto& index : mTileTriangles[aTile])
+  {
+    const auto& triangle = mTriangles[index];
+
+    // Pixels are drawn in groups of four, starting from a multiple of four
+    // so that each group stays within the tile.
+    auto minX = std::max(triangle.mMinX, tileMinX) & ~3;
+    auto maxX = std::min(triangle.mMaxX, tileMaxX);
+    auto minY = std::max(triangle.mMinY, tileMinY);
+    auto maxY = std::min(triangle.mMaxY, tileMaxY);
+
+    Float4 edgeA[3];
+    for(int e = 0; e < 3; ++e)
+    {
+      edgeA[e] = SplatFloat4(triangle.mEdgeA[e]);
+    }
+    auto depthA = SplatFloat4(triangle.mDepthA);
+
+    for(auto y = minY; y <= maxY; ++y)
+    {
+      // Everything but the x-coordinate is constant along the row.
+      auto centerY = y + 0.5f;
+      Float4 edgeRow[3];
+      for(int e = 0; e < 3; ++e)
+      {
+        edgeRow[e] = SplatFloat4(triangle.mEdgeB[e] * centerY + triangle.mEdgeC[e]);
+      }
+      auto depthRow = SplatFloat4(triangle.mDepthB * centerY + triangle.mDepthC);
+
+      auto* row = &depths[y * mWidth];
+      for(auto x = minX; x <= maxX; x += 4)
+      {
+        auto centerX = SplatFloat4(static_cast<float>(x)) + pixelOffsets;
+
+        auto outside = Less(edgeA[0] * centerX + edgeRow[0], zero) |
+                       Less(edgeA[1] * centerX + edgeRow[1], zero) |
+                       Less(edgeA[2] * centerX + edgeRow[2], zero);
+
+        auto depth = depthA * centerX + depthRow;
+        auto current = LoadFloat4(row + x);
+        StoreFloat4(row + x, Select(outside, current, Min(current, depth)));
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+void OcclusionCuller::BuildHierarchy()
+{
+  for(std::size_t i = 1; i < mLevels.size(); ++i)
+  {
+    const auto& source = mLevels[i - 1];
+    auto& destination = mLevels[i];
+
+    for(auto y = 0; y < destination.mHeight; ++y)
+    {
+      auto sourceY0 = y * 2;
+      auto sourceY1 = std::min(sourceY0 + 1, source.mHeight - 1);
+      for(auto x = 0; x < destination.mWidth; ++x)
+      {
+        auto sourceX0 = x * 2;
+        auto sourceX1 = std::min(sourceX0 + 1, source.mWidth - 1);
+        destination.mDepths[y * destination.mWidth + x] =
+          std::max({ source.mDepths[sourceY0 * source.mWidth + sourceX0],
+                     source.mDepths[sourceY0 * source.mWidth + sourceX1],
+                     source.mDepths[sourceY1 * source.mWidth + sourceX0],
+                     source.mDepths[sourceY1 * source.mWidth + sourceX1] });
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+bool OcclusionCuller::IsVisible(const AABB& aBox) const
+{
+  if(mTriangles.empty() || IsEmpty(aBox))
+  {
+    return true;
+  }
+
+  // Find the screen-space rectangle covered by the box's corners, and the
+  // depth of the nearest corner.
+  auto minX = std::numeric_limits<float>::max();
+  auto minY = std::numeric_limits<float>::max();
+  auto maxX = std::numeric_limits<float>::lowest();
+  auto maxY = std::numeric_limits<float>::lowest();
+  auto minDepth = std::numeric_limits<float>::max();
+  for(int corner = 0; corner < 8; ++corner)
+  {
+    Vec3 position((corner & 1) ? aBox.mMax.x : aBox.mMin.x,
+                  (corner & 2) ? aBox.mMax.y : aBox.mMin.y,
+                  (corner & 4) ? aBox.mMax.z : aBox.mMin.z);
+
+    float clip[4];
+    for(int row = 0; row < 4; ++row)
+    {
+      clip[row] = mViewProjection(0, row) * position.x +
+                  mViewProjection(1, row) * position.y +
+                  mViewProjection(2, row) * position.z +
+                  mViewProjection(3, row);
+    }
+
+    if(clip[3] <= 0.0f || clip[2] < -clip[3])
+    {
+      return true;
+    }
+
+    auto x = (clip[0] / clip[3] * 0.5f + 0.5f) * mWidth;
+    auto y = (clip[1] / clip[3] * 0.5f + 0.5f) * mHeight;
+    minX = std::min(minX, x);
+    minY = std::min(minY, y);
+    maxX = std::max(maxX, x);
+    maxY = std::max(maxY, y);
+    minDepth = std::min(minDepth, clip[2] / clip[3]);
+  }
+
+  if(minX < 0.0f || minY < 0.0f || maxX >= mWidth || maxY >= mHeight)
+  {
+    return true;
+  }
+
+  // Widen the rectangle by a pixel, since occluders only cover the pixels
+  // whose centers they overlap.
+  auto pixelMinX = std::max(0, static_cast<int>(minX) - 1);
+  auto pixelMinY = std::max(0, static_cast<int>(minY) - 1);
+  auto pixelMaxX = std::min(mWidth - 1, static_cast<int>(maxX) + 1);
+  auto pixelMaxY = std::min(mHeight - 1, static_cast<int>(maxY) + 1);
+
+  // Choose the level where the rectangle covers only a few texels.
+  std::size_t level = 0;
+  auto size = std::max(pixelMaxX - pixelMinX, pixelMaxY - pixelMinY) + 1;
+  while(level + 1 < mLevels.size() && (size >> level) > 4)
+  {
+    ++level;
+  }
+
+  const auto& depthLevel = mLevels[level];
+  for(auto y = pixelMinY >> level; y <= (pixelMaxY >> level); ++y)
+  {
+    for(auto x = pixelMinX >> level; x <= (pixelMaxX >> level); ++x)
+    {
+      if(minDepth <= depthLevel.mDepths[y * depthLevel.mWidth + x])
+      {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+} // namespace Kuma3D
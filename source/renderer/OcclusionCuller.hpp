@@ -0,0 +1,172 @@
+#ifndef OCCLUSIONCULLER_HPP
+#define OCCLUSIONCULLER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Geometry.hpp"
+#include "Mat4.hpp"
+
+#include "Mesh.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Tests whether bounding boxes are hidden behind occluding geometry, using
+ * a low-resolution depth buffer rasterized on the CPU.
+ *
+ * Each frame, call Begin() with the camera's matrices, add each occluder
+ * with AddOccluder(), then call Rasterize(). The depth buffer is divided
+ * into tiles, which are rasterized in parallel by the JobSystem four pixels
+ * at a time. Afterwards, IsVisible() tests a box's screen-space bounds
+ * against a hierarchy of downsampled depth buffers, where each texel holds
+ * the farthest depth of the texels it covers.
+ *
+ * Occluders are only drawn where they cover the center of a pixel, and
+ * triangles crossing the near plane are skipped, so an occluder can only
+ * hide boxes that are behind it.
+ */
+class OcclusionCuller
+{
+  public:
+
+    /**
+     * Creates a culler with a depth buffer of the given size.
+     *
+     * @param aWidth The width of the depth buffer.
+     * @param aHeight The height of the depth buffer.
+     */
+    OcclusionCuller(int aWidth = DEFAULT_WIDTH, int aHeight = DEFAULT_HEIGHT);
+
+    /**
+     * Changes the size of the depth buffer. Each dimension is rounded up to
+     * a multiple of the tile size.
+     *
+     * @param aWidth The width of the depth buffer.
+     * @param aHeight The height of the depth buffer.
+     */
+    void Resize(int aWidth, int aHeight);
+
+    /**
+     * Removes every occluder and clears the depth buffer.
+     *
+     * @param aViewProjection The projection matrix multiplied by the view
+     *                        matrix of the camera to cull for.
+     */
+    void Begin(const Mat4& aViewProjection);
+
+    /**
+     * Adds the triangles of an occluding mesh.
+     *
+     * @param aVertices The vertices of the mesh.
+     * @param aIndices The indices of the mesh's triangles.
+     * @param aModelMatrix The mesh's world matrix.
+     */
+    void AddOccluder(const std::vector<MeshVertex>& aVertices,
+                     const std::vector<unsigned int>& aIndices,
+                     const Mat4& aModelMatrix);
+
+    /**
+     * Draws each occluder into the depth buffer and builds the depth
+     * hierarchy. Call this after adding every occluder and before calling
+     * IsVisible().
+     */
+    void Rasterize();
+
+    /**
+     * Returns whether any part of a box might be in front of the occluders.
+     * Boxes crossing the near plane or the edges of the screen are always
+     * visible.
+     *
+     * @param aBox The world-space box to test.
+     * @return False if the box is entirely hidden, true otherwise.
+     */
+    bool IsVisible(const AABB& aBox) const;
+
+    /**
+     * Returns the number of triangles added since Begin() that are drawn
+     * into the depth buffer.
+     *
+     * @return The number of occluding triangles.
+     */
+    std::size_t GetNumTriangles() const { return mTriangles.size(); }
+
+    int GetWidth() const { return mWidth; }
+    int GetHeight() const { return mHeight; }
+
+  private:
+
+    /**
+     * A screen-space triangle, ready to be rasterized. Each edge function
+     * is positive inside the triangle, and depth is a linear function of
+     * the pixel position.
+     */
+    struct Triangle
+    {
+      float mEdgeA[3];
+      float mEdgeB[3];
+      float mEdgeC[3];
+
+      float mDepthA { 0.0 };
+      float mDepthB { 0.0 };
+      float mDepthC { 0.0 };
+
+      int mMinX { 0 };
+      int mMinY { 0 };
+      int mMaxX { 0 };
+      int mMaxY { 0 };
+    };
+
+    /**
+     * One level of the depth hierarchy.
+     */
+    struct DepthLevel
+    {
+      int mWidth { 0 };
+      int mHeight { 0 };
+      std::vector<float> mDepths;
+    };
+
+    /**
+     * Sets up a triangle from three clip-space vertices and adds it to each
+     * tile it overlaps.
+     *
+     * @param aVertices The clip-space vertices (x, y, z, w) of the triangle.
+     */
+    void AddTriangle(const float aVertices[3][4]);
+
+    /**
+     * Rasterizes each triangle overlapping a tile into the depth buffer.
+     *
+     * @param aTile The index of the tile.
+     */
+    void RasterizeTile(std::size_t aTile);
+
+    /**
+     * Fills each level of the depth hierarchy after the first.
+     */
+    void BuildHierarchy();
+
+    int mWidth { 0 };
+    int mHeight { 0 };
+    int mTilesX { 0 };
+    int mTilesY { 0 };
+
+    Mat4 mViewProjection;
+
+    // The triangles added since Begin(), and the triangles overlapping
+    // each tile.
+    std::vector<Triangle> mTriangles;
+    std::vector<std::vector<std::size_t>> mTileTriangles;
+
+    // The depth buffer, followed by each level of the hierarchy.
+    std::vector<DepthLevel> mLevels;
+
+    static const int DEFAULT_WIDTH = 256;
+    static const int DEFAULT_HEIGHT = 128;
+    static const int TILE_SIZE = 32;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,305 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+
+#include "RadixSort.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+// The number of bits each field takes up in a sort key. Indices that don't
+// fit are clamped, which only affects the order packets are drawn in.
+const unsigned int SHADER_BITS = 10;
+const unsigned int TEXTURE_BITS = 12;
+const unsigned int VERTEX_ARRAY_BITS = 3;
+const unsigned int RENDER_MODE_BITS = 3;
+const unsigned int GEOMETRY_BITS = 13;
+const unsigned int DEPTH_BITS = 20;
+
+// Marks an Entity without a packet in RenderQueue::mPacketLookup.
+const std::uint32_t NO_PACKET = 0xffffffff;
+
+// A previous order is only reused if no more than one in this many packets
+// is out of place, and each packet moves no more than this many places on
+// average; past that, it's cheaper to sort the packets from scratch.
+const std::size_t MAX_OUT_OF_ORDER_RATIO = 8;
+const std::size_t MAX_MOVES_PER_PACKET = 4;
+
+// The most sorts to skip reusing a previous order for after failing to.
+const unsigned int MAX_BACKOFF = 32;
+
+/******************************************************************************/
+void AppendBits(std::uint64_t& aKey, std::uint64_t aValue, unsigned int aBits)
+{
+  auto maxValue = (std::uint64_t(1) << aBits) - 1;
+  aKey = (aKey << aBits) | std::min(aValue, maxValue);
+}
+
+/******************************************************************************/
+void RenderQueue::Clear()
+{
+  mPackets.clear();
+  mEntities.clear();
+  mKeys.clear();
+
+  mShaderSetMap.clear();
+  mTextureSetMap.clear();
+  mGeometryMap.clear();
+  mVertexArrayMap.clear();
+
+  mShaderSets.clear();
+  mTextureSets.clear();
+}
+
+/******************************************************************************/
+unsigned int RenderQueue::InternShaders(const std::vector<ID>& aShaders)
+{
+  auto foundSet = mShaderSetMap.find(aShaders);
+  if(foundSet == mShaderSetMap.end())
+  {
+    foundSet = mShaderSetMap.emplace(aShaders, mShaderSets.size()).first;
+    mShaderSets.emplace_back(aShaders);
+  }
+
+  return foundSet->second;
+}
+
+/******************************************************************************/
+unsigned int RenderQueue::InternTextures(const std::vector<ID>& aTextures)
+{
+  auto foundSet = mTextureSetMap.find(aTextures);
+  if(foundSet == mTextureSetMap.end())
+  {
+    foundSet = mTextureSetMap.emplace(aTextures, mTextureSets.size()).first;
+    mTextureSets.emplace_back(aTextures);
+  }
+
+  return foundSet->second;
+}
+
+/******************************************************************************/
+unsigned int RenderQueue::InternGeometry(ID aGeometryID)
+{
+  auto foundGeometry = mGeometryMap.find(aGeometryID);
+  if(foundGeometry == mGeometryMap.end())
+  {
+    foundGeometry = mGeometryMap.emplace(aGeometryID, mGeometryMap.size() + 1).first;
+  }
+
+  return foundGeometry->second;
+}
+
+/******************************************************************************/
+void RenderQueue::Add(const DrawPacket& aPacket)
+{
+  auto vertexArray = InternVertexArray(aPacket.mRange.mVertexArray);
+  mKeys.emplace_back(CalculateKey(aPacket, vertexArray), mPackets.size());
+  mPackets.emplace_back(aPacket);
+  mEntities.emplace_back(aPacket.mEntity);
+}
+
+/******************************************************************************/
+void RenderQueue::Sort()
+{
+  RadixSort(mKeys, mScratchKeys, [](const std::pair<std::uint64_t, std::uint32_t>& aKey)
+  {
+    return aKey.first;
+  });
+}
+
+/******************************************************************************/
+bool RenderQueue::Sort(DrawOrder& aDrawOrder)
+{
+  auto reused = false;
+  auto& previousOrder = aDrawOrder.mEntities;
+  if(aDrawOrder.mSkips > 0)
+  {
+    --aDrawOrder.mSkips;
+  }
+  else if(!previousOrder.empty())
+  {
+    // Find each Entity's packet. Until sorted, each key is at the same
+    // position as its packet.
+    for(std::size_t i = 0; i < mEntities.size(); ++i)
+    {
+      auto entity = mEntities[i];
+      if(entity >= mPacketLookup.size())
+      {
+        mPacketLookup.resize(entity + 1, NO_PACKET);
+      }
+      mPacketLookup[entity] = static_cast<std::uint32_t>(i);
+    }
+
+    // Arrange the keys in the previous order, followed by the packets that
+    // weren't drawn last time, forgetting each Entity's packet once it's
+    // placed. Only reuse the order if few packets are out of place;
+    // otherwise, fixing it would take longer than sorting from scratch.
+    mScratchKeys.resize(mKeys.size());
+    auto numArranged = std::size_t(0);
+    auto numOutOfOrder = std::size_t(0);
+    auto maxOutOfOrder = mKeys.size() / MAX_OUT_OF_ORDER_RATIO;
+    auto arrange = [this, &numArranged, &numOutOfOrder](std::uint32_t& aPacket)
+    {
+      mScratchKeys[numArranged] = mKeys[aPacket];
+      aPacket = NO_PACKET;
+      if(numArranged > 0 && mScratchKeys[numArranged] < mScratchKeys[numArranged - 1])
+      {
+        ++numOutOfOrder;
+      }
+      ++numArranged;
+    };
+
+    for(std::size_t i = 0; i < previousOrder.size() && numOutOfOrder <= maxOutOfOrder; ++i)
+    {
+      auto entity = previousOrder[i];
+      if(entity < mPacketLookup.size() && mPacketLookup[entity] != NO_PACKET)
+      {
+        arrange(mPacketLookup[entity]);
+      }
+    }
+
+    for(const auto& entity : mEntities)
+    {
+      if(mPacketLookup[entity] != NO_PACKET)
+      {
+        if(numOutOfOrder <= maxOutOfOrder)
+        {
+          arrange(mPacketLookup[entity]);
+        }
+        mPacketLookup[entity] = NO_PACKET;
+      }
+    }
+
+    // If an Entity has more than one packet, only one is placed, and the
+    // packets are sorted from scratch instead.
+    reused = (numOutOfOrder <= maxOutOfOrder && numArranged == mKeys.size());
+
+    // Fix the order with an insertion sort, giving up if it takes too many
+    // moves. Ties are broken by position in mPackets, to match the stable
+    // radix sort.
+    auto moves = std::size_t(0);
+    auto maxMoves = mScratchKeys.size() * MAX_MOVES_PER_PACKET;
+    for(std::size_t i = 1; i < mScratchKeys.size() && reused; ++i)
+    {
+      auto key = mScratchKeys[i];
+      auto j = i;
+      while(j > 0 && key < mScratchKeys[j - 1])
+      {
+        mScratchKeys[j] = mScratchKeys[j - 1];
+        --j;
+
+        if(++moves > maxMoves)
+        {
+          reused = false;
+          break;
+        }
+      }
+      mScratchKeys[j] = key;
+    }
+
+    if(reused)
+    {
+      mKeys.swap(mScratchKeys);
+      aDrawOrder.mBackoff = 1;
+    }
+    else
+    {
+      aDrawOrder.mSkips = aDrawOrder.mBackoff;
+      aDrawOrder.mBackoff = std::min(aDrawOrder.mBackoff * 2, MAX_BACKOFF);
+    }
+  }
+
+  // The keys are still in the order the packets were added if the previous
+  // order couldn't be used.
+  if(!reused)
+  {
+    Sort();
+  }
+
+  previousOrder.resize(mKeys.size());
+  for(std::size_t i = 0; i < mKeys.size(); ++i)
+  {
+    previousOrder[i] = mEntities[mKeys[i].second];
+  }
+
+  return reused;
+}
+
+/******************************************************************************/
+const DrawPacket& RenderQueue::GetPacket(std::size_t aIndex) const
+{
+  return mPackets[mKeys[aIndex].second];
+}
+
+/******************************************************************************/
+const std::vector<ID>& RenderQueue::GetShaders(unsigned int aShaderSet) const
+{
+  return mShaderSets.at(aShaderSet);
+}
+
+/******************************************************************************/
+const std::vector<ID>& RenderQueue::GetTextures(unsigned int aTextureSet) const
+{
+  return mTextureSets.at(aTextureSet);
+}
+
+/******************************************************************************/
+bool RenderQueue::CanInstance(const DrawPacket& aPacketA, const DrawPacket& aPacketB)
+{
+  return aPacketA.mGeometry != 0 &&
+         aPacketA.mGeometry == aPacketB.mGeometry &&
+         aPacketA.mShaderSet == aPacketB.mShaderSet &&
+         aPacketA.mTextureSet == aPacketB.mTextureSet &&
+         aPacketA.mRange.mVertexArray == aPacketB.mRange.mVertexArray &&
+         aPacketA.mRenderMode == aPacketB.mRenderMode &&
+         aPacketA.mSystem == aPacketB.mSystem &&
+         aPacketA.mUseDepthTesting == aPacketB.mUseDepthTesting &&
+         aPacketA.mHasTransparency == aPacketB.mHasTransparency;
+}
+
+/******************************************************************************/
+std::uint64_t RenderQueue::CalculateKey(const DrawPacket& aPacket,
+                                        unsigned int aVertexArray)
+{
+  auto maxDepth = (std::uint64_t(1) << DEPTH_BITS) - 1;
+  auto depth = static_cast<std::uint64_t>(std::clamp(aPacket.mDepth, 0.0f, 1.0f) * maxDepth);
+
+  std::uint64_t key = aPacket.mHasTransparency;
+
+  // Transparent packets must be drawn back-to-front, so the depth (reversed)
+  // takes priority over everything else.
+  if(aPacket.mHasTransparency)
+  {
+    AppendBits(key, maxDepth - depth, DEPTH_BITS);
+  }
+
+  AppendBits(key, aPacket.mUseDepthTesting, 1);
+  AppendBits(key, static_cast<std::uint64_t>(aPacket.mSystem), 1);
+  AppendBits(key, aPacket.mShaderSet, SHADER_BITS);
+  AppendBits(key, aPacket.mTextureSet, TEXTURE_BITS);
+  AppendBits(key, aVertexArray, VERTEX_ARRAY_BITS);
+  AppendBits(key, static_cast<std::uint64_t>(aPacket.mRenderMode), RENDER_MODE_BITS);
+  AppendBits(key, aPacket.mGeometry, GEOMETRY_BITS);
+
+  // Opaque packets are drawn front-to-back within each group of state.
+  if(!aPacket.mHasTransparency)
+  {
+    AppendBits(key, depth, DEPTH_BITS);
+  }
+
+  return key;
+}
+
+/******************************************************************************/
+unsigned int RenderQueue::InternVertexArray(unsigned int aVertexArray)
+{
+  auto foundVertexArray = mVertexArrayMap.find(aVertexArray);
+  if(foundVertexArray == mVertexArrayMap.end())
+  {
+    foundVertexArray = mVertexArrayMap.emplace(aVertexArray, mVertexArrayMap.size()).first;
+  }
+
+  return foundVertexArray->second;
+}
+
+} // namespace Kuma3D
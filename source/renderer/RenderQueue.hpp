@@ -0,0 +1,243 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Entity.hpp"
+#include "IDGenerator.hpp"
+
+#include "Mat4.hpp"
+
+#include "Mesh.hpp"
+#include "MeshLoader.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Everything needed to draw one Mesh from the perspective of one Camera.
+ *
+ * Shaders, textures and geometry are referred to by small indices given out
+ * by the RenderQueue (see RenderQueue::InternShaders() and friends), so that
+ * packets can be compared and packed into a sort key cheaply.
+ */
+struct DrawPacket
+{
+  Entity mEntity { 0 };
+  MeshRange mRange;
+  Mat4 mModelMatrix;
+
+  unsigned int mShaderSet { 0 };
+  unsigned int mTextureSet { 0 };
+
+  // Identifies the geometry for instancing; 0 if this packet can't be
+  // drawn with an instanced draw call.
+  unsigned int mGeometry { 0 };
+
+  // The distance from the camera, from 0 (the near plane) to 1 (the far
+  // plane).
+  float mDepth { 0.0 };
+
+  RenderMode mRenderMode { RenderMode::eTRIANGLES };
+  CoordinateSystem mSystem { CoordinateSystem::eWORLD_SPACE };
+  bool mUseDepthTesting { true };
+  bool mHasTransparency { false };
+};
+
+/**
+ * The order a RenderQueue's packets were drawn in, kept between frames so
+ * that the next sort can start from it.
+ */
+struct DrawOrder
+{
+  // The Entity of each packet, in drawing order.
+  std::vector<Entity> mEntities;
+
+  // After the order fails to be reused, this many sorts start from scratch
+  // instead of trying again. The number doubles with each failure in a
+  // row, so that scenes whose order changes every frame don't pay for a
+  // failed attempt each frame.
+  unsigned int mSkips { 0 };
+  unsigned int mBackoff { 1 };
+};
+
+/**
+ * Collects the DrawPackets for a frame and sorts them into the order they
+ * should be drawn in.
+ *
+ * Each packet gets a 64-bit key, and the packets are radix sorted by key.
+ * Opaque packets come first, grouped by depth testing, coordinate system,
+ * shaders, textures, vertex array, render mode and geometry (roughly in
+ * order of how expensive each is to change), and drawn front-to-back within
+ * each group to make the most of early depth testing. Transparent packets
+ * come last, drawn back-to-front, with ties broken by the same state.
+ *
+ * Since the order rarely changes much from one frame to the next, the
+ * packets can instead be sorted starting from a previous frame's order,
+ * which only takes a single pass when nothing has moved.
+ */
+class RenderQueue
+{
+  public:
+
+    /**
+     * Removes every packet, and forgets every shader, texture and geometry
+     * index given out.
+     */
+    void Clear();
+
+    /**
+     * Returns an index for the given list of shaders; the same list always
+     * gets the same index until the queue is cleared.
+     *
+     * @param aShaders The shaders to retrieve an index for.
+     * @return The index of the shaders.
+     */
+    unsigned int InternShaders(const std::vector<ID>& aShaders);
+
+    /**
+     * Returns an index for the given list of textures; the same list always
+     * gets the same index until the queue is cleared.
+     *
+     * @param aTextures The textures to retrieve an index for.
+     * @return The index of the textures.
+     */
+    unsigned int InternTextures(const std::vector<ID>& aTextures);
+
+    /**
+     * Returns an index for the stored geometry with the given ID; the same
+     * geometry always gets the same index until the queue is cleared. The
+     * index is never 0.
+     *
+     * @param aGeometryID The ID of the geometry in the MeshLoader.
+     * @return The index of the geometry.
+     */
+    unsigned int InternGeometry(ID aGeometryID);
+
+    /**
+     * Adds a packet to the queue.
+     *
+     * @param aPacket The packet to add.
+     */
+    void Add(const DrawPacket& aPacket);
+
+    /**
+     * Sorts the packets into the order they should be drawn in.
+     */
+    void Sort();
+
+    /**
+     * Sorts the packets into the order they should be drawn in, starting
+     * from the order they were drawn in last time (for example, by the same
+     * Camera last frame). The previous order is fixed with an insertion
+     * sort, unless too many packets have moved, in which case the packets
+     * are sorted from scratch. Either way, the result is the same as
+     * Sort().
+     *
+     * Each packet is identified by its Entity, so each Entity should only
+     * have one packet in the queue.
+     *
+     * @param aDrawOrder The order the packets were drawn in last time;
+     *                   replaced with the new order.
+     * @return True if the previous order was reused, false if the packets
+     *         were sorted from scratch.
+     */
+    bool Sort(DrawOrder& aDrawOrder);
+
+    /**
+     * Returns the number of packets in the queue.
+     *
+     * @return The number of packets.
+     */
+    std::size_t GetNumPackets() const { return mPackets.size(); }
+
+    /**
+     * Returns the packet at the given position in the queue. After Sort()
+     * has been called, the packets are in drawing order.
+     *
+     * @param aIndex The position of the packet.
+     * @return The packet at the given position.
+     */
+    const DrawPacket& GetPacket(std::size_t aIndex) const;
+
+    /**
+     * Returns the sort key for the packet at the given position.
+     *
+     * @param aIndex The position of the packet.
+     * @return The packet's sort key.
+     */
+    std::uint64_t GetKey(std::size_t aIndex) const { return mKeys[aIndex].first; }
+
+    /**
+     * Returns the shaders for an index given out by InternShaders().
+     *
+     * @param aShaderSet The index of the shaders.
+     * @return The shaders.
+     */
+    const std::vector<ID>& GetShaders(unsigned int aShaderSet) const;
+
+    /**
+     * Returns the textures for an index given out by InternTextures().
+     *
+     * @param aTextureSet The index of the textures.
+     * @return The textures.
+     */
+    const std::vector<ID>& GetTextures(unsigned int aTextureSet) const;
+
+    /**
+     * Returns whether two packets can be drawn with a single instanced
+     * draw call.
+     *
+     * @param aPacketA The first packet.
+     * @param aPacketB The second packet.
+     * @return True if the packets can be drawn together, false otherwise.
+     */
+    static bool CanInstance(const DrawPacket& aPacketA, const DrawPacket& aPacketB);
+
+    /**
+     * Calculates the sort key for a packet.
+     *
+     * @param aPacket The packet to calculate a key for.
+     * @param aVertexArray The index of the packet's vertex array.
+     * @return The packet's sort key.
+     */
+    static std::uint64_t CalculateKey(const DrawPacket& aPacket,
+                                      unsigned int aVertexArray);
+
+  private:
+
+    /**
+     * Returns an index for the given vertex array.
+     *
+     * @param aVertexArray The OpenGL vertex array.
+     * @return The index of the vertex array.
+     */
+    unsigned int InternVertexArray(unsigned int aVertexArray);
+
+    std::vector<DrawPacket> mPackets;
+
+    // Each packet's key and position in mPackets, in drawing order once
+    // sorted.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> mKeys;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> mScratchKeys;
+
+    // The Entity of each packet, kept separately so that sorting from a
+    // previous order doesn't need to touch the packets themselves. While
+    // sorting, mPacketLookup maps each Entity to its position in mPackets.
+    std::vector<Entity> mEntities;
+    std::vector<std::uint32_t> mPacketLookup;
+
+    std::map<std::vector<ID>, unsigned int> mShaderSetMap;
+    std::map<std::vector<ID>, unsigned int> mTextureSetMap;
+    std::map<ID, unsigned int> mGeometryMap;
+    std::map<unsigned int, unsigned int> mVertexArrayMap;
+
+    std::vector<std::vector<ID>> mShaderSets;
+    std::vector<std::vector<ID>> mTextureSets;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -1,17 +1,24 @@
 #include "RenderSystem.hpp"
 
 #include <algorithm>
+#include <string>
 
 #include <GL/glew.h>
 
+#include "Game.hpp"
 #include "Scene.hpp"
 
+#include "Geometry.hpp"
 #include "Mat4.hpp"
 #include "MathUtil.hpp"
+#include "TransformStreams.hpp"
 #include "Vec3.hpp"
 
 #include "GameSignals.hpp"
 
+#include "GLState.hpp"
+#include "MeshLoader.hpp"
+#include "RenderQueue.hpp"
 #include "ShaderLoader.hpp"
 
 #include "Camera.hpp"
@@ -19,6 +26,32 @@
 
 namespace Kuma3D {
 
+/******************************************************************************/
+bool IsMeshGeometryEqual(const MeshHandle& aHandle,
+                         const std::vector<MeshVertex>& aVertices,
+                         const std::vector<unsigned int>& aIndices)
+{
+  const auto& vertices = MeshLoader::GetVertices(aHandle);
+  if(vertices.size() != aVertices.size() || MeshLoader::GetIndices(aHandle) != aIndices)
+  {
+    return false;
+  }
+
+  auto isVertexEqual = [](const MeshVertex& aFirst, const MeshVertex& aSecond)
+  {
+    return aFirst.mPosition.x == aSecond.mPosition.x &&
+           aFirst.mPosition.y == aSecond.mPosition.y &&
+           aFirst.mPosition.z == aSecond.mPosition.z &&
+           aFirst.mColor.x == aSecond.mColor.x &&
+           aFirst.mColor.y == aSecond.mColor.y &&
+           aFirst.mColor.z == aSecond.mColor.z &&
+           aFirst.mTexCoords[0] == aSecond.mTexCoords[0] &&
+           aFirst.mTexCoords[1] == aSecond.mTexCoords[1];
+  };
+
+  return std::equal(vertices.begin(), vertices.end(), aVertices.begin(), isVertexEqual);
+}
+
 /******************************************************************************/
 void RenderSystem::Initialize(Scene& aScene)
 {
@@ -59,110 +92,165 @@ void RenderSystem::Initialize(Scene& aScene)
     this->mFramebufferHeight = aHeight;
   });
 
+  // In headless mode there is no OpenGL context, so this System does
+  // nothing but keep track of its Entities.
+  mHeadless = Game::IsHeadless();
+  if(mHeadless)
+  {
+    return;
+  }
+
   // Enable OpenGL blending.
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  GLState::SetEnabled(GL_BLEND, true);
+  GLState::SetBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Create the buffer that per-instance model matrices are copied into.
+  glGenBuffers(1, &mInstanceBuffer);
 }
 
 /******************************************************************************/
 void RenderSystem::Operate(Scene& aScene, double aTime)
 {
+  if(mHeadless)
+  {
+    // Nothing can be drawn, but clear the dirty flags so that Meshes
+    // behave the same as they would with a window.
+    for(const auto& entity : GetEntities())
+    {
+      auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
+      if(entityMesh.mDirty)
+      {
+        ++entityMesh.mRevision;
+        entityMesh.mDirty = false;
+      }
+    }
+
+    return;
+  }
+
   // First, clear the window of the last frame.
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  // Next, separate the entities into two lists: one for transparent entities
-  // and one for opaque entities.
-  std::vector<Entity> transparentEntities;
-  std::vector<Entity> opaqueEntities;
+  // Reclaim some of the space left in the geometry buffers by freed meshes.
+  MeshLoader::Defragment(MAX_DEFRAGMENT_MOVES);
+
+  mStreamBuffer.BeginFrame();
+  mStreamIndexMap.clear();
+  mStreamBoundsMap.clear();
+  mUniformBuffer.BeginFrame();
+
+  // Next, make sure the geometry for each entity is up to date.
   for(const auto& entity : GetEntities())
   {
     auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
-    if(entityMesh.mDirty)
+    if(entityMesh.mUsage == MeshUsage::eDYNAMIC && !entityMesh.mGeometry.IsValid())
     {
-      // If the mesh has the dirty flag set, update the OpenGL buffer
-      // with the new vertices and indices.
-      UpdateBuffersForEntity(entity, entityMesh.mVertices, entityMesh.mIndices);
-      entityMesh.mDirty = false;
-    }
-
-    if(entityMesh.mHasTransparency)
-    {
-      transparentEntities.emplace_back(entity);
+      // Dynamic geometry is streamed every frame, so there's nothing to
+      // store; release anything stored while the Mesh was static.
+      mStreamIndexMap[entity] = mStreamBuffer.Add(entityMesh.mVertices, entityMesh.mIndices);
+      mStreamBoundsMap[entity] = MeshLoader::CalculateBounds(entityMesh.mVertices);
+      ForgetEntityGeometry(entity);
+      if(entityMesh.mDirty)
+      {
+        ++entityMesh.mRevision;
+        entityMesh.mDirty = false;
+      }
     }
-    else
+    else if(entityMesh.mDirty)
     {
-      opaqueEntities.emplace_back(entity);
+      // If the mesh has the dirty flag set, give the MeshLoader a copy of
+      // the new vertices and indices. Shared geometry is already stored
+      // in the MeshLoader.
+      if(!entityMesh.mGeometry.IsValid())
+      {
+        StoreEntityGeometry(entity, entityMesh);
+      }
+      ++entityMesh.mRevision;
+      entityMesh.mDirty = false;
     }
   }
 
-  // Finally, for each camera, draw each entity. The opaque entities are drawn
-  // first, and the transparent entities are drawn second.
+  // Copy this frame's dynamic geometry into the stream buffer all at once.
+  mStreamBuffer.Upload();
+
+  UpdateBounds(aScene);
+
+  // Finally, for each camera, cull the entities, sort the visible ones into
+  // drawing order and draw them.
   auto cameraSignature = aScene.CreateSignature();
   cameraSignature[aScene.GetComponentIndex<Camera>()] = true;
   cameraSignature[aScene.GetComponentIndex<Transform>()] = true;
   auto cameraEntities = aScene.GetEntitiesWithSignature(cameraSignature);
   for(const auto& cameraEntity : cameraEntities)
   {
-    DrawEntities(aScene, cameraEntity, opaqueEntities);
+    QueueEntities(aScene, cameraEntity);
+    if(mRenderQueue.Sort(mDrawOrderMap[cameraEntity]))
+    {
+      mCoherentSorts.Increment();
+    }
+    DrawQueue(aScene, cameraEntity);
+  }
 
-    SortEntitiesByCameraDistance(aScene, cameraEntity, transparentEntities);
-    DrawEntities(aScene, cameraEntity, transparentEntities);
+  // Forget the draw order and gauges of any Camera that's gone.
+  for(auto it = mDrawOrderMap.begin(); it != mDrawOrderMap.end();)
+  {
+    if(std::find(cameraEntities.begin(), cameraEntities.end(), it->first) == cameraEntities.end())
+    {
+      it = mDrawOrderMap.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  for(auto it = mCameraGaugeMap.begin(); it != mCameraGaugeMap.end();)
+  {
+    auto camera = (it++)->first;
+    if(std::find(cameraEntities.begin(), cameraEntities.end(), camera) == cameraEntities.end())
+    {
+      RemoveCameraGauges(camera);
+    }
   }
+
+  mStreamBuffer.EndFrame();
+  mUniformBuffer.EndFrame();
 }
 
 /******************************************************************************/
 void RenderSystem::HandleEntityBecameEligible(Entity aEntity)
 {
-  mVertexArrayMap[aEntity] = 0;
-  mVertexBufferMap[aEntity] = 0;
-  mElementBufferMap[aEntity] = 0;
-
-  glGenVertexArrays(1, &mVertexArrayMap[aEntity]);
-  glGenBuffers(1, &mVertexBufferMap[aEntity]);
-  glGenBuffers(1, &mElementBufferMap[aEntity]);
+  // Geometry is only stored for an Entity once its Mesh is dirty, since
+  // Meshes with shared geometry don't need any.
 }
 
 /******************************************************************************/
 void RenderSystem::HandleEntityBecameIneligible(Entity aEntity)
 {
-  glDeleteVertexArrays(1, &mVertexArrayMap[aEntity]);
-  glDeleteBuffers(1, &mVertexBufferMap[aEntity]);
-  glDeleteBuffers(1, &mElementBufferMap[aEntity]);
-
-  mVertexArrayMap.erase(aEntity);
-  mVertexBufferMap.erase(aEntity);
-  mElementBufferMap.erase(aEntity);
+  // Releasing the handle frees the geometry in the MeshLoader.
+  ForgetEntityGeometry(aEntity);
+  mStreamIndexMap.erase(aEntity);
+  mStreamBoundsMap.erase(aEntity);
 }
 
 /******************************************************************************/
 void RenderSystem::HandleGamePendingExit(double aTime)
 {
-  for(const auto& vertexArrayPair : mVertexArrayMap)
+  mEntityGeometryMap.clear();
+  mGeometryHashMap.clear();
+  mHashEntityMap.clear();
+  mStreamIndexMap.clear();
+  mStreamBoundsMap.clear();
+  mStreamBuffer.Unload();
+  mUniformBuffer.Unload();
+
+  if(mInstanceBuffer != 0)
   {
-    glDeleteVertexArrays(1, &vertexArrayPair.second);
+    glDeleteBuffers(1, &mInstanceBuffer);
+    mInstanceBuffer = 0;
   }
-  mVertexArrayMap.clear();
 
-  for(const auto& vertexBufferPair : mVertexBufferMap)
-  {
-    glDeleteBuffers(1, &vertexBufferPair.second);
-  }
-  mVertexBufferMap.clear();
-
-  for(const auto& elementBufferPair : mElementBufferMap)
-  {
-    glDeleteVertexArrays(1, &elementBufferPair.second);
-  }
-  mElementBufferMap.clear();
-}
-
-/******************************************************************************/
-Mat4 RenderSystem::CalculateModelMatrix(const Transform& aTransform)
-{
-  auto translationMatrix = Translate(aTransform.mPosition);
-  auto scalarMatrix = Scale(aTransform.mScalar);
-
-  return (translationMatrix * aTransform.mRotation * scalarMatrix);
+  // The OpenGL context is about to be destroyed.
+  GLState::Invalidate();
 }
 
 /******************************************************************************/
@@ -176,7 +264,7 @@ Mat4 RenderSystem::CalculateViewMatrix(const Camera& aCamera,
   // the origin (0.0, 0.0, 0.0) and looking forward along the z-axis.
   Vec3 directionVector = Vec3(0.0, 0.0, 1.0);
 
-  // To get the true direction vector, we use the transform's rotation matrix.
+  // To get the true direction vector, we rotate it by the transform's rotation.
   directionVector = aTransform.mRotation * directionVector;
 
   // Now that we have a direction vector, we can calculate a right vector by
@@ -214,170 +302,642 @@ Mat4 RenderSystem::CalculateProjectionMatrix(const CoordinateSystem& aSystem,
 }
 
 /******************************************************************************/
-void RenderSystem::SortEntitiesByCameraDistance(Scene& aScene,
-                                                Entity aCamera,
-                                                std::vector<Entity>& aEntities)
+void RenderSystem::ApplyViewport(const Camera& aCamera)
 {
-  auto& cameraTransform = aScene.GetComponentForEntity<Transform>(aCamera);
+  if(aCamera.mUseWindowAsViewport)
+  {
+    GLState::SetViewport(0, 0, mFramebufferWidth, mFramebufferHeight);
+  }
+  else
+  {
+    GLState::SetViewport(0, 0, aCamera.mViewportX, aCamera.mViewportY);
+  }
+}
 
-  Vec3 forwardVector(0.0, 0.0, 1.0);
-  forwardVector = cameraTransform.mRotation * forwardVector;
+/******************************************************************************/
+bool RenderSystem::IsShaderInstanced(ID aShader)
+{
+  auto foundShader = mInstancedShaderMap.find(aShader);
+  if(foundShader == mInstancedShaderMap.end())
+  {
+    auto instanced = ShaderLoader::IsAttributeDefined(aShader, "instanceMatrix");
+    foundShader = mInstancedShaderMap.emplace(aShader, instanced).first;
+  }
+
+  return foundShader->second;
+}
+
+/******************************************************************************/
+void RenderSystem::UpdateBounds(Scene& aScene)
+{
+  for(int system = 0; system < NUM_COORDINATE_SYSTEMS; ++system)
+  {
+    mCullers[system].Clear();
+    mCullingEntities[system].clear();
+    mWorldMatrices[system].clear();
+    mWorldBounds[system].clear();
+  }
+
+  mBoundedEntities.clear();
+  mLocalBounds.clear();
 
-  // Sort the entities in order from furthest to nearest along the
-  // camera's forward vector.
-  auto sortFunction = [&aScene, &forwardVector, &cameraTransform](Entity aEntityA,
-                                                                  Entity aEntityB)
+  // Find each Entity with something to draw.
+  for(const auto& entity : GetEntities())
   {
-    auto& transformA = aScene.GetComponentForEntity<Transform>(aEntityA);
-    auto& transformB = aScene.GetComponentForEntity<Transform>(aEntityB);
+    const auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
 
-    auto distanceA = Dot(forwardVector, (transformA.mPosition - cameraTransform.mPosition));
-    auto distanceB = Dot(forwardVector, (transformB.mPosition - cameraTransform.mPosition));
+    // Skip Meshes that have nothing to draw with or nothing to draw.
+    AABB bounds;
+    if(entityMesh.mShaders.empty() ||
+       !GetBoundsForEntity(entity, entityMesh, bounds))
+    {
+      continue;
+    }
 
-    return distanceA < distanceB;
+    mBoundedEntities.emplace_back(entity);
+    mLocalBounds.emplace_back(bounds);
+  }
+
+  // Gather their Transforms, so that their model matrices can be built in
+  // one pass.
+  mTransformStreams.Resize(mBoundedEntities.size());
+  for(std::size_t i = 0; i < mBoundedEntities.size(); ++i)
+  {
+    const auto& entityTransform = aScene.GetComponentForEntity<Transform>(mBoundedEntities[i]);
+    mTransformStreams.Set(i,
+                          entityTransform.mPosition,
+                          entityTransform.mRotation,
+                          entityTransform.mScalar);
+  }
+
+  mModelMatrices.resize(mBoundedEntities.size());
+  ComposeMatrices(mTransformStreams, mModelMatrices.data());
+
+  auto getTransform = [&aScene](Entity aEntity) -> const Transform&
+  {
+    return aScene.GetComponentForEntity<Transform>(aEntity);
   };
-  std::sort(aEntities.begin(), aEntities.end(), sortFunction);
+  for(std::size_t i = 0; i < mBoundedEntities.size(); ++i)
+  {
+    auto entity = mBoundedEntities[i];
+    const auto& entityTransform = aScene.GetComponentForEntity<Transform>(entity);
+
+    // If the Entity's Transform component has a parent Transform, include
+    // the parent's model matrix.
+    auto worldMatrix = ComposeWorldMatrix(entityTransform, mModelMatrices[i], getTransform);
+
+    // If the parent is scheduled for removal, schedule this entity for
+    // removal as well.
+    if(entityTransform.mUseParent &&
+       aScene.IsEntityScheduledForRemoval(entityTransform.mParent))
+    {
+      aScene.RemoveEntity(entity);
+    }
+
+    const auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
+    auto system = static_cast<int>(entityMesh.mSystem);
+    auto worldBounds = TransformBounds(worldMatrix, mLocalBounds[i]);
+    mCullers[system].Add(worldBounds);
+    mCullingEntities[system].emplace_back(entity);
+    mWorldMatrices[system].emplace_back(worldMatrix);
+    mWorldBounds[system].emplace_back(worldBounds);
+  }
 }
 
 /******************************************************************************/
-void RenderSystem::DrawEntities(Scene& aScene,
-                                Entity aCamera,
-                                const std::vector<Entity>& aEntities)
+std::size_t RenderSystem::CullOccludedEntities(Scene& aScene,
+                                               int aSystem,
+                                               const Mat4& aViewProjection)
 {
+  const auto& entities = mCullingEntities[aSystem];
+
+  // First, draw each visible occluder into the depth buffer.
+  mOcclusionCuller.Begin(aViewProjection);
+  for(std::size_t i = 0; i < mVisibility.size(); ++i)
+  {
+    const auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entities[i]);
+    if(!mVisibility[i] || !entityMesh.mOccluder ||
+       entityMesh.mRenderMode != RenderMode::eTRIANGLES)
+    {
+      continue;
+    }
+
+    if(entityMesh.mGeometry.IsValid())
+    {
+      mOcclusionCuller.AddOccluder(MeshLoader::GetVertices(entityMesh.mGeometry),
+                                   MeshLoader::GetIndices(entityMesh.mGeometry),
+                                   mWorldMatrices[aSystem][i]);
+    }
+    else
+    {
+      mOcclusionCuller.AddOccluder(entityMesh.mVertices,
+                                   entityMesh.mIndices,
+                                   mWorldMatrices[aSystem][i]);
+    }
+  }
+
+  if(mOcclusionCuller.GetNumTriangles() == 0)
+  {
+    return 0;
+  }
+
+  mOcclusionCuller.Rasterize();
+
+  // Then cull every other visible Entity that's hidden behind them.
+  std::size_t numOccluded = 0;
+  for(std::size_t i = 0; i < mVisibility.size(); ++i)
+  {
+    if(!mVisibility[i] ||
+       aScene.GetComponentForEntity<Mesh>(entities[i]).mOccluder)
+    {
+      continue;
+    }
+
+    if(!mOcclusionCuller.IsVisible(mWorldBounds[aSystem][i]))
+    {
+      mVisibility[i] = 0;
+      ++numOccluded;
+    }
+  }
+
+  return numOccluded;
+}
+
+/******************************************************************************/
+void RenderSystem::QueueEntities(Scene& aScene, Entity aCamera)
+{
+  mRenderQueue.Clear();
+
   auto& camera = aScene.GetComponentForEntity<Camera>(aCamera);
   auto& cameraTransform = aScene.GetComponentForEntity<Transform>(aCamera);
+  auto viewMatrix = CalculateViewMatrix(camera, cameraTransform);
+
+  // The camera looks along its negative z-axis.
+  auto forwardVector = cameraTransform.mRotation * Vec3(0.0, 0.0, -1.0);
+  auto depthRange = camera.mFarPlane - camera.mNearPlane;
 
-  // Set the viewport to fit the camera.
-  if(camera.mUseWindowAsViewport)
+  std::size_t numVisible = 0;
+  std::size_t numCulled = 0;
+  std::size_t numOccluded = 0;
+  for(int system = 0; system < NUM_COORDINATE_SYSTEMS; ++system)
   {
-    glViewport(0, 0, mFramebufferWidth, mFramebufferHeight);
+    // Cull each Entity that can't be seen by the camera.
+    auto projectionMatrix = CalculateProjectionMatrix(static_cast<CoordinateSystem>(system), camera);
+    auto viewProjection = projectionMatrix * viewMatrix;
+    auto frustum = CalculateFrustum(viewProjection);
+    auto systemVisible = mCullers[system].Cull(frustum, mVisibility);
+    numCulled += mCullers[system].GetSize() - systemVisible;
+
+    if(camera.mUseOcclusionCulling && systemVisible > 0)
+    {
+      auto systemOccluded = CullOccludedEntities(aScene, system, viewProjection);
+      systemVisible -= systemOccluded;
+      numOccluded += systemOccluded;
+    }
+    numVisible += systemVisible;
+
+    for(std::size_t i = 0; i < mVisibility.size(); ++i)
+    {
+      if(!mVisibility[i])
+      {
+        continue;
+      }
+
+      auto entity = mCullingEntities[system][i];
+      const auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
+
+      DrawPacket packet;
+      if(!GetRangeForEntity(entity, entityMesh, packet.mRange))
+      {
+        continue;
+      }
+
+      packet.mEntity = entity;
+      packet.mModelMatrix = mWorldMatrices[system][i];
+      packet.mShaderSet = mRenderQueue.InternShaders(entityMesh.mShaders);
+      packet.mTextureSet = mRenderQueue.InternTextures(entityMesh.mTextures);
+      packet.mRenderMode = entityMesh.mRenderMode;
+      packet.mSystem = entityMesh.mSystem;
+      packet.mUseDepthTesting = entityMesh.mUseDepthTesting;
+      packet.mHasTransparency = entityMesh.mHasTransparency;
+
+      // Entities can only be drawn with an instanced draw call if each of
+      // their shaders supports it, and they draw the same stored geometry
+      // (either shared through the Mesh, or found to be identical when it
+      // was stored).
+      auto instanced = std::all_of(entityMesh.mShaders.begin(),
+                                   entityMesh.mShaders.end(),
+                                   [this](ID aShader) { return this->IsShaderInstanced(aShader); });
+      if(instanced)
+      {
+        auto foundGeometry = mEntityGeometryMap.find(entity);
+        if(entityMesh.mGeometry.IsValid())
+        {
+          packet.mGeometry = mRenderQueue.InternGeometry(entityMesh.mGeometry.GetID());
+        }
+        else if(foundGeometry != mEntityGeometryMap.end())
+        {
+          packet.mGeometry = mRenderQueue.InternGeometry(foundGeometry->second.GetID());
+        }
+      }
+
+      // Measure the distance to the Entity along the camera's forward vector.
+      Vec3 position(packet.mModelMatrix.data[3][0],
+                    packet.mModelMatrix.data[3][1],
+                    packet.mModelMatrix.data[3][2]);
+      auto distance = Dot(forwardVector, (position - cameraTransform.mPosition));
+      packet.mDepth = (distance - camera.mNearPlane) / depthRange;
+
+      mRenderQueue.Add(packet);
+    }
   }
-  else
+
+  // Report how many Entities this camera culled.
+  auto& gauges = GetCameraGauges(aCamera);
+  gauges.mVisibleMeshes->Set(numVisible);
+  gauges.mCulledMeshes->Set(numCulled);
+  gauges.mOccludedMeshes->Set(numOccluded);
+  mVisibleMeshes.Increment(numVisible);
+  mCulledMeshes.Increment(numCulled);
+  mOccludedMeshes.Increment(numOccluded);
+}
+
+/******************************************************************************/
+RenderSystem::CameraGauges& RenderSystem::GetCameraGauges(Entity aCamera)
+{
+  auto& gauges = mCameraGaugeMap[aCamera];
+  if(gauges.mVisibleMeshes == nullptr)
   {
-    glViewport(0, 0, camera.mViewportX, camera.mViewportY);
+    auto cameraName = "Renderer.Camera" + std::to_string(aCamera);
+    gauges.mVisibleMeshes = &Metrics::GetGauge(cameraName + ".VisibleMeshes");
+    gauges.mCulledMeshes = &Metrics::GetGauge(cameraName + ".CulledMeshes");
+    gauges.mOccludedMeshes = &Metrics::GetGauge(cameraName + ".OccludedMeshes");
   }
 
+  return gauges;
+}
+
+/******************************************************************************/
+void RenderSystem::RemoveCameraGauges(Entity aCamera)
+{
+  auto cameraName = "Renderer.Camera" + std::to_string(aCamera);
+  Metrics::RemoveGauge(cameraName + ".VisibleMeshes");
+  Metrics::RemoveGauge(cameraName + ".CulledMeshes");
+  Metrics::RemoveGauge(cameraName + ".OccludedMeshes");
+  mCameraGaugeMap.erase(aCamera);
+}
+
+/******************************************************************************/
+void RenderSystem::DrawQueue(Scene& aScene, Entity aCamera)
+{
+  auto& camera = aScene.GetComponentForEntity<Camera>(aCamera);
+  auto& cameraTransform = aScene.GetComponentForEntity<Transform>(aCamera);
+
+  ApplyViewport(camera);
   auto viewMatrix = CalculateViewMatrix(camera, cameraTransform);
 
-  for(const auto& entity : aEntities)
+  // First, group consecutive packets that can be drawn with a single
+  // instanced draw call, and copy the model matrices for every group into
+  // the instance buffer at once; each group then reads from its own range
+  // of the buffer.
+  mDrawRuns.clear();
+  mInstanceMatrices.clear();
+  auto numPackets = mRenderQueue.GetNumPackets();
+  for(std::size_t i = 0; i < numPackets;)
   {
-    auto& entityMesh = aScene.GetComponentForEntity<Mesh>(entity);
-    auto& entityTransform = aScene.GetComponentForEntity<Transform>(entity);
+    const auto& packet = mRenderQueue.GetPacket(i);
+
+    DrawRun run;
+    run.mFirstPacket = i;
+    run.mNumPackets = 1;
+    run.mFirstInstance = mInstanceMatrices.size();
+    run.mInstanced = (packet.mGeometry != 0);
+    if(!run.mInstanced)
+    {
+      // Give packets drawn individually their own copy of the object
+      // block, if any of their shaders read from it.
+      const auto& shaders = mRenderQueue.GetShaders(packet.mShaderSet);
+      run.mUseObjectBlock = std::any_of(shaders.begin(), shaders.end(), [](ID aShader)
+      {
+        return ShaderLoader::IsUniformBlockDefined(aShader, UniformBlock::eOBJECT);
+      });
+      if(run.mUseObjectBlock)
+      {
+        ObjectBlock objectBlock;
+        objectBlock.mModelMatrix = packet.mModelMatrix;
+        run.mObjectOffset = mUniformBuffer.Add(&objectBlock, sizeof(ObjectBlock));
+      }
+    }
+    else
+    {
+      mInstanceMatrices.emplace_back(packet.mModelMatrix);
+      while(i + run.mNumPackets < numPackets &&
+            RenderQueue::CanInstance(packet, mRenderQueue.GetPacket(i + run.mNumPackets)))
+      {
+        mInstanceMatrices.emplace_back(mRenderQueue.GetPacket(i + run.mNumPackets).mModelMatrix);
+        ++run.mNumPackets;
+      }
+    }
+
+    mDrawRuns.emplace_back(run);
+    i += run.mNumPackets;
+  }
+
+  if(!mInstanceMatrices.empty())
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER,
+                 mInstanceMatrices.size() * sizeof(Mat4),
+                 mInstanceMatrices.data(),
+                 GL_STREAM_DRAW);
+    mBufferUploads.Increment();
+  }
+
+  // Add the camera block for each coordinate system, then upload every
+  // block for this camera at once.
+  std::size_t cameraOffsets[2];
+  for(auto system : { CoordinateSystem::eWORLD_SPACE, CoordinateSystem::eSCREEN_SPACE })
+  {
+    CameraBlock cameraBlock;
+    cameraBlock.mViewMatrix = viewMatrix;
+    cameraBlock.mProjectionMatrix = CalculateProjectionMatrix(system, camera);
+    cameraOffsets[static_cast<int>(system)] = mUniformBuffer.Add(&cameraBlock, sizeof(CameraBlock));
+  }
+  mUniformBuffer.Upload();
+
+  // Next, draw each group. Since the packets are sorted by state, most
+  // state changes between groups are skipped by GLState.
+  std::map<ID, CoordinateSystem> shaderSystemMap;
+  mInstancedVertexArrays.clear();
+  int cameraBlockSystem = -1;
+  for(const auto& run : mDrawRuns)
+  {
+    const auto& packet = mRenderQueue.GetPacket(run.mFirstPacket);
 
-    entityMesh.mUseDepthTesting ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    auto system = static_cast<int>(packet.mSystem);
+    if(cameraBlockSystem != system)
+    {
+      mUniformBuffer.Bind(static_cast<unsigned int>(UniformBlock::eCAMERA),
+                          cameraOffsets[system],
+                          sizeof(CameraBlock));
+      cameraBlockSystem = system;
+    }
 
-    // Bind each texture on this mesh.
-    for(int i = 0; i < entityMesh.mTextures.size(); ++i)
+    if(run.mUseObjectBlock)
     {
-      glActiveTexture(GL_TEXTURE0 + i);
-      glBindTexture(GL_TEXTURE_2D, entityMesh.mTextures[i]);
+      mUniformBuffer.Bind(static_cast<unsigned int>(UniformBlock::eOBJECT),
+                          run.mObjectOffset,
+                          sizeof(ObjectBlock));
     }
 
-    // For each shader on this mesh, render it.
-    for(const auto& shader : entityMesh.mShaders)
+    GLState::SetEnabled(GL_DEPTH_TEST, packet.mUseDepthTesting);
+
+    // Bind each texture in the packet's material.
+    const auto& textures = mRenderQueue.GetTextures(packet.mTextureSet);
+    for(unsigned int i = 0; i < textures.size(); ++i)
     {
-      glUseProgram(shader);
+      GLState::BindTexture(i, textures[i]);
+    }
 
-      // Set the model matrix.
-      if(ShaderLoader::IsUniformDefined(shader, "modelMatrix"))
+    auto vertexArray = packet.mRange.mVertexArray;
+    GLState::BindVertexArray(vertexArray);
+
+    if(run.mInstanced)
+    {
+      // Point the instance matrix attribute (one column per location)
+      // at this group's range of the instance buffer.
+      glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+      for(unsigned int column = 0; column < 4; ++column)
       {
-        // If the Entity's Transform component has a parent Transform,
-        // calculate the model matrix for the parent.
-        Mat4 parentMatrix;
-        if(entityTransform.mUseParent)
+        auto offset = (run.mFirstInstance * sizeof(Mat4)) + (column * 4 * sizeof(float));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribPointer(3 + column,
+                              4,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              sizeof(Mat4),
+                              (void*)(offset));
+        glVertexAttribDivisor(3 + column, 1);
+      }
+      if(std::find(mInstancedVertexArrays.begin(), mInstancedVertexArrays.end(), vertexArray) == mInstancedVertexArrays.end())
+      {
+        mInstancedVertexArrays.emplace_back(vertexArray);
+      }
+    }
+    else
+    {
+      auto foundVertexArray = std::find(mInstancedVertexArrays.begin(),
+                                        mInstancedVertexArrays.end(),
+                                        vertexArray);
+      if(foundVertexArray != mInstancedVertexArrays.end())
+      {
+        // Turn the instance matrix attribute back off, so that shaders that
+        // support instancing read the constant value set below instead.
+        for(unsigned int column = 0; column < 4; ++column)
         {
-          auto& parentTransform = aScene.GetComponentForEntity<Transform>(entityTransform.mParent);
-          parentMatrix = CalculateModelMatrix(parentTransform);
+          glDisableVertexAttribArray(3 + column);
+        }
+        mInstancedVertexArrays.erase(foundVertexArray);
+      }
+    }
 
-          // If the parent is scheduled for removal, schedule this
-          // entity for removal as well.
-          if(aScene.IsEntityScheduledForRemoval(entityTransform.mParent))
-          {
-            aScene.RemoveEntity(entity);
-          }
+    // For each shader in the packet's material, draw the group.
+    for(const auto& shader : mRenderQueue.GetShaders(packet.mShaderSet))
+    {
+      GLState::UseProgram(shader);
+
+      // For shaders that don't use the camera block, set the view and
+      // projection matrices the first time each shader is used for this
+      // camera, and the projection matrix again whenever the coordinate
+      // system changes.
+      auto foundShader = shaderSystemMap.find(shader);
+      if(foundShader == shaderSystemMap.end() || foundShader->second != packet.mSystem)
+      {
+        if(foundShader == shaderSystemMap.end())
+        {
+          ShaderLoader::SetMat4(shader, mViewMatrixUniform, viewMatrix);
         }
 
-        auto matrix = parentMatrix * CalculateModelMatrix(entityTransform);
-        ShaderLoader::SetMat4(shader, "modelMatrix", matrix);
+        if(ShaderLoader::IsUniformDefined(shader, mProjectionMatrixUniform))
+        {
+          auto matrix = CalculateProjectionMatrix(packet.mSystem, camera);
+          ShaderLoader::SetMat4(shader, mProjectionMatrixUniform, matrix);
+        }
+
+        shaderSystemMap[shader] = packet.mSystem;
       }
 
-      // Set the view matrix.
-      if(ShaderLoader::IsUniformDefined(shader, "viewMatrix"))
+      if(run.mInstanced)
       {
-        ShaderLoader::SetMat4(shader, "viewMatrix", viewMatrix);
+        glDrawElementsInstancedBaseVertex(static_cast<GLenum>(packet.mRenderMode),
+                                          packet.mRange.mIndexCount,
+                                          GL_UNSIGNED_INT,
+                                          (void*)(packet.mRange.mFirstIndex * sizeof(unsigned int)),
+                                          run.mNumPackets,
+                                          packet.mRange.mBaseVertex);
       }
-
-      // Set the projection matrix.
-      if(ShaderLoader::IsUniformDefined(shader, "projectionMatrix"))
+      else
       {
-        auto matrix = CalculateProjectionMatrix(entityMesh.mSystem, camera);
-        ShaderLoader::SetMat4(shader, "projectionMatrix", matrix);
+        // Set the model matrix. Shaders that support instancing read it
+        // from the instance matrix attribute instead, which holds a constant
+        // value while the attribute is disabled.
+        if(ShaderLoader::IsUniformDefined(shader, mModelMatrixUniform))
+        {
+          ShaderLoader::SetMat4(shader, mModelMatrixUniform, packet.mModelMatrix);
+        }
+        else if(IsShaderInstanced(shader))
+        {
+          for(unsigned int column = 0; column < 4; ++column)
+          {
+            glVertexAttrib4fv(3 + column, packet.mModelMatrix.data[column]);
+          }
+        }
+
+        glDrawElementsBaseVertex(static_cast<GLenum>(packet.mRenderMode),
+                                 packet.mRange.mIndexCount,
+                                 GL_UNSIGNED_INT,
+                                 (void*)(packet.mRange.mFirstIndex * sizeof(unsigned int)),
+                                 packet.mRange.mBaseVertex);
       }
+      mDrawCalls.Increment();
+    }
+  }
 
-      // Draw the mesh.
-      glBindVertexArray(mVertexArrayMap[entity]);
-      glDrawElements(static_cast<GLenum>(entityMesh.mRenderMode),
-                     entityMesh.mIndices.size(),
-                     GL_UNSIGNED_INT,
-                     0);
-      glBindVertexArray(0);
+  // Leave the instance matrix attribute turned off in every vertex array
+  // for the next frame.
+  for(auto vertexArray : mInstancedVertexArrays)
+  {
+    GLState::BindVertexArray(vertexArray);
+    for(unsigned int column = 0; column < 4; ++column)
+    {
+      glDisableVertexAttribArray(3 + column);
     }
+  }
+  mInstancedVertexArrays.clear();
 
-    glEnable(GL_DEPTH_TEST);
+  GLState::BindVertexArray(0);
+  GLState::SetEnabled(GL_DEPTH_TEST, true);
+}
+
+/******************************************************************************/
+void RenderSystem::StoreEntityGeometry(Entity aEntity, const Mesh& aMesh)
+{
+  auto hash = MeshLoader::HashGeometry(aMesh.mVertices, aMesh.mIndices);
+
+  // Stop sharing the Entity's old geometry, but hold onto it so that it can
+  // be updated in place if nothing else uses it.
+  MeshHandle oldGeometry;
+  auto foundGeometry = mEntityGeometryMap.find(aEntity);
+  if(foundGeometry != mEntityGeometryMap.end())
+  {
+    oldGeometry = foundGeometry->second;
   }
+  ForgetEntityGeometry(aEntity);
+
+  // Share the geometry of another Entity, if it's identical. Entities with
+  // the same hash usually have identical geometry, but not always.
+  MeshHandle geometry;
+  auto range = mHashEntityMap.equal_range(hash);
+  for(auto it = range.first; it != range.second; ++it)
+  {
+    const auto& otherGeometry = mEntityGeometryMap.at(it->second);
+    if(IsMeshGeometryEqual(otherGeometry, aMesh.mVertices, aMesh.mIndices))
+    {
+      geometry = otherGeometry;
+      break;
+    }
+  }
+
+  if(!geometry.IsValid())
+  {
+    if(oldGeometry.IsValid() && MeshLoader::GetReferenceCount(oldGeometry) == 1)
+    {
+      MeshLoader::UpdateMesh(oldGeometry, aMesh.mVertices, aMesh.mIndices);
+      geometry = oldGeometry;
+    }
+    else
+    {
+      geometry = MeshLoader::LoadMesh(aMesh.mVertices, aMesh.mIndices);
+    }
+  }
+
+  mEntityGeometryMap.emplace(aEntity, geometry);
+  mGeometryHashMap.emplace(aEntity, hash);
+  mHashEntityMap.emplace(hash, aEntity);
 }
 
 /******************************************************************************/
-void RenderSystem::UpdateBuffersForEntity(Entity aEntity,
-                                          const std::vector<MeshVertex>& aVertices,
-                                          const std::vector<unsigned int>& aIndices)
+void RenderSystem::ForgetEntityGeometry(Entity aEntity)
 {
-  // Bind the vertex array.
-  glBindVertexArray(mVertexArrayMap[aEntity]);
-
-  // Copy the vertex data into the vertex buffer.
-  glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferMap[aEntity]);
-  glBufferData(GL_ARRAY_BUFFER,
-               aVertices.size() * sizeof(MeshVertex),
-               &aVertices[0],
-               GL_STATIC_DRAW);
-
-  // Configure the vertex position attributes.
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0,
-                        3,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(MeshVertex),
-                        (void*)(0));
-
-  // Configure the vertex color attributes.
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1,
-                        3,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(MeshVertex),
-                        (void*)(offsetof(MeshVertex, mColor)));
-
-  // Configure the vertex texture coordinates.
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2,
-                        2,
-                        GL_FLOAT,
-                        GL_FALSE,
-                        sizeof(MeshVertex),
-                        (void*)(offsetof(MeshVertex, mTexCoords)));
-
-  // Copy the index data into the element buffer.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBufferMap[aEntity]);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               aIndices.size() * sizeof(unsigned int),
-               &aIndices[0],
-               GL_STATIC_DRAW);
-
-  // Unbind the vertex array.
-  glBindVertexArray(0);
+  auto foundHash = mGeometryHashMap.find(aEntity);
+  if(foundHash != mGeometryHashMap.end())
+  {
+    auto range = mHashEntityMap.equal_range(foundHash->second);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+      if(it->second == aEntity)
+      {
+        mHashEntityMap.erase(it);
+        break;
+      }
+    }
+    mGeometryHashMap.erase(foundHash);
+  }
+
+  mEntityGeometryMap.erase(aEntity);
+}
+
+/******************************************************************************/
+bool RenderSystem::GetRangeForEntity(Entity aEntity,
+                                     const Mesh& aMesh,
+                                     MeshRange& aRange)
+{
+  if(aMesh.mGeometry.IsValid())
+  {
+    aRange = MeshLoader::GetRange(aMesh.mGeometry);
+    return true;
+  }
+
+  auto foundStream = mStreamIndexMap.find(aEntity);
+  if(foundStream != mStreamIndexMap.end())
+  {
+    aRange = mStreamBuffer.GetRange(foundStream->second);
+    return true;
+  }
+
+  auto foundGeometry = mEntityGeometryMap.find(aEntity);
+  if(foundGeometry != mEntityGeometryMap.end())
+  {
+    aRange = MeshLoader::GetRange(foundGeometry->second);
+    return true;
+  }
+
+  return false;
+}
+
+/******************************************************************************/
+bool RenderSystem::GetBoundsForEntity(Entity aEntity,
+                                      const Mesh& aMesh,
+                                      AABB& aBounds)
+{
+  if(aMesh.mGeometry.IsValid())
+  {
+    aBounds = MeshLoader::GetBounds(aMesh.mGeometry);
+  }
+  else if(mStreamBoundsMap.count(aEntity))
+  {
+    aBounds = mStreamBoundsMap[aEntity];
+  }
+  else if(mEntityGeometryMap.count(aEntity))
+  {
+    aBounds = MeshLoader::GetBounds(mEntityGeometryMap[aEntity]);
+  }
+  else
+  {
+    return false;
+  }
+
+  return !IsEmpty(aBounds);
 }
 
 } // namespace Kuma3D
@@ -4,17 +4,57 @@
 #include "System.hpp"
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include "Camera.hpp"
 #include "Mesh.hpp"
+#include "MeshHandle.hpp"
 #include "Transform.hpp"
 
+#include "Geometry.hpp"
 #include "Mat4.hpp"
+#include "TransformStreams.hpp"
 
+#include "FrustumCuller.hpp"
+#include "MeshLoader.hpp"
+#include "OcclusionCuller.hpp"
+#include "RenderQueue.hpp"
+#include "ShaderLoader.hpp"
+#include "StreamBuffer.hpp"
+#include "UniformRingBuffer.hpp"
+
+#include "Metrics.hpp"
 #include "Observer.hpp"
 
 namespace Kuma3D {
 
+/**
+ * The RenderSystem draws each Entity with a Mesh and a Transform from the
+ * perspective of each Camera in the Scene.
+ *
+ * Each frame, the world-space bounding box of every Mesh is calculated, and
+ * for each Camera, every Entity whose box is outside the Camera's view
+ * frustum is culled. Cameras using occlusion culling also cull each Entity
+ * hidden behind an occluding Mesh (see OcclusionCuller). Each remaining Entity is turned into a DrawPacket and sorted by a
+ * RenderQueue: opaque Entities are grouped by state and drawn front-to-back,
+ * and transparent Entities are drawn back-to-front afterwards. OpenGL state
+ * is only changed between packets that differ.
+ *
+ * Consecutive packets with identical geometry and material (the same
+ * shaders, textures, render mode, coordinate system and depth testing) are
+ * drawn together in a single instanced draw call, provided each of their
+ * shaders takes the model matrix as a per-instance vertex attribute:
+ *
+ *   layout (location = 3) in mat4 instanceMatrix;
+ *
+ * Entities using shaders with a modelMatrix uniform (or an ObjectBlock)
+ * instead are drawn one at a time.
+ *
+ * The view and projection matrices are given to shaders through the camera
+ * uniform block if they declare one, and through viewMatrix and
+ * projectionMatrix uniforms otherwise (see UniformBlock).
+ */
 class RenderSystem : public System
 {
   public:
@@ -30,7 +70,8 @@ class RenderSystem : public System
     void Initialize(Scene& aScene) override;
 
     /**
-     * Renders each Entity with a Mesh and Transform component.
+     * Renders each Entity with a Mesh and Transform component. If the Game
+     * is running in headless mode, nothing is rendered.
      *
      * @param aScene The Scene containing the Entities' component data.
      * @param aTime The start time of the current frame.
@@ -58,20 +99,22 @@ class RenderSystem : public System
   private:
 
     /**
-     * A handler function that gets called just before the game exits.
-     *
-     * @param aTime The time of exiting.
+     * The gauges published for each Camera, looked up once when the Camera
+     * is first drawn.
      */
-    void HandleGamePendingExit(double aTime);
+    struct CameraGauges
+    {
+      Gauge* mVisibleMeshes { nullptr };
+      Gauge* mCulledMeshes { nullptr };
+      Gauge* mOccludedMeshes { nullptr };
+    };
 
     /**
-     * Calculates and returns a model matrix that converts a point
-     * into the coordinate system defined by the given Transform.
+     * A handler function that gets called just before the game exits.
      *
-     * @param aTransform The Transform to calculate a matrix for.
-     * @return A transformation matrix for the Transform.
+     * @param aTime The time of exiting.
      */
-    Mat4 CalculateModelMatrix(const Transform& aTransform);
+    void HandleGamePendingExit(double aTime);
 
     /**
      * Calculates and returns a view matrix for the given Camera with the
@@ -96,48 +139,240 @@ class RenderSystem : public System
                                    const Camera& aCamera);
 
     /**
-     * Sorts the given list of Entities by their distance along the given
-     * Camera's forward axis.
+     * Sets the OpenGL viewport to fit the given Camera.
+     *
+     * @param aCamera The Camera to fit the viewport to.
+     */
+    void ApplyViewport(const Camera& aCamera);
+
+    /**
+     * Returns whether the given shader takes a per-instance model matrix,
+     * and can therefore be used for instanced drawing.
+     *
+     * @param aShader The ID of the shader to check.
+     * @return True if the shader supports instancing, false otherwise.
+     */
+    bool IsShaderInstanced(ID aShader);
+
+    /**
+     * Calculates the world matrix and world-space bounding box of each
+     * Entity that has geometry, for culling against each Camera.
      *
      * @param aScene The Scene containing the Entities.
-     * @param aCamera The Camera to sort by.
-     * @param aEntities The Entities to sort.
      */
-    void SortEntitiesByCameraDistance(Scene& aScene,
-                                      Entity aCamera,
-                                      std::vector<Entity>& aEntities);
+    void UpdateBounds(Scene& aScene);
+
+    /**
+     * Rasterizes each visible occluder in the given coordinate system, then
+     * marks each visible Entity hidden behind them as culled in mVisibility.
+     *
+     * @param aScene The Scene containing the Entities.
+     * @param aSystem The coordinate system of the Entities to cull.
+     * @param aViewProjection The Camera's projection matrix multiplied by
+     *                        its view matrix.
+     * @return The number of Entities culled.
+     */
+    std::size_t CullOccludedEntities(Scene& aScene,
+                                     int aSystem,
+                                     const Mat4& aViewProjection);
+
+    /**
+     * Fills the RenderQueue with a DrawPacket for each Entity visible from
+     * the given Camera.
+     *
+     * @param aScene The Scene containing the Entities.
+     * @param aCamera The Camera from which the Entities will be drawn.
+     */
+    void QueueEntities(Scene& aScene, Entity aCamera);
+
+    /**
+     * Returns the culling gauges for the given Camera, creating them the
+     * first time the Camera is drawn.
+     *
+     * @param aCamera The Camera to get the gauges for.
+     * @return The Camera's gauges.
+     */
+    CameraGauges& GetCameraGauges(Entity aCamera);
+
+    /**
+     * Removes the culling gauges for the given Camera from the Metrics.
+     *
+     * @param aCamera The Camera to remove the gauges for.
+     */
+    void RemoveCameraGauges(Entity aCamera);
+
+    /**
+     * Draws each packet in the (sorted) RenderQueue from the perspective of
+     * the given Camera, combining consecutive packets into instanced draw
+     * calls where possible.
+     *
+     * @param aScene The Scene containing the Camera.
+     * @param aCamera The Camera from which to draw the packets.
+     */
+    void DrawQueue(Scene& aScene, Entity aCamera);
+
+    /**
+     * Stores the vertices and indices of the given Entity's Mesh in the
+     * MeshLoader. If another Entity's stored geometry is identical, the
+     * Entities share it, so that they can be drawn together.
+     *
+     * @param aEntity The Entity whose geometry changed.
+     * @param aMesh The Entity's Mesh.
+     */
+    void StoreEntityGeometry(Entity aEntity, const Mesh& aMesh);
 
     /**
-     * Draws a collection of entities from the perspective of a camera.
+     * Releases the geometry stored for the given Entity, if any.
      *
-     * @param aScene The Scene containing the entities.
-     * @param aCamera The Camera from which to draw the entities.
-     * @param aEntities The entities to draw.
+     * @param aEntity The Entity to release geometry for.
      */
-    void DrawEntities(Scene& aScene,
-                      Entity aCamera,
-                      const std::vector<Entity>& aEntities);
+    void ForgetEntityGeometry(Entity aEntity);
 
     /**
-     * Updates the OpenGL buffer data (vertices and indices) for the given
-     * Entity.
+     * Retrieves where the geometry for the given Entity's Mesh is stored,
+     * uploading it if necessary.
      *
-     * @param aEntity The Entity to update buffers for.
-     * @param aVertices The vertices to copy into the vertex buffer.
-     * @param aIndices The indices to copy into the element buffer.
+     * @param aEntity The Entity to draw.
+     * @param aMesh The Entity's Mesh.
+     * @param aRange Filled with the location of the geometry.
+     * @return True if the Mesh has geometry, false otherwise.
      */
-    void UpdateBuffersForEntity(Entity aEntity,
-                                const std::vector<MeshVertex>& aVertices,
-                                const std::vector<unsigned int>& aIndices);
+    bool GetRangeForEntity(Entity aEntity, const Mesh& aMesh, MeshRange& aRange);
 
-    std::map<Entity, unsigned int> mVertexArrayMap;
-    std::map<Entity, unsigned int> mVertexBufferMap;
-    std::map<Entity, unsigned int> mElementBufferMap;
+    /**
+     * Retrieves the local-space bounding box of the geometry for the given
+     * Entity's Mesh.
+     *
+     * @param aEntity The Entity to retrieve bounds for.
+     * @param aMesh The Entity's Mesh.
+     * @param aBounds Filled with the bounding box of the geometry.
+     * @return True if the Mesh has any vertices, false otherwise.
+     */
+    bool GetBoundsForEntity(Entity aEntity, const Mesh& aMesh, AABB& aBounds);
+
+    /**
+     * A run of consecutive packets in the RenderQueue that are drawn with a
+     * single draw call.
+     */
+    struct DrawRun
+    {
+      std::size_t mFirstPacket { 0 };
+      std::size_t mNumPackets { 0 };
+
+      // The position of the run's first model matrix in the instance buffer.
+      std::size_t mFirstInstance { 0 };
+      bool mInstanced { false };
+
+      // The offset of the run's object block in the uniform buffer.
+      std::size_t mObjectOffset { 0 };
+      bool mUseObjectBlock { false };
+    };
+
+    /**
+     * The contents of the camera uniform block (see UniformBlock), laid
+     * out according to std140.
+     */
+    struct CameraBlock
+    {
+      Mat4 mViewMatrix;
+      Mat4 mProjectionMatrix;
+    };
+
+    /**
+     * The contents of the object uniform block (see UniformBlock), laid
+     * out according to std140.
+     */
+    struct ObjectBlock
+    {
+      Mat4 mModelMatrix;
+    };
+
+    // The geometry of each Entity whose Mesh stores its own vertices and
+    // indices, kept in the MeshLoader alongside all shared geometry.
+    std::map<Entity, MeshHandle> mEntityGeometryMap;
+
+    // Dynamic geometry is streamed through this buffer each frame; each
+    // Entity with a dynamic Mesh is mapped to its geometry for the frame.
+    StreamBuffer mStreamBuffer;
+    std::map<Entity, std::size_t> mStreamIndexMap;
+    std::map<Entity, AABB> mStreamBoundsMap;
+
+    // The camera and object uniform blocks for the current frame.
+    UniformRingBuffer mUniformBuffer;
+
+    // Maps each Entity with stored geometry to a hash of its Mesh's
+    // vertices and indices, and each hash back to those Entities, so that
+    // Entities with identical geometry can share it.
+    std::map<Entity, std::size_t> mGeometryHashMap;
+    std::unordered_multimap<std::size_t, Entity> mHashEntityMap;
+
+    // Caches whether each shader supports instancing.
+    std::map<ID, bool> mInstancedShaderMap;
+
+    // The Entities that have geometry this frame, their world matrices,
+    // and their world-space bounding boxes, separated by coordinate system.
+    // mVisibility holds the result of culling one of the lists.
+    static const int NUM_COORDINATE_SYSTEMS = 2;
+    FrustumCuller mCullers[NUM_COORDINATE_SYSTEMS];
+    std::vector<Entity> mCullingEntities[NUM_COORDINATE_SYSTEMS];
+    std::vector<Mat4> mWorldMatrices[NUM_COORDINATE_SYSTEMS];
+    std::vector<AABB> mWorldBounds[NUM_COORDINATE_SYSTEMS];
+    std::vector<unsigned char> mVisibility;
+
+    // The Transforms of the Entities that have geometry this frame, and
+    // the model matrices and local bounding boxes built from them.
+    TransformStreams mTransformStreams;
+    std::vector<Entity> mBoundedEntities;
+    std::vector<Mat4> mModelMatrices;
+    std::vector<AABB> mLocalBounds;
+
+    // Culls Entities hidden behind occluders, for Cameras that use it.
+    OcclusionCuller mOcclusionCuller;
+
+    // The packets to draw for the current Camera, and the runs they're
+    // drawn in.
+    RenderQueue mRenderQueue;
+    std::vector<DrawRun> mDrawRuns;
+
+    // The order each Camera drew its Entities in last frame, which is
+    // used as the starting point for sorting this frame.
+    std::map<Entity, DrawOrder> mDrawOrderMap;
+
+    // The culling gauges of each Camera, removed along with the Camera.
+    std::map<Entity, CameraGauges> mCameraGaugeMap;
+
+    // The per-instance model matrices for the current Camera, and the
+    // OpenGL buffer they're copied into.
+    std::vector<Mat4> mInstanceMatrices;
+    unsigned int mInstanceBuffer { 0 };
+
+    // The vertex arrays the instance matrix attribute is currently enabled
+    // in, while drawing the current Camera's packets.
+    std::vector<unsigned int> mInstancedVertexArrays;
 
     int mFramebufferWidth { 0 };
     int mFramebufferHeight { 0 };
 
+    // Whether the Game is running without a window or OpenGL context.
+    bool mHeadless { false };
+
+    // The uniforms set on every shader.
+    UniformID mModelMatrixUniform { ShaderLoader::GetUniformID("modelMatrix") };
+    UniformID mViewMatrixUniform { ShaderLoader::GetUniformID("viewMatrix") };
+    UniformID mProjectionMatrixUniform { ShaderLoader::GetUniformID("projectionMatrix") };
+
+    Counter& mDrawCalls { Metrics::GetCounter("Renderer.DrawCalls") };
+    Counter& mBufferUploads { Metrics::GetCounter("Renderer.BufferUploads") };
+    Counter& mVisibleMeshes { Metrics::GetCounter("Renderer.VisibleMeshes") };
+    Counter& mCulledMeshes { Metrics::GetCounter("Renderer.CulledMeshes") };
+    Counter& mOccludedMeshes { Metrics::GetCounter("Renderer.OccludedMeshes") };
+    Counter& mCoherentSorts { Metrics::GetCounter("Renderer.CoherentSorts") };
+
     Observer mObserver;
+
+    // The most meshes to move in each geometry buffer per frame while
+    // defragmenting.
+    static const unsigned int MAX_DEFRAGMENT_MOVES = 16;
 };
 
 } // namespace Kuma3D
@@ -1,12 +1,29 @@
 #include "ShaderLoader.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#include "GLState.hpp"
+#include "HitchDetector.hpp"
+#include "Profiler.hpp"
+
 namespace Kuma3D {
 
 std::map<VertexFragmentPair, ID> ShaderLoader::mShaderMap;
+std::map<std::string, UniformID> ShaderLoader::mUniformIDMap;
+std::map<ID, std::vector<int>> ShaderLoader::mUniformLocationMap;
+std::map<ID, std::map<std::string, int>> ShaderLoader::mFoundUniformLocationMap;
+std::map<ID, unsigned int> ShaderLoader::mUniformBlockMaskMap;
+
+/******************************************************************************/
+// The name each UniformBlock is declared with in GLSL.
+const std::map<std::string, UniformBlock> UNIFORM_BLOCK_NAMES
+{
+  { "CameraBlock", UniformBlock::eCAMERA },
+  { "ObjectBlock", UniformBlock::eOBJECT }
+};
 
 /******************************************************************************/
 ID ShaderLoader::LoadShaderFromFiles(const std::string& aVertexFile,
@@ -38,6 +55,9 @@ ID ShaderLoader::LoadShaderFromFiles(const std::string& aVertexFile,
 ID ShaderLoader::LoadShaderFromText(const std::string& aVertexSource,
                                     const std::string& aFragmentSource)
 {
+  KUMA3D_PROFILE_SCOPE("ShaderLoader::LoadShaderFromText");
+  HitchDetector::AddFrameEvent("Shader compile");
+
   // First, compile the shaders.
   ID vertexID, fragmentID;
 
@@ -64,22 +84,113 @@ void ShaderLoader::UnloadShaders()
   }
 
   mShaderMap.clear();
+  mUniformLocationMap.clear();
+  mFoundUniformLocationMap.clear();
+  mUniformBlockMaskMap.clear();
+  GLState::Invalidate();
 }
 
 /******************************************************************************/
 bool ShaderLoader::IsUniformDefined(const ID& aID,
                                     const std::string& aName)
 {
-  return glGetUniformLocation(aID, aName.c_str()) != -1;
+  return FindUniformLocation(aID, aName) != -1;
+}
+
+/******************************************************************************/
+bool ShaderLoader::IsUniformDefined(const ID& aID,
+                                    UniformID aUniform)
+{
+  return GetUniformLocation(aID, aUniform) != -1;
+}
+
+/******************************************************************************/
+bool ShaderLoader::IsUniformBlockDefined(const ID& aID,
+                                         UniformBlock aBlock)
+{
+  auto foundProgram = mUniformBlockMaskMap.find(aID);
+  if(foundProgram == mUniformBlockMaskMap.end())
+  {
+    return false;
+  }
+
+  return (foundProgram->second & (1u << static_cast<unsigned int>(aBlock))) != 0;
+}
+
+/******************************************************************************/
+UniformID ShaderLoader::GetUniformID(const std::string& aName)
+{
+  auto foundUniform = mUniformIDMap.find(aName);
+  if(foundUniform == mUniformIDMap.end())
+  {
+    foundUniform = mUniformIDMap.emplace(aName, mUniformIDMap.size()).first;
+  }
+
+  return foundUniform->second;
+}
+
+/******************************************************************************/
+int ShaderLoader::GetUniformLocation(const ID& aID,
+                                     UniformID aUniform)
+{
+  auto foundProgram = mUniformLocationMap.find(aID);
+  if(foundProgram == mUniformLocationMap.end() ||
+     aUniform >= foundProgram->second.size())
+  {
+    return -1;
+  }
+
+  return foundProgram->second[aUniform];
+}
+
+/******************************************************************************/
+int ShaderLoader::FindUniformLocation(const ID& aID,
+                                      const std::string& aName)
+{
+  // Don't give the name an ID if it doesn't have one already; names used
+  // this way are often built on the fly (such as array elements).
+  auto foundUniform = mUniformIDMap.find(aName);
+  if(foundUniform != mUniformIDMap.end())
+  {
+    auto location = GetUniformLocation(aID, foundUniform->second);
+    if(location != -1)
+    {
+      return location;
+    }
+  }
+
+  // Only the first element of each array is recorded when a program is
+  // linked, so ask OpenGL about any other name, and remember the answer
+  // (even if the program doesn't use it).
+  if(mUniformLocationMap.find(aID) == mUniformLocationMap.end())
+  {
+    return -1;
+  }
+
+  auto& foundLocations = mFoundUniformLocationMap[aID];
+  auto foundLocation = foundLocations.find(aName);
+  if(foundLocation == foundLocations.end())
+  {
+    foundLocation = foundLocations.emplace(aName, glGetUniformLocation(aID, aName.c_str())).first;
+  }
+
+  return foundLocation->second;
+}
+
+/******************************************************************************/
+bool ShaderLoader::IsAttributeDefined(const ID& aID,
+                                      const std::string& aName)
+{
+  return glGetAttribLocation(aID, aName.c_str()) != -1;
 }
 
 /******************************************************************************/
 void ShaderLoader::SetInt(const ID& aID, const std::string& aName, int aValue)
 {
-  int loc = glGetUniformLocation(aID, aName.c_str());
+  int loc = FindUniformLocation(aID, aName);
   if(loc != -1)
   {
-    glUseProgram(aID);
+    GLState::UseProgram(aID);
     glUniform1i(loc, aValue);
   }
   else
@@ -92,10 +203,10 @@ void ShaderLoader::SetInt(const ID& aID, const std::string& aName, int aValue)
 /******************************************************************************/
 void ShaderLoader::SetFloat(const ID& aID, const std::string& aName, float aValue)
 {
-  int loc = glGetUniformLocation(aID, aName.c_str());
+  int loc = FindUniformLocation(aID, aName);
   if(loc != -1)
   {
-    glUseProgram(aID);
+    GLState::UseProgram(aID);
     glUniform1f(loc, aValue);
   }
   else
@@ -108,10 +219,10 @@ void ShaderLoader::SetFloat(const ID& aID, const std::string& aName, float aValu
 /******************************************************************************/
 void ShaderLoader::SetVec3(const ID& aID, const std::string& aName, const Vec3& aVec)
 {
-  int loc = glGetUniformLocation(aID, aName.c_str());
+  int loc = FindUniformLocation(aID, aName);
   if(loc != -1)
   {
-    glUseProgram(aID);
+    GLState::UseProgram(aID);
     glUniform3fv(loc, 1, &aVec.x);
   }
   else
@@ -124,10 +235,10 @@ void ShaderLoader::SetVec3(const ID& aID, const std::string& aName, const Vec3&
 /******************************************************************************/
 void ShaderLoader::SetMat4(const ID& aID, const std::string& aName, const Mat4& aMat)
 {
-  int loc = glGetUniformLocation(aID, aName.c_str());
+  int loc = FindUniformLocation(aID, aName);
   if(loc != -1)
   {
-    glUseProgram(aID);
+    GLState::UseProgram(aID);
     glUniformMatrix4fv(loc, 1, GL_FALSE, &aMat(0, 0));
   }
   else
@@ -137,6 +248,46 @@ void ShaderLoader::SetMat4(const ID& aID, const std::string& aName, const Mat4&
   }
 }
 
+/******************************************************************************/
+void ShaderLoader::SetInt(const ID& aID, UniformID aUniform, int aValue)
+{
+  int loc = GetUniformLocation(aID, aUniform);
+  if(loc != -1)
+  {
+    glUniform1i(loc, aValue);
+  }
+}
+
+/******************************************************************************/
+void ShaderLoader::SetFloat(const ID& aID, UniformID aUniform, float aValue)
+{
+  int loc = GetUniformLocation(aID, aUniform);
+  if(loc != -1)
+  {
+    glUniform1f(loc, aValue);
+  }
+}
+
+/******************************************************************************/
+void ShaderLoader::SetVec3(const ID& aID, UniformID aUniform, const Vec3& aVec)
+{
+  int loc = GetUniformLocation(aID, aUniform);
+  if(loc != -1)
+  {
+    glUniform3fv(loc, 1, &aVec.x);
+  }
+}
+
+/******************************************************************************/
+void ShaderLoader::SetMat4(const ID& aID, UniformID aUniform, const Mat4& aMat)
+{
+  int loc = GetUniformLocation(aID, aUniform);
+  if(loc != -1)
+  {
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &aMat(0, 0));
+  }
+}
+
 /******************************************************************************/
 void ShaderLoader::CompileShader(ID& aShaderID,
                                  const std::string& aShaderSource,
@@ -181,8 +332,98 @@ ID ShaderLoader::CreateProgram(const ID& aVertexID,
     glGetProgramInfoLog(programID, 512, NULL, infoLog);
     std::cout << "Error linking program!\n" << infoLog << std::endl;
   }
+  else
+  {
+    ReflectUniforms(programID);
+    ReflectUniformBlocks(programID);
+  }
 
   return programID;
 }
 
+/******************************************************************************/
+void ShaderLoader::ReflectUniforms(const ID& aProgramID)
+{
+  int numUniforms = 0;
+  int maxNameLength = 0;
+  glGetProgramiv(aProgramID, GL_ACTIVE_UNIFORMS, &numUniforms);
+  glGetProgramiv(aProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+  auto& locations = mUniformLocationMap[aProgramID];
+  locations.clear();
+  mFoundUniformLocationMap.erase(aProgramID);
+
+  std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+  for(int i = 0; i < numUniforms; ++i)
+  {
+    int length = 0;
+    int size = 0;
+    GLenum type;
+    glGetActiveUniform(aProgramID,
+                       i,
+                       static_cast<GLsizei>(nameBuffer.size()),
+                       &length,
+                       &size,
+                       &type,
+                       nameBuffer.data());
+
+    // Arrays are reported by the name of their first element; record
+    // them under their plain name as well.
+    std::string name(nameBuffer.data(), length);
+    int location = glGetUniformLocation(aProgramID, name.c_str());
+    if(location == -1)
+    {
+      continue;
+    }
+
+    std::vector<std::string> names { name };
+    auto arraySuffix = name.rfind("[0]");
+    if(arraySuffix != std::string::npos && arraySuffix + 3 == name.size())
+    {
+      names.emplace_back(name.substr(0, arraySuffix));
+    }
+
+    for(const auto& uniformName : names)
+    {
+      auto uniform = GetUniformID(uniformName);
+      if(uniform >= locations.size())
+      {
+        locations.resize(uniform + 1, -1);
+      }
+      locations[uniform] = location;
+    }
+  }
+}
+
+/******************************************************************************/
+void ShaderLoader::ReflectUniformBlocks(const ID& aProgramID)
+{
+  int numBlocks = 0;
+  int maxNameLength = 0;
+  glGetProgramiv(aProgramID, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+  glGetProgramiv(aProgramID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+
+  auto& mask = mUniformBlockMaskMap[aProgramID];
+  mask = 0;
+
+  std::vector<char> nameBuffer(std::max(maxNameLength, 1));
+  for(int i = 0; i < numBlocks; ++i)
+  {
+    int length = 0;
+    glGetActiveUniformBlockName(aProgramID,
+                                i,
+                                static_cast<GLsizei>(nameBuffer.size()),
+                                &length,
+                                nameBuffer.data());
+
+    auto foundBlock = UNIFORM_BLOCK_NAMES.find(std::string(nameBuffer.data(), length));
+    if(foundBlock != UNIFORM_BLOCK_NAMES.end())
+    {
+      auto bindingPoint = static_cast<unsigned int>(foundBlock->second);
+      glUniformBlockBinding(aProgramID, i, bindingPoint);
+      mask |= (1u << bindingPoint);
+    }
+  }
+}
+
 } // namespace Kuma3D
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -15,8 +16,39 @@ namespace Kuma3D {
 
 using VertexFragmentPair = std::pair<std::string, std::string>;
 
+// Identifies a uniform by name across all shader programs.
+using UniformID = unsigned int;
+
+/**
+ * Represents each uniform block the engine fills in. A shader uses one by
+ * declaring a block with the matching name and layout, for example:
+ *
+ *   layout (std140) uniform CameraBlock
+ *   {
+ *     mat4 viewMatrix;
+ *     mat4 projectionMatrix;
+ *   };
+ *
+ *   layout (std140) uniform ObjectBlock
+ *   {
+ *     mat4 modelMatrix;
+ *   };
+ *
+ * Each block is always bound to the binding point equal to its value.
+ */
+enum class UniformBlock
+{
+  eCAMERA,
+  eOBJECT
+};
+
 /**
  * A static class that handles loading and manipulating GLSL shaders.
+ *
+ * When a program is linked, the location of each of its active uniforms is
+ * recorded in a table indexed by UniformID, so uniforms can be looked up and
+ * set without querying OpenGL. Retrieve a UniformID once with GetUniformID()
+ * and reuse it for every program and every draw.
  */
 class ShaderLoader
 {
@@ -60,6 +92,57 @@ class ShaderLoader
     static bool IsUniformDefined(const ID& aID,
                                  const std::string& aName);
 
+    /**
+     * Returns whether a uniform exists in the given shader.
+     *
+     * @param aID The ID of the shader to check.
+     * @param aUniform The ID of the uniform to check.
+     * @return True if the uniform exists, false otherwise.
+     */
+    static bool IsUniformDefined(const ID& aID,
+                                 UniformID aUniform);
+
+    /**
+     * Returns whether a uniform block is used by the given shader.
+     *
+     * @param aID The ID of the shader to check.
+     * @param aBlock The uniform block to check.
+     * @return True if the block is used, false otherwise.
+     */
+    static bool IsUniformBlockDefined(const ID& aID,
+                                      UniformBlock aBlock);
+
+    /**
+     * Returns the ID for a uniform name. The same name always gets the same
+     * ID, regardless of which shaders it appears in.
+     *
+     * @param aName The name of the uniform.
+     * @return The ID of the uniform.
+     */
+    static UniformID GetUniformID(const std::string& aName);
+
+    /**
+     * Returns the location of a uniform in the given shader, as recorded
+     * when the shader was linked.
+     *
+     * @param aID The ID of the shader.
+     * @param aUniform The ID of the uniform.
+     * @return The location of the uniform, or -1 if it doesn't exist.
+     */
+    static int GetUniformLocation(const ID& aID,
+                                  UniformID aUniform);
+
+    /**
+     * Returns whether a vertex attribute exists (and is used) in the
+     * given shader.
+     *
+     * @param aID The ID of the shader to check.
+     * @param aName The name of the attribute to check.
+     * @return True if the attribute exists, false otherwise.
+     */
+    static bool IsAttributeDefined(const ID& aID,
+                                   const std::string& aName);
+
     /**
      * Sets an integer uniform on this shader.
      *
@@ -104,6 +187,54 @@ class ShaderLoader
                         const std::string& aName,
                         const Mat4& aValue);
 
+    /**
+     * Sets an integer uniform on this shader, which must be the currently
+     * bound program. Does nothing if the uniform doesn't exist.
+     *
+     * @param aID The ID of the shader to change.
+     * @param aUniform The ID of the uniform to set.
+     * @param aValue The value to set the uniform to.
+     */
+    static void SetInt(const ID& aID,
+                       UniformID aUniform,
+                       int aValue);
+
+    /**
+     * Sets a float uniform on this shader, which must be the currently
+     * bound program. Does nothing if the uniform doesn't exist.
+     *
+     * @param aID The ID of the shader to change.
+     * @param aUniform The ID of the uniform to set.
+     * @param aValue The value to set the uniform to.
+     */
+    static void SetFloat(const ID& aID,
+                         UniformID aUniform,
+                         float aValue);
+
+    /**
+     * Sets a Vec3 uniform on this shader, which must be the currently
+     * bound program. Does nothing if the uniform doesn't exist.
+     *
+     * @param aID The ID of the shader to change.
+     * @param aUniform The ID of the uniform to set.
+     * @param aValue The value to set the uniform to.
+     */
+    static void SetVec3(const ID& aID,
+                        UniformID aUniform,
+                        const Vec3& aValue);
+
+    /**
+     * Sets a Mat4 uniform on this shader, which must be the currently
+     * bound program. Does nothing if the uniform doesn't exist.
+     *
+     * @param aID The ID of the shader to change.
+     * @param aUniform The ID of the uniform to set.
+     * @param aValue The value to set the uniform to.
+     */
+    static void SetMat4(const ID& aID,
+                        UniformID aUniform,
+                        const Mat4& aValue);
+
   private:
 
     /**
@@ -130,7 +261,50 @@ class ShaderLoader
     static ID CreateProgram(const ID& aVertexID,
                             const ID& aFragmentID);
 
+    /**
+     * Returns the location of a uniform in the given shader. Uniforms that
+     * weren't recorded when the shader was linked (such as array elements
+     * other than the first) are looked up in OpenGL once per shader, and
+     * the result is recorded, even if the uniform doesn't exist.
+     *
+     * @param aID The ID of the shader.
+     * @param aName The name of the uniform.
+     * @return The location of the uniform, or -1 if it doesn't exist.
+     */
+    static int FindUniformLocation(const ID& aID,
+                                   const std::string& aName);
+
+    /**
+     * Records the location of each active uniform in a linked program.
+     *
+     * @param aProgramID The ID of the shader program.
+     */
+    static void ReflectUniforms(const ID& aProgramID);
+
+    /**
+     * Assigns each engine uniform block in a linked program to its binding
+     * point.
+     *
+     * @param aProgramID The ID of the shader program.
+     */
+    static void ReflectUniformBlocks(const ID& aProgramID);
+
     static std::map<VertexFragmentPair, ID> mShaderMap;
+
+    // Maps each uniform name to its ID.
+    static std::map<std::string, UniformID> mUniformIDMap;
+
+    // For each shader program, the location of each uniform (indexed by
+    // UniformID), or -1 if the program doesn't use it.
+    static std::map<ID, std::vector<int>> mUniformLocationMap;
+
+    // For each shader program, the location of each uniform that was looked
+    // up by name in OpenGL, or -1 if the program doesn't use it.
+    static std::map<ID, std::map<std::string, int>> mFoundUniformLocationMap;
+
+    // For each shader program, a mask of the uniform blocks it uses (one
+    // bit per UniformBlock).
+    static std::map<ID, unsigned int> mUniformBlockMaskMap;
 };
 
 } // namespace Kuma3D
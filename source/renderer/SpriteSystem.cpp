@@ -156,6 +156,7 @@ void SpriteSystem::UpdateMeshToDisplaySprite(Mesh& aMesh, const Sprite& aSprite)
   aMesh.mTextures.emplace_back(aSprite.mSpritesheetTextureID);
 
   aMesh.mHasTransparency = true;
+  aMesh.mUsage = MeshUsage::eDYNAMIC;
   aMesh.mDirty = true;
 }
 
@@ -0,0 +1,130 @@
+#include "StreamBuffer.hpp"
+
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "GLState.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+StreamBuffer::StreamBuffer(std::size_t aNumSegments)
+  : mRing(aNumSegments)
+{
+}
+
+/******************************************************************************/
+void StreamBuffer::BeginFrame()
+{
+  mVertices.clear();
+  mIndices.clear();
+  mRanges.clear();
+
+  mRing.BeginFrame();
+}
+
+/******************************************************************************/
+std::size_t StreamBuffer::Add(const std::vector<MeshVertex>& aVertices,
+                              const std::vector<unsigned int>& aIndices)
+{
+  MeshRange range;
+  range.mBaseVertex = static_cast<int>(mVertices.size());
+  range.mFirstIndex = mIndices.size();
+  range.mIndexCount = aIndices.size();
+  mRanges.emplace_back(range);
+
+  mVertices.insert(mVertices.end(), aVertices.begin(), aVertices.end());
+  mIndices.insert(mIndices.end(), aIndices.begin(), aIndices.end());
+
+  return mRanges.size() - 1;
+}
+
+/******************************************************************************/
+void StreamBuffer::Upload()
+{
+  if(mVertices.empty() || mIndices.empty())
+  {
+    return;
+  }
+
+  if(mVertexArray == 0)
+  {
+    mRing.Create(2);
+    Grow(mVertices.size(), mIndices.size());
+
+    // The buffers are only ever orphaned, never replaced, so the vertex
+    // array only needs to be set up once.
+    glGenVertexArrays(1, &mVertexArray);
+    GLState::BindVertexArray(mVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mRing.GetBuffer(0));
+    MeshLoader::ConfigureVertexAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mRing.GetBuffer(1));
+    GLState::BindVertexArray(0);
+  }
+  else if(mVertices.size() > mVertexCapacity || mIndices.size() > mIndexCapacity)
+  {
+    Grow(mVertices.size(), mIndices.size());
+  }
+
+  mRing.Write(0, 0, mVertices.size() * sizeof(MeshVertex), mVertices.data());
+  mRing.Write(1, 0, mIndices.size() * sizeof(unsigned int), mIndices.data());
+}
+
+/******************************************************************************/
+MeshRange StreamBuffer::GetRange(std::size_t aIndex) const
+{
+  auto range = mRanges.at(aIndex);
+  range.mVertexArray = mVertexArray;
+  range.mBaseVertex += static_cast<int>(mRing.GetSegment() * mVertexCapacity);
+  range.mFirstIndex += mRing.GetSegment() * mIndexCapacity;
+  return range;
+}
+
+/******************************************************************************/
+void StreamBuffer::EndFrame()
+{
+  if(!mRanges.empty())
+  {
+    mRing.EndFrame();
+  }
+}
+
+/******************************************************************************/
+void StreamBuffer::Unload()
+{
+  mRing.Unload();
+
+  if(mVertexArray != 0)
+  {
+    glDeleteVertexArrays(1, &mVertexArray);
+    GLState::Invalidate();
+    mVertexArray = 0;
+  }
+
+  mVertexCapacity = 0;
+  mIndexCapacity = 0;
+}
+
+/******************************************************************************/
+void StreamBuffer::Grow(std::size_t aVertexCapacity, std::size_t aIndexCapacity)
+{
+  // Double the capacities until they're large enough, to keep the number
+  // of reallocations low.
+  mVertexCapacity = std::max<std::size_t>(mVertexCapacity, 1024);
+  while(mVertexCapacity < aVertexCapacity)
+  {
+    mVertexCapacity *= 2;
+  }
+
+  mIndexCapacity = std::max<std::size_t>(mIndexCapacity, 4096);
+  while(mIndexCapacity < aIndexCapacity)
+  {
+    mIndexCapacity *= 2;
+  }
+
+  mRing.Resize(0, mVertexCapacity * sizeof(MeshVertex));
+  mRing.Resize(1, mIndexCapacity * sizeof(unsigned int));
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,105 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "FencedBufferRing.hpp"
+#include "Mesh.hpp"
+#include "MeshLoader.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A ring of OpenGL buffers for geometry that is rebuilt every frame, such
+ * as animated sprites and text.
+ *
+ * The vertex and index buffers are kept in a FencedBufferRing. Each frame,
+ * geometry is gathered with Add() and written into the next segment with a
+ * single Upload(), after which GetRange() says where it can be drawn from.
+ *
+ * All functions except Add() require an OpenGL context.
+ */
+class StreamBuffer
+{
+  public:
+
+    /**
+     * Creates an empty stream buffer. No OpenGL objects are created until
+     * the first Upload().
+     *
+     * @param aNumSegments The number of frames that can be in flight.
+     */
+    explicit StreamBuffer(std::size_t aNumSegments = 3);
+
+    /**
+     * Moves to the next segment of the ring, waiting for the GPU to finish
+     * with it if necessary, and discards any geometry added last frame.
+     */
+    void BeginFrame();
+
+    /**
+     * Adds geometry to be uploaded this frame.
+     *
+     * @param aVertices The vertices of the geometry.
+     * @param aIndices The indices of the geometry.
+     * @return An index to retrieve the geometry's location with.
+     */
+    std::size_t Add(const std::vector<MeshVertex>& aVertices,
+                    const std::vector<unsigned int>& aIndices);
+
+    /**
+     * Writes all geometry added this frame into the current segment,
+     * growing the buffers if they're too small.
+     */
+    void Upload();
+
+    /**
+     * Returns where geometry added this frame was uploaded to.
+     *
+     * @param aIndex The index returned by Add().
+     * @return The location of the geometry.
+     */
+    MeshRange GetRange(std::size_t aIndex) const;
+
+    /**
+     * Marks the end of the GPU's use of the current segment. This should be
+     * called once all draw calls that use this frame's geometry have been
+     * made.
+     */
+    void EndFrame();
+
+    /**
+     * Deletes all OpenGL objects.
+     */
+    void Unload();
+
+  private:
+
+    /**
+     * Replaces the buffers with larger ones, restarting the ring.
+     *
+     * @param aVertexCapacity The minimum number of vertices per segment.
+     * @param aIndexCapacity The minimum number of indices per segment.
+     */
+    void Grow(std::size_t aVertexCapacity, std::size_t aIndexCapacity);
+
+    // The geometry added this frame, and the location of each piece of
+    // geometry relative to the start of the segment.
+    std::vector<MeshVertex> mVertices;
+    std::vector<unsigned int> mIndices;
+    std::vector<MeshRange> mRanges;
+
+    // The vertex buffer followed by the element buffer.
+    FencedBufferRing mRing;
+
+    // The number of vertices and indices that fit in each segment.
+    std::size_t mVertexCapacity { 0 };
+    std::size_t mIndexCapacity { 0 };
+
+    unsigned int mVertexArray { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
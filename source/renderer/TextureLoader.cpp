@@ -8,10 +8,16 @@
 #include <sstream>
 #include <stdexcept>
 
+#include "GLState.hpp"
+#include "HitchDetector.hpp"
+#include "Metrics.hpp"
+#include "Profiler.hpp"
+
 namespace Kuma3D {
 
 std::map<std::string, ID> TextureLoader::mTextureMap;
 std::map<ID, TextureDimensions> TextureLoader::mTextureDimensionMap;
+std::map<ID, std::size_t> TextureLoader::mTextureSizeMap;
 
 /*****************************************************************************/
 ID TextureLoader::LoadTextureFromFile(const std::string& aFilePath,
@@ -19,10 +25,13 @@ ID TextureLoader::LoadTextureFromFile(const std::string& aFilePath,
                                       TextureWrapOption aWrapOption,
                                       TextureFilterOption aFilterOption)
 {
+  KUMA3D_PROFILE_SCOPE("TextureLoader::LoadTextureFromFile");
+
   // Only load the texture if it hasn't already been loaded.
   auto foundTexture = mTextureMap.find(aFilePath);
   if(foundTexture == mTextureMap.end())
   {
+    HitchDetector::AddFrameEvent("Texture load: " + aFilePath);
     stbi_set_flip_vertically_on_load(true);
 
     int width, height, channels;
@@ -53,16 +62,19 @@ ID TextureLoader::LoadTextureFromData(unsigned char* aData,
                                       TextureWrapOption aWrapOption,
                                       TextureFilterOption aFilterOption)
 {
+  KUMA3D_PROFILE_SCOPE("TextureLoader::LoadTextureFromData");
+
   // Generate an OpenGL texture.
   ID textureID = 0;
   glGenTextures(1, &textureID);
 
   GLint loadFormat, wrapOption, filterOption;
+  std::size_t channels = 0;
   switch(aFormat)
   {
-    case TextureStorageFormat::eR: { loadFormat = GL_RED; break; }
-    case TextureStorageFormat::eRGB: { loadFormat = GL_RGB; break; }
-    case TextureStorageFormat::eRGBA: { loadFormat = GL_RGBA; break; }
+    case TextureStorageFormat::eR: { loadFormat = GL_RED; channels = 1; break; }
+    case TextureStorageFormat::eRGB: { loadFormat = GL_RGB; channels = 3; break; }
+    case TextureStorageFormat::eRGBA: { loadFormat = GL_RGBA; channels = 4; break; }
   }
 
   switch(aWrapOption)
@@ -80,7 +92,7 @@ ID TextureLoader::LoadTextureFromData(unsigned char* aData,
   }
 
   // Set default texture wrapping and filtering options.
-  glBindTexture(GL_TEXTURE_2D, textureID);
+  GLState::BindTextureForEdit(textureID);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapOption);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapOption);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterOption);
@@ -104,6 +116,11 @@ ID TextureLoader::LoadTextureFromData(unsigned char* aData,
   TextureDimensions dimensions(aWidth, aHeight);
   mTextureDimensionMap.emplace(textureID, dimensions);
 
+  // Store the texture size; the mipmap adds roughly another third.
+  std::size_t size = (static_cast<std::size_t>(aWidth) * aHeight * channels * 4) / 3;
+  mTextureSizeMap.emplace(textureID, size);
+  Metrics::GetGauge("Renderer.TextureBytes").Add(size);
+
   return textureID;
 }
 
@@ -117,7 +134,7 @@ void TextureLoader::AddSubImageData(const ID& aID,
                                     TextureStorageFormat aFormat)
 {
   // Bind texture for use.
-  glBindTexture(GL_TEXTURE_2D, aID);
+  GLState::BindTextureForEdit(aID);
 
   GLint loadFormat;
   switch(aFormat)
@@ -156,15 +173,48 @@ TextureDimensions TextureLoader::GetTextureDimensions(const ID& aID)
   return mTextureDimensionMap[aID];
 }
 
+/*****************************************************************************/
+void TextureLoader::UnloadTexture(const ID& aID)
+{
+  auto foundSize = mTextureSizeMap.find(aID);
+  if(foundSize == mTextureSizeMap.end())
+  {
+    return;
+  }
+
+  glDeleteTextures(1, &aID);
+  Metrics::GetGauge("Renderer.TextureBytes").Add(-static_cast<double>(foundSize->second));
+  mTextureSizeMap.erase(foundSize);
+  mTextureDimensionMap.erase(aID);
+
+  for(auto it = mTextureMap.begin(); it != mTextureMap.end(); ++it)
+  {
+    if(it->second == aID)
+    {
+      mTextureMap.erase(it);
+      break;
+    }
+  }
+
+  GLState::Invalidate();
+}
+
 /*****************************************************************************/
 void TextureLoader::UnloadTextures()
 {
-  for(const auto& texturePair : mTextureMap)
+  // Every texture has an entry in the size map, including those that were
+  // loaded from data rather than from a file.
+  auto& textureBytes = Metrics::GetGauge("Renderer.TextureBytes");
+  for(const auto& sizePair : mTextureSizeMap)
   {
-    glDeleteTextures(1, &texturePair.second);
+    glDeleteTextures(1, &sizePair.first);
+    textureBytes.Add(-static_cast<double>(sizePair.second));
   }
 
+  mTextureSizeMap.clear();
+  mTextureDimensionMap.clear();
   mTextureMap.clear();
+  GLState::Invalidate();
 }
 
 } // namespace Kuma3D
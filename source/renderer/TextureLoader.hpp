@@ -122,8 +122,17 @@ class TextureLoader
     static TextureDimensions GetTextureDimensions(const ID& aID);
 
     /**
-     * Unloads all OpenGL textures. If you load any textures, be sure
-     * to call this before the program terminates to avoid memory leaks.
+     * Unloads a single OpenGL texture created by this class. If no such
+     * texture is loaded, this function does nothing.
+     *
+     * @param aID The ID of the texture.
+     */
+    static void UnloadTexture(const ID& aID);
+
+    /**
+     * Unloads all OpenGL textures, whether they were loaded from a file or
+     * from data. If you load any textures, be sure to call this before the
+     * program terminates to avoid memory leaks.
      */
     static void UnloadTextures();
 
@@ -134,6 +143,9 @@ class TextureLoader
 
     // Maps texture IDs to width and height values.
     static std::map<ID, TextureDimensions> mTextureDimensionMap;
+
+    // Maps texture IDs to the (estimated) memory used by each texture.
+    static std::map<ID, std::size_t> mTextureSizeMap;
 };
 
 } // namespace Kuma3D
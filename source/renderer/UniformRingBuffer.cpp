@@ -0,0 +1,112 @@
+#include "UniformRingBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <GL/glew.h>
+
+namespace Kuma3D {
+
+/******************************************************************************/
+UniformRingBuffer::UniformRingBuffer(std::size_t aNumSegments)
+  : mRing(aNumSegments)
+{
+}
+
+/******************************************************************************/
+void UniformRingBuffer::BeginFrame()
+{
+  mData.clear();
+  mUploadedSize = 0;
+
+  mRing.BeginFrame();
+}
+
+/******************************************************************************/
+std::size_t UniformRingBuffer::Add(const void* aData, std::size_t aSize)
+{
+  if(mAlignment == 0)
+  {
+    int alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    mAlignment = std::max(alignment, 1);
+  }
+
+  auto offset = ((mData.size() + mAlignment - 1) / mAlignment) * mAlignment;
+  mData.resize(offset + aSize);
+  std::memcpy(mData.data() + offset, aData, aSize);
+
+  return offset;
+}
+
+/******************************************************************************/
+void UniformRingBuffer::Upload()
+{
+  if(mData.size() == mUploadedSize)
+  {
+    return;
+  }
+
+  if(!mRing.IsCreated())
+  {
+    mRing.Create(1);
+    Grow(mData.size());
+  }
+  else if(mData.size() > mCapacity)
+  {
+    // The new storage doesn't have anything uploaded earlier this frame.
+    Grow(mData.size());
+    mUploadedSize = 0;
+  }
+
+  mRing.Write(0,
+              mUploadedSize,
+              mData.size() - mUploadedSize,
+              mData.data() + mUploadedSize);
+  mUploadedSize = mData.size();
+}
+
+/******************************************************************************/
+void UniformRingBuffer::Bind(unsigned int aBindingPoint,
+                             std::size_t aOffset,
+                             std::size_t aSize)
+{
+  glBindBufferRange(GL_UNIFORM_BUFFER,
+                    aBindingPoint,
+                    mRing.GetBuffer(0),
+                    (mRing.GetSegment() * mCapacity) + aOffset,
+                    aSize);
+}
+
+/******************************************************************************/
+void UniformRingBuffer::EndFrame()
+{
+  if(!mData.empty())
+  {
+    mRing.EndFrame();
+  }
+}
+
+/******************************************************************************/
+void UniformRingBuffer::Unload()
+{
+  mRing.Unload();
+  mCapacity = 0;
+}
+
+/******************************************************************************/
+void UniformRingBuffer::Grow(std::size_t aCapacity)
+{
+  // Double the capacity until it's large enough; each segment must also
+  // start at an aligned offset.
+  mCapacity = std::max<std::size_t>(mCapacity, 16384);
+  while(mCapacity < aCapacity)
+  {
+    mCapacity *= 2;
+  }
+  mCapacity = ((mCapacity + mAlignment - 1) / mAlignment) * mAlignment;
+
+  mRing.Resize(0, mCapacity);
+}
+
+} // namespace Kuma3D
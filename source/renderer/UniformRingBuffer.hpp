@@ -0,0 +1,100 @@
+#ifndef UNIFORMRINGBUFFER_HPP
+#define UNIFORMRINGBUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "FencedBufferRing.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A ring of OpenGL uniform buffer storage for uniform block data that is
+ * rebuilt every frame, such as camera matrices and per-object constants.
+ *
+ * The buffer is kept in a FencedBufferRing, like the StreamBuffer's. Blocks
+ * are gathered with Add(), written with a single Upload(), and bound to a
+ * binding point with Bind() before drawing.
+ *
+ * All functions require an OpenGL context.
+ */
+class UniformRingBuffer
+{
+  public:
+
+    /**
+     * Creates an empty uniform buffer. No OpenGL objects are created until
+     * the first Upload().
+     *
+     * @param aNumSegments The number of frames that can be in flight.
+     */
+    explicit UniformRingBuffer(std::size_t aNumSegments = 3);
+
+    /**
+     * Moves to the next segment of the ring, waiting for the GPU to finish
+     * with it if necessary, and discards any blocks added last frame.
+     */
+    void BeginFrame();
+
+    /**
+     * Adds a block to be uploaded this frame.
+     *
+     * @param aData The contents of the block.
+     * @param aSize The size of the block, in bytes.
+     * @return The offset of the block, to pass to Bind().
+     */
+    std::size_t Add(const void* aData, std::size_t aSize);
+
+    /**
+     * Writes every block added since the last Upload() into the current
+     * segment, growing the buffer if it's too small.
+     */
+    void Upload();
+
+    /**
+     * Binds an uploaded block to a uniform block binding point.
+     *
+     * @param aBindingPoint The binding point to bind to.
+     * @param aOffset The offset returned by Add().
+     * @param aSize The size of the block, in bytes.
+     */
+    void Bind(unsigned int aBindingPoint, std::size_t aOffset, std::size_t aSize);
+
+    /**
+     * Marks the end of the GPU's use of the current segment. This should be
+     * called once all draw calls that use this frame's blocks have been
+     * made.
+     */
+    void EndFrame();
+
+    /**
+     * Deletes all OpenGL objects.
+     */
+    void Unload();
+
+  private:
+
+    /**
+     * Replaces the buffer with a larger one, restarting the ring.
+     *
+     * @param aCapacity The minimum number of bytes per segment.
+     */
+    void Grow(std::size_t aCapacity);
+
+    // The blocks added this frame, each starting at a multiple of
+    // mAlignment, and how many bytes of them have been uploaded.
+    std::vector<unsigned char> mData;
+    std::size_t mUploadedSize { 0 };
+
+    FencedBufferRing mRing;
+
+    // The number of bytes in each segment.
+    std::size_t mCapacity { 0 };
+
+    // The alignment OpenGL requires for offsets passed to Bind().
+    std::size_t mAlignment { 0 };
+};
+
+} // namespace Kuma3D
+
+#endif
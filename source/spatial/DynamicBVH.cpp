@@ -0,0 +1,412 @@
+#include "DynamicBVH.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Kuma3D {
+
+/******************************************************************************/
+int DynamicBVH::CreateProxy(const AABB& aBox, Entity aEntity)
+{
+  auto leaf = AllocateNode();
+  auto& node = mNodes[leaf];
+  node.mBox = aBox;
+  node.mFatBox.mMin = Vec3(aBox.mMin.x - FAT_MARGIN, aBox.mMin.y - FAT_MARGIN, aBox.mMin.z - FAT_MARGIN);
+  node.mFatBox.mMax = Vec3(aBox.mMax.x + FAT_MARGIN, aBox.mMax.y + FAT_MARGIN, aBox.mMax.z + FAT_MARGIN);
+  node.mEntity = aEntity;
+
+  InsertLeaf(leaf);
+  ++mNumProxies;
+  return leaf;
+}
+
+/******************************************************************************/
+void DynamicBVH::DestroyProxy(int aProxy)
+{
+  if(aProxy < 0 || aProxy >= static_cast<int>(mNodes.size()) ||
+     !mNodes[aProxy].IsLeaf() || mNodes[aProxy].mHeight < 0)
+  {
+    throw std::invalid_argument("Invalid proxy ID!");
+  }
+
+  RemoveLeaf(aProxy);
+  FreeNode(aProxy);
+  --mNumProxies;
+}
+
+/******************************************************************************/
+bool DynamicBVH::MoveProxy(int aProxy, const AABB& aBox)
+{
+  auto& node = mNodes[aProxy];
+  node.mBox = aBox;
+  if(Contains(node.mFatBox, aBox))
+  {
+    return false;
+  }
+
+  RemoveLeaf(aProxy);
+  node.mFatBox.mMin = Vec3(aBox.mMin.x - FAT_MARGIN, aBox.mMin.y - FAT_MARGIN, aBox.mMin.z - FAT_MARGIN);
+  node.mFatBox.mMax = Vec3(aBox.mMax.x + FAT_MARGIN, aBox.mMax.y + FAT_MARGIN, aBox.mMax.z + FAT_MARGIN);
+  InsertLeaf(aProxy);
+  return true;
+}
+
+/******************************************************************************/
+void DynamicBVH::Rebuild()
+{
+  // Collect the leaves and free every other node.
+  std::vector<int> leaves;
+  leaves.reserve(mNumProxies);
+  for(std::size_t i = 0; i < mNodes.size(); ++i)
+  {
+    auto& node = mNodes[i];
+    if(node.mHeight < 0)
+    {
+      continue;
+    }
+
+    if(node.IsLeaf())
+    {
+      node.mParent = NULL_NODE;
+      leaves.emplace_back(static_cast<int>(i));
+    }
+    else
+    {
+      FreeNode(static_cast<int>(i));
+    }
+  }
+
+  mRoot = leaves.empty() ? NULL_NODE : BuildSubtree(leaves, 0, leaves.size());
+}
+
+/******************************************************************************/
+void DynamicBVH::Query(const AABB& aBox, std::vector<Entity>& aEntities) const
+{
+  Traverse([&aBox](const AABB& aNodeBox)
+  {
+    return Intersects(aBox, aNodeBox);
+  }, aEntities);
+}
+
+/******************************************************************************/
+void DynamicBVH::Query(const Sphere& aSphere, std::vector<Entity>& aEntities) const
+{
+  Traverse([&aSphere](const AABB& aNodeBox)
+  {
+    return Intersects(aSphere, aNodeBox);
+  }, aEntities);
+}
+
+/******************************************************************************/
+void DynamicBVH::Query(const Frustum& aFrustum, std::vector<Entity>& aEntities) const
+{
+  Traverse([&aFrustum](const AABB& aNodeBox)
+  {
+    return Intersects(aFrustum, aNodeBox);
+  }, aEntities);
+}
+
+/******************************************************************************/
+void DynamicBVH::Raycast(const Ray& aRay,
+                         float aMaxDistance,
+                         const std::function<float(Entity, float, float)>& aTest) const
+{
+  if(mRoot == NULL_NODE)
+  {
+    return;
+  }
+
+  // Visit the nearer child of each node first, so that the farther one can
+  // often be skipped.
+  std::vector<int> stack { mRoot };
+  while(!stack.empty())
+  {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float distance;
+    if(node.IsLeaf())
+    {
+      if(Intersects(aRay, node.mBox, aMaxDistance, distance))
+      {
+        aMaxDistance = aTest(node.mEntity, distance, aMaxDistance);
+      }
+      continue;
+    }
+
+    if(!Intersects(aRay, node.mFatBox, aMaxDistance, distance))
+    {
+      continue;
+    }
+
+    float childDistances[2] { 0.0f, 0.0f };
+    for(int c = 0; c < 2; ++c)
+    {
+      Intersects(aRay, mNodes[node.mChildren[c]].mFatBox, aMaxDistance, childDistances[c]);
+    }
+
+    auto nearer = childDistances[0] < childDistances[1] ? 0 : 1;
+    stack.emplace_back(node.mChildren[1 - nearer]);
+    stack.emplace_back(node.mChildren[nearer]);
+  }
+}
+
+/******************************************************************************/
+void DynamicBVH::Raycast(RayPacket& aPacket,
+                         const std::function<void(Entity, int, const Float4&)>& aTest) const
+{
+  if(mRoot == NULL_NODE)
+  {
+    return;
+  }
+
+  // Each node is visited if any ray in the packet hits it.
+  std::vector<int> stack { mRoot };
+  while(!stack.empty())
+  {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    Float4 distance;
+    if(node.IsLeaf())
+    {
+      auto mask = IntersectBox(aPacket, node.mBox, distance);
+      if(mask != 0)
+      {
+        aTest(node.mEntity, mask, distance);
+      }
+    }
+    else if(IntersectBox(aPacket, node.mFatBox, distance) != 0)
+    {
+      stack.emplace_back(node.mChildren[0]);
+      stack.emplace_back(node.mChildren[1]);
+    }
+  }
+}
+
+/******************************************************************************/
+int DynamicBVH::GetHeight() const
+{
+  return mRoot == NULL_NODE ? -1 : mNodes[mRoot].mHeight;
+}
+
+/******************************************************************************/
+int DynamicBVH::AllocateNode()
+{
+  if(mFreeList == NULL_NODE)
+  {
+    mNodes.emplace_back();
+    return static_cast<int>(mNodes.size() - 1);
+  }
+
+  auto index = mFreeList;
+  mFreeList = mNodes[index].mNextFree;
+  mNodes[index] = Node();
+  return index;
+}
+
+/******************************************************************************/
+void DynamicBVH::FreeNode(int aNode)
+{
+  // Free nodes are marked with a negative height.
+  auto& node = mNodes[aNode];
+  node.mHeight = -1;
+  node.mChildren[0] = NULL_NODE;
+  node.mChildren[1] = NULL_NODE;
+  node.mNextFree = mFreeList;
+  mFreeList = aNode;
+}
+
+/******************************************************************************/
+void DynamicBVH::InsertLeaf(int aLeaf)
+{
+  if(mRoot == NULL_NODE)
+  {
+    mRoot = aLeaf;
+    mNodes[aLeaf].mParent = NULL_NODE;
+    return;
+  }
+
+  // Descend the tree, stopping when making a new parent for the current
+  // node costs less than descending into either child. The cost of a node
+  // is its surface area, and every node above a leaf grows to contain it.
+  auto box = mNodes[aLeaf].mFatBox;
+  auto index = mRoot;
+  while(!mNodes[index].IsLeaf())
+  {
+    const auto& node = mNodes[index];
+    auto area = GetSurfaceArea(node.mFatBox);
+    auto combinedArea = GetSurfaceArea(Merge(node.mFatBox, box));
+
+    auto cost = 2.0f * combinedArea;
+    auto inheritanceCost = 2.0f * (combinedArea - area);
+
+    float childCosts[2];
+    for(int c = 0; c < 2; ++c)
+    {
+      const auto& child = mNodes[node.mChildren[c]];
+      auto mergedArea = GetSurfaceArea(Merge(child.mFatBox, box));
+      childCosts[c] = child.IsLeaf() ? mergedArea + inheritanceCost
+                                     : mergedArea - GetSurfaceArea(child.mFatBox) + inheritanceCost;
+    }
+
+    if(cost < childCosts[0] && cost < childCosts[1])
+    {
+      break;
+    }
+
+    index = childCosts[0] < childCosts[1] ? node.mChildren[0] : node.mChildren[1];
+  }
+
+  // Replace the sibling with a new parent of both it and the leaf.
+  auto sibling = index;
+  auto oldParent = mNodes[sibling].mParent;
+  auto newParent = AllocateNode();
+  mNodes[newParent].mParent = oldParent;
+  mNodes[newParent].mChildren[0] = sibling;
+  mNodes[newParent].mChildren[1] = aLeaf;
+  mNodes[sibling].mParent = newParent;
+  mNodes[aLeaf].mParent = newParent;
+
+  if(oldParent == NULL_NODE)
+  {
+    mRoot = newParent;
+  }
+  else
+  {
+    auto& parent = mNodes[oldParent];
+    parent.mChildren[parent.mChildren[0] == sibling ? 0 : 1] = newParent;
+  }
+
+  Refit(newParent);
+}
+
+/******************************************************************************/
+void DynamicBVH::RemoveLeaf(int aLeaf)
+{
+  if(aLeaf == mRoot)
+  {
+    mRoot = NULL_NODE;
+    return;
+  }
+
+  // Replace the leaf's parent with its sibling.
+  auto parent = mNodes[aLeaf].mParent;
+  auto grandparent = mNodes[parent].mParent;
+  auto sibling = mNodes[parent].mChildren[mNodes[parent].mChildren[0] == aLeaf ? 1 : 0];
+
+  mNodes[sibling].mParent = grandparent;
+  if(grandparent == NULL_NODE)
+  {
+    mRoot = sibling;
+  }
+  else
+  {
+    auto& node = mNodes[grandparent];
+    node.mChildren[node.mChildren[0] == parent ? 0 : 1] = sibling;
+    Refit(grandparent);
+  }
+
+  FreeNode(parent);
+  mNodes[aLeaf].mParent = NULL_NODE;
+}
+
+/******************************************************************************/
+void DynamicBVH::Refit(int aNode)
+{
+  for(auto index = aNode; index != NULL_NODE; index = mNodes[index].mParent)
+  {
+    auto& node = mNodes[index];
+    const auto& childA = mNodes[node.mChildren[0]];
+    const auto& childB = mNodes[node.mChildren[1]];
+    node.mFatBox = Merge(childA.mFatBox, childB.mFatBox);
+    node.mHeight = 1 + std::max(childA.mHeight, childB.mHeight);
+  }
+}
+
+/******************************************************************************/
+int DynamicBVH::BuildSubtree(std::vector<int>& aLeaves, std::size_t aStart, std::size_t aEnd)
+{
+  if(aEnd - aStart == 1)
+  {
+    return aLeaves[aStart];
+  }
+
+  // Split the leaves in half along the longest axis of their centers.
+  AABB centers;
+  for(auto i = aStart; i < aEnd; ++i)
+  {
+    Expand(centers, GetCenter(mNodes[aLeaves[i]].mFatBox));
+  }
+
+  auto extents = GetExtents(centers);
+  auto axis = 0;
+  if(extents.y > extents.x && extents.y >= extents.z)
+  {
+    axis = 1;
+  }
+  else if(extents.z > extents.x && extents.z > extents.y)
+  {
+    axis = 2;
+  }
+
+  auto middle = aStart + (aEnd - aStart) / 2;
+  std::nth_element(aLeaves.begin() + aStart,
+                   aLeaves.begin() + middle,
+                   aLeaves.begin() + aEnd,
+                   [this, axis](int aLeafA, int aLeafB)
+  {
+    auto centerA = GetCenter(this->mNodes[aLeafA].mFatBox);
+    auto centerB = GetCenter(this->mNodes[aLeafB].mFatBox);
+    return axis == 0 ? centerA.x < centerB.x :
+           axis == 1 ? centerA.y < centerB.y :
+                       centerA.z < centerB.z;
+  });
+
+  auto childA = BuildSubtree(aLeaves, aStart, middle);
+  auto childB = BuildSubtree(aLeaves, middle, aEnd);
+
+  auto index = AllocateNode();
+  auto& node = mNodes[index];
+  node.mChildren[0] = childA;
+  node.mChildren[1] = childB;
+  node.mFatBox = Merge(mNodes[childA].mFatBox, mNodes[childB].mFatBox);
+  node.mHeight = 1 + std::max(mNodes[childA].mHeight, mNodes[childB].mHeight);
+  mNodes[childA].mParent = index;
+  mNodes[childB].mParent = index;
+  return index;
+}
+
+/******************************************************************************/
+template<typename T>
+void DynamicBVH::Traverse(const T& aTest, std::vector<Entity>& aEntities) const
+{
+  if(mRoot == NULL_NODE)
+  {
+    return;
+  }
+
+  // Leaves are tested against their exact box, and every other node
+  // against the box containing its children.
+  std::vector<int> stack { mRoot };
+  while(!stack.empty())
+  {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    if(node.IsLeaf())
+    {
+      if(aTest(node.mBox))
+      {
+        aEntities.emplace_back(node.mEntity);
+      }
+    }
+    else if(aTest(node.mFatBox))
+    {
+      stack.emplace_back(node.mChildren[0]);
+      stack.emplace_back(node.mChildren[1]);
+    }
+  }
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,249 @@
+#ifndef DYNAMICBVH_HPP
+#define DYNAMICBVH_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Entity.hpp"
+
+#include "Geometry.hpp"
+
+#include "RayPacket.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A bounding volume hierarchy of boxes that can be added, moved and
+ * removed at any time.
+ *
+ * Each box is stored in a leaf, along with a slightly larger "fat" box.
+ * Moving a box only changes the tree once it leaves its fat box; the leaf
+ * is then removed and reinserted next to the sibling that increases the
+ * tree's surface area the least, and the boxes above it are refit. Since
+ * reinsertion never rebalances the tree, it can gradually become deeper
+ * than necessary; Rebuild() rebuilds it from scratch.
+ *
+ * Each box is identified by a proxy ID, which stays the same until the
+ * box is removed.
+ */
+class DynamicBVH
+{
+  public:
+
+    /**
+     * Adds a box to the tree.
+     *
+     * @param aBox The box to add.
+     * @param aEntity The Entity the box belongs to.
+     * @return The proxy ID of the box.
+     */
+    int CreateProxy(const AABB& aBox, Entity aEntity);
+
+    /**
+     * Removes a box from the tree.
+     *
+     * @param aProxy The proxy ID of the box.
+     */
+    void DestroyProxy(int aProxy);
+
+    /**
+     * Moves a box, reinserting it into the tree if it left its fat box.
+     *
+     * @param aProxy The proxy ID of the box.
+     * @param aBox The new box.
+     * @return True if the box was reinserted, false otherwise.
+     */
+    bool MoveProxy(int aProxy, const AABB& aBox);
+
+    /**
+     * Rebuilds the tree from scratch, splitting each set of boxes in half
+     * along its longest axis. Proxy IDs are unaffected.
+     */
+    void Rebuild();
+
+    /**
+     * Finds each box that overlaps the given box.
+     *
+     * @param aBox The box to test.
+     * @param aEntities The Entity of each overlapping box is added to the
+     *                  end of this; existing elements are kept.
+     */
+    void Query(const AABB& aBox, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Finds each box that overlaps the given sphere.
+     *
+     * @param aSphere The sphere to test.
+     * @param aEntities The Entity of each overlapping box is added to the
+     *                  end of this; existing elements are kept.
+     */
+    void Query(const Sphere& aSphere, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Finds each box that might be inside the given frustum (see
+     * Intersects()).
+     *
+     * @param aFrustum The frustum to test.
+     * @param aEntities The Entity of each box inside is added to the end
+     *                  of this; existing elements are kept.
+     */
+    void Query(const Frustum& aFrustum, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Tests a ray against each box it passes through, nearest boxes first
+     * where possible.
+     *
+     * @param aRay The ray to test.
+     * @param aMaxDistance The farthest distance along the ray to look.
+     * @param aTest Called with the Entity of each box the ray hits closer
+     *              than the maximum distance, along with the distance where
+     *              the ray enters the box. Returns the new maximum distance;
+     *              returning a shorter distance (such as the distance of a
+     *              hit) skips any boxes beyond it.
+     */
+    void Raycast(const Ray& aRay,
+                 float aMaxDistance,
+                 const std::function<float(Entity, float, float)>& aTest) const;
+
+    /**
+     * Tests a packet of rays against each box any of them pass through.
+     *
+     * @param aPacket The rays to test.
+     * @param aTest Called with the Entity of each box hit, along with the
+     *              mask of rays that hit it and the distances where they
+     *              enter it. Shortening the maximum distance of the packet's
+     *              rays skips any boxes beyond it.
+     */
+    void Raycast(RayPacket& aPacket,
+                 const std::function<void(Entity, int, const Float4&)>& aTest) const;
+
+    /**
+     * Returns the box of a proxy.
+     *
+     * @param aProxy The proxy ID of the box.
+     * @return The box.
+     */
+    const AABB& GetBox(int aProxy) const { return mNodes[aProxy].mBox; }
+
+    /**
+     * Returns the Entity a proxy belongs to.
+     *
+     * @param aProxy The proxy ID of the box.
+     * @return The Entity.
+     */
+    Entity GetEntity(int aProxy) const { return mNodes[aProxy].mEntity; }
+
+    /**
+     * Returns the number of boxes in the tree.
+     *
+     * @return The number of boxes.
+     */
+    std::size_t GetNumProxies() const { return mNumProxies; }
+
+    /**
+     * Returns the number of levels in the tree below the root; 0 if the
+     * tree has a single box, and -1 if it's empty.
+     *
+     * @return The height of the tree.
+     */
+    int GetHeight() const;
+
+    static constexpr int NULL_NODE = -1;
+
+  private:
+
+    /**
+     * A node in the tree. Leaves hold a single box; every other node has
+     * exactly two children.
+     */
+    struct Node
+    {
+      // The fat box of a leaf, or the box containing both children.
+      AABB mFatBox;
+
+      // The exact box of a leaf.
+      AABB mBox;
+      Entity mEntity { 0 };
+
+      int mParent { NULL_NODE };
+      int mChildren[2] { NULL_NODE, NULL_NODE };
+      int mHeight { 0 };
+
+      // The next free node, for nodes that aren't in use.
+      int mNextFree { NULL_NODE };
+
+      bool IsLeaf() const { return mChildren[0] == NULL_NODE; }
+    };
+
+    /**
+     * Returns a node that isn't in use.
+     *
+     * @return The index of the node.
+     */
+    int AllocateNode();
+
+    /**
+     * Returns a node to the free list.
+     *
+     * @param aNode The index of the node.
+     */
+    void FreeNode(int aNode);
+
+    /**
+     * Inserts a leaf next to the sibling that increases the surface area
+     * of the tree the least.
+     *
+     * @param aLeaf The index of the leaf.
+     */
+    void InsertLeaf(int aLeaf);
+
+    /**
+     * Removes a leaf from the tree, replacing its parent with its sibling.
+     * The leaf itself isn't freed.
+     *
+     * @param aLeaf The index of the leaf.
+     */
+    void RemoveLeaf(int aLeaf);
+
+    /**
+     * Recalculates the box and height of each node from the given node up
+     * to the root.
+     *
+     * @param aNode The index of the first node to refit.
+     */
+    void Refit(int aNode);
+
+    /**
+     * Builds a subtree from the given leaves.
+     *
+     * @param aLeaves The leaves to build from; reordered by the build.
+     * @param aStart The first leaf of the subtree.
+     * @param aEnd One past the last leaf of the subtree.
+     * @return The index of the subtree's root.
+     */
+    int BuildSubtree(std::vector<int>& aLeaves, std::size_t aStart, std::size_t aEnd);
+
+    /**
+     * Finds each leaf whose box passes the given test, skipping the
+     * children of nodes that fail it.
+     *
+     * @param aTest A function returning whether a box passes.
+     * @param aEntities The Entity of each leaf that passes is added to the
+     *                  end of this.
+     */
+    template<typename T>
+    void Traverse(const T& aTest, std::vector<Entity>& aEntities) const;
+
+    std::vector<Node> mNodes;
+    int mRoot { NULL_NODE };
+    int mFreeList { NULL_NODE };
+    std::size_t mNumProxies { 0 };
+
+    // How far each side of a fat box extends past the box it contains.
+    static constexpr float FAT_MARGIN = 0.1f;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,215 @@
+#ifndef RAYPACKET_HPP
+#define RAYPACKET_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include "Geometry.hpp"
+#include "Mat4.hpp"
+#include "Simd.hpp"
+
+namespace Kuma3D {
+
+/**
+ * Four rays traced together, stored so that each can be tested against the
+ * same box or triangle at once with SIMD instructions.
+ *
+ * Functions that test a packet return a mask with one bit per ray (ray 0
+ * in bit 0), and only test the rays set in mActive.
+ */
+struct RayPacket
+{
+  Float4 mOriginX;
+  Float4 mOriginY;
+  Float4 mOriginZ;
+  Float4 mDirectionX;
+  Float4 mDirectionY;
+  Float4 mDirectionZ;
+  Float4 mInverseDirectionX;
+  Float4 mInverseDirectionY;
+  Float4 mInverseDirectionZ;
+
+  // The farthest distance along each ray to look, which shrinks as hits
+  // are found.
+  Float4 mMaxDistance;
+
+  int mActive { 0 };
+};
+
+/**
+ * Calculates the inverse direction of each ray in a packet. Zero
+ * components are replaced with tiny ones, so that the inverses stay finite.
+ *
+ * @param aPacket The packet to update.
+ */
+inline void UpdateInverseDirections(RayPacket& aPacket)
+{
+  float directions[3][4];
+  StoreFloat4(directions[0], aPacket.mDirectionX);
+  StoreFloat4(directions[1], aPacket.mDirectionY);
+  StoreFloat4(directions[2], aPacket.mDirectionZ);
+  for(auto& axis : directions)
+  {
+    for(auto& value : axis)
+    {
+      value = (std::abs(value) < 1e-20f) ? std::copysign(1e20f, value) : 1.0f / value;
+    }
+  }
+
+  aPacket.mInverseDirectionX = LoadFloat4(directions[0]);
+  aPacket.mInverseDirectionY = LoadFloat4(directions[1]);
+  aPacket.mInverseDirectionZ = LoadFloat4(directions[2]);
+}
+
+/**
+ * Creates a packet from up to four rays. If there are fewer than four, the
+ * remaining rays are inactive.
+ *
+ * @param aRays The rays.
+ * @param aCount The number of rays, from 1 to 4.
+ * @param aMaxDistance The farthest distance along each ray to look.
+ * @return The packet.
+ */
+inline RayPacket MakeRayPacket(const Ray* aRays, std::size_t aCount, float aMaxDistance)
+{
+  float values[6][4];
+  for(std::size_t lane = 0; lane < 4; ++lane)
+  {
+    const auto& ray = aRays[lane < aCount ? lane : 0];
+    values[0][lane] = ray.mOrigin.x;
+    values[1][lane] = ray.mOrigin.y;
+    values[2][lane] = ray.mOrigin.z;
+    values[3][lane] = ray.mDirection.x;
+    values[4][lane] = ray.mDirection.y;
+    values[5][lane] = ray.mDirection.z;
+  }
+
+  RayPacket packet;
+  packet.mOriginX = LoadFloat4(values[0]);
+  packet.mOriginY = LoadFloat4(values[1]);
+  packet.mOriginZ = LoadFloat4(values[2]);
+  packet.mDirectionX = LoadFloat4(values[3]);
+  packet.mDirectionY = LoadFloat4(values[4]);
+  packet.mDirectionZ = LoadFloat4(values[5]);
+  packet.mMaxDistance = SplatFloat4(aMaxDistance);
+  packet.mActive = (1 << aCount) - 1;
+  UpdateInverseDirections(packet);
+  return packet;
+}
+
+/**
+ * Transforms each ray in a packet by a matrix. Since the directions aren't
+ * normalized afterward, distances along the rays stay the same.
+ *
+ * @param aMatrix The transformation matrix.
+ * @param aPacket The packet to transform.
+ * @return The transformed packet.
+ */
+inline RayPacket TransformRayPacket(const Mat4& aMatrix, const RayPacket& aPacket)
+{
+  Float4 m[4][3];
+  for(int c = 0; c < 4; ++c)
+  {
+    for(int r = 0; r < 3; ++r)
+    {
+      m[c][r] = SplatFloat4(aMatrix(c, r));
+    }
+  }
+
+  RayPacket result = aPacket;
+  result.mOriginX = m[0][0] * aPacket.mOriginX + m[1][0] * aPacket.mOriginY + m[2][0] * aPacket.mOriginZ + m[3][0];
+  result.mOriginY = m[0][1] * aPacket.mOriginX + m[1][1] * aPacket.mOriginY + m[2][1] * aPacket.mOriginZ + m[3][1];
+  result.mOriginZ = m[0][2] * aPacket.mOriginX + m[1][2] * aPacket.mOriginY + m[2][2] * aPacket.mOriginZ + m[3][2];
+  result.mDirectionX = m[0][0] * aPacket.mDirectionX + m[1][0] * aPacket.mDirectionY + m[2][0] * aPacket.mDirectionZ;
+  result.mDirectionY = m[0][1] * aPacket.mDirectionX + m[1][1] * aPacket.mDirectionY + m[2][1] * aPacket.mDirectionZ;
+  result.mDirectionZ = m[0][2] * aPacket.mDirectionX + m[1][2] * aPacket.mDirectionY + m[2][2] * aPacket.mDirectionZ;
+  UpdateInverseDirections(result);
+  return result;
+}
+
+/**
+ * Finds where each ray in a packet enters a box.
+ *
+ * @param aPacket The rays.
+ * @param aBox The box.
+ * @param aDistance Set to the distance along each ray where it enters the
+ *                  box, or 0 for rays starting inside the box.
+ * @return A mask of the rays that hit the box within their maximum
+ *         distance.
+ */
+inline int IntersectBox(const RayPacket& aPacket, const AABB& aBox, Float4& aDistance)
+{
+  // Clip each ray against each pair of planes (or slab) bounding the box.
+  auto enterX = (SplatFloat4(aBox.mMin.x) - aPacket.mOriginX) * aPacket.mInverseDirectionX;
+  auto exitX = (SplatFloat4(aBox.mMax.x) - aPacket.mOriginX) * aPacket.mInverseDirectionX;
+  auto enterY = (SplatFloat4(aBox.mMin.y) - aPacket.mOriginY) * aPacket.mInverseDirectionY;
+  auto exitY = (SplatFloat4(aBox.mMax.y) - aPacket.mOriginY) * aPacket.mInverseDirectionY;
+  auto enterZ = (SplatFloat4(aBox.mMin.z) - aPacket.mOriginZ) * aPacket.mInverseDirectionZ;
+  auto exitZ = (SplatFloat4(aBox.mMax.z) - aPacket.mOriginZ) * aPacket.mInverseDirectionZ;
+
+  auto near = Max(Max(Min(enterX, exitX), Min(enterY, exitY)),
+                  Max(Min(enterZ, exitZ), SplatFloat4(0.0f)));
+  auto far = Min(Min(Max(enterX, exitX), Max(enterY, exitY)),
+                 Min(Max(enterZ, exitZ), aPacket.mMaxDistance));
+
+  aDistance = near;
+  return ~MoveMask(Less(far, near)) & aPacket.mActive;
+}
+
+/**
+ * Finds where each ray in a packet hits a triangle, from either side.
+ *
+ * @param aPacket The rays.
+ * @param aA The first vertex of the triangle.
+ * @param aB The second vertex of the triangle.
+ * @param aC The third vertex of the triangle.
+ * @param aDistance Set to the distance along each ray where it hits the
+ *                  triangle.
+ * @return A mask of the rays that hit the triangle within their maximum
+ *         distance.
+ */
+inline int IntersectTriangle(const RayPacket& aPacket,
+                             const Vec3& aA,
+                             const Vec3& aB,
+                             const Vec3& aC,
+                             Float4& aDistance)
+{
+  // The same calculation as Intersects(), for each ray at once.
+  auto edgeABX = SplatFloat4(aB.x - aA.x);
+  auto edgeABY = SplatFloat4(aB.y - aA.y);
+  auto edgeABZ = SplatFloat4(aB.z - aA.z);
+  auto edgeACX = SplatFloat4(aC.x - aA.x);
+  auto edgeACY = SplatFloat4(aC.y - aA.y);
+  auto edgeACZ = SplatFloat4(aC.z - aA.z);
+
+  auto pX = aPacket.mDirectionY * edgeACZ - aPacket.mDirectionZ * edgeACY;
+  auto pY = aPacket.mDirectionZ * edgeACX - aPacket.mDirectionX * edgeACZ;
+  auto pZ = aPacket.mDirectionX * edgeACY - aPacket.mDirectionY * edgeACX;
+  auto determinant = edgeABX * pX + edgeABY * pY + edgeABZ * pZ;
+  auto inverse = SplatFloat4(1.0f) / determinant;
+
+  auto tX = aPacket.mOriginX - SplatFloat4(aA.x);
+  auto tY = aPacket.mOriginY - SplatFloat4(aA.y);
+  auto tZ = aPacket.mOriginZ - SplatFloat4(aA.z);
+  auto u = (tX * pX + tY * pY + tZ * pZ) * inverse;
+
+  auto qX = tY * edgeABZ - tZ * edgeABY;
+  auto qY = tZ * edgeABX - tX * edgeABZ;
+  auto qZ = tX * edgeABY - tY * edgeABX;
+  auto v = (aPacket.mDirectionX * qX + aPacket.mDirectionY * qY + aPacket.mDirectionZ * qZ) * inverse;
+  auto distance = (edgeACX * qX + edgeACY * qY + edgeACZ * qZ) * inverse;
+
+  auto zero = SplatFloat4(0.0f);
+  auto one = SplatFloat4(1.0f);
+  auto miss = Less(determinant * determinant, SplatFloat4(1e-24f)) |
+              Less(u, zero) | Less(one, u) |
+              Less(v, zero) | Less(one, u + v) |
+              Less(distance, zero) | Less(aPacket.mMaxDistance, distance);
+
+  aDistance = distance;
+  return ~MoveMask(miss) & aPacket.mActive;
+}
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,311 @@
+#include "SpatialSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Scene.hpp"
+
+#include "MathUtil.hpp"
+#include "TransformStreams.hpp"
+
+#include "Bounds.hpp"
+
+#include "MeshLoader.hpp"
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void SpatialSystem::Initialize(Scene& aScene)
+{
+  // Register the Bounds and Transform components.
+  if(!aScene.IsComponentTypeRegistered<Bounds>())
+  {
+    aScene.RegisterComponentType<Bounds>();
+  }
+
+  if(!aScene.IsComponentTypeRegistered<Transform>())
+  {
+    aScene.RegisterComponentType<Transform>();
+  }
+
+  // Set the signature to care about entities with Bounds and Transforms.
+  auto signature = aScene.CreateSignature();
+  signature[aScene.GetComponentIndex<Bounds>()] = true;
+  signature[aScene.GetComponentIndex<Transform>()] = true;
+  SetSignature(signature);
+}
+
+/******************************************************************************/
+void SpatialSystem::Operate(Scene& aScene, double aTime)
+{
+  // Triangles cached last frame need to be checked against their Meshes
+  // again.
+  ++mFrame;
+
+  auto getTransform = [&aScene](Entity aEntity) -> const Transform&
+  {
+    return aScene.GetComponentForEntity<Transform>(aEntity);
+  };
+
+  // Move each Entity's box into world space. Boxes that haven't left their
+  // fat box don't change the tree.
+  for(const auto& entity : GetEntities())
+  {
+    const auto& entityBounds = aScene.GetComponentForEntity<Bounds>(entity);
+    auto worldMatrix = ComposeWorldMatrix(aScene.GetComponentForEntity<Transform>(entity),
+                                          getTransform);
+    auto worldBounds = TransformBounds(worldMatrix, entityBounds.mBox);
+
+    auto foundEntry = mEntryMap.find(entity);
+    if(foundEntry == mEntryMap.end())
+    {
+      SpatialEntry entry;
+      entry.mProxy = mTree.CreateProxy(worldBounds, entity);
+      foundEntry = mEntryMap.emplace(entity, entry).first;
+    }
+    else if(mTree.MoveProxy(foundEntry->second.mProxy, worldBounds))
+    {
+      mReinsertions.Increment();
+    }
+
+    foundEntry->second.mWorldMatrix = worldMatrix;
+    foundEntry->second.mInverseValid = false;
+  }
+
+  // Discard the triangles of shared geometry no Mesh uses anymore.
+  for(auto it = mSharedTrianglesMap.begin(); it != mSharedTrianglesMap.end();)
+  {
+    if(MeshLoader::GetReferenceCount(it->second.mGeometry) <= 1)
+    {
+      it = mSharedTrianglesMap.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  // Rebuild the tree if reinsertion has left it too unbalanced.
+  auto numProxies = mTree.GetNumProxies();
+  if(numProxies > 1)
+  {
+    auto balancedHeight = static_cast<int>(std::ceil(std::log2(numProxies)));
+    if(mTree.GetHeight() > MAX_HEIGHT_RATIO * balancedHeight)
+    {
+      mTree.Rebuild();
+      mRebuilds.Increment();
+    }
+  }
+
+  mTreeHeight.Set(mTree.GetHeight());
+}
+
+/******************************************************************************/
+void SpatialSystem::Query(const AABB& aBox, std::vector<Entity>& aEntities) const
+{
+  mTree.Query(aBox, aEntities);
+}
+
+/******************************************************************************/
+void SpatialSystem::Query(const Sphere& aSphere, std::vector<Entity>& aEntities) const
+{
+  mTree.Query(aSphere, aEntities);
+}
+
+/******************************************************************************/
+void SpatialSystem::Query(const Frustum& aFrustum, std::vector<Entity>& aEntities) const
+{
+  mTree.Query(aFrustum, aEntities);
+}
+
+/******************************************************************************/
+bool SpatialSystem::Raycast(Scene& aScene,
+                            const Ray& aRay,
+                            RaycastHit& aHit,
+                            float aMaxDistance)
+{
+  aHit = RaycastHit();
+  mTree.Raycast(aRay, aMaxDistance, [this, &aScene, &aRay, &aHit](Entity aEntity,
+                                                                  float aEntryDistance,
+                                                                  float aMaxDistance)
+  {
+    auto distance = aEntryDistance;
+    auto triangles = GetTriangles(aScene, aEntity);
+    if(triangles != nullptr)
+    {
+      // Test the triangles in the Mesh's local space. The direction isn't
+      // normalized afterward, so that distances stay the same.
+      const auto& inverse = GetInverseWorldMatrix(aEntity);
+      Ray localRay;
+      localRay.mOrigin = inverse * aRay.mOrigin;
+      localRay.mDirection = (inverse * (aRay.mOrigin + aRay.mDirection)) - localRay.mOrigin;
+      if(!triangles->Raycast(localRay, aMaxDistance, distance))
+      {
+        return aMaxDistance;
+      }
+    }
+
+    aHit.mHit = true;
+    aHit.mEntity = aEntity;
+    aHit.mDistance = distance;
+    return distance;
+  });
+
+  if(aHit.mHit)
+  {
+    aHit.mPosition = aRay.mOrigin + (aRay.mDirection * aHit.mDistance);
+  }
+
+  return aHit.mHit;
+}
+
+/******************************************************************************/
+void SpatialSystem::Raycast(Scene& aScene,
+                            const std::vector<Ray>& aRays,
+                            std::vector<RaycastHit>& aHits,
+                            float aMaxDistance)
+{
+  aHits.assign(aRays.size(), RaycastHit());
+
+  for(std::size_t start = 0; start < aRays.size(); start += 4)
+  {
+    auto count = std::min<std::size_t>(4, aRays.size() - start);
+    auto packet = MakeRayPacket(&aRays[start], count, aMaxDistance);
+    mTree.Raycast(packet, [this, &aScene, &aHits, &packet, start](Entity aEntity,
+                                                                  int aMask,
+                                                                  const Float4& aEntryDistances)
+    {
+      auto hitMask = aMask;
+      float distances[4];
+      StoreFloat4(distances, aEntryDistances);
+
+      auto triangles = GetTriangles(aScene, aEntity);
+      if(triangles != nullptr)
+      {
+        auto localPacket = TransformRayPacket(GetInverseWorldMatrix(aEntity), packet);
+        localPacket.mActive = aMask;
+        hitMask = triangles->Raycast(localPacket);
+        StoreFloat4(distances, localPacket.mMaxDistance);
+      }
+
+      if(hitMask == 0)
+      {
+        return;
+      }
+
+      // Shorten each ray that hit the Entity.
+      float maxDistances[4];
+      StoreFloat4(maxDistances, packet.mMaxDistance);
+      for(int lane = 0; lane < 4; ++lane)
+      {
+        if(hitMask & (1 << lane))
+        {
+          maxDistances[lane] = distances[lane];
+
+          auto& hit = aHits[start + lane];
+          hit.mHit = true;
+          hit.mEntity = aEntity;
+          hit.mDistance = distances[lane];
+        }
+      }
+      packet.mMaxDistance = LoadFloat4(maxDistances);
+    });
+
+    for(auto i = start; i < start + count; ++i)
+    {
+      if(aHits[i].mHit)
+      {
+        aHits[i].mPosition = aRays[i].mOrigin + (aRays[i].mDirection * aHits[i].mDistance);
+      }
+    }
+  }
+}
+
+/******************************************************************************/
+void SpatialSystem::HandleEntityBecameIneligible(Entity aEntity)
+{
+  auto foundEntry = mEntryMap.find(aEntity);
+  if(foundEntry != mEntryMap.end())
+  {
+    mTree.DestroyProxy(foundEntry->second.mProxy);
+    mEntryMap.erase(foundEntry);
+  }
+
+  mEntityTrianglesMap.erase(aEntity);
+}
+
+/******************************************************************************/
+const Mat4& SpatialSystem::GetInverseWorldMatrix(Entity aEntity)
+{
+  auto& entry = mEntryMap.at(aEntity);
+  if(!entry.mInverseValid)
+  {
+    entry.mInverseWorldMatrix = Inverse(entry.mWorldMatrix);
+    entry.mInverseValid = true;
+  }
+
+  return entry.mInverseWorldMatrix;
+}
+
+/******************************************************************************/
+const TriangleBVH* SpatialSystem::GetTriangles(Scene& aScene, Entity aEntity)
+{
+  if(!aScene.IsComponentTypeRegistered<Mesh>() ||
+     !aScene.GetSignatureForEntity(aEntity)[aScene.GetComponentIndex<Mesh>()])
+  {
+    return nullptr;
+  }
+
+  const auto& entityMesh = aScene.GetComponentForEntity<Mesh>(aEntity);
+  if(entityMesh.mRenderMode != RenderMode::eTRIANGLES)
+  {
+    return nullptr;
+  }
+
+  // Geometry shared through the MeshLoader is only built once, no matter
+  // how many Meshes use it.
+  if(entityMesh.mGeometry.IsValid())
+  {
+    auto revision = MeshLoader::GetRevision(entityMesh.mGeometry);
+    auto& shared = mSharedTrianglesMap[entityMesh.mGeometry.GetID()];
+    if(!shared.mGeometry.IsValid() || shared.mRevision != revision)
+    {
+      shared.mGeometry = entityMesh.mGeometry;
+      shared.mRevision = revision;
+      shared.mTriangles.Build(MeshLoader::GetVertices(entityMesh.mGeometry),
+                              MeshLoader::GetIndices(entityMesh.mGeometry));
+    }
+
+    return &shared.mTriangles;
+  }
+
+  // A dirty Mesh's geometry takes the next revision once the RenderSystem
+  // picks up the change. Until then, the triangles are rebuilt at most once
+  // per frame, in case the geometry is edited again.
+  auto revision = entityMesh.mRevision;
+  if(entityMesh.mDirty)
+  {
+    ++revision;
+  }
+
+  auto foundTriangles = mEntityTrianglesMap.find(aEntity);
+  auto isNew = (foundTriangles == mEntityTrianglesMap.end());
+  if(isNew)
+  {
+    foundTriangles = mEntityTrianglesMap.emplace(aEntity, EntityTriangles()).first;
+  }
+
+  auto& entityTriangles = foundTriangles->second;
+  if(isNew ||
+     entityTriangles.mRevision != revision ||
+     (entityMesh.mDirty && entityTriangles.mBuiltFrame != mFrame))
+  {
+    entityTriangles.mRevision = revision;
+    entityTriangles.mBuiltFrame = mFrame;
+    entityTriangles.mTriangles.Build(entityMesh.mVertices, entityMesh.mIndices);
+  }
+
+  return &entityTriangles.mTriangles;
+}
+
+} // namespace Kuma3D
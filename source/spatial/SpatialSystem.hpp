@@ -0,0 +1,233 @@
+#ifndef SPATIALSYSTEM_HPP
+#define SPATIALSYSTEM_HPP
+
+#include "System.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "IDGenerator.hpp"
+
+#include "Mesh.hpp"
+#include "MeshHandle.hpp"
+#include "Transform.hpp"
+
+#include "Geometry.hpp"
+#include "Mat4.hpp"
+
+#include "DynamicBVH.hpp"
+#include "TriangleBVH.hpp"
+
+#include "Metrics.hpp"
+
+namespace Kuma3D {
+
+/**
+ * The result of a raycast.
+ */
+struct RaycastHit
+{
+  // Whether the ray hit anything.
+  bool mHit { false };
+
+  // The Entity that was hit, the distance along the ray of the hit, and the
+  // world-space position of the hit.
+  Entity mEntity { 0 };
+  float mDistance { 0.0 };
+  Vec3 mPosition;
+};
+
+/**
+ * The SpatialSystem keeps track of where each Entity with a Bounds and a
+ * Transform is, so that other Systems can find the Entities in an area
+ * without checking every Entity.
+ *
+ * Each frame, every Entity's Bounds is moved into world space and updated
+ * in a DynamicBVH. Queries reflect the Entities' positions as of the most
+ * recent call to Operate(); Entities added since then aren't found until
+ * the next.
+ *
+ * Raycasts hit an Entity's bounds, unless it also has a triangle Mesh, in
+ * which case they hit the Mesh's triangles. A TriangleBVH is built for each
+ * Mesh the first time a ray reaches it, and rebuilt once the Mesh's geometry
+ * changes; this doesn't depend on the Mesh's dirty flag, so this System can
+ * run before or after the RenderSystem.
+ */
+class SpatialSystem : public System
+{
+  public:
+
+    /**
+     * Initializes the System by registering the Bounds and Transform
+     * component types, if they aren't registered already. This function
+     * also sets the Signature of the System to keep track of Entities with
+     * Bounds and Transform components.
+     *
+     * @param aScene The Scene this System was added to.
+     */
+    void Initialize(Scene& aScene) override;
+
+    /**
+     * Updates the world-space bounds of each Entity, rebuilding the tree
+     * if it has become unbalanced.
+     *
+     * @param aScene The Scene containing the Entities' component data.
+     * @param aTime The start time of the current frame.
+     */
+    void Operate(Scene& aScene, double aTime) override;
+
+    /**
+     * Finds each Entity whose bounds overlap the given box.
+     *
+     * @param aBox The world-space box to test.
+     * @param aEntities Each overlapping Entity is added to the end of this;
+     *                  existing elements are kept.
+     */
+    void Query(const AABB& aBox, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Finds each Entity whose bounds overlap the given sphere.
+     *
+     * @param aSphere The world-space sphere to test.
+     * @param aEntities Each overlapping Entity is added to the end of this;
+     *                  existing elements are kept.
+     */
+    void Query(const Sphere& aSphere, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Finds each Entity whose bounds might be inside the given frustum.
+     *
+     * @param aFrustum The world-space frustum to test.
+     * @param aEntities Each Entity inside is added to the end of this;
+     *                  existing elements are kept.
+     */
+    void Query(const Frustum& aFrustum, std::vector<Entity>& aEntities) const;
+
+    /**
+     * Finds the nearest Entity hit by a ray.
+     *
+     * @param aScene The Scene containing the Entities.
+     * @param aRay The world-space ray.
+     * @param aHit Filled with the nearest hit, if any.
+     * @param aMaxDistance The farthest distance along the ray to look.
+     * @return True if the ray hit an Entity, false otherwise.
+     */
+    bool Raycast(Scene& aScene,
+                 const Ray& aRay,
+                 RaycastHit& aHit,
+                 float aMaxDistance = std::numeric_limits<float>::max());
+
+    /**
+     * Finds the nearest Entity hit by each of a list of rays. The rays are
+     * traced in packets of four, which is much faster than tracing them one
+     * at a time when they travel in similar directions.
+     *
+     * @param aScene The Scene containing the Entities.
+     * @param aRays The world-space rays.
+     * @param aHits Resized to the number of rays, and filled with the
+     *              nearest hit of each ray.
+     * @param aMaxDistance The farthest distance along each ray to look.
+     */
+    void Raycast(Scene& aScene,
+                 const std::vector<Ray>& aRays,
+                 std::vector<RaycastHit>& aHits,
+                 float aMaxDistance = std::numeric_limits<float>::max());
+
+    /**
+     * Returns the tree that Entities are stored in.
+     *
+     * @return The tree.
+     */
+    const DynamicBVH& GetTree() const { return mTree; }
+
+  protected:
+
+    /**
+     * A handler function that gets called whenever an Entity becomes
+     * ineligible for this System.
+     *
+     * @param eEntity The Entity that became ineligible.
+     */
+    void HandleEntityBecameIneligible(Entity aEntity) override;
+
+  private:
+
+    /**
+     * Returns the inverse of an Entity's world matrix, calculating it if it
+     * has changed since it was last requested.
+     *
+     * @param aEntity The Entity.
+     * @return The inverse world matrix.
+     */
+    const Mat4& GetInverseWorldMatrix(Entity aEntity);
+
+    /**
+     * Returns the triangles of an Entity's Mesh, building their tree if
+     * necessary.
+     *
+     * @param aScene The Scene containing the Entity.
+     * @param aEntity The Entity.
+     * @return The triangles, or nullptr if the Entity has no triangle Mesh.
+     */
+    const TriangleBVH* GetTriangles(Scene& aScene, Entity aEntity);
+
+    /**
+     * Everything known about an Entity in the tree.
+     */
+    struct SpatialEntry
+    {
+      int mProxy { DynamicBVH::NULL_NODE };
+      Mat4 mWorldMatrix;
+      Mat4 mInverseWorldMatrix;
+      bool mInverseValid { false };
+    };
+
+    /**
+     * The triangles of a Mesh that stores its own geometry, along with the
+     * revision of the geometry they were built from.
+     */
+    struct EntityTriangles
+    {
+      unsigned int mRevision { 0 };
+      std::uint64_t mBuiltFrame { 0 };
+      TriangleBVH mTriangles;
+    };
+
+    /**
+     * The triangles of geometry shared through the MeshLoader. The handle
+     * keeps the geometry (and therefore its ID) from being reused while the
+     * triangles are cached.
+     */
+    struct SharedTriangles
+    {
+      MeshHandle mGeometry;
+      unsigned int mRevision { 0 };
+      TriangleBVH mTriangles;
+    };
+
+    DynamicBVH mTree;
+    std::map<Entity, SpatialEntry> mEntryMap;
+
+    // The triangles of each Mesh that stores its own geometry, and of each
+    // piece of shared geometry.
+    std::map<Entity, EntityTriangles> mEntityTrianglesMap;
+    std::map<ID, SharedTriangles> mSharedTrianglesMap;
+
+    // The number of calls to Operate(), for rebuilding the triangles of
+    // dirty Meshes at most once per frame.
+    std::uint64_t mFrame { 0 };
+
+    Gauge& mTreeHeight { Metrics::GetGauge("Spatial.TreeHeight") };
+    Counter& mReinsertions { Metrics::GetCounter("Spatial.Reinsertions") };
+    Counter& mRebuilds { Metrics::GetCounter("Spatial.Rebuilds") };
+
+    // The tree is rebuilt once it becomes this many times deeper than a
+    // perfectly balanced tree.
+    static const int MAX_HEIGHT_RATIO = 2;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -0,0 +1,208 @@
+#include "TriangleBVH.hpp"
+
+#include <algorithm>
+
+namespace Kuma3D {
+
+/******************************************************************************/
+void TriangleBVH::Build(const std::vector<MeshVertex>& aVertices,
+                        const std::vector<unsigned int>& aIndices)
+{
+  mTriangles.clear();
+  mNodes.clear();
+
+  for(std::size_t i = 0; i + 2 < aIndices.size(); i += 3)
+  {
+    Triangle triangle;
+    triangle.mA = aVertices[aIndices[i]].mPosition;
+    triangle.mB = aVertices[aIndices[i + 1]].mPosition;
+    triangle.mC = aVertices[aIndices[i + 2]].mPosition;
+    mTriangles.emplace_back(triangle);
+  }
+
+  if(!mTriangles.empty())
+  {
+    mNodes.reserve(2 * mTriangles.size());
+    BuildSubtree(0, mTriangles.size());
+  }
+}
+
+/******************************************************************************/
+bool TriangleBVH::Raycast(const Ray& aRay, float aMaxDistance, float& aDistance) const
+{
+  if(mNodes.empty())
+  {
+    return false;
+  }
+
+  // Visit the nearer child of each node first, so that the farther one can
+  // often be skipped.
+  auto hit = false;
+  std::vector<std::size_t> stack { 0 };
+  while(!stack.empty())
+  {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float boxDistance;
+    if(!Intersects(aRay, node.mBox, aMaxDistance, boxDistance))
+    {
+      continue;
+    }
+
+    if(node.IsLeaf())
+    {
+      for(auto i = node.mIndex; i < node.mIndex + node.mNumTriangles; ++i)
+      {
+        const auto& triangle = mTriangles[i];
+        float distance;
+        if(Intersects(aRay, triangle.mA, triangle.mB, triangle.mC, aMaxDistance, distance))
+        {
+          aMaxDistance = distance;
+          aDistance = distance;
+          hit = true;
+        }
+      }
+      continue;
+    }
+
+    auto first = &node - mNodes.data() + 1;
+    auto second = node.mIndex;
+    float firstDistance = 0.0f;
+    float secondDistance = 0.0f;
+    Intersects(aRay, mNodes[first].mBox, aMaxDistance, firstDistance);
+    Intersects(aRay, mNodes[second].mBox, aMaxDistance, secondDistance);
+    if(firstDistance < secondDistance)
+    {
+      stack.emplace_back(second);
+      stack.emplace_back(first);
+    }
+    else
+    {
+      stack.emplace_back(first);
+      stack.emplace_back(second);
+    }
+  }
+
+  return hit;
+}
+
+/******************************************************************************/
+int TriangleBVH::Raycast(RayPacket& aPacket) const
+{
+  if(mNodes.empty())
+  {
+    return 0;
+  }
+
+  // Each node is visited if any ray in the packet hits it.
+  auto hits = 0;
+  std::vector<std::size_t> stack { 0 };
+  while(!stack.empty())
+  {
+    auto index = stack.back();
+    const auto& node = mNodes[index];
+    stack.pop_back();
+
+    Float4 boxDistance;
+    if(IntersectBox(aPacket, node.mBox, boxDistance) == 0)
+    {
+      continue;
+    }
+
+    if(!node.IsLeaf())
+    {
+      stack.emplace_back(node.mIndex);
+      stack.emplace_back(index + 1);
+      continue;
+    }
+
+    for(auto i = node.mIndex; i < node.mIndex + node.mNumTriangles; ++i)
+    {
+      const auto& triangle = mTriangles[i];
+      Float4 distance;
+      auto mask = IntersectTriangle(aPacket, triangle.mA, triangle.mB, triangle.mC, distance);
+      if(mask != 0)
+      {
+        // Shorten each ray that hit the triangle.
+        float maxDistances[4];
+        float distances[4];
+        StoreFloat4(maxDistances, aPacket.mMaxDistance);
+        StoreFloat4(distances, distance);
+        for(int lane = 0; lane < 4; ++lane)
+        {
+          if(mask & (1 << lane))
+          {
+            maxDistances[lane] = distances[lane];
+          }
+        }
+        aPacket.mMaxDistance = LoadFloat4(maxDistances);
+        hits |= mask;
+      }
+    }
+  }
+
+  return hits;
+}
+
+/******************************************************************************/
+void TriangleBVH::BuildSubtree(std::size_t aStart, std::size_t aEnd)
+{
+  auto index = mNodes.size();
+  mNodes.emplace_back();
+
+  AABB box;
+  AABB centers;
+  for(auto i = aStart; i < aEnd; ++i)
+  {
+    const auto& triangle = mTriangles[i];
+    Expand(box, triangle.mA);
+    Expand(box, triangle.mB);
+    Expand(box, triangle.mC);
+    Expand(centers, Vec3((triangle.mA.x + triangle.mB.x + triangle.mC.x) / 3.0f,
+                         (triangle.mA.y + triangle.mB.y + triangle.mC.y) / 3.0f,
+                         (triangle.mA.z + triangle.mB.z + triangle.mC.z) / 3.0f));
+  }
+  mNodes[index].mBox = box;
+
+  if(aEnd - aStart <= MAX_LEAF_TRIANGLES)
+  {
+    mNodes[index].mIndex = aStart;
+    mNodes[index].mNumTriangles = aEnd - aStart;
+    return;
+  }
+
+  // Split the triangles in half along the longest axis of their centers.
+  auto extents = GetExtents(centers);
+  auto axis = 0;
+  if(extents.y > extents.x && extents.y >= extents.z)
+  {
+    axis = 1;
+  }
+  else if(extents.z > extents.x && extents.z > extents.y)
+  {
+    axis = 2;
+  }
+
+  auto middle = aStart + (aEnd - aStart) / 2;
+  std::nth_element(mTriangles.begin() + aStart,
+                   mTriangles.begin() + middle,
+                   mTriangles.begin() + aEnd,
+                   [axis](const Triangle& aTriangleA, const Triangle& aTriangleB)
+  {
+    auto sumA = axis == 0 ? aTriangleA.mA.x + aTriangleA.mB.x + aTriangleA.mC.x :
+                axis == 1 ? aTriangleA.mA.y + aTriangleA.mB.y + aTriangleA.mC.y :
+                            aTriangleA.mA.z + aTriangleA.mB.z + aTriangleA.mC.z;
+    auto sumB = axis == 0 ? aTriangleB.mA.x + aTriangleB.mB.x + aTriangleB.mC.x :
+                axis == 1 ? aTriangleB.mA.y + aTriangleB.mB.y + aTriangleB.mC.y :
+                            aTriangleB.mA.z + aTriangleB.mB.z + aTriangleB.mC.z;
+    return sumA < sumB;
+  });
+
+  // The first child immediately follows this node.
+  BuildSubtree(aStart, middle);
+  mNodes[index].mIndex = mNodes.size();
+  BuildSubtree(middle, aEnd);
+}
+
+} // namespace Kuma3D
@@ -0,0 +1,107 @@
+#ifndef TRIANGLEBVH_HPP
+#define TRIANGLEBVH_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Geometry.hpp"
+
+#include "Mesh.hpp"
+
+#include "RayPacket.hpp"
+
+namespace Kuma3D {
+
+/**
+ * A bounding volume hierarchy over the triangles of a mesh, for finding
+ * where rays hit it without testing every triangle.
+ *
+ * The tree is built once from a copy of the mesh's triangles, and must be
+ * rebuilt if the mesh changes. Nodes are stored depth-first, so that each
+ * node's first child immediately follows it.
+ */
+class TriangleBVH
+{
+  public:
+
+    /**
+     * Builds the tree from the triangles of a mesh.
+     *
+     * @param aVertices The vertices of the mesh.
+     * @param aIndices The indices of the mesh's triangles.
+     */
+    void Build(const std::vector<MeshVertex>& aVertices,
+               const std::vector<unsigned int>& aIndices);
+
+    /**
+     * Finds the nearest triangle hit by a ray.
+     *
+     * @param aRay The ray, in the mesh's local space.
+     * @param aMaxDistance The farthest distance along the ray to look.
+     * @param aDistance Set to the distance along the ray of the nearest hit.
+     * @return True if the ray hits a triangle, false otherwise.
+     */
+    bool Raycast(const Ray& aRay, float aMaxDistance, float& aDistance) const;
+
+    /**
+     * Finds the nearest triangle hit by each ray in a packet. The maximum
+     * distance of each ray that hits a triangle is shortened to the
+     * distance of its nearest hit.
+     *
+     * @param aPacket The rays, in the mesh's local space.
+     * @return A mask of the rays that hit a triangle.
+     */
+    int Raycast(RayPacket& aPacket) const;
+
+    /**
+     * Returns the number of triangles in the tree.
+     *
+     * @return The number of triangles.
+     */
+    std::size_t GetNumTriangles() const { return mTriangles.size(); }
+
+  private:
+
+    /**
+     * A triangle of the mesh.
+     */
+    struct Triangle
+    {
+      Vec3 mA;
+      Vec3 mB;
+      Vec3 mC;
+    };
+
+    /**
+     * A node in the tree. Leaves hold a range of triangles; every other
+     * node has two children, the first of which immediately follows it.
+     */
+    struct Node
+    {
+      AABB mBox;
+
+      // The first triangle of a leaf, or the second child of any other node.
+      std::size_t mIndex { 0 };
+      std::size_t mNumTriangles { 0 };
+
+      bool IsLeaf() const { return mNumTriangles > 0; }
+    };
+
+    /**
+     * Builds the subtree for a range of triangles.
+     *
+     * @param aStart The first triangle of the subtree.
+     * @param aEnd One past the last triangle of the subtree.
+     */
+    void BuildSubtree(std::size_t aStart, std::size_t aEnd);
+
+    std::vector<Triangle> mTriangles;
+    std::vector<Node> mNodes;
+
+    // The most triangles stored in a single leaf.
+    static const std::size_t MAX_LEAF_TRIANGLES = 4;
+};
+
+} // namespace Kuma3D
+
+#endif
@@ -1,12 +1,46 @@
 #ifndef CORETESTS_HPP
 #define CORETESTS_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
 
+#include <Bounds.hpp>
+#include <Collider.hpp>
+#include <CollisionSystem.hpp>
 #include <ComponentList.hpp>
+#include <DynamicBVH.hpp>
+#include <FreeListAllocator.hpp>
+#include <FrustumCuller.hpp>
+#include <Game.hpp>
+#include <Geometry.hpp>
+#include <HitchDetector.hpp>
+#include <JobSystem.hpp>
+#include <Mesh.hpp>
+#include <MeshLoader.hpp>
+#include <MathUtil.hpp>
+#include <Metrics.hpp>
+#include <OcclusionCuller.hpp>
+#include <PhysicsSystem.hpp>
+#include <Profiler.hpp>
+#include <RadixSort.hpp>
+#include <RenderQueue.hpp>
+#include <RenderSystem.hpp>
+#include <RigidBody.hpp>
+#include <RigidBodyStreams.hpp>
 #include <Scene.hpp>
+#include <ShaderLoader.hpp>
+#include <System.hpp>
 
 #include <Signature.hpp>
+#include <SpatialSystem.hpp>
+#include <SweepAndPrune.hpp>
+#include <TriangleBVH.hpp>
 
 namespace Kuma3D {
 
@@ -20,6 +54,36 @@ struct TestComponentB
   std::string mValue;
 };
 
+/**
+ * A System that counts how many times it has been asked to operate.
+ */
+class TestCountingSystem : public System
+{
+  public:
+    TestCountingSystem(unsigned int& aCount, double& aLastTime)
+      : mCount(aCount)
+      , mLastTime(aLastTime) {}
+
+    void Operate(Scene& aScene, double aTime) override
+    {
+      ++mCount;
+      mLastTime = aTime;
+    }
+
+  private:
+    unsigned int& mCount;
+    double& mLastTime;
+};
+
+/**
+ * A CollisionSystem that lets tests make an Entity leave it directly.
+ */
+class TestLeavingCollisionSystem : public CollisionSystem
+{
+  public:
+    using CollisionSystem::HandleEntityBecameIneligible;
+};
+
 /******************************************************************************/
 inline void TestComponentListAddition()
 {
@@ -138,6 +202,1433 @@ inline void TestSignatureRelevancyCheck()
   assert(!IsSignatureRelevant(signatureB, signatureA));
 }
 
+/******************************************************************************/
+inline void TestHeadlessGameLoop()
+{
+  // Initialize the Game without a window.
+  HeadlessOptions options;
+  options.mTimeStep = 0.5;
+  options.mMaxTicks = 10;
+  Game::InitializeHeadless(options);
+  assert(Game::IsHeadless());
+
+  // Create a Scene with a System that counts each update.
+  unsigned int count = 0;
+  double lastTime = -1.0;
+  auto scene = std::make_unique<Scene>();
+  scene->AddSystem(std::make_unique<TestCountingSystem>(count, lastTime));
+
+  // Run the Game; it should stop on its own after the maximum ticks.
+  Game::SetScene(std::move(scene));
+  Game::Run();
+
+  assert(count == 10);
+  assert(lastTime == 4.5);
+  assert(Game::GetTime() == 5.0);
+
+  Game::Uninitialize();
+  assert(!Game::IsHeadless());
+}
+
+/******************************************************************************/
+inline void TestProfilerChromeTrace()
+{
+  Profiler::Clear();
+
+  // Record a zone and a marker. The Profiler is used directly here, since
+  // the macros may be compiled out.
+  {
+    ProfileZone zone("TestZone");
+  }
+  Profiler::RecordMarker("TestMarker");
+
+  std::stringstream trace;
+  Profiler::WriteChromeTrace(trace);
+  auto text = trace.str();
+
+  assert(text.find("\"name\":\"TestZone\"") != std::string::npos);
+  assert(text.find("\"ph\":\"X\"") != std::string::npos);
+  assert(text.find("\"name\":\"TestMarker\"") != std::string::npos);
+  assert(text.find("\"ph\":\"i\"") != std::string::npos);
+
+  // Nothing should be recorded while the Profiler is disabled.
+  Profiler::Clear();
+  Profiler::SetEnabled(false);
+  Profiler::RecordMarker("DisabledMarker");
+  Profiler::SetEnabled(true);
+
+  trace.str("");
+  Profiler::WriteChromeTrace(trace);
+  assert(trace.str().find("DisabledMarker") == std::string::npos);
+}
+
+/******************************************************************************/
+inline void TestProfileBufferWrapping()
+{
+  // Once the buffer wraps around, only the newest events should be read,
+  // oldest first.
+  ProfileBuffer buffer(0);
+  auto count = ProfileBuffer::CAPACITY + 10;
+  for(std::uint64_t i = 0; i < count; ++i)
+  {
+    ProfileEvent event;
+    event.mStart = i;
+    event.mEnd = i + 1;
+    buffer.Write(event);
+  }
+
+  std::vector<ProfileEvent> events;
+  buffer.Read(events);
+  assert(events.size() == ProfileBuffer::CAPACITY);
+  assert(events.front().mStart == 10);
+  assert(events.back().mStart == count - 1);
+
+  // Reading while the owning thread keeps overwriting the buffer should
+  // never produce a partly written event.
+  std::atomic<bool> done { false };
+  std::thread writer([&buffer, &done, count]()
+  {
+    for(std::uint64_t i = count; i < 8 * count; ++i)
+    {
+      ProfileEvent event;
+      event.mStart = i;
+      event.mEnd = i + 1;
+      buffer.Write(event);
+    }
+    done = true;
+  });
+
+  while(!done)
+  {
+    events.clear();
+    buffer.Read(events);
+    for(std::size_t i = 0; i < events.size(); ++i)
+    {
+      assert(events[i].mEnd == events[i].mStart + 1);
+      assert(i == 0 || events[i].mStart > events[i - 1].mStart);
+    }
+  }
+  writer.join();
+}
+
+/******************************************************************************/
+inline void TestHitchDetector()
+{
+  HitchDetector::SetFrameBudget(0.1);
+  HitchDetector::SetHistorySize(100);
+  HitchDetector::SetCaptureSize(4);
+
+  // Record 100 frames taking 1ms through 100ms, then one hitch.
+  std::vector<SystemTiming> timings(1);
+  timings[0].mName = "TestSystem";
+  for(int i = 1; i <= 100; ++i)
+  {
+    timings[0].mSeconds = i * 0.001;
+    HitchDetector::RecordFrame(i * 0.001, timings);
+  }
+  assert(HitchDetector::GetHitchCount() == 0);
+
+  auto stats = HitchDetector::GetFrameTimeStats();
+  assert(stats.mP50 == 0.050);
+  assert(stats.mP95 == 0.095);
+  assert(stats.mP99 == 0.099);
+  assert(stats.mMax == 0.100);
+
+  HitchDetector::AddFrameEvent("Test event");
+  HitchDetector::RecordFrame(0.5, timings);
+  assert(HitchDetector::GetHitchCount() == 1);
+
+  // Only the most recent frames should be captured, along with the event.
+  std::stringstream capture;
+  HitchDetector::WriteCapture(capture);
+  auto text = capture.str();
+
+  assert(text.find("\"frame\": 97,") == std::string::npos);
+  assert(text.find("\"frame\": 98,") != std::string::npos);
+  assert(text.find("\"frame\": 101,") != std::string::npos);
+  assert(text.find("\"frame_ms\": 500.000") != std::string::npos);
+  assert(text.find("\"name\": \"TestSystem\"") != std::string::npos);
+  assert(text.find("\"Test event\"") != std::string::npos);
+
+  // Resetting should clear the history but keep the settings.
+  HitchDetector::Reset();
+  assert(HitchDetector::GetHitchCount() == 0);
+  assert(HitchDetector::GetFrameTimeStats().mMax == 0.0);
+  assert(HitchDetector::GetFrameBudget() == 0.1);
+}
+
+/******************************************************************************/
+inline void TestMetrics()
+{
+  // Counters should report both a total and a per-frame value.
+  auto& counter = Metrics::GetCounter("Test.Counter");
+  assert(&counter == &Metrics::GetCounter("Test.Counter"));
+  counter.Increment(3);
+  Metrics::EndFrame();
+  counter.Increment();
+  Metrics::EndFrame();
+  assert(counter.GetValue() == 4);
+  assert(counter.GetFrameValue() == 1);
+
+  auto& gauge = Metrics::GetGauge("Test.Gauge");
+  gauge.Set(5.0);
+  gauge.Add(-2.0);
+  assert(gauge.GetValue() == 3.0);
+
+  // A removed gauge should no longer be reported, and starts over if it's
+  // requested again.
+  Metrics::GetGauge("Test.RemovedGauge").Set(7.0);
+  Metrics::RemoveGauge("Test.RemovedGauge");
+  std::stringstream removedJSON;
+  Metrics::WriteJSON(removedJSON);
+  assert(removedJSON.str().find("Test.RemovedGauge") == std::string::npos);
+  assert(Metrics::GetGauge("Test.RemovedGauge").GetValue() == 0.0);
+  Metrics::RemoveGauge("Test.RemovedGauge");
+
+  auto& histogram = Metrics::GetHistogram("Test.Histogram", { 1.0, 2.0, 4.0 });
+  for(int i = 0; i < 10; ++i)
+  {
+    histogram.Record(i < 9 ? 1.5 : 8.0);
+  }
+  assert(histogram.GetCount() == 10);
+  assert(histogram.GetBucketCounts()[1] == 9);
+  assert(histogram.GetBucketCounts()[3] == 1);
+  assert(histogram.GetPercentile(0.5) == 2.0);
+  assert(histogram.GetPercentile(1.0) == 8.0);
+
+  // The Scene should publish the number of Entities and components.
+  Scene scene;
+  scene.RegisterComponentType<TestComponentA>();
+  auto entity = scene.CreateEntity();
+  scene.CreateEntity();
+  scene.AddComponentToEntity<TestComponentA>(entity);
+  scene.OperateSystems(0);
+  assert(Metrics::GetGauge("Scene.EntitiesAlive").GetValue() == 2.0);
+  assert(Metrics::GetGauge("Scene.Components.Kuma3D::TestComponentA").GetValue() == 1.0);
+
+  // Each Scene adds to the totals, and takes its share back when it's
+  // destroyed.
+  {
+    Scene otherScene;
+    otherScene.RegisterComponentType<TestComponentA>();
+    otherScene.AddComponentToEntity<TestComponentA>(otherScene.CreateEntity());
+    otherScene.OperateSystems(0);
+    assert(Metrics::GetGauge("Scene.EntitiesAlive").GetValue() == 3.0);
+    assert(Metrics::GetGauge("Scene.Components.Kuma3D::TestComponentA").GetValue() == 2.0);
+  }
+  assert(Metrics::GetGauge("Scene.EntitiesAlive").GetValue() == 2.0);
+  assert(Metrics::GetGauge("Scene.Components.Kuma3D::TestComponentA").GetValue() == 1.0);
+
+  std::stringstream json;
+  Metrics::WriteJSON(json);
+  assert(json.str().find("\"Test.Counter\":{\"total\":4,\"frame\":1}") != std::string::npos);
+  assert(json.str().find("\"Test.Gauge\":3") != std::string::npos);
+
+  std::stringstream csv;
+  Metrics::WriteCSV(csv);
+  assert(csv.str().find(",Test.Counter.frame,1\n") != std::string::npos);
+  assert(csv.str().find(",Test.Histogram.p50,2\n") != std::string::npos);
+}
+
+/******************************************************************************/
+inline void TestMeshHandleReferenceCounting()
+{
+  auto meshCount = MeshLoader::GetMeshCount();
+
+  {
+    std::vector<MeshVertex> vertices(3);
+    std::vector<unsigned int> indices { 0, 1, 2 };
+    auto handle = MeshLoader::LoadMesh(vertices, indices);
+    assert(handle.IsValid());
+    assert(MeshLoader::GetMeshCount() == meshCount + 1);
+    assert(MeshLoader::GetReferenceCount(handle) == 1);
+    assert(MeshLoader::GetIndices(handle).size() == 3);
+
+    // Copying a handle should add a reference, moving one shouldn't.
+    auto copy = handle;
+    assert(copy == handle);
+    assert(MeshLoader::GetReferenceCount(handle) == 2);
+    auto moved = std::move(copy);
+    assert(!copy.IsValid());
+    assert(MeshLoader::GetReferenceCount(handle) == 2);
+    moved.Reset();
+    assert(MeshLoader::GetReferenceCount(handle) == 1);
+
+    // Each Mesh component sharing the geometry should hold a reference,
+    // which is released when the component is removed.
+    Scene scene;
+    scene.RegisterComponentType<Mesh>(10);
+    Mesh meshA;
+    meshA.mGeometry = handle;
+    auto meshB = meshA;
+    auto entityA = scene.CreateEntity();
+    auto entityB = scene.CreateEntity();
+    scene.AddComponentToEntity<Mesh>(entityA, meshA);
+    scene.AddComponentToEntity<Mesh>(entityB, meshB);
+    assert(MeshLoader::GetReferenceCount(handle) == 3);
+
+    scene.RemoveComponentFromEntity<Mesh>(entityA);
+    scene.RemoveComponentFromEntity<Mesh>(entityB);
+    scene.OperateSystems(0);
+    assert(MeshLoader::GetReferenceCount(handle) == 1);
+  }
+
+  // The geometry should be freed once the last handle is destroyed.
+  assert(MeshLoader::GetMeshCount() == meshCount);
+}
+
+/******************************************************************************/
+inline void TestFreeListAllocator()
+{
+  FreeListAllocator allocator(100);
+
+  // Ranges should be allocated from the lowest free offset.
+  assert(allocator.Allocate(1, 10));
+  assert(allocator.Allocate(2, 20));
+  assert(allocator.Allocate(3, 30));
+  assert(allocator.GetBlock(2).mOffset == 10);
+  assert(allocator.GetBlock(3).mOffset == 30);
+  assert(!allocator.Allocate(4, 50));
+  assert(allocator.GetUsedSize() == 60);
+
+  // Freed ranges should be reused, and merged with their neighbors.
+  allocator.Free(2);
+  assert(allocator.GetNumFreeBlocks() == 2);
+  assert(allocator.Allocate(4, 5));
+  assert(allocator.GetBlock(4).mOffset == 10);
+  allocator.Free(1);
+  allocator.Free(4);
+  assert(allocator.GetNumFreeBlocks() == 2);
+  assert(allocator.Allocate(5, 30));
+  assert(allocator.GetBlock(5).mOffset == 0);
+
+  // Growing should extend the last free range.
+  allocator.Grow(200);
+  assert(allocator.GetNumFreeBlocks() == 1);
+  assert(allocator.Allocate(6, 140));
+  assert(allocator.GetBlock(6).mOffset == 60);
+
+  // Compacting should move the last range into the first hole it fits in.
+  allocator.Free(5);
+  FreeListAllocator::Move move;
+  assert(!allocator.Compact(move));
+  allocator.Free(3);
+  assert(allocator.Compact(move) == false);
+  allocator.Free(6);
+  assert(allocator.Allocate(7, 10));
+  assert(allocator.Allocate(8, 10));
+  allocator.Free(7);
+  assert(allocator.Compact(move));
+  assert(move.mID == 8);
+  assert(move.mOldOffset == 10);
+  assert(move.mNewOffset == 0);
+  assert(allocator.GetBlock(8).mOffset == 0);
+  assert(allocator.GetNumFreeBlocks() == 1);
+  assert(!allocator.Compact(move));
+
+  bool threw = false;
+  try
+  {
+    allocator.Allocate(8, 10);
+  }
+  catch(const std::invalid_argument&)
+  {
+    threw = true;
+  }
+  assert(threw);
+}
+
+/******************************************************************************/
+inline void TestRadixSort()
+{
+  // Use few distinct values in the low bits to check that the sort is
+  // stable, and leave some digits constant so that passes get skipped.
+  std::mt19937_64 generator(42);
+  std::vector<std::pair<std::uint64_t, int>> items;
+  for(int i = 0; i < 1000; ++i)
+  {
+    auto key = (generator() & 0xffff0000ff000000) | (generator() % 4);
+    items.emplace_back(key, i);
+  }
+
+  auto expected = items;
+  std::stable_sort(expected.begin(), expected.end(), [](const auto& aA, const auto& aB)
+  {
+    return aA.first < aB.first;
+  });
+
+  std::vector<std::pair<std::uint64_t, int>> scratch;
+  RadixSort(items, scratch, [](const std::pair<std::uint64_t, int>& aItem)
+  {
+    return aItem.first;
+  });
+  assert(items == expected);
+}
+
+/******************************************************************************/
+inline void TestRenderQueueOrder()
+{
+  RenderQueue queue;
+  auto shaderA = queue.InternShaders({ 1 });
+  auto shaderB = queue.InternShaders({ 2 });
+  assert(queue.InternShaders({ 1 }) == shaderA);
+  assert(queue.InternGeometry(5) != 0);
+
+  auto makePacket = [](Entity aEntity, unsigned int aShaderSet, float aDepth, bool aTransparent)
+  {
+    DrawPacket packet;
+    packet.mEntity = aEntity;
+    packet.mShaderSet = aShaderSet;
+    packet.mDepth = aDepth;
+    packet.mHasTransparency = aTransparent;
+    return packet;
+  };
+
+  queue.Add(makePacket(1, shaderB, 0.5, true));
+  queue.Add(makePacket(2, shaderB, 0.9, false));
+  queue.Add(makePacket(3, shaderA, 0.7, false));
+  queue.Add(makePacket(4, shaderB, 0.1, false));
+  queue.Add(makePacket(5, shaderA, 0.8, true));
+  queue.Add(makePacket(6, shaderA, 0.2, false));
+  queue.Sort();
+
+  // Opaque packets should be grouped by shader and drawn front-to-back;
+  // transparent packets should come last, drawn back-to-front.
+  std::vector<Entity> expected { 6, 3, 4, 2, 5, 1 };
+  assert(queue.GetNumPackets() == expected.size());
+  for(std::size_t i = 0; i < expected.size(); ++i)
+  {
+    assert(queue.GetPacket(i).mEntity == expected[i]);
+  }
+}
+
+/******************************************************************************/
+inline void TestRenderQueueCoherentSort()
+{
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> depths(0.0, 1.0);
+  std::uniform_real_distribution<float> jitter(-0.0001, 0.0001);
+
+  std::map<Entity, float> entityDepths;
+  for(Entity entity = 1; entity <= 2000; ++entity)
+  {
+    entityDepths[entity] = depths(generator);
+  }
+
+  // Fills a queue with a transparent packet for each Entity, and checks
+  // that sorting from a previous order matches sorting from scratch.
+  auto sortEntities = [&entityDepths](DrawOrder& aDrawOrder)
+  {
+    RenderQueue coherentQueue;
+    RenderQueue queue;
+    for(const auto& entityDepth : entityDepths)
+    {
+      DrawPacket packet;
+      packet.mEntity = entityDepth.first;
+      packet.mDepth = entityDepth.second;
+      packet.mHasTransparency = (entityDepth.first % 2 == 0);
+      coherentQueue.Add(packet);
+      queue.Add(packet);
+    }
+
+    auto reused = coherentQueue.Sort(aDrawOrder);
+    queue.Sort();
+    assert(aDrawOrder.mEntities.size() == queue.GetNumPackets());
+    for(std::size_t i = 0; i < queue.GetNumPackets(); ++i)
+    {
+      assert(coherentQueue.GetPacket(i).mEntity == queue.GetPacket(i).mEntity);
+      assert(aDrawOrder.mEntities[i] == queue.GetPacket(i).mEntity);
+    }
+    return reused;
+  };
+
+  // Without a previous order, the packets are sorted from scratch.
+  DrawOrder drawOrder;
+  assert(!sortEntities(drawOrder));
+
+  // Small movements, along with some Entities coming and going, reuse the
+  // previous order.
+  for(auto& entityDepth : entityDepths)
+  {
+    entityDepth.second += jitter(generator);
+  }
+  entityDepths.erase(10);
+  entityDepths.erase(11);
+  entityDepths[5000] = 0.5;
+  assert(sortEntities(drawOrder));
+
+  // Large movements sort the packets from scratch, and the next sort
+  // doesn't try to reuse the order.
+  for(auto& entityDepth : entityDepths)
+  {
+    entityDepth.second = depths(generator);
+  }
+  assert(!sortEntities(drawOrder));
+  assert(!sortEntities(drawOrder));
+  assert(sortEntities(drawOrder));
+}
+
+/******************************************************************************/
+inline void TestUniformIDs()
+{
+  // The same name should always map to the same ID.
+  auto modelMatrix = ShaderLoader::GetUniformID("modelMatrix");
+  auto viewMatrix = ShaderLoader::GetUniformID("viewMatrix");
+  assert(modelMatrix != viewMatrix);
+  assert(ShaderLoader::GetUniformID("modelMatrix") == modelMatrix);
+
+  // Programs that were never linked don't define any uniforms.
+  assert(ShaderLoader::GetUniformLocation(12345, modelMatrix) == -1);
+  assert(!ShaderLoader::IsUniformDefined(12345, viewMatrix));
+  assert(!ShaderLoader::IsUniformBlockDefined(12345, UniformBlock::eCAMERA));
+
+  // Names that weren't recorded at link time, like later array elements,
+  // are looked up on first use; that lookup shouldn't record anything for
+  // a program that was never linked.
+  assert(!ShaderLoader::IsUniformDefined(12345, "values[2]"));
+  assert(ShaderLoader::GetUniformLocation(12345, ShaderLoader::GetUniformID("values[2]")) == -1);
+}
+
+/******************************************************************************/
+inline void TestJobSystemParallelFor()
+{
+  JobSystem::Initialize(3);
+
+  // Every index should be visited exactly once, whether or not the range
+  // divides evenly into batches.
+  for(std::size_t count : { 0, 1, 100, 1000, 4097 })
+  {
+    std::vector<std::atomic<int>> visits(count);
+    JobSystem::ParallelFor(count, 64, [&visits](std::size_t aStart, std::size_t aEnd)
+    {
+      for(auto i = aStart; i < aEnd; ++i)
+      {
+        ++visits[i];
+      }
+    });
+
+    for(const auto& visit : visits)
+    {
+      assert(visit == 1);
+    }
+  }
+
+  JobSystem::Uninitialize();
+  assert(JobSystem::GetNumThreads() == 0);
+}
+
+/******************************************************************************/
+inline void TestFrustumCulling()
+{
+  // The identity matrix's frustum is the cube from -1 to 1 on each axis.
+  auto frustum = CalculateFrustum(Mat4());
+
+  AABB inside;
+  Expand(inside, Vec3(-0.5, -0.5, -0.5));
+  Expand(inside, Vec3(0.5, 0.5, 0.5));
+  assert(Intersects(frustum, inside));
+
+  AABB outside;
+  Expand(outside, Vec3(2.0, -0.5, -0.5));
+  Expand(outside, Vec3(3.0, 0.5, 0.5));
+  assert(!Intersects(frustum, outside));
+
+  AABB overlapping;
+  Expand(overlapping, Vec3(0.5, 0.5, 0.5));
+  Expand(overlapping, Vec3(3.0, 3.0, 3.0));
+  assert(Intersects(frustum, overlapping));
+
+  // The culler should agree with Intersects() for every box, including
+  // when the boxes are split across several threads.
+  JobSystem::Initialize(3);
+
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> position(-4.0, 4.0);
+  std::uniform_real_distribution<float> size(0.0, 1.0);
+
+  FrustumCuller culler;
+  std::vector<AABB> boxes;
+  for(int i = 0; i < 5003; ++i)
+  {
+    AABB box;
+    Vec3 corner(position(generator), position(generator), position(generator));
+    Expand(box, corner);
+    Expand(box, Vec3(corner.x + size(generator),
+                     corner.y + size(generator),
+                     corner.z + size(generator)));
+    assert(culler.Add(box) == boxes.size());
+    boxes.push_back(box);
+  }
+  assert(culler.GetSize() == boxes.size());
+
+  std::vector<unsigned char> visible;
+  auto numVisible = culler.Cull(frustum, visible);
+  assert(visible.size() == boxes.size());
+
+  std::size_t expectedVisible = 0;
+  for(std::size_t i = 0; i < boxes.size(); ++i)
+  {
+    auto expected = Intersects(frustum, boxes[i]);
+    assert(visible[i] == (expected ? 1 : 0));
+    expectedVisible += expected ? 1 : 0;
+  }
+  assert(numVisible == expectedVisible);
+  assert(numVisible > 0 && numVisible < boxes.size());
+
+  JobSystem::Uninitialize();
+}
+
+/******************************************************************************/
+inline void TestOcclusionCulling()
+{
+  JobSystem::Initialize(3);
+
+  // A square facing the camera, 4 units wide.
+  std::vector<MeshVertex> vertices(4);
+  vertices[0].mPosition = Vec3(-2.0, -2.0, 0.0);
+  vertices[1].mPosition = Vec3(2.0, -2.0, 0.0);
+  vertices[2].mPosition = Vec3(2.0, 2.0, 0.0);
+  vertices[3].mPosition = Vec3(-2.0, 2.0, 0.0);
+  std::vector<unsigned int> indices { 0, 1, 2, 0, 2, 3 };
+
+  auto makeBox = [](const Vec3& aMin, const Vec3& aMax)
+  {
+    AABB box;
+    Expand(box, aMin);
+    Expand(box, aMax);
+    return box;
+  };
+
+  // Place the square 5 units in front of a camera at the origin, which
+  // looks along the negative z-axis.
+  Camera camera;
+  OcclusionCuller culler;
+  culler.Begin(Perspective(camera));
+
+  // With no occluders, everything is visible.
+  auto behind = makeBox(Vec3(-0.5, -0.5, -11.0), Vec3(0.5, 0.5, -10.0));
+  assert(culler.IsVisible(behind));
+
+  culler.AddOccluder(vertices, indices, Translate(Vec3(0.0, 0.0, -5.0)));
+  assert(culler.GetNumTriangles() == 2);
+  culler.Rasterize();
+
+  // Boxes entirely behind the square are hidden; boxes in front of it, or
+  // poking out from behind it, aren't.
+  assert(!culler.IsVisible(behind));
+  assert(culler.IsVisible(makeBox(Vec3(-0.5, -0.5, -4.0), Vec3(0.5, 0.5, -3.0))));
+  assert(culler.IsVisible(makeBox(Vec3(3.0, -0.5, -11.0), Vec3(4.0, 0.5, -10.0))));
+  assert(culler.IsVisible(makeBox(Vec3(-0.5, -0.5, -6.0), Vec3(0.5, 0.5, -4.0))));
+  assert(culler.IsVisible(makeBox(Vec3(-0.5, -0.5, -11.0), Vec3(6.0, 0.5, -10.0))));
+
+  // Boxes crossing the near plane are always visible.
+  assert(culler.IsVisible(makeBox(Vec3(-0.5, -0.5, -1.0), Vec3(0.5, 0.5, 1.0))));
+
+  // Occluders crossing the near plane are skipped entirely.
+  culler.Begin(Perspective(camera));
+  culler.AddOccluder(vertices, indices, Translate(Vec3(0.0, 0.0, -0.05)));
+  assert(culler.GetNumTriangles() == 0);
+
+  JobSystem::Uninitialize();
+}
+
+/******************************************************************************/
+inline void TestDynamicBVH()
+{
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> position(-50.0, 50.0);
+  std::uniform_real_distribution<float> size(0.1, 3.0);
+  auto randomBox = [&generator, &position, &size]()
+  {
+    AABB box;
+    Vec3 corner(position(generator), position(generator), position(generator));
+    Expand(box, corner);
+    Expand(box, Vec3(corner.x + size(generator),
+                     corner.y + size(generator),
+                     corner.z + size(generator)));
+    return box;
+  };
+
+  // Compares the results of each query against a brute force search.
+  std::map<Entity, AABB> boxes;
+  auto checkQueries = [&boxes](const DynamicBVH& aTree)
+  {
+    AABB queryBox;
+    Expand(queryBox, Vec3(-20.0, -10.0, -30.0));
+    Expand(queryBox, Vec3(10.0, 25.0, 5.0));
+    Sphere querySphere { Vec3(5.0, -5.0, 0.0), 15.0 };
+
+    std::vector<Entity> boxResults;
+    std::vector<Entity> sphereResults;
+    aTree.Query(queryBox, boxResults);
+    aTree.Query(querySphere, sphereResults);
+    std::sort(boxResults.begin(), boxResults.end());
+    std::sort(sphereResults.begin(), sphereResults.end());
+
+    std::vector<Entity> expectedBoxResults;
+    std::vector<Entity> expectedSphereResults;
+    for(const auto& box : boxes)
+    {
+      if(Intersects(queryBox, box.second))
+      {
+        expectedBoxResults.emplace_back(box.first);
+      }
+      if(Intersects(querySphere, box.second))
+      {
+        expectedSphereResults.emplace_back(box.first);
+      }
+    }
+
+    assert(boxResults == expectedBoxResults);
+    assert(sphereResults == expectedSphereResults);
+    assert(!boxResults.empty());
+  };
+
+  DynamicBVH tree;
+  assert(tree.GetHeight() == -1);
+
+  std::map<Entity, int> proxies;
+  for(Entity entity = 0; entity < 500; ++entity)
+  {
+    boxes[entity] = randomBox();
+    proxies[entity] = tree.CreateProxy(boxes[entity], entity);
+  }
+  assert(tree.GetNumProxies() == 500);
+  checkQueries(tree);
+
+  // Small moves stay within each fat box; large moves don't.
+  auto& firstBox = boxes[0];
+  firstBox.mMin.x += 0.05f;
+  firstBox.mMax.x += 0.05f;
+  assert(!tree.MoveProxy(proxies[0], firstBox));
+  for(Entity entity = 0; entity < 500; entity += 2)
+  {
+    boxes[entity] = randomBox();
+    tree.MoveProxy(proxies[entity], boxes[entity]);
+  }
+  checkQueries(tree);
+
+  // Removed boxes are no longer found, and the others keep their IDs.
+  for(Entity entity = 1; entity < 500; entity += 3)
+  {
+    tree.DestroyProxy(proxies[entity]);
+    proxies.erase(entity);
+    boxes.erase(entity);
+  }
+  assert(tree.GetNumProxies() == boxes.size());
+  checkQueries(tree);
+
+  // Rebuilding balances the tree without changing the results.
+  tree.Rebuild();
+  assert(tree.GetHeight() <= static_cast<int>(std::ceil(std::log2(boxes.size()))));
+  checkQueries(tree);
+  for(const auto& proxy : proxies)
+  {
+    assert(tree.GetEntity(proxy.second) == proxy.first);
+  }
+
+  bool destroyFailed = false;
+  try
+  {
+    tree.DestroyProxy(12345);
+  }
+  catch(const std::exception& e)
+  {
+    destroyFailed = true;
+  }
+  assert(destroyFailed);
+}
+
+/******************************************************************************/
+inline void TestSpatialSystem()
+{
+  Scene scene;
+  auto system = std::make_unique<SpatialSystem>();
+  auto spatialSystem = system.get();
+  scene.AddSystem(std::move(system));
+
+  // Create a row of unit boxes, one every 10 units along the x-axis.
+  AABB unitBox;
+  Expand(unitBox, Vec3(-0.5, -0.5, -0.5));
+  Expand(unitBox, Vec3(0.5, 0.5, 0.5));
+
+  std::vector<Entity> entities;
+  for(int i = 0; i < 10; ++i)
+  {
+    auto entity = scene.CreateEntity();
+    Transform transform;
+    transform.mPosition = Vec3(i * 10.0, 0.0, 0.0);
+    scene.AddComponentToEntity<Transform>(entity, transform);
+    Bounds bounds;
+    bounds.mBox = unitBox;
+    scene.AddComponentToEntity<Bounds>(entity, bounds);
+    entities.emplace_back(entity);
+  }
+
+  // The Entities join the System at the end of the first update, and are
+  // added to the tree during the second.
+  scene.OperateSystems(0);
+  scene.OperateSystems(0);
+
+  std::vector<Entity> results;
+  spatialSystem->Query(Sphere { Vec3(20.0, 0.0, 0.0), 2.0 }, results);
+  assert(results.size() == 1 && results[0] == entities[2]);
+
+  // Moving an Entity moves its bounds on the next update.
+  scene.GetComponentForEntity<Transform>(entities[2]).mPosition = Vec3(0.0, 50.0, 0.0);
+  scene.OperateSystems(0);
+  results.clear();
+  spatialSystem->Query(Sphere { Vec3(20.0, 0.0, 0.0), 2.0 }, results);
+  assert(results.empty());
+  spatialSystem->Query(Sphere { Vec3(0.0, 50.0, 0.0), 2.0 }, results);
+  assert(results.size() == 1 && results[0] == entities[2]);
+
+  // Scaling an Entity scales its bounds.
+  scene.GetComponentForEntity<Transform>(entities[5]).mScalar = Vec3(10.0, 1.0, 1.0);
+  scene.OperateSystems(0);
+  results.clear();
+  spatialSystem->Query(Sphere { Vec3(46.0, 0.0, 0.0), 0.5 }, results);
+  assert(results.size() == 1 && results[0] == entities[5]);
+
+  // Removed Entities are no longer found.
+  scene.RemoveEntity(entities[0]);
+  scene.OperateSystems(0);
+  results.clear();
+  spatialSystem->Query(unitBox, results);
+  assert(results.empty());
+  assert(spatialSystem->GetTree().GetNumProxies() == 9);
+}
+
+inline void TestTriangleBVH()
+{
+  // Create a bumpy grid of triangles.
+  std::vector<MeshVertex> vertices;
+  std::vector<unsigned int> indices;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> heights(-0.5, 0.5);
+  const unsigned int size = 20;
+  for(unsigned int y = 0; y <= size; ++y)
+  {
+    for(unsigned int x = 0; x <= size; ++x)
+    {
+      MeshVertex vertex;
+      vertex.mPosition = Vec3(x, y, heights(generator));
+      vertices.emplace_back(vertex);
+    }
+  }
+  for(unsigned int y = 0; y < size; ++y)
+  {
+    for(unsigned int x = 0; x < size; ++x)
+    {
+      auto corner = y * (size + 1) + x;
+      indices.insert(indices.end(), { corner, corner + 1, corner + size + 2,
+                                      corner, corner + size + 2, corner + size + 1 });
+    }
+  }
+
+  TriangleBVH tree;
+  tree.Build(vertices, indices);
+  assert(tree.GetNumTriangles() == size * size * 2);
+
+  // Cast rays down at the grid from random points, comparing the tree
+  // against testing every triangle.
+  std::uniform_real_distribution<float> positions(-2.0, size + 2.0);
+  std::vector<Ray> rays;
+  for(int i = 0; i < 64; ++i)
+  {
+    Ray ray;
+    ray.mOrigin = Vec3(positions(generator), positions(generator), 10.0);
+    ray.mDirection = Normalize(Vec3(heights(generator), heights(generator), -1.0));
+    rays.emplace_back(ray);
+  }
+
+  std::vector<float> distances;
+  for(const auto& ray : rays)
+  {
+    auto expectedHit = false;
+    auto expectedDistance = 100.0f;
+    for(std::size_t i = 0; i < indices.size(); i += 3)
+    {
+      float distance;
+      if(Intersects(ray,
+                    vertices[indices[i]].mPosition,
+                    vertices[indices[i + 1]].mPosition,
+                    vertices[indices[i + 2]].mPosition,
+                    expectedDistance,
+                    distance))
+      {
+        expectedHit = true;
+        expectedDistance = distance;
+      }
+    }
+
+    float distance = -1.0;
+    auto hit = tree.Raycast(ray, 100.0, distance);
+    assert(hit == expectedHit);
+    if(hit)
+    {
+      assert(std::abs(distance - expectedDistance) < 0.0001);
+    }
+    distances.emplace_back(hit ? distance : -1.0f);
+  }
+
+  // Packets of rays find the same hits as single rays.
+  for(std::size_t start = 0; start < rays.size(); start += 4)
+  {
+    auto packet = MakeRayPacket(&rays[start], 4, 100.0);
+    auto mask = tree.Raycast(packet);
+
+    float packetDistances[4];
+    StoreFloat4(packetDistances, packet.mMaxDistance);
+    for(int lane = 0; lane < 4; ++lane)
+    {
+      auto expected = distances[start + lane];
+      assert(((mask & (1 << lane)) != 0) == (expected >= 0.0));
+      if(expected >= 0.0)
+      {
+        assert(std::abs(packetDistances[lane] - expected) < 0.0001);
+      }
+    }
+  }
+}
+
+inline void TestSceneRaycast()
+{
+  Scene scene;
+  scene.RegisterComponentType<Mesh>();
+
+  // Raycasting requires a SpatialSystem.
+  Ray ray;
+  RaycastHit hit;
+  auto threw = false;
+  try
+  {
+    scene.Raycast(ray, hit);
+  }
+  catch(const std::runtime_error&)
+  {
+    threw = true;
+  }
+  assert(threw);
+
+  scene.AddSystem(std::make_unique<SpatialSystem>());
+  assert(scene.GetSystem<SpatialSystem>() != nullptr);
+
+  // Create a right triangle from (0, 0) to (1, 1) facing the z-axis.
+  Mesh triangle;
+  triangle.mVertices.resize(3);
+  triangle.mVertices[1].mPosition = Vec3(1.0, 0.0, 0.0);
+  triangle.mVertices[2].mPosition = Vec3(0.0, 1.0, 0.0);
+  triangle.mIndices = { 0, 1, 2 };
+
+  Bounds triangleBounds;
+  triangleBounds.mBox = MeshLoader::CalculateBounds(triangle.mVertices);
+
+  // Place two triangles, one behind the other, and a box to the side
+  // with no Mesh.
+  std::vector<Entity> entities;
+  for(int i = 0; i < 3; ++i)
+  {
+    auto entity = scene.CreateEntity();
+    Transform transform;
+    transform.mPosition = Vec3(i == 2 ? 5.0 : 0.0, 0.0, -5.0 * (i + 1));
+    scene.AddComponentToEntity<Transform>(entity, transform);
+    scene.AddComponentToEntity<Bounds>(entity, triangleBounds);
+    if(i < 2)
+    {
+      auto mesh = triangle;
+      scene.AddComponentToEntity<Mesh>(entity, mesh);
+    }
+    entities.emplace_back(entity);
+  }
+
+  scene.OperateSystems(0);
+  scene.OperateSystems(0);
+
+  // The nearer triangle is hit.
+  ray.mOrigin = Vec3(0.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit));
+  assert(hit.mEntity == entities[0]);
+  assert(std::abs(hit.mDistance - 5.0) < 0.0001);
+  assert(std::abs(hit.mPosition.z + 5.0) < 0.0001);
+
+  // Rays limited to a shorter distance miss it.
+  assert(!scene.Raycast(ray, hit, 4.0));
+  assert(!hit.mHit);
+
+  // Rays that pass through the triangles' bounds but not the triangles
+  // miss, while rays through the box without a Mesh hit the box.
+  ray.mOrigin = Vec3(0.75, 0.75, 0.0);
+  assert(!scene.Raycast(ray, hit));
+  ray.mOrigin = Vec3(5.75, 0.75, 0.0);
+  assert(scene.Raycast(ray, hit));
+  assert(hit.mEntity == entities[2]);
+  assert(std::abs(hit.mDistance - 15.0) < 0.0001);
+
+  // Moving the nearer triangle away reveals the one behind it.
+  scene.GetComponentForEntity<Transform>(entities[0]).mPosition = Vec3(0.0, 10.0, -5.0);
+  scene.OperateSystems(0);
+  ray.mOrigin = Vec3(0.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit));
+  assert(hit.mEntity == entities[1]);
+  assert(std::abs(hit.mDistance - 10.0) < 0.0001);
+
+  // Rotated and scaled triangles are hit in world space.
+  auto& transform = scene.GetComponentForEntity<Transform>(entities[0]);
+  transform.mPosition = Vec3(0.0, 0.0, -5.0);
+  transform.mRotation = AxisAngle(Vec3(0.0, 1.0, 0.0), 180.0);
+  transform.mScalar = Vec3(2.0, 2.0, 2.0);
+  scene.OperateSystems(0);
+  ray.mOrigin = Vec3(-1.5, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit));
+  assert(hit.mEntity == entities[0]);
+  assert(std::abs(hit.mDistance - 5.0) < 0.0001);
+
+  // A batch of rays finds the same hits as casting each one.
+  std::vector<Ray> rays;
+  for(int i = 0; i < 11; ++i)
+  {
+    Ray batchRay;
+    batchRay.mOrigin = Vec3(-2.0 + i * 0.75, 0.25, 0.0);
+    rays.emplace_back(batchRay);
+  }
+
+  std::vector<RaycastHit> hits;
+  scene.Raycast(rays, hits);
+  assert(hits.size() == rays.size());
+  auto numHits = 0;
+  for(std::size_t i = 0; i < rays.size(); ++i)
+  {
+    RaycastHit expected;
+    scene.Raycast(rays[i], expected);
+    assert(hits[i].mHit == expected.mHit);
+    if(expected.mHit)
+    {
+      assert(hits[i].mEntity == expected.mEntity);
+      assert(std::abs(hits[i].mDistance - expected.mDistance) < 0.0001);
+      ++numHits;
+    }
+  }
+  assert(numHits > 0);
+}
+
+/******************************************************************************/
+inline void TestSceneRaycastMeshEdits()
+{
+  // The RenderSystem clears each Mesh's dirty flag before the SpatialSystem
+  // runs, which shouldn't stop edited Meshes from being raycast correctly.
+  HeadlessOptions options;
+  Game::InitializeHeadless(options);
+
+  Scene scene;
+  scene.AddSystem(std::make_unique<RenderSystem>());
+  scene.AddSystem(std::make_unique<SpatialSystem>());
+
+  // Create a right triangle from (0, 0) to (1, 1) facing the z-axis, one
+  // stored on its Mesh and one shared through the MeshLoader.
+  Mesh triangle;
+  triangle.mVertices.resize(3);
+  triangle.mVertices[1].mPosition = Vec3(1.0, 0.0, 0.0);
+  triangle.mVertices[2].mPosition = Vec3(0.0, 1.0, 0.0);
+  triangle.mIndices = { 0, 1, 2 };
+  auto sharedGeometry = MeshLoader::LoadMesh(triangle.mVertices, triangle.mIndices);
+
+  Bounds bounds;
+  Expand(bounds.mBox, Vec3(-5.0, -5.0, 0.0));
+  Expand(bounds.mBox, Vec3(5.0, 5.0, 0.0));
+
+  std::vector<Entity> entities;
+  for(int i = 0; i < 2; ++i)
+  {
+    auto entity = scene.CreateEntity();
+    Transform transform;
+    transform.mPosition = Vec3(i * 20.0, 0.0, -5.0);
+    scene.AddComponentToEntity<Transform>(entity, transform);
+    scene.AddComponentToEntity<Bounds>(entity, bounds);
+    auto mesh = triangle;
+    if(i == 1)
+    {
+      mesh.mVertices.clear();
+      mesh.mIndices.clear();
+      mesh.mGeometry = sharedGeometry;
+    }
+    scene.AddComponentToEntity<Mesh>(entity, mesh);
+    entities.emplace_back(entity);
+  }
+
+  scene.OperateSystems(0);
+  scene.OperateSystems(0);
+
+  Ray ray;
+  RaycastHit hit;
+  ray.mOrigin = Vec3(0.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[0]);
+  ray.mOrigin = Vec3(20.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[1]);
+
+  // Move each triangle 2 units along the x-axis by editing its geometry.
+  auto movedVertices = triangle.mVertices;
+  for(auto& vertex : movedVertices)
+  {
+    vertex.mPosition.x += 2.0;
+  }
+  auto& entityMesh = scene.GetComponentForEntity<Mesh>(entities[0]);
+  entityMesh.mVertices = movedVertices;
+  entityMesh.mDirty = true;
+  MeshLoader::UpdateMesh(sharedGeometry, movedVertices, triangle.mIndices);
+  scene.OperateSystems(0);
+  assert(!entityMesh.mDirty);
+
+  ray.mOrigin = Vec3(0.25, 0.25, 0.0);
+  assert(!scene.Raycast(ray, hit));
+  ray.mOrigin = Vec3(2.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[0]);
+  ray.mOrigin = Vec3(20.25, 0.25, 0.0);
+  assert(!scene.Raycast(ray, hit));
+  ray.mOrigin = Vec3(22.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[1]);
+
+  // Move the first triangle back. Raycasts should see the change before the
+  // RenderSystem picks it up, and still see it afterward.
+  entityMesh.mVertices = triangle.mVertices;
+  entityMesh.mDirty = true;
+  ray.mOrigin = Vec3(0.25, 0.25, 0.0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[0]);
+  scene.OperateSystems(0);
+  assert(scene.Raycast(ray, hit) && hit.mEntity == entities[0]);
+  ray.mOrigin = Vec3(2.25, 0.25, 0.0);
+  assert(!scene.Raycast(ray, hit));
+
+  Game::Uninitialize();
+}
+
+/******************************************************************************/
+inline void TestRigidBodyIntegration()
+{
+  // Moving the bodies in groups of four should match moving them one at a
+  // time, including for the bodies left over at the end.
+  RigidBodyStreams streams;
+  std::vector<RigidBody> bodies;
+  std::vector<Vec3> positions;
+  for(int i = 0; i < 7; ++i)
+  {
+    RigidBody body;
+    body.mVelocity = Vec3(i * 0.5, 1.0, -2.0);
+    body.mAcceleration = Vec3(0.0, -10.0, i);
+    body.mLinearDamping = i * 0.25;
+    Vec3 position(i, 0.0, 0.0);
+    assert(streams.Add(position, body, 0.05) == bodies.size());
+    bodies.emplace_back(body);
+    positions.emplace_back(position);
+  }
+
+  // Leave a body out of the range to make sure it isn't moved.
+  IntegrateBodies(streams, 0, 6, 0.125);
+  for(std::size_t i = 0; i < 6; ++i)
+  {
+    auto drag = 1.0 / (1.0 + bodies[i].mLinearDamping * 0.125);
+    auto velocity = (bodies[i].mVelocity + bodies[i].mAcceleration * 0.125) * drag;
+    auto position = positions[i] + velocity * 0.125;
+    assert(std::abs(streams.mVelocityX[i] - velocity.x) < 0.0001);
+    assert(std::abs(streams.mVelocityY[i] - velocity.y) < 0.0001);
+    assert(std::abs(streams.mVelocityZ[i] - velocity.z) < 0.0001);
+    assert(std::abs(streams.mPositionX[i] - position.x) < 0.0001);
+    assert(std::abs(streams.mPositionY[i] - position.y) < 0.0001);
+    assert(std::abs(streams.mPositionZ[i] - position.z) < 0.0001);
+    assert(streams.mSleepTime[i] == 0.0);
+  }
+  assert(streams.mPositionX[6] == 6.0 && streams.mVelocityY[6] == 1.0);
+
+  // Slow bodies build up sleep time, unless they can never sleep.
+  RigidBody slowBody;
+  slowBody.mVelocity = Vec3(0.01, 0.0, 0.0);
+  auto restingIndex = streams.Add(Vec3(), slowBody, 0.05);
+  auto restlessIndex = streams.Add(Vec3(), slowBody, -1.0);
+  IntegrateBodies(streams, 0, streams.Size(), 0.125);
+  IntegrateBodies(streams, 0, streams.Size(), 0.125);
+  assert(streams.mSleepTime[restingIndex] == 0.25);
+  assert(streams.mSleepTime[restlessIndex] == 0.0);
+
+  // Slow bodies that are accelerating don't rest either.
+  slowBody.mAcceleration = Vec3(0.0, 0.001, 0.0);
+  auto acceleratingIndex = streams.Add(Vec3(), slowBody, 0.05);
+  IntegrateBodies(streams, acceleratingIndex, streams.Size(), 0.125);
+  assert(streams.mSleepTime[acceleratingIndex] == 0.0);
+  streams.PopBack();
+
+  // Swapping and removing bodies keeps the rest of their state together.
+  streams.Swap(0, restingIndex);
+  assert(streams.mSleepTime[0] == 0.25 && streams.mPositionY[restingIndex] != 0.0);
+  streams.PopBack();
+  assert(streams.Size() == 8);
+}
+
+/******************************************************************************/
+inline void TestPhysicsSystem()
+{
+  Scene scene;
+  scene.RegisterComponentType<Transform>(20000);
+  scene.RegisterComponentType<RigidBody>(20000);
+  auto system = std::make_unique<PhysicsSystem>();
+  auto physicsSystem = system.get();
+  physicsSystem->SetTimeStep(0.125);
+  scene.AddSystem(std::move(system));
+
+  // A falling body, a slow body that falls asleep, and a slow body that
+  // isn't allowed to.
+  auto createBody = [&scene](const Vec3& aVelocity, const Vec3& aAcceleration, bool aCanSleep)
+  {
+    auto entity = scene.CreateEntity();
+    Transform transform;
+    scene.AddComponentToEntity<Transform>(entity, transform);
+    RigidBody body;
+    body.mVelocity = aVelocity;
+    body.mAcceleration = aAcceleration;
+    body.mCanSleep = aCanSleep;
+    scene.AddComponentToEntity<RigidBody>(entity, body);
+    return entity;
+  };
+  auto falling = createBody(Vec3(), Vec3(0.0, -8.0, 0.0), true);
+  auto resting = createBody(Vec3(0.01, 0.0, 0.0), Vec3(), true);
+  auto restless = createBody(Vec3(0.01, 0.0, 0.0), Vec3(), false);
+
+  // The Entities join the System at the end of the first update, and their
+  // bodies are added during the second.
+  scene.OperateSystems(0.0);
+  scene.OperateSystems(0.0);
+  assert(physicsSystem->GetNumAwakeBodies() == 3);
+
+  // Bodies only move in whole time steps.
+  scene.OperateSystems(0.1);
+  assert(scene.GetComponentForEntity<Transform>(falling).mPosition.y == 0.0);
+  scene.OperateSystems(0.125);
+  assert(scene.GetComponentForEntity<RigidBody>(falling).mVelocity.y == -1.0);
+  assert(scene.GetComponentForEntity<Transform>(falling).mPosition.y == -0.125);
+
+  // Long frames are limited to a few steps.
+  scene.OperateSystems(10.0);
+  assert(scene.GetComponentForEntity<RigidBody>(falling).mVelocity.y == -5.0);
+
+  // After half a second of moving slowly, a body falls asleep and stops.
+  assert(scene.GetComponentForEntity<RigidBody>(resting).mSleeping);
+  assert(scene.GetComponentForEntity<RigidBody>(resting).mVelocity.x == 0.0);
+  assert(!scene.GetComponentForEntity<RigidBody>(restless).mSleeping);
+  assert(physicsSystem->GetNumAwakeBodies() == 2);
+
+  auto sleepingPosition = scene.GetComponentForEntity<Transform>(resting).mPosition;
+  auto restlessPosition = scene.GetComponentForEntity<Transform>(restless).mPosition;
+  scene.OperateSystems(10.125);
+  assert(scene.GetComponentForEntity<Transform>(resting).mPosition.x == sleepingPosition.x);
+  assert(scene.GetComponentForEntity<Transform>(restless).mPosition.x > restlessPosition.x);
+
+  // Waking a body reloads it from its components.
+  scene.GetComponentForEntity<RigidBody>(resting).mVelocity = Vec3(0.0, 0.0, 4.0);
+  physicsSystem->WakeBody(scene, resting);
+  assert(physicsSystem->GetNumAwakeBodies() == 3);
+  scene.OperateSystems(10.25);
+  assert(!scene.GetComponentForEntity<RigidBody>(resting).mSleeping);
+  assert(scene.GetComponentForEntity<Transform>(resting).mPosition.z == 0.5);
+
+  // Changes made to an awake body's components are picked up on the next
+  // frame rather than overwritten.
+  scene.GetComponentForEntity<Transform>(restless).mPosition = Vec3(50.0, 0.0, 0.0);
+  scene.GetComponentForEntity<RigidBody>(restless).mVelocity = Vec3(8.0, 0.0, 0.0);
+
+  // Removing a body leaves the others in place.
+  scene.RemoveEntity(falling);
+  scene.OperateSystems(10.375);
+  assert(physicsSystem->GetNumAwakeBodies() == 2);
+  assert(scene.GetComponentForEntity<Transform>(resting).mPosition.z == 1.0);
+  assert(scene.GetComponentForEntity<Transform>(restless).mPosition.x == 51.0);
+  assert(scene.GetComponentForEntity<RigidBody>(restless).mVelocity.x == 8.0);
+
+  // Enough bodies to be split across the JobSystem's workers all move the
+  // same way.
+  JobSystem::Initialize(3);
+  std::vector<Entity> bodies;
+  for(int i = 0; i < 10001; ++i)
+  {
+    bodies.emplace_back(createBody(Vec3(1.0, 0.0, 0.0), Vec3(), true));
+  }
+  scene.OperateSystems(10.375);
+  scene.OperateSystems(10.375);
+  scene.OperateSystems(10.5);
+  assert(physicsSystem->GetNumAwakeBodies() == 10003);
+  for(const auto& entity : bodies)
+  {
+    assert(scene.GetComponentForEntity<Transform>(entity).mPosition.x == 0.125);
+  }
+  JobSystem::Uninitialize();
+}
+
+/******************************************************************************/
+inline void TestSweepAndPrune()
+{
+  JobSystem::Initialize(3);
+
+  // The sweep should find the same pairs as testing every pair, whether
+  // there are none, one, or enough boxes to be split across the workers.
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<float> position(-60.0, 60.0);
+  std::uniform_real_distribution<float> size(0.0, 4.0);
+
+  SweepAndPrune sweepAndPrune;
+  for(std::size_t count : { 0, 1, 7, 3000 })
+  {
+    sweepAndPrune.Clear();
+    std::vector<AABB> boxes;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+      AABB box;
+      Vec3 corner(position(generator), position(generator) * 0.1f, position(generator) * 0.1f);
+      Expand(box, corner);
+      Expand(box, Vec3(corner.x + size(generator),
+                       corner.y + size(generator),
+                       corner.z + size(generator)));
+      assert(sweepAndPrune.Add(box) == i);
+      boxes.emplace_back(box);
+    }
+    assert(sweepAndPrune.GetSize() == count);
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+    sweepAndPrune.FindPairs(pairs);
+    std::sort(pairs.begin(), pairs.end());
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> expected;
+    for(std::uint32_t i = 0; i < boxes.size(); ++i)
+    {
+      for(std::uint32_t j = i + 1; j < boxes.size(); ++j)
+      {
+        if(Intersects(boxes[i], boxes[j]))
+        {
+          expected.emplace_back(i, j);
+        }
+      }
+    }
+    assert(pairs == expected);
+    assert(count < 3000 || expected.size() > 100);
+  }
+
+  // Boxes that only touch overlap.
+  sweepAndPrune.Clear();
+  AABB left;
+  Expand(left, Vec3(-1.0, -1.0, -1.0));
+  Expand(left, Vec3(0.0, 1.0, 1.0));
+  AABB right;
+  Expand(right, Vec3(0.0, 1.0, 1.0));
+  Expand(right, Vec3(1.0, 2.0, 2.0));
+  sweepAndPrune.Add(right);
+  sweepAndPrune.Add(left);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+  sweepAndPrune.FindPairs(pairs);
+  assert(pairs.size() == 1 && pairs[0].first == 0 && pairs[0].second == 1);
+
+  JobSystem::Uninitialize();
+}
+
+/******************************************************************************/
+inline void TestCollisionSystem()
+{
+  Scene scene;
+  auto system = std::make_unique<TestLeavingCollisionSystem>();
+  auto collisionSystem = system.get();
+  scene.AddSystem(std::move(system));
+
+  // Every event in a frame arrives in a single notification.
+  Observer observer;
+  unsigned int numNotifications = 0;
+  std::vector<CollisionEvent> events;
+  CollisionsDetected.Connect(observer, [&numNotifications, &events](const std::vector<CollisionEvent>& aEvents, Scene& aScene)
+  {
+    ++numNotifications;
+    events = aEvents;
+  });
+
+  auto createCollider = [&scene](ColliderType aType, const Vec3& aPosition, const Quat& aRotation)
+  {
+    auto entity = scene.CreateEntity();
+    Transform transform;
+    transform.mPosition = aPosition;
+    transform.mRotation = aRotation;
+    scene.AddComponentToEntity<Transform>(entity, transform);
+    Collider collider;
+    collider.mType = aType;
+    collider.mHalfExtents = Vec3(1.0, 1.0, 1.0);
+    collider.mRadius = 1.0;
+    scene.AddComponentToEntity<Collider>(entity, collider);
+    return entity;
+  };
+
+  // A sphere touching a box, and a box turned into a diamond next to a box
+  // that overlaps its bounds, but not the diamond itself.
+  auto sphere = createCollider(ColliderType::eSPHERE, Vec3(0.0, 0.0, 0.0), Quat());
+  auto box = createCollider(ColliderType::eBOX, Vec3(1.9, 0.0, 0.0), Quat());
+  auto diamond = createCollider(ColliderType::eORIENTED_BOX, Vec3(10.0, 0.0, 0.0), AxisAngle(Vec3(0.0, 0.0, 1.0), 45.0));
+  auto neighbor = createCollider(ColliderType::eORIENTED_BOX, Vec3(12.4, 1.2, 0.0), Quat());
+
+  // The Entities join the System at the end of the first update.
+  scene.OperateSystems(0);
+  scene.OperateSystems(0);
+  assert(numNotifications == 1);
+  assert(events.size() == 1);
+  assert(events[0].mFirst == sphere && events[0].mSecond == box);
+  assert(events[0].mState == CollisionState::eBEGIN);
+  assert(collisionSystem->AreColliding(box, sphere));
+  assert(!collisionSystem->AreColliding(diamond, neighbor));
+  assert(Metrics::GetGauge("Collision.CandidatePairs").GetValue() == 2);
+
+  scene.OperateSystems(0);
+  assert(numNotifications == 2);
+  assert(events.size() == 1 && events[0].mState == CollisionState::eSTAY);
+  assert(collisionSystem->GetCollisionEvents().size() == 1);
+
+  // Moving the neighbor onto the diamond begins a second collision.
+  scene.GetComponentForEntity<Transform>(neighbor).mPosition = Vec3(12.3, 1.1, 0.0);
+  scene.OperateSystems(0);
+  assert(events.size() == 2);
+  assert(events[0].mFirst == sphere && events[0].mState == CollisionState::eSTAY);
+  assert(events[1].mFirst == diamond && events[1].mSecond == neighbor);
+  assert(events[1].mState == CollisionState::eBEGIN);
+
+  // Moving the box away ends the first.
+  scene.GetComponentForEntity<Transform>(box).mPosition = Vec3(5.0, 0.0, 0.0);
+  scene.OperateSystems(0);
+  assert(events.size() == 2);
+  assert(events[0].mFirst == sphere && events[0].mState == CollisionState::eEND);
+  assert(events[1].mFirst == diamond && events[1].mState == CollisionState::eSTAY);
+  assert(!collisionSystem->AreColliding(sphere, box));
+
+  // Removing an Entity ends its collisions on the next frame.
+  scene.RemoveEntity(neighbor);
+  scene.OperateSystems(0);
+  scene.OperateSystems(0);
+  assert(events.size() == 1 && events[0].mState == CollisionState::eEND);
+  assert(events[0].mFirst == diamond && events[0].mSecond == neighbor);
+
+  // An Entity that leaves the System ends its collisions, even if its ID
+  // is back in the System by the next frame, as when a new Entity reuses
+  // it.
+  scene.GetComponentForEntity<Transform>(box).mPosition = Vec3(1.9, 0.0, 0.0);
+  scene.OperateSystems(0);
+  assert(collisionSystem->AreColliding(sphere, box));
+  collisionSystem->HandleEntityBecameIneligible(box);
+  assert(!collisionSystem->AreColliding(sphere, box));
+  scene.OperateSystems(0);
+  assert(events.size() == 2);
+  assert(events[0].mFirst == sphere && events[0].mSecond == box);
+  assert(events[0].mState == CollisionState::eEND);
+  assert(events[1].mFirst == sphere && events[1].mSecond == box);
+  assert(events[1].mState == CollisionState::eBEGIN);
+  scene.GetComponentForEntity<Transform>(box).mPosition = Vec3(5.0, 0.0, 0.0);
+  scene.OperateSystems(0);
+
+  // Frames without any collisions don't notify anyone.
+  auto lastNotifications = numNotifications;
+  scene.OperateSystems(0);
+  assert(numNotifications == lastNotifications);
+  assert(collisionSystem->GetCollisionEvents().empty());
+}
+
 } // namespace Kuma3D
 
 #endif
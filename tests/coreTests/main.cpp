@@ -34,5 +34,120 @@ int main()
   Kuma3D::TestSignatureRelevancyCheck();
   std::cout << "Signature relevancy check successful!" << std::endl;
 
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing headless game loop..." << std::endl;
+  Kuma3D::TestHeadlessGameLoop();
+  std::cout << "Headless game loop successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing profiler trace export..." << std::endl;
+  Kuma3D::TestProfilerChromeTrace();
+  std::cout << "Profiler trace export successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing profile buffer wrapping..." << std::endl;
+  Kuma3D::TestProfileBufferWrapping();
+  std::cout << "Profile buffer wrapping successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing hitch detection..." << std::endl;
+  Kuma3D::TestHitchDetector();
+  std::cout << "Hitch detection successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing metrics registry..." << std::endl;
+  Kuma3D::TestMetrics();
+  std::cout << "Metrics registry successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing mesh handle reference counting..." << std::endl;
+  Kuma3D::TestMeshHandleReferenceCounting();
+  std::cout << "Mesh handle reference counting successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing free list allocation..." << std::endl;
+  Kuma3D::TestFreeListAllocator();
+  std::cout << "Free list allocation successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing radix sort..." << std::endl;
+  Kuma3D::TestRadixSort();
+  std::cout << "Radix sort successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing render queue ordering..." << std::endl;
+  Kuma3D::TestRenderQueueOrder();
+  std::cout << "Render queue ordering successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing render queue coherent sort..." << std::endl;
+  Kuma3D::TestRenderQueueCoherentSort();
+  std::cout << "Render queue coherent sort successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing uniform IDs..." << std::endl;
+  Kuma3D::TestUniformIDs();
+  std::cout << "Uniform IDs successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing job system parallel for..." << std::endl;
+  Kuma3D::TestJobSystemParallelFor();
+  std::cout << "Job system parallel for successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing frustum culling..." << std::endl;
+  Kuma3D::TestFrustumCulling();
+  std::cout << "Frustum culling successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing occlusion culling..." << std::endl;
+  Kuma3D::TestOcclusionCulling();
+  std::cout << "Occlusion culling successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing dynamic BVH..." << std::endl;
+  Kuma3D::TestDynamicBVH();
+  std::cout << "Dynamic BVH successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing spatial system..." << std::endl;
+  Kuma3D::TestSpatialSystem();
+  std::cout << "Spatial system successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing triangle BVH..." << std::endl;
+  Kuma3D::TestTriangleBVH();
+  std::cout << "Triangle BVH successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing scene raycasts..." << std::endl;
+  Kuma3D::TestSceneRaycast();
+  std::cout << "Scene raycasts successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing scene raycasts after mesh edits..." << std::endl;
+  Kuma3D::TestSceneRaycastMeshEdits();
+  std::cout << "Scene raycasts after mesh edits successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing rigid body integration..." << std::endl;
+  Kuma3D::TestRigidBodyIntegration();
+  std::cout << "Rigid body integration successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing physics system..." << std::endl;
+  Kuma3D::TestPhysicsSystem();
+  std::cout << "Physics system successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing sweep and prune..." << std::endl;
+  Kuma3D::TestSweepAndPrune();
+  std::cout << "Sweep and prune successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing collision system..." << std::endl;
+  Kuma3D::TestCollisionSystem();
+  std::cout << "Collision system successful!" << std::endl;
+
   return 0;
 }
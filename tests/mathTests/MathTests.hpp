@@ -2,11 +2,20 @@
 #define MATHTESTS_HPP
 
 #include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
 
 #include "Mat4.hpp"
+#include "Quat.hpp"
+#include "Simd.hpp"
 #include "Vec3.hpp"
+#include "Vec4.hpp"
 
+#include "BoundsStreams.hpp"
+#include "Geometry.hpp"
 #include "MathUtil.hpp"
+#include "TransformStreams.hpp"
 
 namespace Kuma3D {
 
@@ -77,6 +86,232 @@ inline void TestMat4MultiplicationWithVec3()
   assert(c.z == 770.0);
 }
 
+inline void TestMat4MultiplicationWithVec4()
+{
+  Mat4 a(1.0, 2.0, 3.0, 4.0,
+         5.0, 6.0, 7.0, 8.0,
+         9.0, 10.0, 11.0, 12.0,
+         13.0, 14.0, 15.0, 16.0);
+  Vec4 b(17.0, 22.0, 35.0, 2.0);
+  Vec4 c = a * b;
+
+  assert(c.x == 174.0);
+  assert(c.y == 478.0);
+  assert(c.z == 782.0);
+  assert(c.w == 1086.0);
+}
+
+inline void TestVec4Operations()
+{
+  Vec4 a(1.0, 2.0, 3.0, 4.0);
+  Vec4 b(5.0, 6.0, 7.0, 8.0);
+
+  auto c = (a + b) * 2.0 - a / 0.5;
+  assert(c.x == 10.0);
+  assert(c.y == 12.0);
+  assert(c.z == 14.0);
+  assert(c.w == 16.0);
+  assert(Dot(a, b) == 70.0);
+}
+
+inline void TestMat4Transpose()
+{
+  Mat4 a(1.0, 2.0, 3.0, 4.0,
+         5.0, 6.0, 7.0, 8.0,
+         9.0, 10.0, 11.0, 12.0,
+         13.0, 14.0, 15.0, 16.0);
+  auto b = Transpose(a);
+
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(b(c, r) == a(r, c));
+    }
+  }
+}
+
+inline void TestQuatRotation()
+{
+  // A quaternion rotates a vector the same way as the matrix for the same
+  // axis and angle.
+  Vec3 pos(1.0, 2.0, 3.0);
+  auto axis = Normalize(Vec3(1.0, -2.0, 0.5));
+  auto rotation = AxisAngle(axis, 70.0);
+  auto matrix = Rotate(axis, 70.0);
+
+  auto rotated = rotation * pos;
+  auto expected = matrix * pos;
+  assert(std::abs(rotated.x - expected.x) < 0.0001);
+  assert(std::abs(rotated.y - expected.y) < 0.0001);
+  assert(std::abs(rotated.z - expected.z) < 0.0001);
+
+  auto converted = ToMatrix(rotation);
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(std::abs(converted(c, r) - matrix(c, r)) < 0.0001);
+    }
+  }
+
+  // Rotating by the inverse undoes the rotation.
+  auto restored = Inverse(rotation) * rotated;
+  assert(std::abs(restored.x - pos.x) < 0.0001);
+  assert(std::abs(restored.y - pos.y) < 0.0001);
+  assert(std::abs(restored.z - pos.z) < 0.0001);
+}
+
+inline void TestQuatComposition()
+{
+  // Combining two rotations applies the right-hand one first, the same as
+  // multiplying their matrices.
+  auto a = AxisAngle(Vec3(1.0, 0.0, 0.0), 90.0);
+  auto b = AxisAngle(Vec3(0.0, 1.0, 0.0), 90.0);
+  auto combined = ToMatrix(a * b);
+  auto expected = ToMatrix(a) * ToMatrix(b);
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(std::abs(combined(c, r) - expected(c, r)) < 0.0001);
+    }
+  }
+
+  // Combining many small rotations stays a rotation once normalized.
+  Quat accumulated;
+  auto step = AxisAngle(Normalize(Vec3(1.0, 1.0, 1.0)), 1.0);
+  for(int i = 0; i < 360; ++i)
+  {
+    accumulated = Normalize(step * accumulated);
+  }
+  assert(std::abs(Dot(accumulated, accumulated) - 1.0) < 0.0001);
+  assert(std::abs(std::abs(accumulated.w) - 1.0) < 0.001);
+}
+
+inline void TestQuatMatrixConversion()
+{
+  // Exercise each way of extracting the quaternion from a matrix.
+  Vec3 axes[4] = { Vec3(0.0, 1.0, 0.0),
+                   Vec3(1.0, 0.0, 0.0),
+                   Vec3(0.0, 1.0, 0.0),
+                   Vec3(0.0, 0.0, 1.0) };
+  float angles[4] = { 30.0, 170.0, 170.0, 170.0 };
+  for(int i = 0; i < 4; ++i)
+  {
+    auto expected = AxisAngle(axes[i], angles[i]);
+    auto converted = ToQuat(Rotate(axes[i], angles[i]));
+
+    // A quaternion and its negation are the same rotation.
+    assert(std::abs(std::abs(Dot(converted, expected)) - 1.0) < 0.0001);
+  }
+}
+
+inline void TestQuatInterpolation()
+{
+  Quat start;
+  auto target = AxisAngle(Vec3(0.0, 1.0, 0.0), 90.0);
+
+  // Slerp rotates at a constant speed.
+  auto halfway = Slerp(start, target, 0.5);
+  auto expected = AxisAngle(Vec3(0.0, 1.0, 0.0), 45.0);
+  assert(std::abs(Dot(halfway, expected) - 1.0) < 0.0001);
+
+  auto quarter = Slerp(start, target, 0.25);
+  expected = AxisAngle(Vec3(0.0, 1.0, 0.0), 22.5);
+  assert(std::abs(Dot(quarter, expected) - 1.0) < 0.0001);
+
+  // Both take the shorter path when the target is negated.
+  Quat negated(-target.x, -target.y, -target.z, -target.w);
+  halfway = Slerp(start, negated, 0.5);
+  assert(std::abs(std::abs(Dot(halfway, AxisAngle(Vec3(0.0, 1.0, 0.0), 45.0))) - 1.0) < 0.0001);
+  halfway = Nlerp(start, negated, 0.5);
+  assert(std::abs(std::abs(Dot(halfway, AxisAngle(Vec3(0.0, 1.0, 0.0), 45.0))) - 1.0) < 0.0001);
+
+  // The endpoints are the given rotations.
+  assert(std::abs(Dot(Nlerp(start, target, 0.0), start) - 1.0) < 0.0001);
+  assert(std::abs(Dot(Nlerp(start, target, 1.0), target) - 1.0) < 0.0001);
+}
+
+inline void TestComposeMatrices()
+{
+  // Use a number of objects that isn't a multiple of four, so that some
+  // are built one at a time.
+  TransformStreams streams;
+  streams.Resize(7);
+  std::vector<Mat4> expected;
+  for(int i = 0; i < 7; ++i)
+  {
+    Vec3 position(i, 2.0 * i, -3.0 * i);
+    auto rotation = AxisAngle(Normalize(Vec3(1.0, i, 2.0)), 20.0 * i);
+    Vec3 scale(1.0 + i, 0.5, 2.0);
+    streams.Set(i, position, rotation, scale);
+    expected.emplace_back(Translate(position) * ToMatrix(rotation) * Scale(scale));
+
+    auto composed = ComposeMatrix(position, rotation, scale);
+    for(unsigned int c = 0; c < 4; ++c)
+    {
+      for(unsigned int r = 0; r < 4; ++r)
+      {
+        assert(std::abs(composed(c, r) - expected.back()(c, r)) < 0.00001);
+      }
+    }
+  }
+
+  std::vector<Mat4> matrices(streams.Size());
+  ComposeMatrices(streams, matrices.data());
+  for(std::size_t i = 0; i < matrices.size(); ++i)
+  {
+    for(unsigned int c = 0; c < 4; ++c)
+    {
+      for(unsigned int r = 0; r < 4; ++r)
+      {
+        assert(std::abs(matrices[i](c, r) - expected[i](c, r)) < 0.00001);
+      }
+    }
+  }
+}
+
+inline void TestComposeWorldMatrix()
+{
+  Transform parent;
+  parent.mPosition = Vec3(1.0, 2.0, 3.0);
+  parent.mRotation = AxisAngle(Vec3(0.0, 1.0, 0.0), 90.0);
+
+  Transform child;
+  child.mPosition = Vec3(4.0, 0.0, 0.0);
+  child.mScalar = Vec3(2.0, 2.0, 2.0);
+  child.mParent = 1;
+  auto getTransform = [&parent](Entity aEntity) -> const Transform&
+  {
+    assert(aEntity == 1);
+    return parent;
+  };
+
+  // Without a parent, the world matrix is the Transform's own matrix.
+  auto composed = ComposeWorldMatrix(child, getTransform);
+  auto expected = ComposeMatrix(child);
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(composed(c, r) == expected(c, r));
+    }
+  }
+
+  // With one, the parent's matrix is applied afterward.
+  child.mUseParent = true;
+  composed = ComposeWorldMatrix(child, getTransform);
+  expected = ComposeMatrix(parent) * ComposeMatrix(child);
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(std::abs(composed(c, r) - expected(c, r)) < 0.00001);
+    }
+  }
+}
+
 inline void TestMat4Translation()
 {
   Vec3 pos(1.0, 2.0, 3.0);
@@ -142,6 +377,288 @@ inline void TestLerp()
   assert(Lerp(5.0, 15.0, 0.5) == 10.0);
 }
 
+inline void TestMat4Inverse()
+{
+  auto matrix = Translate(Vec3(1.0, 2.0, 3.0)) *
+                Rotate(Vec3(0.0, 1.0, 0.0), 30.0) *
+                Scale(Vec3(2.0, 4.0, 8.0));
+  auto inverse = Inverse(matrix);
+
+  Vec3 pos(5.0, -3.0, 7.0);
+  auto result = inverse * (matrix * pos);
+  assert(std::abs(result.x - pos.x) < 0.0001);
+  assert(std::abs(result.y - pos.y) < 0.0001);
+  assert(std::abs(result.z - pos.z) < 0.0001);
+
+  // Projection matrices have a bottom row, too.
+  Camera camera;
+  matrix = Perspective(camera) * matrix;
+  auto identity = matrix * Inverse(matrix);
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(std::abs(identity(c, r) - (c == r ? 1.0 : 0.0)) < 0.0001);
+    }
+  }
+
+  // Matrices that can't be inverted give the identity matrix.
+  auto singular = Inverse(Scale(Vec3(1.0, 0.0, 1.0)));
+  for(unsigned int c = 0; c < 4; ++c)
+  {
+    for(unsigned int r = 0; r < 4; ++r)
+    {
+      assert(singular(c, r) == (c == r ? 1.0 : 0.0));
+    }
+  }
+}
+
+inline void TestPlanes()
+{
+  // A plane facing up through (0, 2, 0).
+  auto plane = CreatePlane(Vec3(0.0, 1.0, 0.0), Vec3(5.0, 2.0, -3.0));
+  assert(plane.mDistance == -2.0);
+  assert(GetDistance(plane, Vec3(1.0, 5.0, 1.0)) == 3.0);
+  assert(GetDistance(plane, Vec3(1.0, -1.0, 1.0)) == -3.0);
+
+  // Rays cross the plane from either side, but not when parallel to it or
+  // pointing away from it.
+  Ray ray;
+  ray.mOrigin = Vec3(0.0, 5.0, 0.0);
+  ray.mDirection = Vec3(0.0, -1.0, 0.0);
+  float distance = 0.0;
+  assert(Intersects(ray, plane, 100.0, distance));
+  assert(distance == 3.0);
+  assert(!Intersects(ray, plane, 2.0, distance));
+
+  ray.mOrigin = Vec3(0.0, -1.0, 0.0);
+  assert(!Intersects(ray, plane, 100.0, distance));
+  ray.mDirection = Vec3(0.0, 2.0, 0.0);
+  assert(Intersects(ray, plane, 100.0, distance));
+  assert(distance == 1.5);
+  ray.mDirection = Vec3(1.0, 0.0, 0.0);
+  assert(!Intersects(ray, plane, 100.0, distance));
+}
+
+inline void TestSpheres()
+{
+  AABB box;
+  Expand(box, Vec3(-1.0, -2.0, -2.0));
+  Expand(box, Vec3(1.0, 2.0, 2.0));
+  assert(Contains(box, Vec3(1.0, 0.0, -2.0)));
+  assert(!Contains(box, Vec3(1.5, 0.0, 0.0)));
+
+  auto sphere = GetBoundingSphere(box);
+  assert(sphere.mRadius == 3.0);
+  assert(GetBoundingSphere(AABB()).mRadius == 0.0);
+
+  // Merging puts both spheres inside the result.
+  Sphere a { Vec3(0.0, 0.0, 0.0), 1.0 };
+  Sphere b { Vec3(4.0, 0.0, 0.0), 1.0 };
+  auto merged = Merge(a, b);
+  assert(merged.mCenter.x == 2.0);
+  assert(merged.mRadius == 3.0);
+  Sphere inner { Vec3(0.5, 0.0, 0.0), 0.25 };
+  assert(Merge(a, inner).mRadius == 1.0);
+  assert(Merge(inner, a).mRadius == 1.0);
+
+  // Transforming moves the center and scales the radius by the largest
+  // scale.
+  auto transformed = TransformBounds(Translate(Vec3(1.0, 2.0, 3.0)) * Scale(Vec3(1.0, 3.0, 2.0)), a);
+  assert(transformed.mCenter.x == 1.0 && transformed.mCenter.y == 2.0 && transformed.mCenter.z == 3.0);
+  assert(std::abs(transformed.mRadius - 3.0) < 0.0001);
+
+  assert(Intersects(a, Sphere { Vec3(2.0, 0.0, 0.0), 1.0 }));
+  assert(!Intersects(a, b));
+
+  // A ray hits the near side of a sphere, or starts inside it.
+  Ray ray;
+  ray.mOrigin = Vec3(4.0, 0.0, 5.0);
+  float distance = 0.0;
+  assert(Intersects(ray, b, 100.0, distance));
+  assert(distance == 4.0);
+  assert(!Intersects(ray, b, 3.0, distance));
+  ray.mOrigin = Vec3(4.0, 0.0, -5.0);
+  assert(!Intersects(ray, b, 100.0, distance));
+  ray.mOrigin = Vec3(4.0, 0.5, 0.0);
+  assert(Intersects(ray, b, 100.0, distance));
+  assert(distance == 0.0);
+  ray.mOrigin = Vec3(6.0, 0.0, 5.0);
+  assert(!Intersects(ray, b, 100.0, distance));
+
+  // The identity matrix's frustum is the cube from -1 to 1 on each axis.
+  auto frustum = CalculateFrustum(Mat4());
+  assert(Intersects(frustum, a));
+  assert(!Intersects(frustum, Sphere { Vec3(2.5, 0.0, 0.0), 1.0 }));
+  assert(Intersects(frustum, Sphere { Vec3(1.5, 0.0, 0.0), 1.0 }));
+}
+
+inline void TestOrientedBoxes()
+{
+  AABB unitBox;
+  Expand(unitBox, Vec3(-1.0, -1.0, -1.0));
+  Expand(unitBox, Vec3(1.0, 1.0, 1.0));
+
+  // Turning a box 45 degrees makes a diamond reaching sqrt(2) along x and y.
+  auto diamond = TransformBounds(ToMatrix(AxisAngle(Vec3(0.0, 0.0, 1.0), 45.0)), ToOBB(unitBox));
+  auto bounds = GetBounds(diamond);
+  assert(std::abs(bounds.mMax.x - std::sqrt(2.0)) < 0.0001);
+  assert(std::abs(bounds.mMin.y + std::sqrt(2.0)) < 0.0001);
+  assert(std::abs(bounds.mMax.z - 1.0) < 0.0001);
+
+  auto closest = GetClosestPoint(diamond, Vec3(3.0, 0.0, 0.0));
+  assert(std::abs(closest.x - std::sqrt(2.0)) < 0.0001 && std::abs(closest.y) < 0.0001);
+
+  // Scaling moves into the extents, leaving the axes normalized.
+  auto scaled = TransformBounds(Translate(Vec3(1.0, 2.0, 3.0)) * Scale(Vec3(2.0, 3.0, 4.0)), ToOBB(unitBox));
+  assert(scaled.mCenter.x == 1.0 && scaled.mCenter.y == 2.0 && scaled.mCenter.z == 3.0);
+  assert(scaled.mHalfExtents.x == 2.0 && scaled.mHalfExtents.y == 3.0 && scaled.mHalfExtents.z == 4.0);
+  assert(scaled.mAxes[1].x == 0.0 && scaled.mAxes[1].y == 1.0 && scaled.mAxes[1].z == 0.0);
+
+  // A sphere near the diamond's bounding box can still miss the diamond.
+  assert(Intersects(Sphere { Vec3(1.6, 1.6, 0.0), 0.5 }, bounds));
+  assert(!Intersects(Sphere { Vec3(1.6, 1.6, 0.0), 0.5 }, diamond));
+  assert(Intersects(Sphere { Vec3(1.2, 0.0, 0.0), 0.5 }, diamond));
+  assert(Intersects(Sphere { Vec3(2.0, 0.0, 0.0), 0.6 }, diamond));
+
+  // The same goes for boxes.
+  auto box = ToOBB(unitBox);
+  box.mCenter = Vec3(2.4, 1.2, 0.0);
+  assert(Intersects(bounds, GetBounds(box)));
+  assert(!Intersects(diamond, box));
+  assert(!Intersects(box, diamond));
+  box.mCenter = Vec3(2.3, 1.1, 0.0);
+  assert(Intersects(diamond, box));
+  assert(Intersects(box, diamond));
+
+  // Boxes that aren't separated by any axis should share a point. Checking
+  // points spread through one box catches separating axes being reported
+  // where there are none.
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> unit(-1.0, 1.0);
+  std::uniform_real_distribution<float> angle(0.0, 360.0);
+  auto randomBox = [&]()
+  {
+    Vec3 axis(unit(generator), unit(generator), unit(generator));
+    axis /= std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+    auto matrix = Translate(Vec3(unit(generator) * 2.0f, unit(generator) * 2.0f, unit(generator) * 2.0f)) *
+                  ToMatrix(AxisAngle(axis, angle(generator))) *
+                  Scale(Vec3(0.2f + std::abs(unit(generator)), 0.2f + std::abs(unit(generator)), 0.2f + std::abs(unit(generator))));
+    return TransformBounds(matrix, ToOBB(unitBox));
+  };
+
+  int numOverlapping = 0;
+  for(int i = 0; i < 200; ++i)
+  {
+    auto first = randomBox();
+    auto second = randomBox();
+    auto overlapping = Intersects(first, second);
+    assert(overlapping == Intersects(second, first));
+    numOverlapping += overlapping ? 1 : 0;
+
+    for(int j = 0; j < 500 && !overlapping; ++j)
+    {
+      auto point = first.mCenter +
+                   first.mAxes[0] * (unit(generator) * first.mHalfExtents.x) +
+                   first.mAxes[1] * (unit(generator) * first.mHalfExtents.y) +
+                   first.mAxes[2] * (unit(generator) * first.mHalfExtents.z);
+      auto offset = GetClosestPoint(second, point) - point;
+      assert(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z > 1e-8);
+    }
+  }
+  assert(numOverlapping > 0 && numOverlapping < 200);
+}
+
+inline void TestBatchedFrustumTests()
+{
+  // The batched tests should agree with testing one at a time, including
+  // for the boxes and spheres in the last, partly filled group of four.
+  auto frustum = CalculateFrustum(Perspective(Camera()) * Translate(Vec3(0.0, 0.0, -20.0)));
+
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> position(-40.0, 40.0);
+  std::uniform_real_distribution<float> size(0.0, 4.0);
+
+  BoxStreams boxes;
+  SphereStreams spheres;
+  std::vector<AABB> boxList;
+  std::vector<Sphere> sphereList;
+  for(int i = 0; i < 1003; ++i)
+  {
+    AABB box;
+    Vec3 corner(position(generator), position(generator), position(generator));
+    Expand(box, corner);
+    Expand(box, Vec3(corner.x + size(generator),
+                     corner.y + size(generator),
+                     corner.z + size(generator)));
+    assert(boxes.Add(box) == boxList.size());
+    boxList.emplace_back(box);
+
+    Sphere sphere { corner, size(generator) };
+    assert(spheres.Add(sphere) == sphereList.size());
+    sphereList.emplace_back(sphere);
+  }
+  assert(boxes.Size() == 1003 && spheres.Size() == 1003);
+  assert(boxes.mCenterX.size() == 1004 && spheres.mCenterX.size() == 1004);
+
+  std::vector<unsigned char> boxResults(boxes.mCenterX.size());
+  std::vector<unsigned char> sphereResults(spheres.mCenterX.size());
+  Intersects(frustum, boxes, 0, boxes.Size(), boxResults.data());
+  Intersects(frustum, spheres, 0, spheres.Size(), sphereResults.data());
+
+  std::size_t numInside = 0;
+  for(std::size_t i = 0; i < boxList.size(); ++i)
+  {
+    assert(boxResults[i] == (Intersects(frustum, boxList[i]) ? 1 : 0));
+    assert(sphereResults[i] == (Intersects(frustum, sphereList[i]) ? 1 : 0));
+    numInside += boxResults[i];
+  }
+  assert(numInside > 0 && numInside < boxList.size());
+}
+
+inline void TestScreenPointToRay()
+{
+  Camera camera;
+  camera.mViewportX = 800.0;
+  camera.mViewportY = 600.0;
+  Transform transform;
+  transform.mPosition = Vec3(0.0, 0.0, 10.0);
+
+  // The center of the screen looks straight ahead.
+  auto ray = ScreenPointToRay(camera, transform, 400.0, 300.0, 800.0, 600.0);
+  assert(std::abs(ray.mOrigin.x) < 0.0001);
+  assert(std::abs(ray.mOrigin.y) < 0.0001);
+  assert(std::abs(ray.mOrigin.z - (10.0 - camera.mNearPlane)) < 0.0001);
+  assert(std::abs(ray.mDirection.z + 1.0) < 0.0001);
+
+  // Points above and to the right of the center look up and to the right.
+  ray = ScreenPointToRay(camera, transform, 600.0, 100.0, 800.0, 600.0);
+  assert(ray.mDirection.x > 0.0);
+  assert(ray.mDirection.y > 0.0);
+  assert(ray.mDirection.z < 0.0);
+}
+
+inline void TestSimdMinMax()
+{
+  // Every backend should pick the second value wherever either is NaN,
+  // the same way SSE does.
+  auto nan = std::nanf("");
+  float lhsValues[4] = { 1.0f, 4.0f, nan, 2.0f };
+  float rhsValues[4] = { 3.0f, 2.0f, 5.0f, nan };
+  auto lhs = LoadFloat4(lhsValues);
+  auto rhs = LoadFloat4(rhsValues);
+
+  float minValues[4];
+  float maxValues[4];
+  StoreFloat4(minValues, Min(lhs, rhs));
+  StoreFloat4(maxValues, Max(lhs, rhs));
+
+  assert(minValues[0] == 1.0f && minValues[1] == 2.0f);
+  assert(maxValues[0] == 3.0f && maxValues[1] == 4.0f);
+  assert(minValues[2] == 5.0f && maxValues[2] == 5.0f);
+  assert(std::isnan(minValues[3]) && std::isnan(maxValues[3]));
+}
+
 } // namespace Kuma3D
 
 #endif
@@ -24,6 +24,51 @@ int main()
   Kuma3D::TestMat4MultiplicationWithVec3();
   std::cout << "Mat4 multiplication with Vec3 successful!" << std::endl;
 
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Mat4 multiplication with Vec4..." << std::endl;
+  Kuma3D::TestMat4MultiplicationWithVec4();
+  std::cout << "Mat4 multiplication with Vec4 successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Vec4 operations..." << std::endl;
+  Kuma3D::TestVec4Operations();
+  std::cout << "Vec4 operations successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Mat4 transpose..." << std::endl;
+  Kuma3D::TestMat4Transpose();
+  std::cout << "Mat4 transpose successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Quat rotation..." << std::endl;
+  Kuma3D::TestQuatRotation();
+  std::cout << "Quat rotation successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Quat composition..." << std::endl;
+  Kuma3D::TestQuatComposition();
+  std::cout << "Quat composition successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Quat matrix conversion..." << std::endl;
+  Kuma3D::TestQuatMatrixConversion();
+  std::cout << "Quat matrix conversion successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Quat interpolation..." << std::endl;
+  Kuma3D::TestQuatInterpolation();
+  std::cout << "Quat interpolation successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing matrix composition..." << std::endl;
+  Kuma3D::TestComposeMatrices();
+  std::cout << "Matrix composition successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing world matrix composition..." << std::endl;
+  Kuma3D::TestComposeWorldMatrix();
+  std::cout << "World matrix composition successful!" << std::endl;
+
   std::cout << "-------------------------------------" << std::endl;
   std::cout << "Testing Mat4 translation..." << std::endl;
   Kuma3D::TestMat4Translation();
@@ -44,5 +89,40 @@ int main()
   Kuma3D::TestLerp();
   std::cout << "Linear interpolation successful!" << std::endl;
 
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing Mat4 inverse..." << std::endl;
+  Kuma3D::TestMat4Inverse();
+  std::cout << "Mat4 inverse successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing planes..." << std::endl;
+  Kuma3D::TestPlanes();
+  std::cout << "Planes successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing spheres..." << std::endl;
+  Kuma3D::TestSpheres();
+  std::cout << "Spheres successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing oriented boxes..." << std::endl;
+  Kuma3D::TestOrientedBoxes();
+  std::cout << "Oriented boxes successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing batched frustum tests..." << std::endl;
+  Kuma3D::TestBatchedFrustumTests();
+  std::cout << "Batched frustum tests successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing screen point to ray..." << std::endl;
+  Kuma3D::TestScreenPointToRay();
+  std::cout << "Screen point to ray successful!" << std::endl;
+
+  std::cout << "-------------------------------------" << std::endl;
+  std::cout << "Testing SIMD min and max..." << std::endl;
+  Kuma3D::TestSimdMinMax();
+  std::cout << "SIMD min and max successful!" << std::endl;
+
   return 0;
 }